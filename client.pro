@@ -8,6 +8,12 @@ include(qmake_conf/macx.pro)
 include(qmake_conf/bsd.pro)
 #include(qmake_conf/windows.pro)
 
+# The database engine: "qmake CONFIG+=sqlite" builds the SQLite backend
+sqlite {
+	DEFINES	+= USE_SQLITE
+	LIBS	+= -lsqlite3
+}
+
 INCLUDEPATH	+= include \
 	src/gen-cpp
 
@@ -15,12 +21,17 @@ SOURCES += \
 	src/convertions.cpp \
 	src/cfg.cpp \
 	src/database.cpp \
+	src/dependency_graph.cpp \
 	src/domain.cpp \
+	src/memory_database.cpp \
 	src/job.cpp \
+	src/name_table.cpp \
 	src/node.cpp \
 	src/router.cpp \
 	src/rpc_client.cpp \
 	src/rpc_server.cpp \
+	src/sql_database.cpp \
+	src/timing_wheel.cpp \
 	src/gen-cpp/model_constants.cpp \
 	src/gen-cpp/model_types.cpp \
 	src/gen-cpp/ows_rpc.cpp \
@@ -30,12 +41,17 @@ HEADERS	+= include/common.h \
 	include/convertions.h \
 	include/cfg.h \
 	include/database.h \
+	include/dependency_graph.h \
 	include/domain.h \
+	include/memory_database.h \
 	include/job.h \
+	include/name_table.h \
 	include/node.h \
 	include/router.h \
 	include/rpc_client.h \
 	include/rpc_server.h \
+	include/sql_database.h \
+	include/timing_wheel.h \
 	src/gen-cpp/model_constants.h \
 	src/gen-cpp/model_types.h \
 	src/gen-cpp/ows_rpc.h
@@ -10,9 +10,11 @@ SET sql_notes = 0;
 -- -----------------------------------------------------
 
 CREATE TABLE IF NOT EXISTS `node` (
+	`node_id` INT(11) NOT NULL ,
 	`node_name` VARCHAR(45) NOT NULL ,
 	`node_weight` INT(11) NOT NULL DEFAULT '0' ,
-	PRIMARY KEY (`node_name`)
+	PRIMARY KEY (`node_id`) ,
+	UNIQUE INDEX `uq_node_name` (`node_name` ASC)
 )
 ENGINE = InnoDB
 DEFAULT CHARACTER SET = latin1;
@@ -26,6 +28,7 @@ CREATE TABLE IF NOT EXISTS `recovery_type` (
 	`rectype_short_label` VARCHAR(45) NOT NULL ,
 	`rectype_label` VARCHAR(45) NOT NULL ,
 	`rectype_action` ENUM('restart','stop_schedule') NOT NULL ,
+	`rectype_timeout` BIGINT NULL DEFAULT NULL ,
 	PRIMARY KEY (`rectype_id`)
 )
 ENGINE = InnoDB
@@ -49,25 +52,36 @@ COMMENT = '\'This is an abstract object' ;
 -- -----------------------------------------------------
 -- Table `job`
 -- job_macro_job_id should be NOT NULL
+-- The jobs' and the nodes' ids are given by the server (see Name_Table)
 -- -----------------------------------------------------
 
 CREATE TABLE IF NOT EXISTS `job` (
+	`job_id` INT(11) NOT NULL ,
 	`job_name` VARCHAR(45) NOT NULL ,
 	`job_cmd_line` VARCHAR(45) NOT NULL ,
-	`job_node_name` VARCHAR(45) NOT NULL ,
+	`job_node_id` INT(11) NOT NULL ,
 	`job_weight` INT(11) NOT NULL DEFAULT '1' ,
+	`job_timeout` BIGINT NULL DEFAULT NULL ,
 	`job_start_time` DATETIME ,
 	`job_stop_time` DATETIME ,
+	`job_stdout_bytes` BIGINT NULL DEFAULT NULL ,
+	`job_stderr_bytes` BIGINT NULL DEFAULT NULL ,
+	`job_cpu_usage` BIGINT NULL DEFAULT NULL ,
+	`job_memory_peak` BIGINT NULL DEFAULT NULL ,
+	`job_io_read_bytes` BIGINT NULL DEFAULT NULL ,
+	`job_io_write_bytes` BIGINT NULL DEFAULT NULL ,
 	`job_state` ENUM('waiting','running','succeded','failed') NULL DEFAULT 'waiting' ,
+	`job_failure` ENUM('return_code','spawn','timeout') NULL DEFAULT NULL ,
 	`job_rectype_id` INT(11) NULL DEFAULT NULL ,
 	`job_macro_job_id` INT(11) ,
-	PRIMARY KEY (`job_name`) ,
-	INDEX `fk_job_node` (`job_node_name` ASC) ,
+	PRIMARY KEY (`job_id`) ,
+	UNIQUE INDEX `uq_job_name` (`job_name` ASC) ,
+	INDEX `fk_job_node` (`job_node_id` ASC) ,
 	INDEX `fk_rectype_id` (`job_rectype_id` ASC) ,
 	INDEX `fk_job_macro_job1` (`job_macro_job_id` ASC) ,
 	CONSTRAINT `fk_job_node`
-		FOREIGN KEY (`job_node_name` )
-		REFERENCES `node` (`node_name` )
+		FOREIGN KEY (`job_node_id` )
+		REFERENCES `node` (`node_id` )
 		ON DELETE NO ACTION
 		ON UPDATE NO ACTION,
 	CONSTRAINT `fk_rectype_id`
@@ -82,7 +96,6 @@ CREATE TABLE IF NOT EXISTS `job` (
 		ON UPDATE NO ACTION
 )
 ENGINE = InnoDB
-AUTO_INCREMENT = 5
 DEFAULT CHARACTER SET = latin1;
 
 -- -----------------------------------------------------
@@ -91,14 +104,14 @@ DEFAULT CHARACTER SET = latin1;
 
 CREATE TABLE IF NOT EXISTS `resource` (
 	`resource_name` VARCHAR(45) NOT NULL ,
-	`resource_node_name` VARCHAR(11) NOT NULL ,
+	`resource_node_id` INT(11) NOT NULL ,
 	`resource_current_value` INT(11) NOT NULL ,
 	`resource_initial_value` INT(11) NOT NULL ,
-	INDEX `fk_resource_node` (`resource_node_name` ASC) ,
-	PRIMARY KEY (`resource_name`, `resource_node_name`) ,
+	INDEX `fk_resource_node` (`resource_node_id` ASC) ,
+	PRIMARY KEY (`resource_name`, `resource_node_id`) ,
 	CONSTRAINT `fk_resource_node`
-		FOREIGN KEY (`resource_node_name` )
-		REFERENCES `node` (`node_name` )
+		FOREIGN KEY (`resource_node_id` )
+		REFERENCES `node` (`node_id` )
 		ON DELETE NO ACTION
 		ON UPDATE NO ACTION
 )
@@ -112,12 +125,12 @@ DEFAULT CHARACTER SET = latin1;
 CREATE TABLE IF NOT EXISTS `time_constraint` (
 	`time_c_type` ENUM('at','before','after') NOT NULL ,
 	`time_c_value` TIME NOT NULL ,
-	`time_c_job_name` VARCHAR(45) NOT NULL ,
-	PRIMARY KEY (`time_c_type`, `time_c_job_name`) ,
-	INDEX `fk_time_constraint_job1` (`time_c_job_name` ASC) ,
+	`time_c_job_id` INT(11) NOT NULL ,
+	PRIMARY KEY (`time_c_type`, `time_c_job_id`) ,
+	INDEX `fk_time_constraint_job1` (`time_c_job_id` ASC) ,
 	CONSTRAINT `fk_time_constraint_job1`
-		FOREIGN KEY (`time_c_job_name` )
-		REFERENCES `job` (`job_name` )
+		FOREIGN KEY (`time_c_job_id` )
+		REFERENCES `job` (`job_id` )
 		ON DELETE NO ACTION
 		ON UPDATE NO ACTION
 )
@@ -129,19 +142,19 @@ DEFAULT CHARACTER SET = latin1;
 -- -----------------------------------------------------
 
 CREATE TABLE IF NOT EXISTS `jobs_link` (
-	`job_name_prv` VARCHAR(45) NOT NULL ,
-	`job_name_nxt` VARCHAR(45) NOT NULL ,
-	PRIMARY KEY (`job_name_prv`, `job_name_nxt`) ,
-	INDEX `fk_job_has_job_job2` (`job_name_nxt` ASC) ,
-	INDEX `fk_job_has_job_job1` (`job_name_prv` ASC) ,
+	`job_id_prv` INT(11) NOT NULL ,
+	`job_id_nxt` INT(11) NOT NULL ,
+	PRIMARY KEY (`job_id_prv`, `job_id_nxt`) ,
+	INDEX `fk_job_has_job_job2` (`job_id_nxt` ASC) ,
+	INDEX `fk_job_has_job_job1` (`job_id_prv` ASC) ,
 	CONSTRAINT `fk_job_has_job_job1`
-		FOREIGN KEY (`job_name_prv` )
-		REFERENCES `job` (`job_name` )
+		FOREIGN KEY (`job_id_prv` )
+		REFERENCES `job` (`job_id` )
 		ON DELETE NO ACTION
 		ON UPDATE NO ACTION,
 	CONSTRAINT `fk_job_has_job_job2`
-		FOREIGN KEY (`job_name_nxt` )
-		REFERENCES `job` (`job_name` )
+		FOREIGN KEY (`job_id_nxt` )
+		REFERENCES `job` (`job_id` )
 		ON DELETE NO ACTION
 		ON UPDATE NO ACTION
 )
@@ -151,27 +164,27 @@ DEFAULT CHARACTER SET = latin1;
 -- -----------------------------------------------------
 -- Placeholder table for view `get_ready_job`
 -- -----------------------------------------------------
-CREATE TABLE IF NOT EXISTS `get_ready_job` (`job_name` VARCHAR(45), `job_cmd_line` INT, `job_node_name` INT, `job_weight` INT, `job_state` INT, `job_rectype_id` INT);
+CREATE TABLE IF NOT EXISTS `get_ready_job` (`job_id` INT, `job_name` VARCHAR(45), `job_cmd_line` INT, `job_node_id` INT, `job_weight` INT, `job_state` INT, `job_rectype_id` INT);
 
 -- -----------------------------------------------------
 -- Placeholder table for view `get_ready_time`
 -- -----------------------------------------------------
-CREATE TABLE IF NOT EXISTS `get_ready_time` (`job_name` VARCHAR(45));
+CREATE TABLE IF NOT EXISTS `get_ready_time` (`job_id` INT);
 
 -- -----------------------------------------------------
 -- Placeholder table for view `get_ready_links`
 -- -----------------------------------------------------
-CREATE TABLE IF NOT EXISTS `get_ready_links` (`job_name` VARCHAR(45));
+CREATE TABLE IF NOT EXISTS `get_ready_links` (`job_id` INT);
 
 -- -----------------------------------------------------
 -- Placeholder table for view `get_ready_linkless`
 -- -----------------------------------------------------
-CREATE TABLE IF NOT EXISTS `get_ready_linkless` (`job_name` VARCHAR(45));
+CREATE TABLE IF NOT EXISTS `get_ready_linkless` (`job_id` INT);
 
 -- -----------------------------------------------------
 -- Placeholder table for view `get_available_resource`
 -- -----------------------------------------------------
-CREATE TABLE IF NOT EXISTS `get_available_resource` (`resource_id` INT, `resource_name` INT, `resource_node_name` INT, `resource_value` INT);
+CREATE TABLE IF NOT EXISTS `get_available_resource` (`resource_id` INT, `resource_name` INT, `resource_node_id` INT, `resource_value` INT);
 
 -- -----------------------------------------------------
 -- View `get_ready_job`
@@ -180,14 +193,14 @@ DROP VIEW IF EXISTS `get_ready_job` ;
 DROP TABLE IF EXISTS `get_ready_job`;
 
 CREATE OR REPLACE ALGORITHM=UNDEFINED
-	VIEW `get_ready_job` AS select `j`.`job_name` AS `job_name`,`j`.`job_cmd_line` AS `job_cmd_line`,`j`.`job_node_name` AS `job_node_name`,`j`.`job_weight` AS `job_weight`,`j`.`job_state` AS `job_state`,`j`.`job_rectype_id` AS `job_rectype_id` from `job` `j`
+	VIEW `get_ready_job` AS select `j`.`job_id` AS `job_id`,`j`.`job_name` AS `job_name`,`j`.`job_cmd_line` AS `job_cmd_line`,`j`.`job_node_id` AS `job_node_id`,`j`.`job_weight` AS `job_weight`,`j`.`job_state` AS `job_state`,`j`.`job_rectype_id` AS `job_rectype_id` from `job` `j`
 	where (
 			(
-			 `j`.`job_name` in (select `get_ready_links`.`job_name` AS `job_name` from `get_ready_links`)
+			 `j`.`job_id` in (select `get_ready_links`.`job_id` AS `job_id` from `get_ready_links`)
 			 xor
-			 `j`.`job_name` in (select `get_ready_linkless`.`job_name` AS `job_name` from `get_ready_linkless`)
+			 `j`.`job_id` in (select `get_ready_linkless`.`job_id` AS `job_id` from `get_ready_linkless`)
 			)
-			and `j`.`job_name` in (select `j`.`job_name` AS `job_name` from `get_ready_time`)
+			and `j`.`job_id` in (select `get_ready_time`.`job_id` AS `job_id` from `get_ready_time`)
 	      )
 	;
 
@@ -198,13 +211,13 @@ DROP VIEW IF EXISTS `get_ready_time` ;
 DROP TABLE IF EXISTS `get_ready_time`;
 
 CREATE OR REPLACE ALGORITHM=UNDEFINED
-	VIEW `get_ready_time` AS select job_name from job j
+	VIEW `get_ready_time` AS select job_id from job j
 	where
-	j.job_name not in (select time_c_job_name from time_constraint)
+	j.job_id not in (select time_c_job_id from time_constraint)
 	xor (
-			j.job_name in (select time_c_job_name from time_constraint where (time_c_type = 'at' and time_format(time_c_value,'%H %i') = time_format(now(),'%H %i')))
-			or j.job_name in (select time_c_job_name from time_constraint where (time_c_type = 'before' and time_format(time_c_value,'%H %i') >= time_format(now(),'%H %i')))
-			or j.job_name in (select time_c_job_name from time_constraint where (time_c_type = 'after' and time_format(time_c_value,'%H %i') <= time_format(now(),'%H %i')))
+			j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'at' and time_format(time_c_value,'%H %i') = time_format(now(),'%H %i')))
+			or j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'before' and time_format(time_c_value,'%H %i') >= time_format(now(),'%H %i')))
+			or j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'after' and time_format(time_c_value,'%H %i') <= time_format(now(),'%H %i')))
 	    )
 	;
 
@@ -215,7 +228,7 @@ DROP VIEW IF EXISTS `get_ready_links` ;
 DROP TABLE IF EXISTS `get_ready_links`;
 
 CREATE OR REPLACE ALGORITHM=UNDEFINED
-	VIEW `get_ready_links` AS select distinct `jl`.`job_name_nxt` AS `job_name` from (`jobs_link` `jl` join `job` `j`) where (`jl`.`job_name_prv` = `j`.`job_name`) and (`j`.`job_state` = 'succeded');
+	VIEW `get_ready_links` AS select distinct `jl`.`job_id_nxt` AS `job_id` from (`jobs_link` `jl` join `job` `j`) where (`jl`.`job_id_prv` = `j`.`job_id`) and (`j`.`job_state` = 'succeded');
 
 -- -----------------------------------------------------
 -- View `get_ready_linkless`
@@ -224,7 +237,7 @@ DROP VIEW IF EXISTS `get_ready_linkless` ;
 DROP TABLE IF EXISTS `get_ready_linkless`;
 
 CREATE OR REPLACE ALGORITHM=UNDEFINED
-	VIEW `get_ready_linkless` AS SELECT `job_name` FROM `job` WHERE `job_state` = 'waiting' AND `job_name` NOT IN ( SELECT `job_name_nxt` FROM `jobs_link` );
+	VIEW `get_ready_linkless` AS SELECT `job_id` FROM `job` WHERE `job_state` = 'waiting' AND `job_id` NOT IN ( SELECT `job_id_nxt` FROM `jobs_link` );
 
 -- -----------------------------------------------------
 -- View `get_available_resource`
@@ -233,7 +246,7 @@ DROP VIEW IF EXISTS `get_available_resource` ;
 DROP TABLE IF EXISTS `get_available_resource`;
 
 CREATE OR REPLACE ALGORITHM=UNDEFINED
-	VIEW `get_available_resource` AS select `resource`.`resource_name` AS `resource_name`,`resource`.`resource_node_name` AS `resource_node_name`,`resource`.`resource_current_value` AS `resource_current_value` from `resource` where (`resource`.`resource_current_value` > 0);
+	VIEW `get_available_resource` AS select `resource`.`resource_name` AS `resource_name`,`resource`.`resource_node_id` AS `resource_node_id`,`resource`.`resource_current_value` AS `resource_current_value` from `resource` where (`resource`.`resource_current_value` > 0);
 
 -- We re activate the warnings
 SET sql_notes = 1;
@@ -1,140 +1,155 @@
-CREATE TABLE IF NOT EXISTS  node (
-  node_name text NOT NULL ,
-  node_weight integer NOT NULL DEFAULT '0' ,
-  PRIMARY KEY (node_name)
+-- -----------------------------------------------------
+-- The SQLite version of etc/mysql/skeleton.sql
+-- Each planning is stored in its own file
+-- The timestamps are UNIX timestamps, the times of the day are 'HH:MM:SS'
+-- strings (see SEC_TO_TIME and TIME_TO_SEC)
+-- -----------------------------------------------------
+
+-- -----------------------------------------------------
+-- Table `node`
+-- -----------------------------------------------------
+
+CREATE TABLE IF NOT EXISTS node (
+	node_id INTEGER PRIMARY KEY ,
+	node_name TEXT NOT NULL UNIQUE ,
+	node_weight INTEGER NOT NULL DEFAULT 0
 );
 
-CREATE TABLE IF NOT EXISTS  recovery_type (
-  rectype_id integer primary key AUTOINCREMENT ,
-  rectype_short_label text NOT NULL ,
-  rectype_label text NOT NULL ,
-  rectype_action integer DEFAULT NULL 
+-- -----------------------------------------------------
+-- Table `recovery_type`
+-- Deals with what to do after the end of a failed job
+-- -----------------------------------------------------
+
+CREATE TABLE IF NOT EXISTS recovery_type (
+	rectype_id INTEGER PRIMARY KEY AUTOINCREMENT ,
+	rectype_short_label TEXT NOT NULL ,
+	rectype_label TEXT NOT NULL ,
+	rectype_action TEXT NOT NULL CHECK (rectype_action IN ('restart','stop_schedule')) ,
+	rectype_timeout INTEGER DEFAULT NULL
 );
 
-CREATE TABLE IF NOT EXISTS  job (
-  job_id integer primary key AUTOINCREMENT ,
-  job_name text NOT NULL ,
-  job_cmd_line text NOT NULL ,
-  job_weight integer NOT NULL DEFAULT '1' ,
-  job_state integer DEFAULT '0' ,
-    job_node_name 
-    REFERENCES node (node_name ),
-    job_rectype_id 
-    REFERENCES recovery_type (rectype_id )
-);
-CREATE INDEX IF NOT EXISTS fk_job_node on  job (job_node_name ASC);
-CREATE INDEX IF NOT EXISTS fk_rectype_id on job (job_rectype_id ASC);
-
-CREATE TABLE IF NOT EXISTS  jobs_link (
-  idjobs_link integer primary key AUTOINCREMENT ,
-    job_next 
-    REFERENCES job (job_id ),
-    job_prev 
-    REFERENCES job (job_id )
-);
-CREATE INDEX IF NOT EXISTS fk_job_prev on jobs_link (job_prev ASC);
-CREATE INDEX IF NOT EXISTS fk_job_next on jobs_link (job_next ASC);
+-- -----------------------------------------------------
+-- Table `macro_job`
+-- This is an abstract object
+-- -----------------------------------------------------
 
+CREATE TABLE IF NOT EXISTS macro_job (
+	macro_id INTEGER PRIMARY KEY AUTOINCREMENT ,
+	macro_name TEXT NOT NULL
+);
 
-CREATE TABLE IF NOT EXISTS  resource (
-  resource_id integer primary key AUTOINCREMENT,
-  resource_name text NOT NULL ,
-  resource_value integer NOT NULL ,
-    resource_node_name 
-    REFERENCES node (node_name )
+-- -----------------------------------------------------
+-- Table `job`
+-- job_macro_job_id should be NOT NULL
+-- The jobs' and the nodes' ids are given by the server (see Name_Table)
+-- -----------------------------------------------------
+
+CREATE TABLE IF NOT EXISTS job (
+	job_id INTEGER PRIMARY KEY ,
+	job_name TEXT NOT NULL UNIQUE ,
+	job_cmd_line TEXT NOT NULL ,
+	job_node_id INTEGER NOT NULL REFERENCES node (node_id) ,
+	job_weight INTEGER NOT NULL DEFAULT 1 ,
+	job_timeout INTEGER DEFAULT NULL ,
+	job_start_time INTEGER ,
+	job_stop_time INTEGER ,
+	job_stdout_bytes INTEGER DEFAULT NULL ,
+	job_stderr_bytes INTEGER DEFAULT NULL ,
+	job_cpu_usage INTEGER DEFAULT NULL ,
+	job_memory_peak INTEGER DEFAULT NULL ,
+	job_io_read_bytes INTEGER DEFAULT NULL ,
+	job_io_write_bytes INTEGER DEFAULT NULL ,
+	job_state TEXT DEFAULT 'waiting' CHECK (job_state IN ('waiting','running','succeded','failed')) ,
+	job_failure TEXT DEFAULT NULL CHECK (job_failure IN ('return_code','spawn','timeout')) ,
+	job_rectype_id INTEGER DEFAULT NULL REFERENCES recovery_type (rectype_id) ,
+	job_macro_job_id INTEGER REFERENCES macro_job (macro_id)
+);
+CREATE INDEX IF NOT EXISTS fk_job_node ON job (job_node_id ASC);
+CREATE INDEX IF NOT EXISTS fk_rectype_id ON job (job_rectype_id ASC);
+CREATE INDEX IF NOT EXISTS fk_job_macro_job1 ON job (job_macro_job_id ASC);
+
+-- -----------------------------------------------------
+-- Table `resource`
+-- -----------------------------------------------------
+
+CREATE TABLE IF NOT EXISTS resource (
+	resource_name TEXT NOT NULL ,
+	resource_node_id INTEGER NOT NULL REFERENCES node (node_id) ,
+	resource_current_value INTEGER NOT NULL ,
+	resource_initial_value INTEGER NOT NULL ,
+	PRIMARY KEY (resource_name, resource_node_id)
 );
-  CREATE INDEX IF NOT EXISTS fk_resource_node on resource (resource_node_name ASC);
+CREATE INDEX IF NOT EXISTS fk_resource_node ON resource (resource_node_id ASC);
 
+-- -----------------------------------------------------
+-- Table `time_constraint`
+-- -----------------------------------------------------
 
-CREATE TABLE IF NOT EXISTS  time_constraint (
-  time_c_type integer NOT NULL ,
-  time_c_value text NOT NULL ,
-    time_c_job_id 
-    REFERENCES job (job_id ),
-  PRIMARY KEY (time_c_type, time_c_job_id) 
+CREATE TABLE IF NOT EXISTS time_constraint (
+	time_c_type TEXT NOT NULL CHECK (time_c_type IN ('at','before','after')) ,
+	time_c_value TEXT NOT NULL ,
+	time_c_job_id INTEGER NOT NULL REFERENCES job (job_id) ,
+	PRIMARY KEY (time_c_type, time_c_job_id)
 );
-CREATE INDEX IF NOT EXISTS id_job on time_constraint (time_c_job_id ASC) ;
+CREATE INDEX IF NOT EXISTS fk_time_constraint_job1 ON time_constraint (time_c_job_id ASC);
 
-CREATE TABLE IF NOT EXISTS schedule_job (
-sched_name text not null,
-sched_id references job(job_id),
-primary key (sched_id)
-);
+-- -----------------------------------------------------
+-- Table `jobs_link`
+-- -----------------------------------------------------
 
-CREATE INDEX IF NOT EXISTS fk_schedule_id on schedule_job  (sched_id ASC) ;
-
-
-CREATE VIEW IF NOT EXISTS get_ready_time AS
-select job_id from job j
-where
-	j.job_id not in (
-		(select time_c_job_id from time_constraint)
-		and not (
-			j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'at' and strftime('%H %i', time_c_value) = strftime( '%H %i', 'now')))
-			or j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'before' and strftime('%H %i', time_c_value) >= strftime( '%H %i', 'now')))
-			or j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'after' and strftime('%H %i', time_c_value) <= strftime( '%H %i', 'now')))
-		)
-		or
-		not (select time_c_job_id from time_constraint)
-		and
-		(
-			j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'at' and strftime('%H %i', time_c_value) = strftime( '%H %i', 'now')))
-			or j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'before' and strftime('%H %i', time_c_value) >= strftime( '%H %i', 'now')))
-			or j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'after' and strftime('%H %i', time_c_value) <= strftime( '%H %i', 'now')))
-		)
-
-	);
-
-
---CREATE VIEW IF NOT EXISTS get_ready_time AS
---select job_id from job j
---where
---	j.job_id not in (
---		(select time_c_job_id from time_constraint)
---   		and not 
---		(
---    			j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'at' and strftime('%H %i', time_c_value) = strftime( '%H %i', 'now')))
---    			or j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'before' and strftime('%H %i', time_c_value) >= strftime( '%H %i', 'now')))
---    			or j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'after' and strftime('%H %i', time_c_value) <= strftime( '%H %i', 'now')))
---		)
---		or
---		not (select time_c_job_id from time_constraint)
---		and
---		(
---    			j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'at' and strftime('%H %i', time_c_value) = strftime( '%H %i', 'now')))
---    			or j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'before' and strftime('%H %i', time_c_value) >= strftime( '%H %i', 'now')))
---    			or j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'after' and strftime('%H %i', time_c_value) <= strftime( '%H %i', 'now')))
---		)
---
---	);
-
-
-CREATE VIEW IF NOT EXISTS get_ready_links AS select distinct jl.job_next AS job_id from (jobs_link jl join job j) where (jl.job_prev = j.job_id) and (j.job_state = 'succeded');
-
-CREATE VIEW IF NOT EXISTS get_ready_linkless AS SELECT job_id FROM job WHERE job_state = 'waiting' AND job_id NOT IN ( SELECT job_next FROM jobs_link );
-
-CREATE VIEW IF NOT EXISTS get_available_resource AS select resource.resource_id AS resource_id,resource.resource_name AS resource_name,resource.resource_node_name AS resource_node_name,resource.resource_value AS resource_value from resource where (resource.resource_value > 0);
-
-CREATE VIEW IF NOT EXISTS get_ready_job AS
-	select	j.job_id AS job_id,
-		j.job_name AS job_name,
-		j.job_cmd_line AS job_cmd_line,
-		j.job_node_name AS job_node_name,
-		j.job_weight AS job_weight,
-		j.job_state AS job_state,
-		j.job_rectype_id AS job_rectype_id
-	from job j
+CREATE TABLE IF NOT EXISTS jobs_link (
+	job_id_prv INTEGER NOT NULL REFERENCES job (job_id) ,
+	job_id_nxt INTEGER NOT NULL REFERENCES job (job_id) ,
+	PRIMARY KEY (job_id_prv, job_id_nxt)
+);
+CREATE INDEX IF NOT EXISTS fk_job_has_job_job2 ON jobs_link (job_id_nxt ASC);
+CREATE INDEX IF NOT EXISTS fk_job_has_job_job1 ON jobs_link (job_id_prv ASC);
+
+-- -----------------------------------------------------
+-- View `get_ready_time`
+-- The time constraints are compared to the local time
+-- -----------------------------------------------------
+
+CREATE VIEW IF NOT EXISTS get_ready_time AS select job_id from job j
+	where
+	( j.job_id not in (select time_c_job_id from time_constraint) )
+	<> (
+			j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'at' and substr(time_c_value, 1, 5) = strftime('%H:%M', 'now', 'localtime')))
+			or j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'before' and substr(time_c_value, 1, 5) >= strftime('%H:%M', 'now', 'localtime')))
+			or j.job_id in (select time_c_job_id from time_constraint where (time_c_type = 'after' and substr(time_c_value, 1, 5) <= strftime('%H:%M', 'now', 'localtime')))
+	    )
+	;
+
+-- -----------------------------------------------------
+-- View `get_ready_links`
+-- -----------------------------------------------------
+
+CREATE VIEW IF NOT EXISTS get_ready_links AS select distinct jl.job_id_nxt AS job_id from jobs_link jl join job j on (jl.job_id_prv = j.job_id) where (j.job_state = 'succeded');
+
+-- -----------------------------------------------------
+-- View `get_ready_linkless`
+-- -----------------------------------------------------
+
+CREATE VIEW IF NOT EXISTS get_ready_linkless AS SELECT job_id FROM job WHERE job_state = 'waiting' AND job_id NOT IN ( SELECT job_id_nxt FROM jobs_link );
+
+-- -----------------------------------------------------
+-- View `get_ready_job`
+-- SQLite has no XOR: the booleans are compared instead
+-- -----------------------------------------------------
+
+CREATE VIEW IF NOT EXISTS get_ready_job AS select j.job_id AS job_id, j.job_name AS job_name, j.job_cmd_line AS job_cmd_line, j.job_node_id AS job_node_id, j.job_weight AS job_weight, j.job_state AS job_state, j.job_rectype_id AS job_rectype_id from job j
 	where (
-  		(
-			NOT j.job_id in (select get_ready_links.job_id AS job_id from get_ready_links)
-			AND
-			j.job_id in (select get_ready_linkless.job_id AS job_id from get_ready_linkless)
-			OR
-			j.job_id in (select get_ready_links.job_id AS job_id from get_ready_links)
-			AND
-			NOT j.job_id in (select get_ready_linkless.job_id AS job_id from get_ready_linkless)
-		)
-		and
-			j.job_id in (select j.job_id AS job_id from get_ready_time)
-	);
-
+			(
+			 ( j.job_id in (select job_id from get_ready_links) )
+			 <>
+			 ( j.job_id in (select job_id from get_ready_linkless) )
+			)
+			and j.job_id in (select job_id from get_ready_time)
+	      )
+	;
+
+-- -----------------------------------------------------
+-- View `get_available_resource`
+-- -----------------------------------------------------
+
+CREATE VIEW IF NOT EXISTS get_available_resource AS select resource_name, resource_node_id, resource_current_value from resource where (resource_current_value > 0);
@@ -36,6 +36,7 @@
 
 #include <boost/thread/mutex.hpp>
 #include <boost/regex.hpp>
+#include <boost/lexical_cast.hpp>
 
 //#include "common.h"
 
@@ -101,6 +102,19 @@ public:
 	 */
 	std::string*	get_param(const char*);
 
+	/**
+	 * get_integer_param
+	 *
+	 * Gets the value associated to a key as an integer
+	 * The syntax of the integer keys is checked by parse_file
+	 *
+	 * @param	field		the key
+	 * @param	default_value	the value to use if the key is not set
+	 *
+	 * @return	the value
+	 */
+	long	get_integer_param(const char* field, const long default_value);
+
 	/**
 	 * get_master_node
 	 *
@@ -48,7 +48,9 @@
 /*
  * Database selection
  *
- * You can only use one database engine.
+ * The engine is chosen at runtime using db_engine (mysql, sqlite or memory).
+ * MySQL and the in-memory engine are always built, the SQLite backend is
+ * built using "qmake CONFIG+=sqlite".
  */
 
 // To use MySQL support
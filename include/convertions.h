@@ -28,12 +28,24 @@
 #ifndef CONVERTIONS_H
 #define CONVERTIONS_H
 
+#include <string>
+#include <vector>
+
 #include <time.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/resource.h>
 #include <boost/lexical_cast.hpp>
 #include <boost/regex.hpp>
+#include <boost/foreach.hpp>
 
 #include "model_types.h"
 
+/*
+ * The arguments of a command line executed without shell
+ */
+typedef	std::vector<std::string>	v_command_args;
+
 /**
  * build_job_state_from_string
  *
@@ -45,6 +57,19 @@
  */
 rpc::e_job_state::type	build_job_state_from_string(const char* state);
 
+/**
+ * build_job_state_from_string
+ *
+ * Translates a 'stringed' job_state to an enumed job_state
+ * The string does not need to be null-terminated
+ *
+ * @param	state	the state to convert
+ * @param	length	the string's length
+ *
+ * @return	the enumed state
+ */
+rpc::e_job_state::type	build_job_state_from_string(const char* state, const size_t length);
+
 /**
  * build_string_from_job_state
  *
@@ -67,6 +92,19 @@ std::string	build_string_from_job_state(const rpc::e_job_state::type& js);
  */
 rpc::e_rectype_action::type	build_rectype_action_from_string(const char* rt_action);
 
+/**
+ * build_rectype_action_from_string
+ *
+ * Translates a 'stringed' rectype_action to an enumed one
+ * The string does not need to be null-terminated
+ *
+ * @param	rt_action	the type to convert
+ * @param	length		the string's length
+ *
+ * @return	the enumed type
+ */
+rpc::e_rectype_action::type	build_rectype_action_from_string(const char* rt_action, const size_t length);
+
 /**
  * build_string_from_rectype_action
  *
@@ -78,6 +116,30 @@ rpc::e_rectype_action::type	build_rectype_action_from_string(const char* rt_acti
  */
 std::string	build_string_from_rectype_action(const rpc::e_rectype_action::type& rt_action);
 
+/**
+ * build_job_failure_from_string
+ *
+ * Translates a 'stringed' job_failure to an enumed one
+ * The string does not need to be null-terminated
+ *
+ * @param	failure	the failure to convert
+ * @param	length	the string's length
+ *
+ * @return	the enumed failure
+ */
+rpc::e_job_failure::type	build_job_failure_from_string(const char* failure, const size_t length);
+
+/**
+ * build_string_from_job_failure
+ *
+ * Translates an enumed job_failure to a 'stringed' one
+ *
+ * @param	failure	the failure to convert
+ *
+ * @return	the 'stringed' failure
+ */
+std::string	build_string_from_job_failure(const rpc::e_job_failure::type& failure);
+
 /**
  * build_time_constraint_type_from_string
  *
@@ -88,6 +150,33 @@ std::string	build_string_from_rectype_action(const rpc::e_rectype_action::type&
  */
 rpc::e_time_constraint_type::type build_time_constraint_type_from_string(const char* type);
 
+/**
+ * build_time_constraint_type_from_string
+ *
+ * Translates a 'stringed' time_constraint_type to an enumed one
+ * The string does not need to be null-terminated
+ *
+ * @param	tc_type	the type to convert
+ * @param	length	the string's length
+ *
+ * @return	the enumed type
+ */
+rpc::e_time_constraint_type::type build_time_constraint_type_from_string(const char* type, const size_t length);
+
+/**
+ * build_integer_from_string
+ *
+ * Parses a decimal integer without allocating memory
+ * The string does not need to be null-terminated
+ *
+ * @param	str	the digits, an optional sign first
+ * @param	length	the string's length
+ * @param	_return	the parsed value
+ *
+ * @return	false	the string is not a valid 64 bits integer
+ */
+bool	build_integer_from_string(const char* str, const size_t length, int64_t& _return);
+
 /**
  * build_string_from_time_constraint_type
  *
@@ -121,4 +210,78 @@ std::string	build_human_readable_time(const time_t& time);
  */
 time_t	build_unix_time_from_hhmm_time(const std::string& time);
 
+/**
+ * build_minute_of_day
+ *
+ * Gives the local minute of the day of an UNIX time
+ *
+ * @arg	time	the time to convert
+ *
+ * @return	the minutes since midnight
+ */
+int64_t	build_minute_of_day(const time_t& time);
+
+/**
+ * match_time_constraints
+ *
+ * Tells if a job can start at the given minute, like the get_ready_time view:
+ * no time constraint or one of them matches (at ==, before >=, after <=)
+ *
+ * @arg	time_constraints	the job's time constraints (seconds since midnight)
+ * @arg	minute			the minute of the day
+ *
+ * @return	true if the job can start
+ */
+bool	match_time_constraints(const rpc::v_time_constraints& time_constraints, const int64_t minute);
+
+/**
+ * build_args_from_command_line
+ *
+ * Splits a command line on blanks when it can be executed without shell:
+ * no quoting, expansion, redirection or control operator, no variable
+ * assignment, no builtin command nor keyword
+ *
+ * @arg	cmd_line	the command line
+ * @arg	_return		the arguments, the program first
+ *
+ * @return	false if the command line needs the shell
+ */
+bool	build_args_from_command_line(const std::string& cmd_line, v_command_args& _return);
+
+/**
+ * build_usage_from_rusage
+ *
+ * Sets a job's usage from the resources of its ended process: the CPU time,
+ * the largest resident set and the blocks read and written (512 bytes each)
+ * The processes left running by the job are not counted
+ *
+ * @arg	usage	the resources given by wait4
+ * @arg	_return	the job, its usage counters are set
+ */
+void	build_usage_from_rusage(const struct rusage& usage, rpc::t_job& _return);
+
+/**
+ * build_job_result
+ *
+ * Builds the result of a job given to a batch
+ *
+ * @arg	code	what happened to the job
+ * @arg	msg	why it failed, empty if it did not
+ *
+ * @return	the result
+ */
+rpc::t_job_result	build_job_result(const rpc::e_job_result::type code, const std::string& msg);
+
+/**
+ * is_file_name
+ *
+ * Tells if a name can be used as a file's name under a given directory:
+ * it is not empty, has no '/' and does not start with '.'
+ *
+ * @arg	name	the name, a job's or a planning's
+ *
+ * @return	true if it is usable
+ */
+bool	is_file_name(const std::string& name);
+
 #endif // CONVERTIONS_H
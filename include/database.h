@@ -1,7 +1,7 @@
 /**
  * Project: OWS: an Open Source Workload Scheduler
  * File name: database.h
- * Description: deals with the database connection (MySQLe or SQLite).
+ * Description: the storage interface and the SQL connectors (MySQLe or SQLite).
  *
  * @author Mathieu Grzybek on 2010-05-16
  * @copyright 2010 Mathieu Grzybek. All rights reserved.
@@ -31,18 +31,30 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <vector>
+#include <stdint.h>
+
+#include <list>
+#include <map>
+#include <deque>
 
 #include <boost/regex.hpp>
 #include <boost/foreach.hpp>
+#include <boost/function.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "common.h"
+#include "name_table.h"
 
 #ifdef USE_MYSQL
 #include <mysql.h>
 #endif
 #ifdef USE_SQLITE
-//#include <boost/filesystem.hpp>
+#include <set>
+#include <boost/shared_ptr.hpp>
 #include <sqlite3.h>
 #endif
 
@@ -52,21 +64,548 @@ typedef	std::vector<std::string>	v_row;
 typedef	std::vector<v_row>		v_v_row;
 typedef	std::vector<std::string>	v_queries;
 
-///////////////////////////////////////////////////////////////////////////////
+/**
+ * e_sql_param_type
+ *
+ * The types a prepared statement's parameter can be bound as
+ */
+enum e_sql_param_type {
+	SQL_NULL,
+	SQL_INTEGER,
+	SQL_STRING
+};
+
+/**
+ * sql_param
+ *
+ * A typed parameter bound to a prepared statement's placeholder ("?")
+ * The values are never concatenated into the SQL text
+ */
+struct sql_param {
+	sql_param() : type(SQL_NULL), integer(0) {}
+	sql_param(const int64_t& i) : type(SQL_INTEGER), integer(i) {}
+	sql_param(const std::string& s) : type(SQL_STRING), integer(0), string(s) {}
+	sql_param(const char* s) : type(SQL_STRING), integer(0), string(s) {}
+
+	e_sql_param_type	type;
+	int64_t			integer;
+	std::string		string;
+};
+typedef	std::vector<sql_param>	v_sql_params;
+
+/**
+ * sql_statement
+ *
+ * A parameterized query and the values of its placeholders
+ */
+struct sql_statement {
+	sql_statement(const std::string& q) : query(q) {}
+	sql_statement(const std::string& q, const v_sql_params& p) : query(q), params(p) {}
+
+	std::string	query;
+	v_sql_params	params;
+};
+typedef	std::vector<sql_statement>	v_sql_statements;
+
+/**
+ * v_sql_columns
+ *
+ * The types of the columns returned by a query (SQL_INTEGER or SQL_STRING),
+ * declared once per query. The missing columns are decoded as strings
+ */
+typedef	std::vector<e_sql_param_type>	v_sql_columns;
+
+/**
+ * sql_cell
+ *
+ * A value of the row given by a cursor to its handler
+ * - SQL_STRING columns use data and length, which belong to the database
+ *   layer and are only valid during the call
+ * - SQL_INTEGER columns use integer, data is NULL
+ */
+struct sql_cell {
+	const char*	data;
+	size_t		length;
+	int64_t		integer;
+	bool		is_null;
+
+	std::string	str() const { return this->is_null == true or this->data == NULL ? std::string() : std::string(this->data, this->length); }
+};
+typedef	std::vector<sql_cell>	v_cells;
+
+/**
+ * row_handler
+ *
+ * Called by the cursors for each fetched row
+ * An exception thrown by the handler stops the fetch and is forwarded
+ * The connection is held during the calls: the handler must not query
+ */
+typedef	boost::function<void (const v_cells&)>	row_handler;
+
+/*
+ * Hash tables used to join the rows fetched by the bulk loaders
+ * The keys are the names (or the ids) the rows refer to
+ */
+typedef	boost::unordered_map<std::string, rpc::v_job_names>		m_jobs_links;
+typedef	boost::unordered_map<std::string, rpc::v_time_constraints>	m_time_constraints;
+typedef	boost::unordered_map<int, rpc::t_recovery_type>		m_recovery_types;
+typedef	boost::unordered_map<std::string, rpc::v_resources>		m_resources;
+
+/*
+ * What a job consumed and why it failed, recorded with its final state
+ * The counters not measured are -1 (NULL in the database), failure is a
+ * rpc::e_job_failure or -1 if the job did not fail
+ */
+struct job_usage {
+	int64_t	stdout_bytes;
+	int64_t	stderr_bytes;
+	int64_t	cpu_usage;
+	int64_t	memory_peak;
+	int64_t	io_read_bytes;
+	int64_t	io_write_bytes;
+	int	failure;
+
+	job_usage() : stdout_bytes(-1), stderr_bytes(-1), cpu_usage(-1), memory_peak(-1), io_read_bytes(-1), io_write_bytes(-1), failure(-1) {}
+};
+
 /*
+ * A job's state transition waiting to be committed by the writer thread
+ * The job is given by its id (see Name_Table)
+ */
+struct job_state_update {
+	std::string		domain_name;
+	int			job_id;
+	rpc::e_job_state::type	state;
+	bool			has_times;
+	time_t			start_time;
+	time_t			stop_time;
+	bool			has_usage;
+	job_usage		usage;
+};
+
+typedef	std::deque<job_state_update>	d_job_state_updates;
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Database
+ *
+ * The storage used by the Domain, the engine is chosen by db_engine:
+ * - mysql and sqlite store the plannings using SQL (see Sql_Database)
+ * - memory keeps them in hash tables (see Memory_Database)
+ *
+ * The plannings are given by name. The NULL filters mean "every row".
+ * The objects are returned as stored: the Domain joins them
+ *
+ * The jobs and the nodes are stored using the ids given by the Domain's name
+ * tables, the names are only used by this interface
+ */
 class Database {
 public:
-	virtual	bool	init_node(const std::string*)	= 0;
-	virtual	bool	execute(const std::string*)		= 0;
-	virtual	bool	shutdown()						= 0;
+	/**
+	 * Database
+	 *
+	 * The constructor
+	 *
+	 * @param	jobs	the jobs' name table, owned by the Domain
+	 * @param	nodes	the nodes' name table, owned by the Domain
+	 */
+	Database(Name_Table* jobs, Name_Table* nodes) : job_names(jobs), node_names(nodes) {}
+
+	virtual	~Database() {}
+
+	/**
+	 * init_planning
+	 *
+	 * Creates the planning unless it already exists
+	 *
+	 * @param	planning_name	the planning's name
+	 * @param	skeleton	the file describing its structure (SQL engines)
+	 *
+	 * @return	true	the planning exists or has been created
+	 * @throw	rpc::ex_processing	storage error
+	 */
+	virtual	bool	init_planning(const std::string& planning_name, const std::string& skeleton) = 0;
+
+	/**
+	 * planning_exists
+	 *
+	 * @param	planning_name	the planning's name
+	 *
+	 * @return	true	the planning exists
+	 * @throw	rpc::ex_processing	storage error
+	 */
+	virtual	bool	planning_exists(const std::string& planning_name) = 0;
+
+	/**
+	 * clone_planning
+	 *
+	 * Creates a planning from another one, the jobs' runtime values (state,
+	 * start and stop times) are reset
+	 *
+	 * @param	source		the planning to copy
+	 * @param	target		the planning to create
+	 *
+	 * @return	true	success
+	 * @throw	rpc::ex_processing	storage error
+	 */
+	virtual	bool	clone_planning(const std::string& source, const std::string& target) = 0;
+
+	/**
+	 * get_planning_names
+	 *
+	 * @param	_return		the stored plannings' names
+	 */
+	virtual	void	get_planning_names(std::vector<std::string>& _return) = 0;
+
+	/**
+	 * load_names
+	 *
+	 * Registers the ids of the jobs and the nodes stored in a planning into
+	 * the name tables
+	 *
+	 * @param	planning_name	the planning to read
+	 *
+	 * @throw	rpc::ex_job	storage error
+	 */
+	virtual	void	load_names(const char* planning_name) = 0;
+
+	/**
+	 * add_node
+	 *
+	 * Adds a node, an existing node is not modified
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	node_name	its name
+	 * @param	weight		its weight
+	 *
+	 * @return	true	success
+	 */
+	virtual	bool	add_node(const char* planning_name, const std::string& node_name, const rpc::integer weight) = 0;
+
+	/**
+	 * remove_node
+	 *
+	 * Removes a node, its jobs must be removed first
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	node_name	its name
+	 *
+	 * @return	true	success
+	 */
+	virtual	bool	remove_node(const char* planning_name, const std::string& node_name) = 0;
+
+	/**
+	 * add_job
+	 *
+	 * Adds a job, its links and its time constraints
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	j		the job
+	 *
+	 * @return	true	success
+	 * @throw	rpc::ex_node		the job's node does not exist
+	 * @throw	rpc::ex_processing	storage error
+	 */
+	virtual	bool	add_job(const char* planning_name, const rpc::t_job& j) = 0;
+
+	/**
+	 * update_job
+	 *
+	 * Replaces a job, its links and its time constraints
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	j		the job
+	 *
+	 * @return	true	success
+	 */
+	virtual	bool	update_job(const char* planning_name, const rpc::t_job& j) = 0;
+
+	/**
+	 * remove_job
+	 *
+	 * Removes a job, its links and its time constraints
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	job_name	its name
+	 *
+	 * @return	true	success
+	 */
+	virtual	bool	remove_job(const char* planning_name, const std::string& job_name) = 0;
+
+	/**
+	 * add_jobs
+	 *
+	 * Adds jobs in a single transaction, a job whose node does not exist
+	 * is rejected and the others are added
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	jobs		the jobs
+	 * @param	_return		a result per job, in the same order
+	 *
+	 * @return	false if the transaction failed: nothing is added
+	 */
+	virtual	bool	add_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return) = 0;
+
+	/**
+	 * update_jobs
+	 *
+	 * Replaces jobs in a single transaction (see update_job), a job
+	 * missing from the planning is rejected and the others are replaced
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	jobs		the jobs
+	 * @param	_return		a result per job, in the same order
+	 *
+	 * @return	false if the transaction failed: nothing is replaced
+	 */
+	virtual	bool	update_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return) = 0;
+
+	/**
+	 * remove_jobs
+	 *
+	 * Removes jobs in a single transaction (see remove_job), a job
+	 * missing from the planning is rejected and the others are removed
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	jobs		the jobs, only their names are used
+	 * @param	_return		a result per job, in the same order
+	 *
+	 * @return	false if the transaction failed: nothing is removed
+	 */
+	virtual	bool	remove_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return) = 0;
+
+	/**
+	 * update_job_states
+	 *
+	 * Applies a batch of state transitions, atomically per planning
+	 *
+	 * @param	batch		the transitions
+	 *
+	 * @return	true	success
+	 * @throw	rpc::ex_processing	storage error
+	 */
+	virtual	bool	update_job_states(const d_job_state_updates& batch) = 0;
+
+	/**
+	 * add_resource
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	r		the resource
+	 * @param	node_name	the node using it
+	 *
+	 * @return	true	success
+	 */
+	virtual	bool	add_resource(const char* planning_name, const rpc::t_resource& r, const char* node_name) = 0;
+
+	/**
+	 * get_nodes
+	 *
+	 * Gets the nodes without their resources and jobs
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	_return		the output
+	 * @param	node_name	the node to get, NULL means every node
+	 */
+	virtual	void	get_nodes(const char* planning_name, rpc::v_nodes& _return, const char* node_name) = 0;
+
+	/**
+	 * get_jobs
+	 *
+	 * Gets the jobs without their links and time constraints, only the
+	 * recovery type's id is set
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	_return		the output
+	 * @param	node_name	the node running the jobs, NULL means every node
+	 * @param	job_name	the job to get, NULL means every job
+	 */
+	virtual	void	get_jobs(const char* planning_name, rpc::v_jobs& _return, const char* node_name, const char* job_name) = 0;
+
+	/**
+	 * get_ready_jobs
+	 *
+	 * Gets the jobs ready to be launched: their previous jobs succeeded
+	 * and their time constraints match the current time
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	_return		the output
+	 * @param	node_name	the node running the jobs, NULL means every node
+	 */
+	virtual	void	get_ready_jobs(const char* planning_name, rpc::v_jobs& _return, const char* node_name) = 0;
+
+	/**
+	 * get_jobs_links
+	 *
+	 * Gets the next jobs, grouped by previous job
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	_return		the output
+	 * @param	node_name	the node running the previous jobs, NULL means every node
+	 * @param	job_name	the previous job, NULL means every job
+	 */
+	virtual	void	get_jobs_links(const char* planning_name, m_jobs_links& _return, const char* node_name, const char* job_name) = 0;
+
+	/**
+	 * get_time_constraints
+	 *
+	 * Gets the time constraints, grouped by job
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	_return		the output
+	 * @param	node_name	the node running the jobs, NULL means every node
+	 * @param	job_name	the job, NULL means every job
+	 */
+	virtual	void	get_time_constraints(const char* planning_name, m_time_constraints& _return, const char* node_name, const char* job_name) = 0;
+
+	/**
+	 * get_resources
+	 *
+	 * Gets the resources, grouped by node
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	_return		the output
+	 * @param	node_name	the node using the resources, NULL means every node
+	 */
+	virtual	void	get_resources(const char* planning_name, m_resources& _return, const char* node_name) = 0;
+
+	/**
+	 * get_recovery_types
+	 *
+	 * Gets the recovery types, indexed by id
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	_return		the output
+	 */
+	virtual	void	get_recovery_types(const char* planning_name, m_recovery_types& _return) = 0;
+
+	/**
+	 * get_macro_jobs
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	_return		the output
+	 */
+	virtual	void	get_macro_jobs(const char* planning_name, rpc::v_macro_jobs& _return) = 0;
+
+	/**
+	 * count_jobs_in_state
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	state		the state to look for
+	 *
+	 * @return	the number of jobs in this state
+	 */
+	virtual	int64_t	count_jobs_in_state(const char* planning_name, const rpc::e_job_state::type state) = 0;
+
+	/**
+	 * count_node_jobs
+	 *
+	 * @param	planning_name	the planning to use
+	 * @param	node_name	the node to check
+	 *
+	 * @return	the number of jobs run by the node
+	 */
+	virtual	int64_t	count_node_jobs(const char* planning_name, const char* node_name) = 0;
+
+	/**
+	 * sql_exec
+	 *
+	 * Runs an SQL query, for debug only
+	 *
+	 * @param	planning_name	the planning to use, NULL means none
+	 * @param	query		the query
+	 *
+	 * @return	true	success, false if the engine does not use SQL
+	 */
+	virtual	bool	sql_exec(const char* planning_name, const std::string& query) = 0;
+
+	/**
+	 * get_queries_count
+	 *
+	 * Gives the number of statements sent to the engine since the start
+	 *
+	 * @return	the counter
+	 */
+	virtual	uint64_t	get_queries_count() = 0;
+
+protected:
+	/**
+	 * job_names, node_names
+	 *
+	 * The { name <=> id } tables
+	 */
+	Name_Table*	job_names;
+	Name_Table*	node_names;
 };
-*/
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Sql_Connector
+ *
+ * The SQL engines used by Sql_Database
+ * See Mysql and Sqlite for the details
+ */
+class Sql_Connector {
+public:
+	virtual	~Sql_Connector() {}
+
+	virtual	bool	init_domain_structure(const std::string& domain_name, const std::string& db_skeleton) = 0;
+	virtual	bool	clone_schema(const std::string& source, const std::string& target, const v_sql_statements& after_copy) = 0;
+	virtual	bool	schema_exists(const std::string& schema) = 0;
+	virtual	void	list_schemas(std::vector<std::string>& _return) = 0;
+
+	virtual	bool	standalone_execute(const v_queries& queries, const char* database_name) = 0;
+	virtual	bool	query_one_row(v_row& _return, const char* query, const char* database_name) = 0;
+	virtual	bool	query_full_result(v_v_row& _return, const char* query, const char* database_name) = 0;
+	virtual	bool	query_each_row(const char* query, const row_handler& handler, const char* database_name) = 0;
+	virtual	bool	query_each_row(const char* query, const v_sql_columns& columns, const row_handler& handler, const char* database_name) = 0;
+
+	virtual	bool	prepared_query_each_row(const std::string& query, const v_sql_params& params, const row_handler& handler, const char* database_name) = 0;
+	virtual	bool	prepared_query_each_row(const std::string& query, const v_sql_params& params, const v_sql_columns& columns, const row_handler& handler, const char* database_name) = 0;
+	virtual	bool	prepared_execute(const v_sql_statements& statements, const char* database_name) = 0;
+	virtual	bool	prepared_query_one_row(v_row& _return, const std::string& query, const v_sql_params& params, const char* database_name) = 0;
+	virtual	bool	prepared_query_full_result(v_v_row& _return, const std::string& query, const v_sql_params& params, const char* database_name) = 0;
+
+	virtual	int		get_inserted_id(const char* database_name) = 0;
+	virtual	uint64_t	get_queries_count() = 0;
+	virtual	bool		shutdown() = 0;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #ifdef USE_MYSQL
 
-//class Mysql : public Database {
-class Mysql {
+/**
+ * m_mysql_statements
+ *
+ * Defines the { SQL text => prepared statement } map
+ */
+typedef std::map<std::string, MYSQL_STMT*>	m_mysql_statements;
+
+/**
+ * mysql_connection
+ *
+ * A connection to the embedded server kept in the pool
+ * - schema is the database selected by the connection ("" means none)
+ * - last_used is used to know if a health check is needed
+ * - statements are prepared once per connection and reused
+ */
+struct mysql_connection {
+	MYSQL*			handle;
+	std::string		schema;
+	time_t			last_used;
+	m_mysql_statements	statements;
+};
+
+/**
+ * m_mysql_connections
+ *
+ * Defines the { schema => idle connections } map
+ */
+typedef std::map<std::string, std::list<mysql_connection*> >	m_mysql_connections;
+
+class Mysql : public Sql_Connector {
 public:
 	Mysql();
 	~Mysql();
@@ -76,10 +615,14 @@ public:
 	 *
 	 * Prepares the domain to be used :
 	 * - creates the embedded database engine
+	 * - sizes the connections' pool
+	 *
+	 * @param	pool_size	the maximum number of opened connections
+	 * @param	check_interval	idle time (seconds) after which a connection is pinged
 	 *
 	 * @return	true	success
 	 */
-	bool	prepare();
+	bool	prepare(const size_t pool_size, const time_t check_interval);
 
 	/**
 	 * init_domain_structure
@@ -94,6 +637,46 @@ public:
 	 */
 	bool	init_domain_structure(const std::string& domain_name, const std::string& db_skeleton);
 
+	/**
+	 * clone_schema
+	 *
+	 * Creates a schema from another one on the server side:
+	 * - the tables are created using CREATE TABLE ... LIKE
+	 * - the views are created from their definitions, dependencies first
+	 * - the rows are copied using INSERT ... SELECT in a single transaction
+	 * - the rows are counted in both schemas before the commit
+	 * The target schema is dropped if any step fails
+	 *
+	 * @param	source		the schema to copy
+	 * @param	target		the schema to create
+	 * @param	after_copy	statements run on target in the copy's transaction
+	 *
+	 * @return	true		success
+	 * @throw	rpc::ex_processing	database error or rows count mismatch
+	 */
+	bool	clone_schema(const std::string& source, const std::string& target, const v_sql_statements& after_copy);
+
+	/**
+	 * schema_exists
+	 *
+	 * Tells if the given schema exists
+	 *
+	 * @param	schema	the schema's name
+	 *
+	 * @return	true	the schema exists
+	 * @throw	rpc::ex_processing	database error
+	 */
+	bool	schema_exists(const std::string& schema);
+
+	/**
+	 * list_schemas
+	 *
+	 * Gives the schemas hosted by the server
+	 *
+	 * @param	_return		the schemas' names
+	 */
+	void	list_schemas(std::vector<std::string>& _return);
+
 	/**
 	 * execute
 	 *
@@ -128,64 +711,308 @@ public:
 	 * @param	query		SQL query
 	 * @param	database_name	the schema to use
 	 *
-	 * @return	true		success
+	 * @return	true		success
+	 */
+	bool	query_full_result(v_v_row& _return, const char* query, const char* database_name);
+
+	/**
+	 * query_each_row
+	 *
+	 * Executes a query and streams its result: the rows are not stored, each
+	 * of them is given to the handler as soon as it is fetched
+	 *
+	 * @param	query		SQL query
+	 * @param	handler		called for each row
+	 * @param	database_name	the schema to use
+	 *
+	 * @return	true		success
+	 */
+	bool	query_each_row(const char* query, const row_handler& handler, const char* database_name);
+
+	/**
+	 * query_each_row
+	 *
+	 * Executes a query and streams its result, the integer columns are
+	 * decoded before the handler is called
+	 *
+	 * @param	query		SQL query
+	 * @param	columns		the columns' types
+	 * @param	handler		called for each row
+	 * @param	database_name	the schema to use
+	 *
+	 * @return	true		success
+	 * @throw	rpc::ex_processing	a value is not an integer
+	 */
+	bool	query_each_row(const char* query, const v_sql_columns& columns, const row_handler& handler, const char* database_name);
+
+	/**
+	 * prepared_query_each_row
+	 *
+	 * Executes a parameterized query and streams its result
+	 *
+	 * @param	query		SQL query using "?" placeholders
+	 * @param	params		the placeholders' values
+	 * @param	handler		called for each row
+	 * @param	database_name	the schema to use
+	 *
+	 * @return	true		success
+	 */
+	bool	prepared_query_each_row(const std::string& query, const v_sql_params& params, const row_handler& handler, const char* database_name);
+
+	/**
+	 * prepared_query_each_row
+	 *
+	 * Executes a parameterized query and streams its result, the integer
+	 * columns are bound as native integers
+	 *
+	 * @param	query		SQL query using "?" placeholders
+	 * @param	params		the placeholders' values
+	 * @param	columns		the columns' types
+	 * @param	handler		called for each row
+	 * @param	database_name	the schema to use
+	 *
+	 * @return	true		success
+	 */
+	bool	prepared_query_each_row(const std::string& query, const v_sql_params& params, const v_sql_columns& columns, const row_handler& handler, const char* database_name);
+
+	/**
+	 * prepared_execute
+	 *
+	 * Executes parameterized queries without result in a single transaction
+	 * The statements are prepared once per connection and cached
+	 *
+	 * @param	statements	the queries and their parameters
+	 * @param	database_name	the schema to use
+	 *
+	 * @return	true		success
+	 * @throw	rpc::ex_processing	database error
+	 */
+	bool	prepared_execute(const v_sql_statements& statements, const char* database_name);
+
+	/**
+	 * prepared_query_one_row
+	 *
+	 * Executes a parameterized query returning a single-row result
+	 * NULL values are skipped, like query_one_row does
+	 *
+	 * @param	_return		the result
+	 * @param	query		SQL query using "?" placeholders
+	 * @param	params		the placeholders' values
+	 * @param	database_name	the schema to use
+	 *
+	 * @return	true		success
+	 */
+	bool	prepared_query_one_row(v_row& _return, const std::string& query, const v_sql_params& params, const char* database_name);
+
+	/**
+	 * prepared_query_full_result
+	 *
+	 * Executes a parameterized query returning several rows
+	 * NULL values are given as "NULL", like query_full_result does
+	 *
+	 * @param	_return		the output
+	 * @param	query		SQL query using "?" placeholders
+	 * @param	params		the placeholders' values
+	 * @param	database_name	the schema to use
+	 *
+	 * @return	true		success
+	 */
+	bool	prepared_query_full_result(v_v_row& _return, const std::string& query, const v_sql_params& params, const char* database_name);
+
+	/**
+	 * get_inserted_id
+	 *
+	 * Gives mysql_insert_id(). It is used to update the object's id
+	 *
+	 * @param	database_name	the schema to use
+	 *
+	 * @return	the id
+	 */
+	int	get_inserted_id(const char* database_name);
+
+	/**
+	 * get_queries_count
+	 *
+	 * Gives the number of statements sent to the server since the start
+	 * It is used to measure what the Domain's calls cost
+	 *
+	 * @return	the counter
+	 */
+	uint64_t	get_queries_count();
+
+	/**
+	 * shutdown
+	 *
+	 * Makes a clean database shutdown
+	 *
+	 * @return true
+	 */
+	bool	shutdown();
+
+private:
+	/**
+	 * results
+	 *
+	 * Used to store the query's result
+	 */
+//	MYSQL_RES*		results;
+
+	/**
+	 * record
+	 *
+	 * Used to store each row of the result
+	 */
+//	MYSQL_ROW		record;
+
+	/**
+	 * updates_mutex
+	 *
+	 * This mutex is used to secure the database's access
+	 * MySQLe does not support multi access
+	 */
+//	boost::mutex	updates_mutex;
+
+	/**
+	 * idle_connections
+	 *
+	 * The pooled connections waiting to be used, sorted by schema
+	 */
+	m_mysql_connections	idle_connections;
+
+	/**
+	 * opened_connections
+	 *
+	 * The number of connections currently opened (idle or used)
+	 */
+	size_t		opened_connections;
+
+	/**
+	 * pool_size
+	 *
+	 * The maximum number of opened connections
+	 */
+	size_t		pool_size;
+
+	/**
+	 * pool_check_interval
+	 *
+	 * An idle connection older than this (seconds) is pinged before use
+	 */
+	time_t		pool_check_interval;
+
+	/**
+	 * pool_mutex
+	 *
+	 * Protects the pool's attributes
+	 */
+	boost::mutex	pool_mutex;
+
+	/**
+	 * pool_released
+	 *
+	 * Signaled each time a connection goes back to the pool
+	 */
+	boost::condition_variable	pool_released;
+
+	/**
+	 * queries_count
+	 *
+	 * The number of statements sent to the server, protected by stats_mutex
+	 */
+	uint64_t	queries_count;
+	boost::mutex	stats_mutex;
+
+	/**
+	 * count_query
+	 *
+	 * Increments queries_count
+	 */
+	void	count_query();
+
+	/**
+	 * execute
+	 *
+	 * Executes an SQL query without result
+	 *
+	 * @param	query	SQL query
+	 * @param	mysql	the MySQL connector
+	 *
+	 * @return	true	success
 	 */
-	bool	query_full_result(v_v_row& _return, const char* query, const char* database_name);
+	bool	atomic_execute(const std::string& query, MYSQL* m);
 
 	/**
-	 * get_inserted_id
-	 *
-	 * Gives mysql_insert_id(). It is used to update the object's id
+	 * drop_schema
 	 *
-	 * @param	database_name	the schema to use
+	 * Drops a schema, the errors are only logged
 	 *
-	 * @return	the id
+	 * @param	schema	the schema's name
 	 */
-	int	get_inserted_id(const char* database_name);
+	void	drop_schema(const std::string& schema);
 
 	/**
-	 * shutdown
+	 * fetch_one_row
 	 *
-	 * Makes a clean database shutdown
+	 * Executes a query returning a single row using the given connection
+	 * It is used inside a running transaction
 	 *
-	 * @return true
+	 * @param	_return		the row
+	 * @param	query		the query
+	 * @param	c		the connection
+	 *
+	 * @throw	rpc::ex_processing	database error
 	 */
-	bool	shutdown();
+	void	fetch_one_row(v_row& _return, const std::string& query, mysql_connection* c);
 
-private:
 	/**
-	 * results
+	 * get_statement
 	 *
-	 * Used to store the query's result
+	 * Gets the prepared statement of the query from the connection's cache
+	 * The query is prepared if it is not cached yet
+	 *
+	 * @param	c	the connection
+	 * @param	query	SQL query using "?" placeholders
+	 *
+	 * @return	the statement
+	 * @throw	rpc::ex_processing	the query cannot be prepared
 	 */
-//	MYSQL_RES*		results;
+	MYSQL_STMT*	get_statement(mysql_connection* c, const std::string& query);
 
 	/**
-	 * record
+	 * prepared_run
 	 *
-	 * Used to store each row of the result
+	 * Binds the parameters and executes a cached statement
+	 *
+	 * @param	c	the connection
+	 * @param	query	SQL query using "?" placeholders
+	 * @param	params	the placeholders' values
+	 *
+	 * @return	the executed statement
+	 * @throw	rpc::ex_processing	binding or execution failed
 	 */
-//	MYSQL_ROW		record;
+	MYSQL_STMT*	prepared_run(mysql_connection* c, const std::string& query, const v_sql_params& params);
 
 	/**
-	 * updates_mutex
+	 * prepared_fetch
 	 *
-	 * This mutex is used to secure the database's access
-	 * MySQLe does not support multi access
+	 * Fetches the rows of an executed statement one by one
+	 *
+	 * @param	stmt		the executed statement
+	 * @param	columns		the columns' types
+	 * @param	handler		called for each row
+	 *
+	 * @return	true		success
 	 */
-//	boost::mutex	updates_mutex;
+	bool	prepared_fetch(MYSQL_STMT* stmt, const v_sql_columns& columns, const row_handler& handler);
 
 	/**
-	 * execute
-	 *
-	 * Executes an SQL query without result
+	 * close_statements
 	 *
-	 * @param	query	SQL query
-	 * @param	mysql	the MySQL connector
+	 * Closes the prepared statements cached by a connection
 	 *
-	 * @return	true	success
+	 * @param	c	the connection
 	 */
-	bool	atomic_execute(const std::string& query, MYSQL* m);
+	void	close_statements(mysql_connection* c);
 
 	/**
 	 * load_file
@@ -201,26 +1028,51 @@ private:
 	/**
 	 * init
 	 *
-	 * Initializes the MySQL connection to the embedded server
-	 * - must be called on each thread
+	 * Gets a connection to the embedded server from the pool
+	 * - an idle connection using the same schema is preferred
+	 * - a new one is opened if the pool is not full
+	 * - otherwise an idle connection is switched to the schema
+	 * - otherwise we wait for a connection to be released
 	 * - basically it is called at the beginning of each method
 	 *
 	 * @param	database_name	the schema to use
 	 *
-	 * @return	the MYSQL object
+	 * @return	the connection
+	 * @throw	rpc::ex_processing	cannot connect
 	 */
-	MYSQL*		init(const char* database_name);
+	mysql_connection*	init(const char* database_name);
 
 	/**
 	 * end
 	 *
-	 * Ends the MySQL connection to the embedded server
-	 * - must be called on each thread
+	 * Gives the connection back to the pool
 	 * - basically it is called at the end of each method
 	 *
-	 * @param	db	the MYSQL object to destroy
+	 * @param	c	the connection to release
+	 * @param	broken	the connection must be closed instead of reused
+	 */
+	void		end(mysql_connection* c, const bool broken = false);
+
+	/**
+	 * connect
+	 *
+	 * Opens a new connection to the embedded server
+	 *
+	 * @param	database_name	the schema to use
+	 *
+	 * @return	the connection
+	 * @throw	rpc::ex_processing	cannot connect
 	 */
-	void		end(MYSQL* db);
+	mysql_connection*	connect(const char* database_name);
+
+	/**
+	 * disconnect
+	 *
+	 * Closes a connection opened by connect()
+	 *
+	 * @param	c	the connection to close
+	 */
+	void		disconnect(mysql_connection* c);
 
 	/**
 	 * translate_into_db
@@ -260,8 +1112,57 @@ private:
 
 #ifdef USE_SQLITE
 
-//class Sqlite : public Database {
-class Sqlite {
+/**
+ * m_sqlite_statements
+ *
+ * Defines the { SQL text => prepared statement } map
+ */
+typedef std::map<std::string, sqlite3_stmt*>	m_sqlite_statements;
+
+/**
+ * sqlite_connection
+ *
+ * A connection to a planning's file, used by a single thread
+ * - schema is the planning ("" means the in-memory database)
+ * - statements are prepared once per connection and reused
+ */
+struct sqlite_connection {
+	sqlite3*		handle;
+	std::string		schema;
+	m_sqlite_statements	statements;
+};
+
+/**
+ * m_sqlite_connections
+ *
+ * Defines the { schema => connection } map of a thread
+ */
+typedef std::map<std::string, sqlite_connection*>	m_sqlite_connections;
+
+/**
+ * sqlite_registry
+ *
+ * The connections opened by every thread
+ * It is shared by the Sqlite object and the threads: the connections are
+ * closed either when their thread exits or by shutdown(), whichever comes
+ * first
+ */
+struct sqlite_registry {
+	boost::mutex			mutex;
+	std::set<sqlite_connection*>	connections;
+};
+
+/**
+ * sqlite_thread_connections
+ *
+ * The connections of a thread, stored in a thread specific pointer
+ */
+struct sqlite_thread_connections {
+	boost::shared_ptr<sqlite_registry>	registry;
+	m_sqlite_connections			connections;
+};
+
+class Sqlite : public Sql_Connector {
 public:
 	/**
 	 * Sqlite
@@ -281,62 +1182,235 @@ public:
 	 * prepare
 	 *
 	 * Prepares the domain to be used :
-	 * - creates the database file from the template
+	 * - creates the directory of the plannings' files
+	 * - sets the size of the memory map used by the connections
+	 *
+	 * @param	data_path	the directory storing one file per planning
+	 * @param	mmap_size	the PRAGMA mmap_size value (bytes)
+	 *
+	 * @return	true	success
+	 */
+	bool	prepare(const std::string& data_path, const int64_t mmap_size);
+
+	/**
+	 * init_domain_structure
+	 *
+	 * Creates a planning using the given name
+	 *
+	 * @param	domain_name	the domain's name
+	 * @param	db_skeleton	the SQL file to use to create the planning
 	 *
-	 * @param	node_name	node's name
-	 * @param	db_skeleton	the SQL skeleton to use
+	 * @return	true	the planning exists or has been created
+	 * @throw	rpc::ex_processing	database error
+	 */
+	bool	init_domain_structure(const std::string& domain_name, const std::string& db_skeleton);
+
+	/**
+	 * clone_schema
+	 *
+	 * Creates a planning's file from another one using the online backup
+	 * API: the pages are copied as they are, then the after_copy statements
+	 * are run in a single transaction
+	 * The target file is removed if any step fails
+	 *
+	 * @param	source		the planning to copy
+	 * @param	target		the planning to create
+	 * @param	after_copy	statements run on target after the copy
 	 *
 	 * @return	true		success
+	 * @throw	rpc::ex_processing	database error
 	 */
-	bool	prepare(const char* node_name, const std::string* db_data, const std::string* db_skeleton );
+	bool	clone_schema(const std::string& source, const std::string& target, const v_sql_statements& after_copy);
 
 	/**
-	 * standaline_execute
+	 * schema_exists
 	 *
-	 * Executes an SQL query without result
+	 * Tells if the given planning's file exists
 	 *
-	 * @param	query	SQL queries
+	 * @param	schema	the planning's name
 	 *
-	 * @return	true	success
+	 * @return	true	the file exists
+	 * @throw	rpc::ex_processing	invalid name
+	 */
+	bool	schema_exists(const std::string& schema);
+
+	/**
+	 * list_schemas
+	 *
+	 * Gives the plannings stored in the data directory
+	 *
+	 * @param	_return		the plannings' names
+	 */
+	void	list_schemas(std::vector<std::string>& _return);
+
+	/**
+	 * standalone_execute
+	 *
+	 * Executes SQL queries without result in a single transaction
+	 *
+	 * @param	queries		SQL queries
+	 * @param	database_name	the planning to use
+	 *
+	 * @return	true		success
+	 * @throw	rpc::ex_processing	database error
 	 */
-	bool	standalone_execute(const v_queries* queries);
+	bool	standalone_execute(const v_queries& queries, const char* database_name);
 
 	/**
 	 * query_one_row
 	 *
 	 * Executes a SQL query returing a single-row result
 	 *
-	 * @param	query	SQL query
+	 * @param	_return		the result
+	 * @param	query		SQL query
+	 * @param	database_name	the planning to use
 	 *
-	 * @return	true	success
+	 * @return	true		success
 	 */
-	v_row	query_one_row(const char* query);
+	bool	query_one_row(v_row& _return, const char* query, const char* database_name);
 
 	/**
 	 * query_full_result
 	 *
 	 * Executes a SQL query returning several rows
 	 *
+	 * @param	_return		the output
+	 * @param	query		SQL query
+	 * @param	database_name	the planning to use
+	 *
+	 * @return	true		success
+	 */
+	bool	query_full_result(v_v_row& _return, const char* query, const char* database_name);
+
+	/**
+	 * query_each_row
+	 *
+	 * Executes a query and streams its result to the handler
+	 * The query is not cached
+	 *
+	 * @param	query		SQL query
+	 * @param	handler		called for each row
+	 * @param	database_name	the planning to use
+	 *
+	 * @return	true		success
+	 */
+	bool	query_each_row(const char* query, const row_handler& handler, const char* database_name);
+
+	/**
+	 * query_each_row
+	 *
+	 * Executes a query and streams its result, the integer columns are
+	 * decoded before the handler is called
+	 *
 	 * @param	query		SQL query
-	 * @param	result		the rows
+	 * @param	columns		the columns' types
+	 * @param	handler		called for each row
+	 * @param	database_name	the planning to use
+	 *
+	 * @return	true		success
+	 * @throw	rpc::ex_processing	a value is not an integer
+	 */
+	bool	query_each_row(const char* query, const v_sql_columns& columns, const row_handler& handler, const char* database_name);
+
+	/**
+	 * prepared_query_each_row
+	 *
+	 * Executes a parameterized query and streams its result
+	 *
+	 * @param	query		SQL query using "?" placeholders
+	 * @param	params		the placeholders' values
+	 * @param	handler		called for each row
+	 * @param	database_name	the planning to use
+	 *
+	 * @return	true		success
+	 */
+	bool	prepared_query_each_row(const std::string& query, const v_sql_params& params, const row_handler& handler, const char* database_name);
+
+	/**
+	 * prepared_query_each_row
+	 *
+	 * Executes a parameterized query and streams its result, the integer
+	 * columns are read as native integers
+	 *
+	 * @param	query		SQL query using "?" placeholders
+	 * @param	params		the placeholders' values
+	 * @param	columns		the columns' types
+	 * @param	handler		called for each row
+	 * @param	database_name	the planning to use
+	 *
+	 * @return	true		success
+	 */
+	bool	prepared_query_each_row(const std::string& query, const v_sql_params& params, const v_sql_columns& columns, const row_handler& handler, const char* database_name);
+
+	/**
+	 * prepared_execute
+	 *
+	 * Executes parameterized queries without result in a single transaction
+	 * The statements are prepared once per connection and cached
+	 *
+	 * @param	statements	the queries and their parameters
+	 * @param	database_name	the planning to use
+	 *
+	 * @return	true		success
+	 * @throw	rpc::ex_processing	database error
+	 */
+	bool	prepared_execute(const v_sql_statements& statements, const char* database_name);
+
+	/**
+	 * prepared_query_one_row
+	 *
+	 * Executes a parameterized query returning a single-row result
+	 * NULL values are skipped, like query_one_row does
+	 *
+	 * @param	_return		the result
+	 * @param	query		SQL query using "?" placeholders
+	 * @param	params		the placeholders' values
+	 * @param	database_name	the planning to use
+	 *
+	 * @return	true		success
+	 */
+	bool	prepared_query_one_row(v_row& _return, const std::string& query, const v_sql_params& params, const char* database_name);
+
+	/**
+	 * prepared_query_full_result
 	 *
-	 * @return	true		the success
+	 * Executes a parameterized query returning several rows
+	 * NULL values are given as "NULL", like query_full_result does
+	 *
+	 * @param	_return		the output
+	 * @param	query		SQL query using "?" placeholders
+	 * @param	params		the placeholders' values
+	 * @param	database_name	the planning to use
+	 *
+	 * @return	true		success
 	 */
-	v_v_row*	query_full_result(const char* query);
+	bool	prepared_query_full_result(v_v_row& _return, const std::string& query, const v_sql_params& params, const char* database_name);
 
 	/**
 	 * get_inserted_id
 	 *
-	 * Gives mysql_insert_id(). It is used to update the object's id
+	 * Gives sqlite3_last_insert_rowid() of the thread's connection
+	 *
+	 * @param	database_name	the planning to use
 	 *
 	 * @return	the id
 	 */
-	int		get_inserted_id();
+	int	get_inserted_id(const char* database_name);
+
+	/**
+	 * get_queries_count
+	 *
+	 * Gives the number of statements executed since the start
+	 *
+	 * @return	the counter
+	 */
+	uint64_t	get_queries_count();
 
 	/**
 	 * shutdown
 	 *
-	 * Makes a clean database shutdown
+	 * Closes the connections of every thread
+	 * The object must not be used afterwards
 	 *
 	 * @return true
 	 */
@@ -344,96 +1418,180 @@ public:
 
 private:
 	/**
-	 * updates_mutex
+	 * data_path
 	 *
-	 * This mutex is used to secure the database's access
-	 * MySQLe does not support multi access
+	 * The directory storing the plannings' files
 	 */
-//	boost::mutex	updates_mutex;
+	std::string	data_path;
 
 	/**
-	 * pp_db
+	 * mmap_size
 	 *
-	 * This SQLite db handler
+	 * The PRAGMA mmap_size value set on each connection
 	 */
-//	sqlite3*	p_db;
-	std::string	db;
+	int64_t		mmap_size;
 
 	/**
-	 * execute
+	 * registry
 	 *
-	 * Executes an SQL query without result
+	 * The connections opened by every thread
+	 */
+	boost::shared_ptr<sqlite_registry>	registry;
+
+	/**
+	 * thread_connections
 	 *
-	 * @param	query	SQL query
-	 * @param	mysql	the MySQL connector
+	 * The connections of the current thread, one per planning
+	 */
+	boost::thread_specific_ptr<sqlite_thread_connections>	thread_connections;
+
+	/**
+	 * queries_count
+	 *
+	 * The number of statements executed, protected by stats_mutex
+	 */
+	uint64_t	queries_count;
+	boost::mutex	stats_mutex;
+
+	/**
+	 * count_query
+	 *
+	 * Increments queries_count
+	 */
+	void	count_query();
+
+	/**
+	 * get_file_path
+	 *
+	 * Gives the file storing a planning
+	 *
+	 * @param	schema	the planning's name
+	 *
+	 * @return	the path
+	 * @throw	rpc::ex_processing	the name is not a valid file name
+	 */
+	std::string	get_file_path(const std::string& schema);
+
+	/**
+	 * remove_schema
+	 *
+	 * Closes the thread's connection to a planning and removes its files,
+	 * the errors are only logged
+	 *
+	 * @param	schema	the planning's name
+	 */
+	void	remove_schema(const std::string& schema);
+
+	/**
+	 * atomic_execute
+	 *
+	 * Executes SQL queries without result
+	 *
+	 * @param	query	SQL queries
+	 * @param	c	the connection
+	 *
+	 * @return	true	success
+	 * @throw	rpc::ex_processing	database error
+	 */
+	bool	atomic_execute(const std::string& query, sqlite_connection* c);
+
+	/**
+	 * get_statement
+	 *
+	 * Gets the prepared statement of the query from the connection's cache
+	 * The query is prepared if it is not cached yet
+	 *
+	 * @param	c	the connection
+	 * @param	query	SQL query using "?" placeholders
+	 *
+	 * @return	the statement
+	 * @throw	rpc::ex_processing	the query cannot be prepared
+	 */
+	sqlite3_stmt*	get_statement(sqlite_connection* c, const std::string& query);
+
+	/**
+	 * bind_params
+	 *
+	 * Binds the values to the statement's placeholders
+	 *
+	 * @param	stmt	the prepared statement
+	 * @param	params	the placeholders' values
 	 *
 	 * @return	true	success
 	 */
-	bool	atomic_execute(const std::string& query, sqlite3* p_db);
+	bool	bind_params(sqlite3_stmt* stmt, const v_sql_params& params);
+
+	/**
+	 * fetch
+	 *
+	 * Steps through the rows of a statement and resets it
+	 *
+	 * @param	c		the connection
+	 * @param	stmt		the bound statement
+	 * @param	columns		the columns' types
+	 * @param	handler		called for each row
+	 *
+	 * @return	true		success
+	 * @throw	rpc::ex_processing	a value is not an integer
+	 */
+	bool	fetch(sqlite_connection* c, sqlite3_stmt* stmt, const v_sql_columns& columns, const row_handler& handler);
 
 	/**
 	 * load_file
 	 *
 	 * Reads an SQL file and execute the queries
 	 *
+	 * @param	database_name	the planning to use
 	 * @param	file_path	the SQL file
 	 *
 	 * @return	true		success
 	 */
-	bool	load_file(const char* node_name, const char* file_path);
+	bool	load_file(const char* database_name, const char* file_path);
 
 	/**
 	 * init
 	 *
-	 * Initializes the SQLite connection to the embedded server
-	 * - must be called on each thread
-	 * - basically it is called at the beginning of each method
+	 * Gets the thread's connection to the planning
+	 * The connection is opened on first use and kept until the thread exits
 	 *
-	 * @return	the sqlite3 object
+	 * @param	database_name	the planning to use, NULL means in-memory
+	 *
+	 * @return	the connection
+	 * @throw	rpc::ex_processing	cannot open the file
 	 */
-	sqlite3*	init();
+	sqlite_connection*	init(const char* database_name);
 
 	/**
-	 * end
+	 * connect
 	 *
-	 * Ends the SQLite connection to the embedded server
-	 * - must be called on each thread
-	 * - basically it is called at the end of each method
+	 * Opens a connection and tunes it: WAL journal, memory map, busy
+	 * timeout and the functions used by the MySQL flavoured queries
+	 *
+	 * @param	schema	the planning to use, "" means in-memory
 	 *
-	 * @param	sqlite3	the db object
+	 * @return	the connection
+	 * @throw	rpc::ex_processing	cannot open the file
 	 */
-	void	end(sqlite3* p_db);
+	sqlite_connection*	connect(const std::string& schema);
 
 	/**
-	 * callback
+	 * disconnect
 	 *
-	 * The SQLite's callback function from the quickstart guide
-	 * Must be declared and defined here, otherwise it won't be usable into
-	 * sqlite3_exec calls
+	 * Finalizes the cached statements and closes the connection
 	 *
-	 * @param	NotUsed	not used
-	 * @param	argc	the number of arguments
-	 * @param	argv	the arguments
-	 * @param	asColName	the name of the column to process
-	 *
-	 * @return	the return code
+	 * @param	c	the connection to close
 	 */
-	static int	callback(void *NotUsed, int argc, char **argv, char **azColName) {
-		int i;
-
-		for ( i=0; i < argc ; i++ ) {
-			std::cout << azColName[i] << " = ";
-
-			if ( argv[i] )
-				std::cout << argv[i];
-			else
-				std::cout << "NULL";
-
-			std::cout << std::endl;
-		}
+	static	void	disconnect(sqlite_connection* c);
 
-		return 0;
-	}
+	/**
+	 * release_thread_connections
+	 *
+	 * The cleanup function of thread_connections: closes the connections
+	 * of an exiting thread unless shutdown() already did it
+	 *
+	 * @param	t	the thread's connections
+	 */
+	static	void	release_thread_connections(sqlite_thread_connections* t);
 
         /**
          * root_logger
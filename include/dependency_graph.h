@@ -0,0 +1,293 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: dependency_graph.h
+ * Description: the jobs' links of the current planning, kept in memory.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef DEPENDENCY_GRAPH_H
+#define DEPENDENCY_GRAPH_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+#include <time.h>
+#include <stdint.h>
+
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "common.h"
+#include "convertions.h"
+#include "database.h"
+#include "name_table.h"
+#include "timing_wheel.h"
+
+// namespace ows {
+
+/*
+ * A job of the graph
+ * - next: the ids of the jobs waiting for it
+ * - remaining: the number of its previous jobs not succeeded yet
+ * - on_time: tells if its time constraints let it start now
+ * - queued: tells if it is in the ready queue
+ * - released: when its last previous job succeeded, not_a_date_time once
+ *   it is given to the poller
+ * - args: the command line split at the load, NULL if it needs the shell
+ */
+struct graph_job {
+	rpc::t_job			job;
+	boost::shared_ptr<const v_command_args>	args;
+	std::vector<int>		next;
+	int				remaining;
+	bool				on_time;
+	bool				queued;
+	boost::posix_time::ptime	released;
+
+	graph_job() : remaining(0), on_time(true), queued(false) {}
+};
+
+typedef	boost::unordered_map<int, graph_job>	m_graph_jobs;
+
+// How many release latencies are kept
+#define DEPENDENCY_GRAPH_LATENCY_SAMPLES	4096
+
+/**
+ * Dependency_Graph
+ *
+ * The links of a planning as adjacency lists indexed by job id
+ * A job is ready when it is waiting, all its previous jobs succeeded and its
+ * time window is open: it is pushed to the ready queue by the state
+ * transition or the timer releasing it, the queue is read without scanning
+ * the other jobs
+ *
+ * The time constraints are planning-relative seconds turned into a window:
+ * AFTER opens it, BEFORE closes it, AT opens it for at_window seconds. The
+ * windows are opened and closed by a timing wheel
+ *
+ * The database stays the durable copy: the graph is loaded from it
+ * This class is not thread safe, the Domain protects it
+ */
+class Dependency_Graph {
+public:
+	/**
+	 * Dependency_Graph
+	 *
+	 * The constructor, the graph is empty and not loaded
+	 */
+	Dependency_Graph();
+
+	/**
+	 * load
+	 *
+	 * Builds the graph of a planning from its stored content
+	 *
+	 * @param	planning_name		the planning
+	 * @param	start_time		its start time
+	 * @param	now			the current time
+	 * @param	at_window		the seconds an AT window stays open
+	 * @param	jobs			its jobs
+	 * @param	links			its links keyed by previous job
+	 * @param	time_constraints	its time constraints
+	 * @param	job_names		the jobs' name table
+	 */
+	void	load(const std::string& planning_name, const time_t start_time, const time_t now, const int64_t at_window, const rpc::v_jobs& jobs, const m_jobs_links& links, const m_time_constraints& time_constraints, Name_Table* job_names);
+
+	/**
+	 * invalidate
+	 *
+	 * Forgets the graph: the planning's structure changed
+	 */
+	void	invalidate();
+
+	/**
+	 * is_loaded
+	 *
+	 * @param	planning_name	the planning
+	 *
+	 * @return	true if the graph of this planning is loaded
+	 */
+	bool	is_loaded(const std::string& planning_name) const;
+
+	/**
+	 * set_state
+	 *
+	 * Records a state transition and releases the next jobs of a
+	 * succeeded one. The unknown jobs are ignored
+	 *
+	 * @param	job_id		the job's id
+	 * @param	state		its new state
+	 * @param	has_times	tells if the times are given
+	 * @param	start_time	its start time
+	 * @param	stop_time	its stop time
+	 */
+	void	set_state(const int job_id, const rpc::e_job_state::type state, const bool has_times, const time_t start_time, const time_t stop_time);
+
+	/**
+	 * get_ready_jobs
+	 *
+	 * Fires the expired timers and gives the queued jobs, the jobs which
+	 * are not ready anymore leave the queue
+	 *
+	 * @param	_return		the jobs, without their links
+	 * @param	node_name	the node to check, NULL means every node
+	 * @param	now		the current time
+	 */
+	void	get_ready_jobs(rpc::v_jobs& _return, const char* node_name, const time_t now);
+
+	/**
+	 * advance_windows
+	 *
+	 * Fires the expired timers, the jobs in time join the ready queue
+	 *
+	 * @param	now		the current time
+	 */
+	void	advance_windows(const time_t now);
+
+	/**
+	 * get_jobs_count
+	 *
+	 * @return	the number of jobs in the graph
+	 */
+	size_t	get_jobs_count() const;
+
+	/**
+	 * get_ready_count
+	 *
+	 * @return	the size of the ready queue
+	 */
+	size_t	get_ready_count() const;
+
+	/**
+	 * get_timers_count
+	 *
+	 * @return	the number of pending time windows' events
+	 */
+	size_t	get_timers_count() const;
+
+	/**
+	 * get_args
+	 *
+	 * @param	job_id	the job
+	 *
+	 * @return	the job's arguments, NULL if its command line needs the shell
+	 */
+	boost::shared_ptr<const v_command_args>	get_args(const int job_id) const;
+
+	/**
+	 * get_next_timeout
+	 *
+	 * Gives when get_ready_jobs should be called to fire the next timers
+	 *
+	 * @param	_return	the UNIX time
+	 *
+	 * @return	false if no timer is pending
+	 */
+	bool	get_next_timeout(time_t& _return) const;
+
+	/**
+	 * get_release_latencies
+	 *
+	 * Gives the last measured delays between the success of a job's last
+	 * previous job and its hand over by get_ready_jobs
+	 *
+	 * @param	_return	the latencies in microseconds, unsorted
+	 */
+	void	get_release_latencies(std::vector<uint64_t>& _return) const;
+
+private:
+	/**
+	 * planning_name
+	 *
+	 * The loaded planning, empty if the graph is not loaded
+	 */
+	std::string	planning_name;
+
+	/**
+	 * start_time
+	 *
+	 * The loaded planning's start time, the origin of the wheel
+	 */
+	time_t	start_time;
+
+	/**
+	 * wheel
+	 *
+	 * Opens and closes the jobs' time windows
+	 */
+	Timing_Wheel	wheel;
+
+	/**
+	 * release_latencies
+	 *
+	 * The last release latencies (microseconds), a ring of
+	 * DEPENDENCY_GRAPH_LATENCY_SAMPLES samples
+	 */
+	std::vector<uint64_t>	release_latencies;
+	size_t			release_latencies_next;
+
+	/**
+	 * jobs
+	 *
+	 * The jobs indexed by id
+	 */
+	m_graph_jobs	jobs;
+
+	/**
+	 * ready
+	 *
+	 * The ids of the released jobs, in release order
+	 */
+	std::deque<int>	ready;
+
+	/**
+	 * push_ready
+	 *
+	 * Queues a job if it is waiting for nothing
+	 *
+	 * @param	job_id	the job's id
+	 * @param	job	the job
+	 */
+	void	push_ready(const int job_id, graph_job& job);
+
+	/**
+	 * schedule_window
+	 *
+	 * Schedules the opening and the closing of a job's time window
+	 *
+	 * @param	job_id			the job's id
+	 * @param	time_constraints	its time constraints
+	 * @param	at_window		the seconds an AT window stays open
+	 *
+	 * @return	true if the window is open now
+	 */
+	bool	schedule_window(const int job_id, const rpc::v_time_constraints& time_constraints, const int64_t at_window);
+};
+
+// } // namespace ows
+
+#endif // DEPENDENCY_GRAPH_H
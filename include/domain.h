@@ -31,17 +31,29 @@
 
 #include <iostream>
 #include <vector>
+#include <deque>
+#include <set>
+#include <map>
 #include <string>
 #include <time.h>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/foreach.hpp>
 #include <boost/regex.hpp>
+#include <boost/bind.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/date_time/posix_time/conversion.hpp>
 
 #include "common.h"
 #include "cfg.h"
 #include "convertions.h"
 #include "database.h"
+#include "dependency_graph.h"
+#include "sql_database.h"
+#include "memory_database.h"
+#include "name_table.h"
 #include "job.h"
 
 #include "gen-cpp/ows_rpc.h"
@@ -53,6 +65,40 @@ class Job;
 
 typedef	std::vector<Job>	v_jobs;
 
+/*
+ * The jobs grouped by node
+ */
+typedef	boost::unordered_map<std::string, rpc::v_jobs>			m_jobs;
+
+/*
+ * The write-behind queue's counters
+ * The latencies are given in microseconds
+ */
+struct job_states_metrics {
+	uint64_t	updates;
+	uint64_t	batches;
+	uint64_t	failed_batches;
+	uint64_t	max_batch_size;
+	uint64_t	total_commit_latency;
+	uint64_t	max_commit_latency;
+	uint64_t	parked;
+
+	job_states_metrics() : updates(0), batches(0), failed_batches(0), max_batch_size(0), total_commit_latency(0), max_commit_latency(0), parked(0) {}
+};
+
+/*
+ * The delays between the success of a job's last previous job and the
+ * moment it is given to the poller, in microseconds
+ */
+struct release_latency_metrics {
+	uint64_t	samples;
+	uint64_t	p50;
+	uint64_t	p99;
+	uint64_t	max;
+
+	release_latency_metrics() : samples(0), p50(0), p99(0), max(0) {}
+};
+
 class Domain {
 public:
 	/**
@@ -216,6 +262,7 @@ public:
 	 * get_node
 	 *
 	 * Get the node according to its name and its domain
+	 * The resources and the jobs are fetched in a constant number of queries
 	 *
 	 * @param	domain_name	the name of the domain hosting the node
 	 * @param	_return		the node to use as output
@@ -227,6 +274,8 @@ public:
 	 * get_nodes
 	 *
 	 * Gets the nodes hosted by a domain
+	 * The whole content is fetched in a constant number of queries and
+	 * assembled in memory
 	 *
 	 * @param	domain_name	the name of the domain hosting the nodes
 	 * @param	_return		the nodes vector to use as output
@@ -315,14 +364,15 @@ public:
 	/**
 	 * update_job_state
 	 *
-	 * Updates the job's state
+	 * Queues the job's state transition, the writer thread commits it
+	 * with the other pending transitions (see flush_job_states)
 	 *
 	 * @param	domain_name	the domain hosting the job
 	 * @param	running_node	the name of the node running the job
 	 * @param	j_name		the job's name
 	 * @param	js		the new job's state
 	 *
-	 * @return	true on success
+	 * @return	true if the transition is queued
 	 *
 	 * TODO: use only the Job object (remove the second argument)
 	 */
@@ -331,7 +381,8 @@ public:
 	/**
 	 * update_job_state
 	 *
-	 * Updates the job's state
+	 * Queues the job's state transition, the writer thread commits it
+	 * with the other pending transitions (see flush_job_states)
 	 *
 	 * @param	domain_name	the domain hosting the job
 	 * @param	running_node	the name of the node running the job
@@ -340,7 +391,7 @@ public:
 	 * @param	start_time	the start time of the job
 	 * @param	stop_time	the stop time of the job
 	 *
-	 * @return	true on success
+	 * @return	true if the transition is queued
 	 *
 	 * TODO: use only the Job object (remove the second argument)
 	 */
@@ -349,7 +400,8 @@ public:
 	/**
 	 * update_job_state
 	 *
-	 * Updates the job's state
+	 * Updates the job's state, the usage counters of the job are recorded
+	 * when they are set
 	 *
 	 * @param	domain_name	the domain hosting the job
 	 * @param	j		the job to update
@@ -363,6 +415,117 @@ public:
 	 */
 	bool	update_job_state(const char* domain_name, const Job* j, const rpc::e_job_state::type& js, time_t& start_time, time_t& stop_time);
 
+	/**
+	 * add_jobs
+	 *
+	 * Adds jobs to the domain in a single transaction, a job whose time
+	 * constraints exceed the planning's duration is rejected
+	 *
+	 * @param	domain_name	the domain hosting the jobs
+	 * @param	jobs		the jobs to add
+	 * @param	_return		a result per job, in the same order
+	 *
+	 * @return	false if the transaction failed
+	 */
+	bool	add_jobs(const char* domain_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return);
+
+	/**
+	 * update_jobs
+	 *
+	 * Updates jobs in a single transaction
+	 *
+	 * @param	domain_name	the domain hosting the jobs
+	 * @param	jobs		the jobs to update
+	 * @param	_return		a result per job, in the same order
+	 *
+	 * @return	false if the transaction failed
+	 */
+	bool	update_jobs(const char* domain_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return);
+
+	/**
+	 * remove_jobs
+	 *
+	 * Removes jobs in a single transaction
+	 *
+	 * @param	domain_name	the domain hosting the jobs
+	 * @param	jobs		the jobs to remove
+	 * @param	_return		a result per job, in the same order
+	 *
+	 * @return	false if the transaction failed
+	 */
+	bool	remove_jobs(const char* domain_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return);
+
+	/**
+	 * update_job_states
+	 *
+	 * Queues the jobs' state transitions at once: the writer thread commits
+	 * them in the same transaction (see flush_job_states)
+	 *
+	 * @param	domain_name	the domain hosting the jobs
+	 * @param	jobs		the jobs, their node, name and state are used
+	 * @param	_return		a result per job, in the same order
+	 */
+	void	update_job_states(const char* domain_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return);
+
+	/**
+	 * flush_job_states
+	 *
+	 * Waits for the job states queued so far to be committed
+	 * The readers needing their own updates call it before querying
+	 *
+	 * @return	true on success, false if the commit failed
+	 */
+	bool	flush_job_states();
+
+	/**
+	 * get_job_states_metrics
+	 *
+	 * Gets the write-behind queue's counters
+	 *
+	 * @param	_return		the output
+	 */
+	void	get_job_states_metrics(job_states_metrics& _return);
+
+	/**
+	 * get_release_latency_metrics
+	 *
+	 * Gets the percentiles of the last release latencies
+	 *
+	 * @param	_return		the output
+	 */
+	void	get_release_latency_metrics(release_latency_metrics& _return);
+
+	/**
+	 * wait_for_events
+	 *
+	 * Sleeps until something may have made jobs ready: a job's state
+	 * changed, the planning was modified or a time window opens or closes
+	 * The events received since the last call wake it up at once
+	 *
+	 * @param	deadline	the UNIX time to wake up at anyway
+	 *
+	 * @return	true if woken up by an event, false on deadline
+	 */
+	bool	wait_for_events(const time_t deadline);
+
+	/**
+	 * notify_events
+	 *
+	 * Wakes the scheduler loop up
+	 */
+	void	notify_events();
+
+	/**
+	 * advance_windows
+	 *
+	 * Opens and closes the time windows up to now without handing the
+	 * ready jobs over: wait_for_events would return at once on a past
+	 * window while the executor is full
+	 *
+	 * @param	now		the current UNIX time
+	 */
+	void	advance_windows(const time_t now);
+
 ////////////////////////////////////////////////////////////////////////////////
 
 	/**
@@ -389,10 +552,12 @@ public:
 	 * get_jobs
 	 *
 	 * Gets the jobs' list
+	 * The links, the time constraints and the recovery types are fetched
+	 * once for the whole list
 	 *
 	 * @param	domain_name	the domain hosting the job
 	 * @param	_return		the output
-	 * @param	running_node	the node to get
+	 * @param	running_node	the node to get, NULL means every node
 	 */
 	void	get_jobs(const char* domain_name, rpc::v_jobs& _return, const char* running_node);
 
@@ -406,6 +571,8 @@ public:
 	 * @param	_return		the output
 	 * @param	running_node	the node to check
 	 * @param	job_name	the job to get
+	 *
+	 * @throw	ex_job		if the job does not exist
 	 */
 	void	get_job(const char* domain_name, rpc::t_job& _return, const char* running_node, const char* job_name);
 
@@ -454,9 +621,9 @@ public:
 	 *
 	 * @param	domain_name	the domain hosting the resource
 	 * @param	_return		the output
-	 * @param	node_name	the node using this resource
+	 * @param	node_name	the node using this resource, NULL means every node
 	 */
-	void	get_resources(const char* domain_name, rpc::v_resources& _return);
+	void	get_resources(const char* domain_name, rpc::v_resources& _return, const char* node_name);
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -563,14 +730,48 @@ private:
 	 * The map containing the paramaters read from the .cfg file
 	 */
 	Config*	config;
-#ifdef USE_MYSQL
+
 	/**
 	 * database
 	 *
-	 * The MySQL handler
+	 * The storage engine chosen by db_engine
+	 */
+	Database*	database;
+
+	/**
+	 * job_names, node_names
+	 *
+	 * The { name <=> id } tables shared by every planning
+	 * The objects are known by their ids inside the server, the names are
+	 * only used by the RPC calls and the logs
+	 */
+	Name_Table	job_names;
+	Name_Table	node_names;
+
+	/**
+	 * graph
+	 *
+	 * The links of the current planning, the ready jobs are read from it
+	 * It is loaded on demand and protected by graph_mutex. The lock is
+	 * taken before job_states_mutex and updates_mutex
 	 */
-	Mysql	database;
-#endif
+	Dependency_Graph	graph;
+	boost::mutex		graph_mutex;
+
+	/**
+	 * graph_recovery_types
+	 *
+	 * The recovery types of the graph's planning, loaded with it and
+	 * protected by graph_mutex: the launched jobs carry their timeouts
+	 */
+	m_recovery_types	graph_recovery_types;
+
+	/**
+	 * at_window
+	 *
+	 * How many seconds an AT time constraint lets its job start
+	 */
+	time_t	at_window;
 
 	/**
 	 * name
@@ -607,6 +808,39 @@ private:
 	 */
 	boost::mutex	updates_mutex;
 
+	/**
+	 * job_states
+	 *
+	 * The write-behind queue of the jobs' state transitions
+	 * The writer thread commits them in batches every commit_interval
+	 * milliseconds. The sequences count the queued and the committed
+	 * updates, the flushers wait for the second to reach the first.
+	 * The failed commits are counted by planning: after commit_retries
+	 * attempts, the planning's updates are dropped.
+	 */
+	d_job_state_updates		job_states;
+	boost::mutex			job_states_mutex;
+	boost::condition_variable	job_states_queued;
+	boost::condition_variable	job_states_committed;
+	uint64_t			job_states_queued_sequence;
+	uint64_t			job_states_committed_sequence;
+	bool				job_states_flush_requested;
+	bool				job_states_stopping;
+	job_states_metrics		job_states_counters;
+	boost::posix_time::time_duration	commit_interval;
+	size_t				commit_retries;
+	std::map<std::string, size_t>	job_states_failures;
+	boost::thread*			job_states_writer;
+
+	/**
+	 * events
+	 *
+	 * Wakes the scheduler loop up (see wait_for_events)
+	 */
+	boost::mutex			events_mutex;
+	boost::condition_variable	events_signaled;
+	bool				events_pending;
+
 	/**
 	 * root_logger
 	 *
@@ -614,6 +848,114 @@ private:
 	 */
 	log4cpp::Category&	root_logger = log4cpp::Category::getRoot();
 
+	/**
+	 * init_database
+	 *
+	 * Creates the storage engine chosen by db_engine (mysql by default)
+	 *
+	 * @throw	rpc::ex_processing	unknown or unavailable engine
+	 */
+	void	init_database();
+
+	/**
+	 * load_graph
+	 *
+	 * Loads the links of a planning from the database
+	 * graph_mutex must be held
+	 *
+	 * @param	planning_name	the planning to load
+	 */
+	void	load_graph(const std::string& planning_name);
+
+	/**
+	 * invalidate_graph
+	 *
+	 * Forgets the graph if the planning's structure changed, the next poll
+	 * loads it again
+	 *
+	 * @param	planning_name	the modified planning, NULL means any
+	 */
+	void	invalidate_graph(const char* planning_name);
+
+	/**
+	 * get_graph_ready_jobs
+	 *
+	 * Gets the jobs ready to be launched from the graph
+	 *
+	 * @param	_return		the output
+	 * @param	planning_name	the current planning
+	 * @param	running_node	the node to check, NULL means every node
+	 */
+	void	get_graph_ready_jobs(rpc::v_jobs& _return, const std::string& planning_name, const char* running_node);
+
+	/**
+	 * known_plannings
+	 *
+	 * The plannings found by planning_exists, they are never dropped
+	 */
+	std::set<std::string>	known_plannings;
+	boost::mutex		known_plannings_mutex;
+
+	/**
+	 * planning_exists
+	 *
+	 * Tells if a planning exists, the states of the other ones are not
+	 * queued: they would never be committed
+	 *
+	 * @param	planning_name	the planning
+	 *
+	 * @return	true if it exists
+	 */
+	bool	planning_exists(const char* planning_name);
+
+	/**
+	 * queue_job_state
+	 *
+	 * Applies a state transition to the graph and appends it to the
+	 * write-behind queue
+	 *
+	 * @param	domain_name	the domain hosting the job
+	 * @param	job_id		the job's id
+	 * @param	js		the new job's state
+	 * @param	has_times	tells if the times are given
+	 * @param	start_time	the start time of the job
+	 * @param	stop_time	the stop time of the job
+	 * @param	usage		what the job consumed, NULL if it is not known
+	 *
+	 * @return	false if the job or the planning is unknown
+	 */
+	bool	queue_job_state(const char* domain_name, const int job_id, const rpc::e_job_state::type js, const bool has_times, const time_t start_time, const time_t stop_time, const job_usage* usage);
+
+	/**
+	 * queue_job_states
+	 *
+	 * Applies state transitions to the graph and appends them to the
+	 * write-behind queue in one block
+	 *
+	 * @param	updates		the transitions of known jobs
+	 */
+	void	queue_job_states(const d_job_state_updates& updates);
+
+	/**
+	 * write_job_states
+	 *
+	 * The writer thread's routine: waits for the queued transitions, lets
+	 * the batch grow during commit_interval then commits it
+	 * The updates of a failed planning are kept at the head of the queue
+	 * and retried, up to commit_retries times
+	 */
+	void	write_job_states();
+
+	/**
+	 * commit_job_states
+	 *
+	 * Commits a batch, one transaction per planning
+	 *
+	 * @param	batch		the transitions
+	 * @param	_return		the plannings whose transaction failed
+	 */
+	void	commit_job_states(const d_job_state_updates& batch, std::set<std::string>& _return);
+
 	/**
 	 * get_add_node_query
 	 *
@@ -0,0 +1,238 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: executor.h
+ * Description: admits the local jobs and hands them to the supervisor.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <boost/bind.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "common.h"
+#include "cfg.h"
+#include "domain.h"
+#include "job.h"
+#include "supervisor.h"
+
+// namespace ows {
+
+/*
+ * A launch waiting for its admission
+ * The Job is built again by the worker: it cannot be assigned
+ * The heaviest jobs go first, then the oldest ones
+ */
+struct executor_task {
+	rpc::t_job			job;
+	int				job_id;
+	int				node_id;
+	int				priority;
+	uint64_t			sequence;
+	boost::posix_time::ptime	submitted;
+	boost::shared_ptr<const v_command_args>	args;
+
+	executor_task(const Job& j, const uint64_t s) : job(*j.get_job()), job_id(j.get_id()), node_id(j.get_node_id()), priority(j.get_weight()), sequence(s), submitted(boost::posix_time::microsec_clock::universal_time()), args(j.get_args()) {}
+
+	bool operator<(const executor_task& t) const {
+		if ( this->priority != t.priority )
+			return this->priority < t.priority;
+		return this->sequence > t.sequence;
+	}
+};
+
+/*
+ * The pending launches and the running jobs of a node
+ */
+struct executor_node {
+	std::priority_queue<executor_task>	pending;
+	size_t					running;
+
+	executor_node() : running(0) {}
+};
+
+typedef	boost::unordered_map<std::string, executor_node>	m_executor_nodes;
+
+/*
+ * The executor's counters
+ * The waits for admission are given in microseconds
+ */
+struct executor_metrics {
+	uint64_t	submitted;
+	uint64_t	rejected;
+	uint64_t	started;
+	uint64_t	running;
+	uint64_t	queue_depth;
+	uint64_t	max_queue_depth;
+	uint64_t	total_admission_wait;
+	uint64_t	max_admission_wait;
+
+	executor_metrics() : submitted(0), rejected(0), started(0), running(0), queue_depth(0), max_queue_depth(0), total_admission_wait(0), max_admission_wait(0) {}
+};
+
+/**
+ * Executor
+ *
+ * Admits the jobs and hands them to the supervisor, no thread is held by a
+ * running job: the admissions are made by the submitter and by the
+ * supervisor when a job ends
+ * - executor_max_jobs: the jobs running at the same time
+ * - executor_node_limit: the jobs of a node running at the same time
+ * - executor_queue_size: the launches waiting for their admission, the
+ *   scheduler stops submitting when the queue is full
+ */
+class Executor {
+public:
+	/**
+	 * Executor
+	 *
+	 * The constructor, starts the supervisor
+	 *
+	 * @param	d	the domain to wake up when the queue has room again
+	 * @param	c	the configuration object
+	 */
+	Executor(Domain* d, Config* c);
+
+	/**
+	 * ~Executor
+	 *
+	 * The destructor, waits for the pending and the running jobs
+	 */
+	~Executor();
+
+	/**
+	 * submit
+	 *
+	 * Queues a job whose state is already RUNNING
+	 *
+	 * @param	j	the job
+	 *
+	 * @return	false if the queue is full
+	 */
+	bool	submit(const Job& j);
+
+	/**
+	 * is_full
+	 *
+	 * @return	true if submit would reject a job
+	 */
+	bool	is_full();
+
+	/**
+	 * get_metrics
+	 *
+	 * Gets the executor's counters
+	 *
+	 * @param	_return		the output
+	 */
+	void	get_metrics(executor_metrics& _return);
+
+private:
+	/**
+	 * domain
+	 *
+	 * The scheduler to wake up
+	 */
+	Domain*	domain;
+
+	/**
+	 * max_jobs, node_limit, queue_size
+	 *
+	 * The limits read from the configuration
+	 */
+	size_t	max_jobs;
+	size_t	node_limit;
+	size_t	queue_size;
+
+	/**
+	 * nodes
+	 *
+	 * The pending and the running jobs by node, protected by mutex
+	 */
+	m_executor_nodes		nodes;
+	boost::mutex			mutex;
+	boost::condition_variable	idle;
+	uint64_t			sequence;
+	bool				stopping;
+	executor_metrics		counters;
+
+
+	/**
+	 * root_logger
+	 *
+	 * This is a reference to the root logger
+	 */
+	log4cpp::Category&	root_logger = log4cpp::Category::getRoot();
+
+	/**
+	 * supervisor
+	 *
+	 * Runs the admitted jobs, it is destroyed first
+	 */
+	Supervisor	supervisor;
+
+	/**
+	 * dispatch
+	 *
+	 * Admits the pending jobs within the limits and spawns them, the slots
+	 * of the jobs which cannot be spawned are given to the next ones
+	 */
+	void	dispatch();
+
+	/**
+	 * release
+	 *
+	 * Frees the slot of an ended job and admits the next ones
+	 *
+	 * @param	node_name	the job's node
+	 */
+	void	release(const std::string& node_name);
+
+	/**
+	 * admit
+	 *
+	 * Takes the next job of the nodes having a free slot
+	 * mutex must be held
+	 *
+	 * @param	_return		the node of the job
+	 *
+	 * @return	false if no job can be admitted
+	 */
+	bool	admit(executor_node*& _return);
+};
+
+// } // namespace ows
+
+#endif // EXECUTOR_H
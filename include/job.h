@@ -32,7 +32,19 @@
 
 #include <vector>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <boost/shared_ptr.hpp>
+
 #include "common.h"
+#include "convertions.h"
 //#include "cfg.h"
 #include "domain.h"
 
@@ -70,6 +82,43 @@ public:
 	 */
 	bool	run();
 
+	/**
+	 * execute
+	 *
+	 * Runs the job already set RUNNING and updates its final state
+	 * The scheduler sets the state before handing the job to a thread so
+	 * that the next poll cannot start it twice
+	 *
+	 * @return	true	state updated sucessfuly
+	 */
+	bool	execute();
+
+	/**
+	 * spawn
+	 *
+	 * Starts the job's process with posix_spawn, or vfork when it goes into
+	 * a cgroup: the scheduler's memory is never copied, whatever its size
+	 * The standard input is /dev/null, the signals are set to their
+	 * defaults, the process leads its own process group
+	 *
+	 * @param	_return		the process' pid
+	 * @param	stdout_fd	the standard output, -1 to keep the scheduler's
+	 * @param	stderr_fd	the standard error, -1 to keep the scheduler's
+	 * @param	direct		executes the split command line without shell
+	 * @param	cgroup_fd	the cgroup.procs the process writes itself into
+	 *				before running the job, -1 for none
+	 *
+	 * @return	0 on success, the error's number otherwise
+	 */
+	int	spawn(pid_t& _return, const int stdout_fd, const int stderr_fd, const bool direct, const int cgroup_fd) const;
+
+	/**
+	 * is_direct
+	 *
+	 * @return	true if the command line can be executed without shell
+	 */
+	bool	is_direct() const;
+
 	/**
 	 * update_state
 	 *
@@ -106,9 +155,16 @@ public:
 	/**
 	 * get_id
 	 *
-	 * @return	the job's id
+	 * @return	the job's id, 0 if it is unknown
 	 */
-	int	get_id()  const;
+	int	get_id() const;
+
+	/**
+	 * get_node_id
+	 *
+	 * @return	the id of the node hosting the job, 0 if it is unknown
+	 */
+	int	get_node_id() const;
 
 	/**
 	 * get_name
@@ -176,12 +232,39 @@ public:
 	/**
 	 * set_id
 	 *
-	 * TODO: implement me
-	 *
-	 * @param	id	the job's id
+	 * @param	id	the job's id given by the domain's name table
 	 */
 	void	set_id(const int);
 
+	/**
+	 * set_node_id
+	 *
+	 * @param	id	the node's id given by the domain's name table
+	 */
+	void	set_node_id(const int);
+
+	/**
+	 * get_args
+	 *
+	 * @return	the arguments to execute without shell, NULL if the
+	 * command line needs the shell
+	 */
+	const boost::shared_ptr<const v_command_args>&	get_args() const;
+
+	/**
+	 * set_args
+	 *
+	 * @param	a	the command line split by the dependency graph
+	 */
+	void	set_args(const boost::shared_ptr<const v_command_args>& a);
+
+	/**
+	 * set_failure
+	 *
+	 * @param	f	why the job failed, recorded with its final state
+	 */
+	void	set_failure(const rpc::e_job_failure::type f);
+
 private:
 	/**
 	 * domain
@@ -198,6 +281,21 @@ private:
 	 */
 	rpc::t_job	job;
 
+	/**
+	 * id, node_id
+	 *
+	 * The ids used inside the server, rpc::t_job only knows the names
+	 */
+	int		id;
+	int		node_id;
+
+	/**
+	 * args
+	 *
+	 * The command line split once for all the job's launches
+	 */
+	boost::shared_ptr<const v_command_args>	args;
+
 	/**
 	 * root_logger
 	 *
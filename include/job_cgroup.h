@@ -0,0 +1,257 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: job_cgroup.h
+ * Description: limits and measures the jobs using cgroup v2.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef JOB_CGROUP_H
+#define JOB_CGROUP_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "common.h"
+#include "cfg.h"
+#include "convertions.h"
+
+// namespace ows {
+
+/*
+ * The cpu.max period in microseconds: 100 percents of a CPU
+ */
+#define JOB_CGROUP_CPU_PERIOD	100000
+
+/*
+ * The cgroups' counters
+ */
+struct job_cgroups_metrics {
+	uint64_t	created;
+	uint64_t	failures;
+	uint64_t	oom_killed;
+	uint64_t	stale;
+
+	job_cgroups_metrics() : created(0), failures(0), oom_killed(0), stale(0) {}
+};
+
+/**
+ * Job_Cgroups
+ *
+ * Puts each job in its own cgroup v2 leaf: <job_cgroup_path>/<planning>.<job>.<sequence>
+ * - cpu.weight: 100 per unit of the job's weight
+ * - cpu.max: job_cgroup_cpu_per_weight percents of a CPU per unit of weight
+ * - memory.max: job_cgroup_memory_per_weight bytes per unit of weight
+ * The usage of the leaf (the job and all its children) is read at its end
+ *
+ * The cgroups are disabled when job_cgroup_path is not set or is not a
+ * writable cgroup v2 directory: the scheduler must not run in it and the
+ * controllers which cannot be enabled are not used
+ */
+class Job_Cgroups {
+public:
+	/**
+	 * Job_Cgroups
+	 *
+	 * The constructor, checks the cgroups' directory
+	 *
+	 * @param	c	the configuration object
+	 *
+	 * @throw	rpc::ex_processing	the configuration is NULL
+	 */
+	Job_Cgroups(Config* c);
+
+	/**
+	 * ~Job_Cgroups
+	 *
+	 * The destructor, removes the stale leaves which are empty now
+	 */
+	~Job_Cgroups();
+
+	/**
+	 * is_enabled
+	 *
+	 * @return	false if the jobs are not put into cgroups
+	 */
+	bool	is_enabled() const;
+
+	/**
+	 * create
+	 *
+	 * Creates a job's leaf and sets its limits
+	 * The names are not escaped: they must be usable file names
+	 *
+	 * @param	_return		the leaf's path
+	 * @param	j		the job
+	 *
+	 * @return	false if the cgroups are disabled, a name is unusable or on failure
+	 */
+	bool	create(std::string& _return, const rpc::t_job& j);
+
+	/**
+	 * attach
+	 *
+	 * Opens the cgroup.procs of a leaf: the job's process writes itself
+	 * into it before running the job (see Job::spawn), so the processes it
+	 * starts cannot escape
+	 *
+	 * @param	leaf	the leaf's path
+	 *
+	 * @return	the descriptor to close, -1 on failure
+	 */
+	int	attach(const std::string& leaf);
+
+	/**
+	 * collect
+	 *
+	 * Reads the usage of an ended job's leaf
+	 *
+	 * @param	leaf	the leaf's path
+	 * @param	j	the job, its usage counters are set
+	 */
+	void	collect(const std::string& leaf, rpc::t_job& j);
+
+	/**
+	 * remove
+	 *
+	 * Removes a job's leaf, the leaves still holding processes are
+	 * removed later
+	 *
+	 * @param	leaf	the leaf's path
+	 */
+	void	remove(const std::string& leaf);
+
+	/**
+	 * get_metrics
+	 *
+	 * Gets the cgroups' counters
+	 *
+	 * @param	_return		the output
+	 */
+	void	get_metrics(job_cgroups_metrics& _return);
+
+private:
+	/**
+	 * path, cpu_per_weight, memory_per_weight
+	 *
+	 * The settings read from the configuration
+	 */
+	std::string	path;
+	int64_t		cpu_per_weight;
+	int64_t		memory_per_weight;
+
+	/**
+	 * enabled, cpu, memory, io
+	 *
+	 * The features found by check
+	 */
+	bool	enabled;
+	bool	cpu;
+	bool	memory;
+	bool	io;
+
+	/**
+	 * sequence, stale
+	 *
+	 * The suffix of the next leaf and the leaves to remove, protected by
+	 * mutex
+	 */
+	uint64_t			sequence;
+	std::vector<std::string>	stale;
+	boost::mutex			mutex;
+	job_cgroups_metrics		counters;
+
+	/**
+	 * root_logger
+	 *
+	 * This is a reference to the root logger
+	 */
+	log4cpp::Category&	root_logger = log4cpp::Category::getRoot();
+
+	/**
+	 * check
+	 *
+	 * Enables the controllers and tries to create a leaf
+	 *
+	 * @return	false if the cgroups cannot be used
+	 */
+	bool	check();
+
+	/**
+	 * enable
+	 *
+	 * Enables a controller for the leaves
+	 *
+	 * @param	controllers	the available controllers
+	 * @param	name		the controller
+	 *
+	 * @return	false if the controller cannot be used
+	 */
+	bool	enable(const std::string& controllers, const char* name);
+
+	/**
+	 * read_file, write_file
+	 *
+	 * Read and write the cgroups' interface files
+	 *
+	 * @param	file	the file's path
+	 * @param	_return	the content read
+	 * @param	value	the content to write
+	 *
+	 * @return	false on failure, errno is set
+	 */
+	bool	read_file(const std::string& file, std::string& _return);
+	bool	write_file(const std::string& file, const std::string& value);
+
+	/**
+	 * read_key
+	 *
+	 * Sums the values of a key in a flat keyed file (cpu.stat, memory.events)
+	 * or a nested keyed one (io.stat)
+	 *
+	 * @param	content	the file's content
+	 * @param	key	the key, followed by a blank or an equal sign
+	 * @param	_return	the sum
+	 *
+	 * @return	false if the key is missing
+	 */
+	bool	read_key(const std::string& content, const std::string& key, int64_t& _return);
+};
+
+// } // namespace ows
+
+#endif // JOB_CGROUP_H
@@ -0,0 +1,330 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: job_log.h
+ * Description: writes the jobs' outputs into size-capped and rotated files.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef JOB_LOG_H
+#define JOB_LOG_H
+
+#include <deque>
+#include <string>
+
+#include <stdint.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <zlib.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "common.h"
+#include "cfg.h"
+#include "convertions.h"
+
+// namespace ows {
+
+/*
+ * The size of the buffer used to compress the rotated files
+ */
+#define JOB_LOG_COMPRESS_BUFFER	65536
+
+/*
+ * The streams written into a job's log
+ */
+enum e_job_log_stream {
+	JOB_STDOUT	= 1,
+	JOB_STDERR	= 2
+};
+
+/*
+ * A rotated file to compress and an expired one to remove
+ * The tasks are run in order by the archiving thread: a file is compressed
+ * before its removal
+ */
+struct job_log_task {
+	std::string	rotated;
+	std::string	expired;
+};
+
+typedef	std::deque<job_log_task>	d_job_log_tasks;
+
+/*
+ * The logs' counters
+ */
+struct job_logs_metrics {
+	uint64_t	opened;
+	uint64_t	written_bytes;
+	uint64_t	lost_bytes;
+	uint64_t	rotated;
+	uint64_t	compressed;
+
+	job_logs_metrics() : opened(0), written_bytes(0), lost_bytes(0), rotated(0), compressed(0) {}
+};
+
+class Job_Logs;
+
+/**
+ * Job_Log
+ *
+ * The log of a running job: <job_logs_path>/<planning>/<job>.log
+ * When the file reaches job_log_max_size it becomes <job>.log.<sequence>,
+ * the job_log_rotations last rotated files are kept
+ *
+ * A Job_Log is used by one thread at a time
+ */
+class Job_Log {
+public:
+	/**
+	 * Job_Log
+	 *
+	 * The constructor, opens the file in append mode: a job run again
+	 * keeps its previous output
+	 *
+	 * @param	l	the logs' manager
+	 * @param	p	the file's path
+	 */
+	Job_Log(Job_Logs* l, const std::string& p);
+
+	/**
+	 * ~Job_Log
+	 *
+	 * The destructor, closes the file
+	 */
+	~Job_Log();
+
+	/**
+	 * write
+	 *
+	 * Appends a job's output to its file, the bytes are counted even if
+	 * the file cannot be written
+	 *
+	 * @param	stream	the stream the data comes from
+	 * @param	data	the output
+	 * @param	length	the data's length
+	 */
+	void	write(const e_job_log_stream stream, const char* data, const size_t length);
+
+	/**
+	 * get_stdout_bytes, get_stderr_bytes
+	 *
+	 * @return	the bytes written on the job's streams
+	 */
+	int64_t	get_stdout_bytes() const;
+	int64_t	get_stderr_bytes() const;
+
+private:
+	/**
+	 * logs
+	 *
+	 * The manager giving the limits and archiving the rotated files
+	 */
+	Job_Logs*	logs;
+
+	/**
+	 * path, fd, size
+	 *
+	 * The current file, its descriptor (-1 if it cannot be opened) and
+	 * its size
+	 */
+	std::string	path;
+	int		fd;
+	int64_t		size;
+
+	/**
+	 * sequence
+	 *
+	 * The suffix given to the next rotated file
+	 */
+	uint64_t	sequence;
+
+	/**
+	 * stdout_bytes, stderr_bytes
+	 *
+	 * The counters recorded in the job's record
+	 */
+	int64_t	stdout_bytes;
+	int64_t	stderr_bytes;
+
+	/**
+	 * root_logger
+	 *
+	 * This is a reference to the root logger
+	 */
+	log4cpp::Category&	root_logger = log4cpp::Category::getRoot();
+
+	/**
+	 * rotate
+	 *
+	 * Renames the current file and opens a new one
+	 */
+	void	rotate();
+};
+
+/**
+ * Job_Logs
+ *
+ * Gives the jobs' logs and archives the rotated files from its own thread
+ * - job_logs_path: the directory holding one directory per planning
+ * - job_log_max_size: the bytes of a file before its rotation
+ * - job_log_rotations: the rotated files kept by job
+ * - job_log_compress: yes to gzip the rotated files
+ */
+class Job_Logs {
+public:
+	/**
+	 * Job_Logs
+	 *
+	 * The constructor, starts the archiving thread
+	 *
+	 * @param	c	the configuration object
+	 *
+	 * @throw	rpc::ex_processing	the configuration is NULL
+	 */
+	Job_Logs(Config* c);
+
+	/**
+	 * ~Job_Logs
+	 *
+	 * The destructor, archives the remaining files
+	 */
+	~Job_Logs();
+
+	/**
+	 * open
+	 *
+	 * Gives the log of a job, the planning's directory is created if needed
+	 * The names are not escaped: they must be usable file names
+	 *
+	 * @param	planning_name	the job's planning
+	 * @param	job_name	the job
+	 *
+	 * @return	the log to delete by the caller, NULL if a name is unusable
+	 */
+	Job_Log*	open(const std::string& planning_name, const std::string& job_name);
+
+	/**
+	 * archive
+	 *
+	 * Queues a rotated file
+	 *
+	 * @param	rotated		the file to compress
+	 * @param	expired		the file to remove, empty if none
+	 */
+	void	archive(const std::string& rotated, const std::string& expired);
+
+	/**
+	 * add_written, add_lost
+	 *
+	 * Updates the counters
+	 *
+	 * @param	bytes	the bytes written or lost
+	 */
+	void	add_written(const uint64_t bytes);
+	void	add_lost(const uint64_t bytes);
+
+	/**
+	 * get_max_size, get_rotations
+	 *
+	 * @return	the configured limits
+	 */
+	int64_t		get_max_size() const;
+	uint64_t	get_rotations() const;
+
+	/**
+	 * get_metrics
+	 *
+	 * Gets the logs' counters
+	 *
+	 * @param	_return		the output
+	 */
+	void	get_metrics(job_logs_metrics& _return);
+
+private:
+	/**
+	 * path, max_size, rotations, compress
+	 *
+	 * The settings read from the configuration
+	 */
+	std::string	path;
+	int64_t		max_size;
+	uint64_t	rotations;
+	bool		compress;
+
+	/**
+	 * tasks
+	 *
+	 * The rotated files waiting for the archiving thread, protected by mutex
+	 */
+	d_job_log_tasks			tasks;
+	boost::mutex			mutex;
+	boost::condition_variable	queued;
+	bool				stopping;
+	job_logs_metrics		counters;
+
+	/**
+	 * thread
+	 *
+	 * The archiving thread
+	 */
+	boost::thread*	thread;
+
+	/**
+	 * root_logger
+	 *
+	 * This is a reference to the root logger
+	 */
+	log4cpp::Category&	root_logger = log4cpp::Category::getRoot();
+
+	/**
+	 * archiver
+	 *
+	 * The archiving thread's loop
+	 */
+	void	archiver();
+
+	/**
+	 * gzip
+	 *
+	 * Compresses a file into <file>.gz and removes it
+	 *
+	 * @param	file	the file to compress
+	 *
+	 * @return	false on failure, the file is kept
+	 */
+	bool	gzip(const std::string& file);
+};
+
+// } // namespace ows
+
+#endif // JOB_LOG_H
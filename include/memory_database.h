@@ -0,0 +1,223 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: memory_database.h
+ * Description: the storage keeping the plannings in hash tables.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef MEMORY_DATABASE_H
+#define MEMORY_DATABASE_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <time.h>
+
+#include <boost/foreach.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "common.h"
+#include "convertions.h"
+#include "database.h"
+
+// namespace ows {
+
+/*
+ * The tables of a planning, indexed by name: the ids are only used by the
+ * state transitions (see update_job_states)
+ * - the jobs are stored without their links and time constraints
+ * - the links are indexed both ways
+ */
+typedef	boost::unordered_map<std::string, rpc::t_node>			m_memory_nodes;
+typedef	boost::unordered_map<std::string, rpc::t_job>			m_memory_jobs;
+typedef	boost::unordered_map<std::string, std::set<std::string> >	m_memory_index;
+
+struct memory_planning {
+	m_memory_nodes		nodes;
+	m_memory_jobs		jobs;
+	m_memory_index		node_jobs;
+	m_memory_index		jobs_next;
+	m_memory_index		jobs_previous;
+	m_time_constraints	time_constraints;
+	m_resources		resources;
+	m_recovery_types	recovery_types;
+	rpc::v_macro_jobs	macro_jobs;
+};
+
+typedef	boost::unordered_map<std::string, memory_planning>	m_memory_plannings;
+
+/**
+ * Memory_Database
+ *
+ * Nothing is written on disk: the plannings are lost when the master stops
+ * It is used by the benchmarks and the small deployments
+ */
+class Memory_Database : public Database {
+public:
+	/**
+	 * Memory_Database
+	 *
+	 * The constructor
+	 *
+	 * @param	jobs	the jobs' name table
+	 * @param	nodes	the nodes' name table
+	 */
+	Memory_Database(Name_Table* jobs, Name_Table* nodes);
+
+	/**
+	 * ~Memory_Database
+	 *
+	 * The destructor
+	 */
+	~Memory_Database();
+
+	bool	init_planning(const std::string& planning_name, const std::string& skeleton);
+	bool	planning_exists(const std::string& planning_name);
+	bool	clone_planning(const std::string& source, const std::string& target);
+	void	get_planning_names(std::vector<std::string>& _return);
+	void	load_names(const char* planning_name);
+
+	bool	add_node(const char* planning_name, const std::string& node_name, const rpc::integer weight);
+	bool	remove_node(const char* planning_name, const std::string& node_name);
+	bool	add_job(const char* planning_name, const rpc::t_job& j);
+	bool	update_job(const char* planning_name, const rpc::t_job& j);
+	bool	remove_job(const char* planning_name, const std::string& job_name);
+	bool	add_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return);
+	bool	update_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return);
+	bool	remove_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return);
+	bool	update_job_states(const d_job_state_updates& batch);
+	bool	add_resource(const char* planning_name, const rpc::t_resource& r, const char* node_name);
+
+	void	get_nodes(const char* planning_name, rpc::v_nodes& _return, const char* node_name);
+	void	get_jobs(const char* planning_name, rpc::v_jobs& _return, const char* node_name, const char* job_name);
+	void	get_ready_jobs(const char* planning_name, rpc::v_jobs& _return, const char* node_name);
+	void	get_jobs_links(const char* planning_name, m_jobs_links& _return, const char* node_name, const char* job_name);
+	void	get_time_constraints(const char* planning_name, m_time_constraints& _return, const char* node_name, const char* job_name);
+	void	get_resources(const char* planning_name, m_resources& _return, const char* node_name);
+	void	get_recovery_types(const char* planning_name, m_recovery_types& _return);
+	void	get_macro_jobs(const char* planning_name, rpc::v_macro_jobs& _return);
+
+	int64_t	count_jobs_in_state(const char* planning_name, const rpc::e_job_state::type state);
+	int64_t	count_node_jobs(const char* planning_name, const char* node_name);
+
+	bool		sql_exec(const char* planning_name, const std::string& query);
+	uint64_t	get_queries_count();
+
+private:
+	/**
+	 * plannings
+	 *
+	 * The plannings' tables, protected by mutex
+	 */
+	m_memory_plannings	plannings;
+	boost::mutex		mutex;
+
+	/**
+	 * operations_count
+	 *
+	 * The number of calls, protected by mutex
+	 */
+	uint64_t		operations_count;
+
+	/**
+	 * root_logger
+	 *
+	 * This is a reference to the root logger
+	 */
+	log4cpp::Category&	root_logger = log4cpp::Category::getRoot();
+
+	/**
+	 * get_planning
+	 *
+	 * Gives the tables of a planning and counts the operation
+	 * The mutex must be held
+	 *
+	 * @param	planning_name	the planning's name
+	 *
+	 * @return	the tables
+	 * @throw	rpc::ex_processing	the planning does not exist
+	 */
+	memory_planning&	get_planning(const char* planning_name);
+
+	/**
+	 * unlink_job
+	 *
+	 * Removes the links and the time constraints of a job
+	 *
+	 * @param	p		the planning
+	 * @param	job_name	the job
+	 */
+	void	unlink_job(memory_planning& p, const std::string& job_name);
+
+	/**
+	 * erase_job
+	 *
+	 * Removes a job, its links and its time constraints if it exists
+	 *
+	 * @param	p		the planning
+	 * @param	job_name	the job
+	 */
+	void	erase_job(memory_planning& p, const std::string& job_name);
+
+	/**
+	 * store_job
+	 *
+	 * Stores a new job, its links and its time constraints
+	 * The runtime values are not copied: the job is waiting
+	 *
+	 * @param	p		the planning
+	 * @param	j		the job
+	 */
+	void	store_job(memory_planning& p, const rpc::t_job& j);
+
+	/**
+	 * link_jobs
+	 *
+	 * Adds a link between two jobs
+	 *
+	 * @param	p		the planning
+	 * @param	previous	the job to wait for
+	 * @param	next		the job to run after it
+	 */
+	void	link_jobs(memory_planning& p, const std::string& previous, const std::string& next);
+
+	/**
+	 * is_ready
+	 *
+	 * Tells if a job can be launched, like the get_ready_job view does:
+	 * - a previous job succeeded or the job is waiting and has no previous job
+	 * - it has no time constraint or one of them matches the current minute
+	 *
+	 * @param	p		the planning
+	 * @param	job		the job
+	 * @param	now		the current minute of the day
+	 *
+	 * @return	true	the job is ready
+	 */
+	bool	is_ready(const memory_planning& p, const rpc::t_job& job, const int64_t now);
+};
+
+// } // namespace ows
+
+#endif // MEMORY_DATABASE_H
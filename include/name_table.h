@@ -0,0 +1,133 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: name_table.h
+ * Description: interns the jobs' and the nodes' names into integer ids.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef NAME_TABLE_H
+#define NAME_TABLE_H
+
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+// namespace ows {
+
+/**
+ * Name_Table
+ *
+ * Gives each name a stable id, starting at 1. 0 means "unknown"
+ * The ids are never reused: a removed object keeps its id so that the
+ * older plannings can still be read
+ */
+class Name_Table {
+public:
+	/**
+	 * Name_Table
+	 *
+	 * The constructor
+	 */
+	Name_Table();
+
+	/**
+	 * intern
+	 *
+	 * Gives the id of a name, a new id is created if the name is unknown
+	 *
+	 * @param	name	the name
+	 *
+	 * @return	the id
+	 */
+	int	intern(const std::string& name);
+
+	/**
+	 * find
+	 *
+	 * Gives the id of a name
+	 *
+	 * @param	name	the name
+	 *
+	 * @return	the id, 0 if the name is unknown
+	 */
+	int	find(const std::string& name);
+
+	/**
+	 * get_name
+	 *
+	 * Gives the name of an id
+	 *
+	 * @param	_return	the name
+	 * @param	id	the id
+	 *
+	 * @return	false if the id is unknown
+	 */
+	bool	get_name(std::string& _return, const int id);
+
+	/**
+	 * insert
+	 *
+	 * Registers an id read from the storage
+	 * The newest id wins if a name has several ids
+	 *
+	 * @param	id	the id
+	 * @param	name	the name
+	 */
+	void	insert(const int id, const std::string& name);
+
+	/**
+	 * size
+	 *
+	 * @return	the number of ids given so far
+	 */
+	size_t	size();
+
+private:
+	/**
+	 * ids
+	 *
+	 * The { name => id } map
+	 */
+	boost::unordered_map<std::string, int>	ids;
+
+	/**
+	 * names
+	 *
+	 * The names indexed by id, names[0] is unused
+	 */
+	std::vector<std::string>	names;
+
+	/**
+	 * mutex
+	 *
+	 * Protects the tables
+	 */
+	boost::mutex	mutex;
+};
+
+// } // namespace ows
+
+#endif // NAME_TABLE_H
@@ -35,6 +35,7 @@
 #include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
@@ -46,6 +47,7 @@
 // namespace ows {
 
 class Rpc_Client;
+class Rpc_Clients;
 
 /**
  * p_host_keys / m_host_keys
@@ -110,12 +112,18 @@ typedef boost::multi_index::multi_index_container<
 typedef	std::pair<std::string,m_weighted_gateway>	p_routing_table;
 typedef	std::map<std::string,m_weighted_gateway>	m_routing_table;
 
+/**
+ * Router
+ *
+ * The routes and the master node are shared by the RPC server's
+ * connections, their accessors are thread-safe
+ */
 class Router {
 public:
 	/**
 	 * Router
 	 *
-	 * Initializes its Rpc_Client
+	 * Initializes its Rpc_Client and the connections' pools
 	 * Gets the Config object
 	 *
 	 * @param	c	Config object
@@ -125,7 +133,7 @@ public:
 	/**
 	 * ~Router
 	 *
-	 * Deletes its Rpc_Client
+	 * Deletes its Rpc_Client and closes the kept connections
 	 */
 	~Router();
 
@@ -220,9 +228,9 @@ public:
 	 *
 	 * @param	destination	the node to reach
 	 *
-	 * @return	the lightest usable gateway
+	 * @return	the lightest usable gateway, empty if the destination is unknown
 	 */
-	std::string*	get_gateway(const std::string& destination);
+	std::string	get_gateway(const std::string& destination);
 
 	/**
 	 * get_gateway
@@ -232,9 +240,9 @@ public:
 	 *
 	 * @param	destination	the node to reach
 	 *
-	 * @return	the lightest usable gateway
+	 * @return	the lightest usable gateway, empty if the destination is unknown
 	 */
-	std::string*	get_gateway(const char* destination);
+	std::string	get_gateway(const char* destination);
 
 	/**
 	 * delete_gateway
@@ -279,9 +287,9 @@ public:
 	 *
 	 * Gets the master node's name
 	 *
-	 * @return	its name
+	 * @return	its name, empty if not reached yet
 	 */
-	std::string*	get_master_node();
+	std::string	get_master_node();
 
 	/**
 	 * get_reachable_peers_number
@@ -292,6 +300,15 @@ public:
 	 */
 	u_int	get_reachable_peers_number();
 
+	/**
+	 * get_clients
+	 *
+	 * Gets the connections' pools shared by the RPC clients
+	 *
+	 * @return	the pools
+	 */
+	Rpc_Clients*	get_clients();
+
 private:
 
 	/**
@@ -324,10 +341,20 @@ private:
 	 */
 	Rpc_Client*	rpc_client;
 
+	/**
+	 * clients
+	 *
+	 * The connections to the gateways, kept between the calls of the
+	 * router and of the RPC server's handlers
+	 */
+	Rpc_Clients*	clients;
+
 	/**
 	 * updates_mutex
 	 *
-	 * TODO: use it
+	 * Protects the routing table and the master node: the RPC server's
+	 * connections read them concurrently. The gateways and the master
+	 * node given as pointers are never freed while their route exists
 	 */
 	boost::mutex	updates_mutex;
 
@@ -30,13 +30,26 @@
 
 #include <iostream>
 #include <fstream>
+#include <list>
+#include <map>
 #include <string>
+#include <vector>
 
+#include <poll.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <boost/foreach.hpp>
 #include <boost/regex.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 // common.h must be included before using the USE_* macros
 #include "common.h"
+#include "cfg.h"
 
 #ifdef USE_THRIFT
 // RPC Stuff
@@ -46,23 +59,281 @@
 #include <transport/TSocket.h>
 #include <transport/TBufferTransports.h>
 #include <protocol/TBinaryProtocol.h>
+#include <protocol/TCompactProtocol.h>
+#include <protocol/TProtocolException.h>
 #endif //USE_THRIFT
 
 // namespace ows {
 
+#ifdef USE_THRIFT
+
+/**
+ * rpc_connection
+ *
+ * A connection to a gateway kept in the pool
+ * - socket gives the descriptor checked before the connection is reused
+ * - last_used is used to evict the idle connections
+ */
+struct rpc_connection {
+	std::string							gateway;
+	boost::shared_ptr<apache::thrift::transport::TSocket>		socket;
+	boost::shared_ptr<apache::thrift::transport::TTransport>	transport;
+	boost::shared_ptr<rpc::ows_rpcClient>				handler;
+	time_t								last_used;
+};
+
+/*
+ * The counters of a gateway's pool
+ */
+struct rpc_clients_metrics {
+	uint64_t	opened;
+	uint64_t	reused;
+	uint64_t	reconnected;
+	uint64_t	broken;
+	uint64_t	evicted;
+	uint64_t	failures;
+	uint64_t	waits;
+	uint64_t	fallbacks;
+	uint64_t	timeouts;
+
+	rpc_clients_metrics() : opened(0), reused(0), reconnected(0), broken(0), evicted(0), failures(0), waits(0), fallbacks(0), timeouts(0) {}
+};
+
+/**
+ * rpc_gateway_pool
+ *
+ * The connections to a gateway
+ * - idle are the connections waiting to be used, the most recent first
+ * - opened is the number of connections (idle or used)
+ * - negotiated is set once the protocol is known, binary when the gateway
+ *   does not speak the compact protocol: it is checked again once all the
+ *   connections are closed
+ */
+struct rpc_gateway_pool {
+	std::list<rpc_connection*>	idle;
+	size_t				opened;
+	bool				negotiated;
+	bool				binary;
+	rpc_clients_metrics		counters;
+
+	rpc_gateway_pool() : opened(0), negotiated(false), binary(false) {}
+};
+
+/**
+ * m_rpc_gateway_pools / m_rpc_clients_metrics
+ *
+ * Define the { gateway => pool } and { gateway => counters } maps
+ */
+typedef std::map<std::string, rpc_gateway_pool>		m_rpc_gateway_pools;
+typedef std::map<std::string, rpc_clients_metrics>	m_rpc_clients_metrics;
+
+#endif // USE_THRIFT
+
+/**
+ * Rpc_Clients
+ *
+ * Keeps the connections to the gateways opened between the calls, so a
+ * forwarded call costs one round trip per hop
+ * - rpc_client_pool_size: the connections opened to a gateway at once,
+ *   the callers wait for a connection beyond it
+ * - rpc_client_idle_timeout: the seconds a connection is kept unused
+ * - rpc_client_connect_timeout, rpc_client_call_timeout: the seconds to
+ *   connect and to send or receive a call, a dead gateway cannot hold a
+ *   connection forever
+ * - rpc_client_wait_timeout: the seconds to wait for a free connection
+ *
+ * The connections use TCP keep-alive. A kept connection closed by its peer
+ * is opened again before its use. A connection whose call failed is closed
+ *
+ * rpc_protocol chooses the protocol: binary or compact (smaller plannings
+ * and lists of jobs). The first compact connection to a gateway calls
+ * reach_master: a gateway that cannot read it (a protocol error or a
+ * connection closed on the first call) is reached with the binary protocol
+ *
+ * The transport is not negotiated: a gateway whose rpc_server_mode uses
+ * another transport (framed or buffered) is not supported, its calls fail
+ */
+class Rpc_Clients {
+public:
+	/**
+	 * Rpc_Clients
+	 *
+	 * The constructor, the transport follows rpc_server_mode and the port
+	 * is bind_port: the peers are expected to use the same settings. The
+	 * protocol is rpc_protocol
+	 *
+	 * @param	c	the configuration object
+	 *
+	 * @throw	rpc::ex_processing	the configuration is NULL
+	 */
+	Rpc_Clients(Config* c);
+
+	/**
+	 * ~Rpc_Clients
+	 *
+	 * The destructor, closes the idle connections
+	 */
+	~Rpc_Clients();
+
+#ifdef USE_THRIFT
+
+	/**
+	 * acquire
+	 *
+	 * Gets a connection to a gateway
+	 * - the most recently used idle connection is preferred
+	 * - a new one is opened if the pool is not full
+	 * - otherwise we wait for a connection to be released, up to
+	 *   wait_timeout
+	 *
+	 * @param	gateway	the node to connect to
+	 *
+	 * @return	the connection
+	 * @throw	apache::thrift::transport::TTransportException	cannot connect or no connection released in time
+	 */
+	rpc_connection*	acquire(const std::string& gateway);
+
+	/**
+	 * release
+	 *
+	 * Gives a connection back to the pool
+	 *
+	 * @param	c	the connection
+	 * @param	broken	the connection must be closed instead of reused
+	 */
+	void	release(rpc_connection* c, const bool broken = false);
+
+	/**
+	 * get_metrics
+	 *
+	 * Gets the pools' counters
+	 *
+	 * @param	_return		the output
+	 */
+	void	get_metrics(m_rpc_clients_metrics& _return);
+
+#endif // USE_THRIFT
+
+private:
+	/**
+	 * port, framed, compact, pool_size, idle_timeout, connect_timeout,
+	 * call_timeout, wait_timeout
+	 *
+	 * The settings read from the configuration, the last three in
+	 * milliseconds
+	 */
+	int	port;
+	bool	framed;
+	bool	compact;
+	size_t	pool_size;
+	time_t	idle_timeout;
+	int	connect_timeout;
+	int	call_timeout;
+	int	wait_timeout;
+
+#ifdef USE_THRIFT
+
+	/**
+	 * pools
+	 *
+	 * The pools by gateway, protected by mutex
+	 */
+	m_rpc_gateway_pools		pools;
+	boost::mutex			mutex;
+
+	/**
+	 * released
+	 *
+	 * Signaled each time a connection goes back to a pool or is closed
+	 */
+	boost::condition_variable	released;
+
+	/**
+	 * connect
+	 *
+	 * Opens a new connection
+	 *
+	 * @param	gateway	the node to connect to
+	 * @param	compact	use the compact protocol
+	 *
+	 * @return	the connection
+	 * @throw	apache::thrift::transport::TTransportException	cannot connect
+	 */
+	rpc_connection*	connect(const std::string& gateway, const bool compact);
+
+	/**
+	 * negotiate
+	 *
+	 * Opens the first compact connection to a gateway, falls back to the
+	 * binary protocol if the gateway cannot read it. The other failures
+	 * (timeout, refused connection) leave the protocol unknown
+	 *
+	 * @param	pool	the gateway's pool, the mutex must not be held
+	 * @param	gateway	the node to connect to
+	 *
+	 * @return	the connection
+	 * @throw	apache::thrift::transport::TTransportException	cannot connect
+	 */
+	rpc_connection*	negotiate(rpc_gateway_pool& pool, const std::string& gateway);
+
+	/**
+	 * disconnect
+	 *
+	 * Closes a connection opened by connect()
+	 *
+	 * @param	c	the connection
+	 */
+	void	disconnect(rpc_connection* c);
+
+	/**
+	 * is_alive
+	 *
+	 * Checks a kept connection: an idle connection has nothing to read,
+	 * a readable one has been closed by its peer
+	 *
+	 * @param	c	the connection
+	 *
+	 * @return	false if the connection must be opened again
+	 */
+	bool	is_alive(const rpc_connection* c) const;
+
+	/**
+	 * evict
+	 *
+	 * Takes the connections idle for more than idle_timeout out of the
+	 * pools, the mutex must be held
+	 *
+	 * @param	now	the current time
+	 * @param	_return	the connections to close once the mutex is released
+	 */
+	void	evict(const time_t now, std::vector<rpc_connection*>& _return);
+
+#endif // USE_THRIFT
+
+	/**
+	 * root_logger
+	 *
+	 * This is a reference to the root logger
+	 */
+	log4cpp::Category&	root_logger = log4cpp::Category::getRoot();
+};
+
 class Rpc_Client {
 public:
 	/**
 	 * Rpc_Client
 	 *
 	 * The constructor
+	 *
+	 * @param	c	the pools giving the connections
 	 */
-	Rpc_Client();
+	Rpc_Client(Rpc_Clients* c);
 
 	/**
 	 * Rpc_Client
 	 *
-	 * The destructor
+	 * The destructor, a connection which was not closed may be in the
+	 * middle of a call: it is not reused
 	 */
 	~Rpc_Client();
 
@@ -71,14 +342,14 @@ public:
 	/**
 	 * open
 	 *
-	 * Open a connection to a remote noode
+	 * Gets a connection to a remote node from the pool
 	 *
 	 * @param	hostname	target's name
-	 * @param	port		the TCP port to use
 	 *
 	 * @return	true		success
+	 * @throw	apache::thrift::transport::TTransportException	cannot connect
 	 */
-	bool	open(const char* hostname, const int& port);
+	bool	open(const char* hostname);
 
 	/**
 	 * get_handler
@@ -92,26 +363,12 @@ public:
 	/**
 	 * close
 	 *
-	 * Closes the connection
+	 * Gives the connection back to the pool
 	 *
 	 * @return	true on success
 	 */
 	bool	close();
 
-	/**
-	 * transport
-	 *
-	 * Thrift's connection handler
-	 */
-	boost::shared_ptr<apache::thrift::transport::TTransport>	transport;
-
-	/**
-	 * handler
-	 *
-	 * Thrift's interface
-	 */
-	rpc::ows_rpcClient*	handler;
-
 #endif // USE_THRIFT
 
 	/**
@@ -126,6 +383,25 @@ public:
 	 */
 	std::string*	build_url(const std::string* target);
 
+private:
+	/**
+	 * clients
+	 *
+	 * The pools giving the connections
+	 */
+	Rpc_Clients*	clients;
+
+#ifdef USE_THRIFT
+
+	/**
+	 * connection
+	 *
+	 * The connection used between open and close
+	 */
+	rpc_connection*	connection;
+
+#endif // USE_THRIFT
+
 	/**
 	 * root_logger
 	 *
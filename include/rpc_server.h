@@ -47,7 +47,12 @@
 
 // Common Stuff
 #include <protocol/TBinaryProtocol.h>
+#include <protocol/TCompactProtocol.h>
+#include <concurrency/ThreadManager.h>
+#include <concurrency/PosixThreadFactory.h>
 #include <server/TSimpleServer.h>
+#include <server/TThreadPoolServer.h>
+#include <server/TNonblockingServer.h>
 #include <transport/TServerSocket.h>
 #include <transport/TBufferTransports.h>
 #endif // USE_THRIFT
@@ -93,9 +98,10 @@ protected:
 	/**
 	 * client
 	 *
-	 * The RPC client object to use to call RPCs
+	 * The RPC client object to use to call RPCs, a handler serves one
+	 * connection at a time so its client is not shared
 	 */
-	Rpc_Client*	client; // TODO: create rpc_clients on demand to by multi-thread compatible
+	Rpc_Client*	client;
 
 	/**
 	 * root_logger
@@ -146,7 +152,15 @@ public:
 	/**
 	 * run
 	 *
-	 * Used to start the server
+	 * Used to start the server, rpc_server_mode chooses how the calls are
+	 * served:
+	 * - simple: one connection at a time (buffered transport)
+	 * - thread_pool: rpc_server_workers threads, a connection uses a
+	 *   thread while it is opened (framed transport)
+	 * - nonblocking: the connections are read by an event loop, the calls
+	 *   are run by rpc_server_workers threads (framed transport)
+	 * Each connection gets its own handler (see ows_rpcHandlerFactory)
+	 * rpc_protocol chooses the binary or the compact protocol
 	 */
 	void	run();
 
@@ -191,6 +205,77 @@ private:
 
 #ifdef USE_THRIFT
 
+/**
+ * ows_rpcHandlerFactory
+ *
+ * Gives a handler to each connection: the handlers only share the domain,
+ * the configuration and the router, which are thread-safe
+ */
+class ows_rpcHandlerFactory : virtual public rpc::ows_rpcIfFactory {
+public:
+	/**
+	 * ows_rpcHandlerFactory
+	 *
+	 * The constructor
+	 *
+	 * @param	d	the domain to use
+	 * @param	c	the configuration object to use
+	 * @param	r	the routing engine to use
+	 */
+	ows_rpcHandlerFactory(Domain* d, Config* c, Router* r);
+
+	/**
+	 * getHandler
+	 *
+	 * Creates the handler of a new connection
+	 *
+	 * @param	connection	the connection's transports
+	 *
+	 * @return	the handler, given back by releaseHandler
+	 */
+	rpc::ows_rpcIf*	getHandler(const apache::thrift::TConnectionInfo& connection);
+
+	/**
+	 * releaseHandler
+	 *
+	 * Deletes the handler of a closed connection
+	 *
+	 * @param	handler	the handler
+	 */
+	void	releaseHandler(rpc::ows_rpcIf* handler);
+
+private:
+	/**
+	 * domain, config, router
+	 *
+	 * The objects given to the handlers
+	 */
+	Domain*		domain;
+	Config*		config;
+	Router*		router;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * e_job_batch
+ *
+ * The operations applied to the jobs batches (see run_job_batch)
+ */
+enum e_job_batch {
+	ADD_JOBS,
+	UPDATE_JOBS,
+	REMOVE_JOBS,
+	UPDATE_JOB_STATES
+};
+
+/*
+ * The positions of a batch's jobs forwarded to each gateway
+ */
+typedef std::map<std::string, std::vector<size_t> >	m_gateway_jobs;
+
+///////////////////////////////////////////////////////////////////////////////
+
 class ows_rpcHandler : virtual public rpc::ows_rpcIf, public Rpc_Object {
 public:
 	/**
@@ -233,6 +318,12 @@ public:
 	bool remove_job(const rpc::t_routing_data& routing, const rpc::t_job& j);
 	bool update_job_state(const rpc::t_routing_data& routing, const rpc::t_job& j);
 
+	// Jobs batches methods
+	void add_jobs(rpc::v_job_results& _return, const rpc::t_routing_data& routing, const rpc::v_jobs& jobs);
+	void update_jobs(rpc::v_job_results& _return, const rpc::t_routing_data& routing, const rpc::v_jobs& jobs);
+	void remove_jobs(rpc::v_job_results& _return, const rpc::t_routing_data& routing, const rpc::v_jobs& jobs);
+	void update_job_states(rpc::v_job_results& _return, const rpc::t_routing_data& routing, const rpc::v_jobs& jobs);
+
 	// SQL methods
 	void sql_exec(const std::string& query);
 
@@ -294,6 +385,48 @@ private:
 	 */
 	void	check_job_arg(const rpc::t_job job);
 
+	/**
+	 * run_job_batch
+	 *
+	 * Checks the jobs then applies the ones hosted by this node in a single
+	 * transaction and forwards the others, in one call per gateway
+	 * A job that cannot be checked, reached or applied gets its own result,
+	 * the other jobs are still applied
+	 *
+	 * @param	_return		a result per job, in the given order
+	 * @param	batch		the operation
+	 * @param	routing		the call's routing data
+	 * @param	jobs		the jobs
+	 *
+	 * @throw	ex_routing	the routing data are not usable
+	 */
+	void	run_job_batch(rpc::v_job_results& _return, const e_job_batch batch, const rpc::t_routing_data& routing, const rpc::v_jobs& jobs);
+
+	/**
+	 * apply_job_batch
+	 *
+	 * Applies the jobs hosted by this node
+	 *
+	 * @param	_return		a result per job, in the given order
+	 * @param	batch		the operation
+	 * @param	domain_name	the domain hosting the jobs
+	 * @param	jobs		the jobs
+	 */
+	void	apply_job_batch(rpc::v_job_results& _return, const e_job_batch batch, const std::string& domain_name, const rpc::v_jobs& jobs);
+
+	/**
+	 * forward_job_batch
+	 *
+	 * Sends jobs to the gateway reaching their nodes
+	 *
+	 * @param	_return		a result per job, in the given order
+	 * @param	batch		the operation
+	 * @param	gateway		the gateway
+	 * @param	routing		the call's routing data
+	 * @param	jobs		the jobs
+	 */
+	void	forward_job_batch(rpc::v_job_results& _return, const e_job_batch batch, const std::string& gateway, const rpc::t_routing_data& routing, const rpc::v_jobs& jobs);
+
 	/**
 	 * check_auth
 	 *
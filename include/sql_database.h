@@ -0,0 +1,257 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: sql_database.h
+ * Description: the storage using an SQL engine (MySQLe or SQLite).
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef SQL_DATABASE_H
+#define SQL_DATABASE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+#include "common.h"
+#include "convertions.h"
+#include "database.h"
+
+// namespace ows {
+
+class Sql_Database : public Database {
+public:
+	/**
+	 * Sql_Database
+	 *
+	 * The constructor
+	 *
+	 * @param	c	the prepared connector, deleted by the destructor
+	 * @param	jobs	the jobs' name table
+	 * @param	nodes	the nodes' name table
+	 */
+	Sql_Database(Sql_Connector* c, Name_Table* jobs, Name_Table* nodes);
+
+	/**
+	 * ~Sql_Database
+	 *
+	 * The destructor
+	 */
+	~Sql_Database();
+
+	bool	init_planning(const std::string& planning_name, const std::string& skeleton);
+	bool	planning_exists(const std::string& planning_name);
+	bool	clone_planning(const std::string& source, const std::string& target);
+	void	get_planning_names(std::vector<std::string>& _return);
+	void	load_names(const char* planning_name);
+
+	bool	add_node(const char* planning_name, const std::string& node_name, const rpc::integer weight);
+	bool	remove_node(const char* planning_name, const std::string& node_name);
+	bool	add_job(const char* planning_name, const rpc::t_job& j);
+	bool	update_job(const char* planning_name, const rpc::t_job& j);
+	bool	remove_job(const char* planning_name, const std::string& job_name);
+	bool	add_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return);
+	bool	update_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return);
+	bool	remove_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return);
+	bool	update_job_states(const d_job_state_updates& batch);
+	bool	add_resource(const char* planning_name, const rpc::t_resource& r, const char* node_name);
+
+	void	get_nodes(const char* planning_name, rpc::v_nodes& _return, const char* node_name);
+	void	get_jobs(const char* planning_name, rpc::v_jobs& _return, const char* node_name, const char* job_name);
+	void	get_ready_jobs(const char* planning_name, rpc::v_jobs& _return, const char* node_name);
+	void	get_jobs_links(const char* planning_name, m_jobs_links& _return, const char* node_name, const char* job_name);
+	void	get_time_constraints(const char* planning_name, m_time_constraints& _return, const char* node_name, const char* job_name);
+	void	get_resources(const char* planning_name, m_resources& _return, const char* node_name);
+	void	get_recovery_types(const char* planning_name, m_recovery_types& _return);
+	void	get_macro_jobs(const char* planning_name, rpc::v_macro_jobs& _return);
+
+	int64_t	count_jobs_in_state(const char* planning_name, const rpc::e_job_state::type state);
+	int64_t	count_node_jobs(const char* planning_name, const char* node_name);
+
+	bool		sql_exec(const char* planning_name, const std::string& query);
+	uint64_t	get_queries_count();
+
+private:
+	/**
+	 * connector
+	 *
+	 * The SQL engine
+	 */
+	Sql_Connector*	connector;
+
+	/**
+	 * root_logger
+	 *
+	 * This is a reference to the root logger
+	 */
+	log4cpp::Category&	root_logger = log4cpp::Category::getRoot();
+
+	/**
+	 * query_each_row
+	 *
+	 * Runs a query with or without parameters and streams its result
+	 * The failures are thrown
+	 *
+	 * @param	query		SQL query using "?" placeholders
+	 * @param	params		the placeholders' values
+	 * @param	columns		the columns' types
+	 * @param	handler		called for each row
+	 * @param	planning_name	the planning to use
+	 *
+	 * @throw	rpc::ex_job	the query failed
+	 */
+	void	query_each_row(const std::string& query, const v_sql_params& params, const v_sql_columns& columns, const row_handler& handler, const char* planning_name);
+
+	/**
+	 * execute_job_batch
+	 *
+	 * Runs the statements of a batch in a single transaction, the jobs of
+	 * a failed transaction are marked as failed
+	 *
+	 * @param	statements	the statements
+	 * @param	planning_name	the planning to use
+	 * @param	_return		the jobs' results
+	 *
+	 * @return	false if the transaction failed
+	 */
+	bool	execute_job_batch(const v_sql_statements& statements, const char* planning_name, rpc::v_job_results& _return);
+
+	/**
+	 * add_job_statements
+	 *
+	 * Appends the statements inserting a job, its links and its time
+	 * constraints
+	 *
+	 * @param	_return		the statements
+	 * @param	j		the job
+	 * @param	node_id		the id of its node
+	 */
+	void	add_job_statements(v_sql_statements& _return, const rpc::t_job& j, const int64_t node_id);
+
+	/**
+	 * update_job_statements
+	 *
+	 * Appends the statements replacing a job, its links and its time
+	 * constraints
+	 *
+	 * @param	_return		the statements
+	 * @param	j		the job
+	 */
+	void	update_job_statements(v_sql_statements& _return, const rpc::t_job& j);
+
+	/**
+	 * remove_job_statements
+	 *
+	 * Appends the statements deleting a job, its links and its time
+	 * constraints
+	 *
+	 * @param	_return		the statements
+	 * @param	job_id		the job's id
+	 */
+	void	remove_job_statements(v_sql_statements& _return, const int64_t job_id);
+
+	/**
+	 * decode_job
+	 *
+	 * Row handler appending a job built from the cells of a row:
+	 * id, name, cmd_line, node_id, weight, state, rectype_id and optionally
+	 * the start and stop times as UNIX timestamps
+	 * Only the recovery type's id is set, the type is joined by the caller
+	 *
+	 * @param	_return		the jobs to fill
+	 * @param	cells		the row
+	 */
+	void	decode_job(rpc::v_jobs* _return, const v_cells& cells);
+
+	/**
+	 * decode_node
+	 *
+	 * Row handler appending a node built from the cells of a row:
+	 * id, name and weight
+	 *
+	 * @param	_return		the nodes to fill
+	 * @param	cells		the row
+	 */
+	void	decode_node(rpc::v_nodes* _return, const v_cells& cells);
+
+	/**
+	 * decode_resource
+	 *
+	 * Row handler grouping a resource by node:
+	 * name, node_id, current_value and initial_value
+	 *
+	 * @param	_return		the resources to fill
+	 * @param	cells		the row
+	 */
+	void	decode_resource(m_resources* _return, const v_cells& cells);
+
+	/**
+	 * decode_job_link
+	 *
+	 * Row handler grouping a link by previous job:
+	 * previous and next job ids
+	 *
+	 * @param	_return		the links to fill
+	 * @param	cells		the row
+	 */
+	void	decode_job_link(m_jobs_links* _return, const v_cells& cells);
+
+	/**
+	 * decode_time_constraint
+	 *
+	 * Row handler grouping a time constraint by job:
+	 * job_id, type and value in seconds
+	 *
+	 * @param	_return		the time constraints to fill
+	 * @param	cells		the row
+	 */
+	void	decode_time_constraint(m_time_constraints* _return, const v_cells& cells);
+
+	/**
+	 * decode_recovery_type
+	 *
+	 * Row handler indexing a recovery type by id:
+	 * id, short_label, label and action
+	 *
+	 * @param	_return		the recovery types to fill
+	 * @param	cells		the row
+	 */
+	void	decode_recovery_type(m_recovery_types* _return, const v_cells& cells);
+
+	/**
+	 * decode_macro_job
+	 *
+	 * Row handler appending a macro job: id and name
+	 *
+	 * @param	_return		the macro jobs to fill
+	 * @param	cells		the row
+	 */
+	void	decode_macro_job(rpc::v_macro_jobs* _return, const v_cells& cells);
+};
+
+// } // namespace ows
+
+#endif // SQL_DATABASE_H
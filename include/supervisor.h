@@ -0,0 +1,373 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: supervisor.h
+ * Description: spawns the jobs and waits for them from a single thread.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif // __linux__
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "common.h"
+#include "cfg.h"
+#include "domain.h"
+#include "job.h"
+#include "job_log.h"
+#include "job_cgroup.h"
+#include "timing_wheel.h"
+
+// namespace ows {
+
+/*
+ * The supervising loop's settings
+ * - the milliseconds between two checks of the children without pidfd
+ * - the events read by each epoll_wait
+ * - the bytes of output read at once: a chatty job cannot hold the loop
+ */
+#define SUPERVISOR_SWEEP_INTERVAL	100
+#define SUPERVISOR_EVENTS		64
+#define SUPERVISOR_OUTPUT_BUFFER	65536
+
+/*
+ * The key of a polled descriptor: the child's pid and the stream it belongs
+ * to (0 for the pidfd, see e_job_log_stream)
+ */
+#define SUPERVISOR_KEY(pid, stream)	(static_cast<uint64_t>(pid) | static_cast<uint64_t>(stream) << 32)
+
+/*
+ * A running job
+ * - pidfd: the descriptor polled by the supervisor, -1 if the child is swept
+ * - stdout_fd, stderr_fd: the pipes' read ends, -1 once they are closed
+ * - log: the file receiving the outputs
+ * - cgroup: the job's leaf, empty if the job is not in its own cgroup
+ * - deadline: the expiry of its pending timeout timer, -1 if none
+ * - timed_out: tells if it was killed by its timeout
+ * - on_exit: called once the job's final state is posted
+ */
+struct supervised_job {
+	rpc::t_job		job;
+	int			job_id;
+	int			node_id;
+	int			pidfd;
+	int			stdout_fd;
+	int			stderr_fd;
+	boost::shared_ptr<Job_Log>	log;
+	std::string			cgroup;
+	int64_t				deadline;
+	bool				timed_out;
+	boost::function<void ()>	on_exit;
+};
+
+typedef	boost::unordered_map<pid_t, supervised_job>	m_supervised_jobs;
+
+/*
+ * The supervisor's counters
+ * The CPU times are given in microseconds
+ */
+struct supervisor_metrics {
+	uint64_t	spawned;
+	uint64_t	direct;
+	uint64_t	spawn_failures;
+	uint64_t	exited;
+	uint64_t	timed_out;
+	uint64_t	running;
+	uint64_t	total_user_time;
+	uint64_t	total_system_time;
+
+	supervisor_metrics() : spawned(0), direct(0), spawn_failures(0), exited(0), timed_out(0), running(0), total_user_time(0), total_system_time(0) {}
+};
+
+/**
+ * Supervisor
+ *
+ * Spawns the jobs with posix_spawn and waits for all of them from one
+ * thread: each child's pidfd is polled by epoll, the exited children are
+ * reaped with wait4 and their final state is posted to the domain
+ *
+ * The children without pidfd (kernels older than 5.3, other systems) are
+ * swept every SUPERVISOR_SWEEP_INTERVAL milliseconds
+ *
+ * The command lines without shell syntax are executed directly, the other
+ * ones by /bin/sh -c (see Job::spawn and job_direct_exec)
+ *
+ * The jobs' standard output and error are non-blocking pipes polled by the
+ * same loop and written into the jobs' logs (see Job_Logs): each running job
+ * uses four file descriptors (pidfd, two pipes, log)
+ *
+ * The jobs' usage comes from wait4, or from their cgroup v2 leaves when
+ * job_cgroup_path is set (see Job_Cgroups): the leaf also counts the
+ * processes started by the job
+ *
+ * Each job runs in its own process group. A job running longer than its
+ * timeout gets SIGTERM, then SIGKILL job_kill_grace seconds later, both sent
+ * to its process group: the deadlines are timers of a timing wheel checked
+ * by the supervising loop. The job fails with the TIMEOUT failure
+ */
+class Supervisor {
+public:
+	/**
+	 * Supervisor
+	 *
+	 * The constructor, starts the supervising thread
+	 *
+	 * @param	d	the domain receiving the jobs' states
+	 * @param	c	the configuration object
+	 *
+	 * @throw	rpc::ex_processing	cannot create the event descriptors
+	 */
+	Supervisor(Domain* d, Config* c);
+
+	/**
+	 * ~Supervisor
+	 *
+	 * The destructor, waits for the running jobs
+	 */
+	~Supervisor();
+
+	/**
+	 * spawn
+	 *
+	 * Starts a job whose state is already RUNNING
+	 *
+	 * @param	j	the job
+	 * @param	on_exit	called from the supervising thread when the job ends
+	 *
+	 * @return	false if the job cannot be started
+	 */
+	bool	spawn(const Job& j, const boost::function<void ()>& on_exit);
+
+	/**
+	 * get_metrics
+	 *
+	 * Gets the supervisor's counters
+	 *
+	 * @param	_return		the output
+	 */
+	void	get_metrics(supervisor_metrics& _return);
+
+private:
+	/**
+	 * domain
+	 *
+	 * The domain receiving the jobs' states
+	 */
+	Domain*	domain;
+
+	/**
+	 * children
+	 *
+	 * The running jobs by pid, protected by mutex
+	 * swept: the children without pidfd
+	 * wake_up, woken: wake the loop up on the systems without epoll
+	 */
+	m_supervised_jobs		children;
+	std::vector<pid_t>		swept;
+	boost::mutex			mutex;
+	boost::condition_variable	wake_up;
+	bool				woken;
+	bool				stopping;
+	supervisor_metrics		counters;
+
+#ifdef __linux__
+	/**
+	 * epoll_fd, event_fd
+	 *
+	 * The poller and the descriptor waking it up
+	 */
+	int	epoll_fd;
+	int	event_fd;
+#endif // __linux__
+
+	/**
+	 * direct_exec
+	 *
+	 * Tells if the jobs split by the dependency graph skip the shell
+	 */
+	bool	direct_exec;
+
+	/**
+	 * timeouts, origin
+	 *
+	 * The running jobs' deadlines keyed by pid, protected by mutex: the
+	 * open timers send SIGTERM, the other ones SIGKILL
+	 * The wheel's times are the seconds since origin
+	 */
+	Timing_Wheel	timeouts;
+	time_t		origin;
+
+	/**
+	 * default_timeout, kill_grace
+	 *
+	 * The seconds a job may run when neither it nor its recovery type has
+	 * a timeout (0 means no limit) and the seconds between SIGTERM and
+	 * SIGKILL
+	 */
+	int64_t	default_timeout;
+	int64_t	kill_grace;
+
+	/**
+	 * job_logs, job_cgroups, output
+	 *
+	 * The jobs' logs, their cgroups and the buffer used to read the pipes
+	 */
+	Job_Logs		job_logs;
+	Job_Cgroups		job_cgroups;
+	std::vector<char>	output;
+
+	/**
+	 * thread
+	 *
+	 * The supervising thread
+	 */
+	boost::thread*	thread;
+
+	/**
+	 * root_logger
+	 *
+	 * This is a reference to the root logger
+	 */
+	log4cpp::Category&	root_logger = log4cpp::Category::getRoot();
+
+	/**
+	 * supervise
+	 *
+	 * The supervising thread's loop
+	 */
+	void	supervise();
+
+	/**
+	 * wait_for_events
+	 *
+	 * Waits for exited children and for outputs to read
+	 *
+	 * @param	_return		the pids of the exited children
+	 * @param	outputs		the keys of the readable pipes
+	 * @param	timeout		the longest wait in milliseconds, -1 means forever
+	 */
+	void	wait_for_events(std::vector<pid_t>& _return, std::vector<uint64_t>& outputs, const int timeout);
+
+	/**
+	 * open_pipe
+	 *
+	 * Creates the pipe of a child's stream
+	 *
+	 * @param	fds	the output: the non-blocking read end and the write end
+	 *
+	 * @return	false on failure
+	 */
+	bool	open_pipe(int fds[2]);
+
+	/**
+	 * drain
+	 *
+	 * Reads a child's pipe into its log, the pipe is closed at its end
+	 *
+	 * @param	key	the pipe's key
+	 * @param	all	false to read SUPERVISOR_OUTPUT_BUFFER bytes at most
+	 */
+	void	drain(const uint64_t key, const bool all);
+
+	/**
+	 * read_output
+	 *
+	 * Reads a pipe into a log
+	 *
+	 * @param	fd	the pipe's read end
+	 * @param	stream	the stream read
+	 * @param	log	the job's log
+	 * @param	all	false to read SUPERVISOR_OUTPUT_BUFFER bytes at most
+	 *
+	 * @return	false once the pipe is closed by the writers
+	 */
+	bool	read_output(const int fd, const e_job_log_stream stream, Job_Log* log, const bool all);
+
+	/**
+	 * notify
+	 *
+	 * Wakes the supervising thread up
+	 * mutex must be held
+	 */
+	void	notify();
+
+	/**
+	 * get_timeout
+	 *
+	 * Gives the seconds a job may run: its own timeout, else its recovery
+	 * type's, else job_timeout
+	 *
+	 * @param	j	the job
+	 *
+	 * @return	the timeout, 0 means no limit
+	 */
+	int64_t	get_timeout(const rpc::t_job& j) const;
+
+	/**
+	 * expire
+	 *
+	 * Signals the jobs whose deadline passed
+	 */
+	void	expire();
+
+	/**
+	 * reap
+	 *
+	 * Collects an exited child and posts its final state
+	 *
+	 * @param	pid	the child
+	 *
+	 * @return	false if the child is still running
+	 */
+	bool	reap(const pid_t pid);
+};
+
+// } // namespace ows
+
+#endif // SUPERVISOR_H
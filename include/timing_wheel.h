@@ -0,0 +1,187 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: timing_wheel.h
+ * Description: the timers of the jobs' time constraints.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <vector>
+
+#include <stdint.h>
+
+#include <boost/foreach.hpp>
+
+// namespace ows {
+
+/*
+ * The wheel's geometry
+ * - 64 slots per level
+ * - level n slots last 64^n seconds: 4 levels cover 194 days
+ */
+#define TIMING_WHEEL_BITS	6
+#define TIMING_WHEEL_SLOTS	(1 << TIMING_WHEEL_BITS)
+#define TIMING_WHEEL_MASK	(TIMING_WHEEL_SLOTS - 1)
+#define TIMING_WHEEL_LEVELS	4
+
+/*
+ * A timer
+ * - expiry: its time, in seconds
+ * - job_id: the job to wake up
+ * - open: true if the job's time window opens, false if it closes
+ */
+struct wheel_timer {
+	int64_t	expiry;
+	int	job_id;
+	bool	open;
+};
+
+typedef	std::vector<wheel_timer>	v_wheel_timers;
+
+/**
+ * Timing_Wheel
+ *
+ * A hierarchical timing wheel: scheduling a timer costs O(1), a timer is
+ * moved down at most once per level before it expires and an empty wheel
+ * advances for free
+ * The times are relative to any origin (the planning's start time)
+ *
+ * This class is not thread safe
+ */
+class Timing_Wheel {
+public:
+	/**
+	 * Timing_Wheel
+	 *
+	 * The constructor, the wheel is empty and starts at 0
+	 */
+	Timing_Wheel();
+
+	/**
+	 * reset
+	 *
+	 * Removes the timers
+	 *
+	 * @param	now	the wheel's new current time
+	 */
+	void	reset(const int64_t now);
+
+	/**
+	 * schedule
+	 *
+	 * Adds a timer, a past timer expires on the next call to advance
+	 *
+	 * @param	timer	the timer
+	 */
+	void	schedule(const wheel_timer& timer);
+
+	/**
+	 * advance
+	 *
+	 * Moves the wheel to the given time
+	 *
+	 * @param	now	the current time, an earlier time is ignored
+	 * @param	_return	the expired timers, in expiry order
+	 */
+	void	advance(const int64_t now, v_wheel_timers& _return);
+
+	/**
+	 * get_next_expiry
+	 *
+	 * Gives when the wheel should be advanced next: the expiry of the
+	 * nearest timer or the time its upper slot is cascaded, never later
+	 *
+	 * @param	_return	the time
+	 *
+	 * @return	false if the wheel is empty
+	 */
+	bool	get_next_expiry(int64_t& _return) const;
+
+	/**
+	 * get_current_time
+	 *
+	 * @return	the wheel's current time
+	 */
+	int64_t	get_current_time() const;
+
+	/**
+	 * size
+	 *
+	 * @return	the number of pending timers
+	 */
+	size_t	size() const;
+
+private:
+	/**
+	 * current
+	 *
+	 * The last second processed
+	 */
+	int64_t	current;
+
+	/**
+	 * count
+	 *
+	 * The number of pending timers
+	 */
+	size_t	count;
+
+	/**
+	 * slots
+	 *
+	 * The timers by level and slot
+	 */
+	v_wheel_timers	slots[TIMING_WHEEL_LEVELS][TIMING_WHEEL_SLOTS];
+
+	/**
+	 * overdue
+	 *
+	 * The timers scheduled in the past
+	 */
+	v_wheel_timers	overdue;
+
+	/**
+	 * place
+	 *
+	 * Puts a timer into the level matching its distance to current
+	 *
+	 * @param	timer	the timer
+	 */
+	void	place(const wheel_timer& timer);
+
+	/**
+	 * cascade
+	 *
+	 * Moves the timers of the current slot of a level to the lower levels
+	 *
+	 * @param	level	the level
+	 */
+	void	cascade(const int level);
+};
+
+// } // namespace ows
+
+#endif // TIMING_WHEEL_H
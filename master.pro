@@ -11,19 +11,34 @@ include(qmake_conf/macx.pro)
 include(qmake_conf/bsd.pro)
 #include(qmake_conf/windows.pro)
 
+# The database engine: "qmake CONFIG+=sqlite" builds the SQLite backend
+sqlite {
+	DEFINES	+= USE_SQLITE
+	LIBS	+= -lsqlite3
+}
+
 INCLUDEPATH	+= include \
 	src/gen-cpp
 
 SOURCES += src/convertions.cpp \
 	src/cfg.cpp \
 	src/database.cpp \
+	src/dependency_graph.cpp \
 	src/domain.cpp \
+	src/executor.cpp \
+	src/memory_database.cpp \
 	src/job.cpp \
+	src/job_log.cpp \
+	src/job_cgroup.cpp \
 	src/master.cpp \
+	src/name_table.cpp \
 	src/node.cpp \
 	src/router.cpp \
 	src/rpc_client.cpp \
 	src/rpc_server.cpp \
+	src/sql_database.cpp \
+	src/supervisor.cpp \
+	src/timing_wheel.cpp \
 	src/gen-cpp/model_constants.cpp \
 	src/gen-cpp/model_types.cpp \
 	src/gen-cpp/ows_rpc.cpp
@@ -32,12 +47,21 @@ HEADERS	+= include/common.h \
 	include/convertions.h \
 	include/cfg.h \
 	include/database.h \
+	include/dependency_graph.h \
 	include/domain.h \
+	include/executor.h \
+	include/memory_database.h \
 	include/job.h \
+	include/job_log.h \
+	include/job_cgroup.h \
+	include/name_table.h \
 	include/node.h \
 	include/router.h \
 	include/rpc_client.h \
 	include/rpc_server.h \
+	include/sql_database.h \
+	include/supervisor.h \
+	include/timing_wheel.h \
 	src/gen-cpp/model_constants.h \
 	src/gen-cpp/model_types.h \
 	src/gen-cpp/ows_rpc.h
@@ -1,5 +1,7 @@
 !macx:unix {
 	LIBS += -lthrift \
+		-lthriftnb \
+		-levent \
 		-L/usr/local/lib \
 		-L/usr/local/lib/mysql \
 		/usr/local/lib/mysql/libmysqld.a \
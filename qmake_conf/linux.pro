@@ -1,5 +1,7 @@
 linux {
 	LIBS += -lthrift \
+		-lthriftnb \
+		-levent \
 		-L/usr/local/lib \
 		/usr/lib/libmysqld.a \
 		-L/usr/lib \
@@ -1,5 +1,7 @@
 macx {
 	LIBS += -lthrift \
+		-lthriftnb \
+		-levent \
 		-L/opt/local/lib \
 		/opt/local/lib/mariadb/mysql/libmysqld.a \
 		-L/usr/lib \
@@ -32,6 +32,34 @@
 Config::Config() {
 	// Model : this->syntax_regex.insert(std::pair<std::string, boost::regex>("", boost::regex("", boost::regex::perl)));
 	this->syntax_regex.insert(std::pair<std::string, boost::regex>("bind_port", boost::regex("^[0-9]{2,}$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("db_engine", boost::regex("^(mysql|sqlite|memory)$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("db_pool_size", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("db_pool_check_interval", boost::regex("^[0-9]+$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("db_commit_interval", boost::regex("^[0-9]+$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("db_commit_retries", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("db_mmap_size", boost::regex("^[0-9]+$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("time_constraint_at_window", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("scheduler_safety_poll", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("executor_max_jobs", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("executor_node_limit", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("executor_queue_size", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("job_log_max_size", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("job_log_rotations", boost::regex("^[0-9]+$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("job_log_compress", boost::regex("^(yes|no)$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("job_direct_exec", boost::regex("^(yes|no)$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("job_cgroup_cpu_per_weight", boost::regex("^[0-9]+$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("job_cgroup_memory_per_weight", boost::regex("^[0-9]+$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("job_timeout", boost::regex("^[0-9]+$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("job_kill_grace", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("rpc_server_mode", boost::regex("^(simple|thread_pool|nonblocking)$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("rpc_server_workers", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("rpc_server_max_connections", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("rpc_protocol", boost::regex("^(binary|compact)$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("rpc_client_pool_size", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("rpc_client_idle_timeout", boost::regex("^[0-9]+$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("rpc_client_connect_timeout", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("rpc_client_call_timeout", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
+	this->syntax_regex.insert(std::pair<std::string, boost::regex>("rpc_client_wait_timeout", boost::regex("^[1-9][0-9]*$", boost::regex::perl)));
 	//	this->syntax_regex.insert(std::pair<std::string, boost::regex>("bind_address", boost::regex("^([0-9]+)([[.period.]][0-9]+){3}$", boost::regex::perl)));
 	//	this->syntax_regex.insert(std::pair<std::string, boost::regex>("node_name", boost::regex('[\w]', boost::regex::perl)));
 }
@@ -115,6 +143,23 @@ std::string*	Config::get_param(const char* field) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+long	Config::get_integer_param(const char* field, const long default_value) {
+	std::string*	value = this->get_param(field);
+
+	if ( value == NULL )
+		return default_value;
+
+	try {
+		return boost::lexical_cast<long>(*value);
+	} catch (const boost::bad_lexical_cast& e) {
+		std::cerr << "Bad integer value for " << field << "=" << *value << ", using " << default_value << std::endl;
+	}
+
+	return default_value;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 const std::string*	Config::get_master_node() {
 	return &this->master_node;
 }
@@ -192,7 +192,7 @@ int	main (int argc, char * const argv[]) {
 			break;
 		}
 		case ACTIVE: {
-			while ( router.get_node(conf_params.get_param("domain_name")->c_str(), node, router.get_master_node()->c_str()) == false ) {
+			while ( router.get_node(conf_params.get_param("domain_name")->c_str(), node, router.get_master_node().c_str()) == false ) {
 				WARN << "Cannot get the planning";
 				sleep(30);
 			}
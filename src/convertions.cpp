@@ -28,16 +28,30 @@
 
 #include "convertions.h"
 
+/*
+ * equals
+ *
+ * Compares a string which is not null-terminated to a literal
+ */
+template <size_t N>
+static	inline	bool	equals(const char* str, const size_t length, const char (&literal)[N]) {
+	return length == N - 1 and memcmp(str, literal, N - 1) == 0;
+}
+
 rpc::e_job_state::type	build_job_state_from_string(const char* state) {
+	return build_job_state_from_string(state, strlen(state));
+}
+
+rpc::e_job_state::type	build_job_state_from_string(const char* state, const size_t length) {
 	rpc::ex_processing e;
 
-	if ( strcmp(state, "waiting") == 0 )
+	if ( equals(state, length, "waiting") )
 		return rpc::e_job_state::WAITING;
-	if ( strcmp(state, "running") == 0 )
+	if ( equals(state, length, "running") )
 		return rpc::e_job_state::RUNNING;
-	if ( strcmp(state, "succeded") == 0 )
+	if ( equals(state, length, "succeded") )
 		return rpc::e_job_state::SUCCEDED;
-	if ( strcmp(state, "failed") == 0 )
+	if ( equals(state, length, "failed") )
 		return rpc::e_job_state::FAILED;
 
 	e.msg = "ex_processing: string state is not related to a job's state";
@@ -72,11 +86,15 @@ std::string	build_string_from_job_state(const rpc::e_job_state::type& js) {
 }
 
 rpc::e_rectype_action::type	build_rectype_action_from_string(const char* rt_action) {
+	return build_rectype_action_from_string(rt_action, strlen(rt_action));
+}
+
+rpc::e_rectype_action::type	build_rectype_action_from_string(const char* rt_action, const size_t length) {
 	rpc::ex_processing e;
 
-	if ( strcmp(rt_action, "restart") == 0 )
+	if ( equals(rt_action, length, "restart") )
 		return rpc::e_rectype_action::RESTART;
-	if ( strcmp(rt_action, "stop_schedule") == 0 )
+	if ( equals(rt_action, length, "stop_schedule") )
 		return rpc::e_rectype_action::STOP_SCHEDULE;
 
 	e.msg = "ex_pocessing: string action is not related to a rectype action";
@@ -107,14 +125,60 @@ std::string	build_string_from_rectype_action(const rpc::e_rectype_action::type&
 	return result;
 }
 
+rpc::e_job_failure::type	build_job_failure_from_string(const char* failure, const size_t length) {
+	rpc::ex_processing e;
+
+	if ( equals(failure, length, "return_code") )
+		return rpc::e_job_failure::RETURN_CODE;
+	if ( equals(failure, length, "spawn") )
+		return rpc::e_job_failure::SPAWN;
+	if ( equals(failure, length, "timeout") )
+		return rpc::e_job_failure::TIMEOUT;
+
+	e.msg = "ex_processing: string failure is not related to a job's failure";
+	throw e;
+
+	return rpc::e_job_failure::RETURN_CODE;
+}
+
+std::string	build_string_from_job_failure(const rpc::e_job_failure::type& failure) {
+	std::string	result;
+
+	switch (failure) {
+		case rpc::e_job_failure::RETURN_CODE: {
+			result = "return_code";
+			break;
+		}
+		case rpc::e_job_failure::SPAWN: {
+			result = "spawn";
+			break;
+		}
+		case rpc::e_job_failure::TIMEOUT: {
+			result = "timeout";
+			break;
+		}
+		default: {
+			rpc::ex_processing e;
+			e.msg = "ex_processing: bad e_job_failure given as argument";
+			throw e;
+		}
+	}
+
+	return result;
+}
+
 rpc::e_time_constraint_type::type build_time_constraint_type_from_string(const char* type) {
+	return build_time_constraint_type_from_string(type, strlen(type));
+}
+
+rpc::e_time_constraint_type::type build_time_constraint_type_from_string(const char* type, const size_t length) {
 	rpc::ex_processing e;
 
-	if ( strcmp(type, "at") == 0 )
+	if ( equals(type, length, "at") )
 		return rpc::e_time_constraint_type::AT;
-	if ( strcmp(type, "before") == 0 )
+	if ( equals(type, length, "before") )
 		return rpc::e_time_constraint_type::BEFORE;
-	if ( strcmp(type, "after") == 0 )
+	if ( equals(type, length, "after") )
 		return rpc::e_time_constraint_type::AFTER;
 
 	e.msg = "ex_processing: the given type is not valid";
@@ -143,6 +207,41 @@ std::string	build_string_from_time_constraint_type(const rpc::e_time_constraint_
 	return result;
 }
 
+bool	build_integer_from_string(const char* str, const size_t length, int64_t& _return) {
+	uint64_t	value		= 0;
+	uint64_t	limit		= INT64_MAX;
+	size_t		i		= 0;
+	bool		negative	= false;
+
+	if ( str == NULL or length == 0 )
+		return false;
+
+	if ( str[0] == '-' or str[0] == '+' ) {
+		negative = str[0] == '-';
+		i++;
+	}
+
+	if ( i == length )
+		return false;
+
+	// INT64_MIN has no positive counterpart
+	if ( negative == true )
+		limit++;
+
+	for ( ; i < length ; i++ ) {
+		if ( str[i] < '0' or str[i] > '9' )
+			return false;
+
+		if ( value > ( limit - ( str[i] - '0' ) ) / 10 )
+			return false;
+
+		value = value * 10 + ( str[i] - '0' );
+	}
+
+	_return = negative == true ? static_cast<int64_t>(0 - value) : static_cast<int64_t>(value);
+	return true;
+}
+
 std::string	build_human_readable_time(const time_t& time) {
 	std::string	result;
 	char		buffer[80];
@@ -195,3 +294,105 @@ time_t	build_unix_time_from_hhmm_time(const std::string& time) {
 
 	return result;
 }
+
+int64_t	build_minute_of_day(const time_t& time) {
+	struct tm	timeinfo;
+
+	localtime_r(&time, &timeinfo);
+
+	return timeinfo.tm_hour * 60 + timeinfo.tm_min;
+}
+
+bool	match_time_constraints(const rpc::v_time_constraints& time_constraints, const int64_t minute) {
+	if ( time_constraints.empty() == true )
+		return true;
+
+	// The values are seconds since midnight, compared minute by minute
+	BOOST_FOREACH(const rpc::t_time_constraint& tc, time_constraints) {
+		switch ( tc.type ) {
+			case rpc::e_time_constraint_type::AT: {
+				if ( tc.value / 60 == minute )
+					return true;
+				break;
+			}
+			case rpc::e_time_constraint_type::BEFORE: {
+				if ( tc.value / 60 >= minute )
+					return true;
+				break;
+			}
+			case rpc::e_time_constraint_type::AFTER: {
+				if ( tc.value / 60 <= minute )
+					return true;
+				break;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool	build_args_from_command_line(const std::string& cmd_line, v_command_args& _return) {
+	static const char*	shell_characters	= "|&;<>()$`\\\"'*?[]{}~#!\r\n";
+	static const char*	blanks			= " \t";
+	// The builtins without a binary of the same behaviour and the keywords
+	static const char*	builtins[]		= { ".", ":", "alias", "bg", "bind", "break", "builtin", "caller", "case", "cd", "command", "compgen", "complete", "compopt", "continue", "coproc", "declare", "dirs", "disown", "do", "done", "elif", "else", "enable", "esac", "eval", "exec", "exit", "export", "fc", "fg", "fi", "for", "function", "getopts", "hash", "help", "history", "if", "jobs", "let", "local", "logout", "mapfile", "popd", "pushd", "read", "readarray", "readonly", "return", "select", "set", "shift", "shopt", "source", "suspend", "then", "time", "times", "trap", "type", "typeset", "ulimit", "umask", "unalias", "unset", "until", "wait", "while", NULL };
+	std::string::size_type	start;
+	std::string::size_type	end;
+
+	_return.clear();
+
+	if ( cmd_line.find_first_of(shell_characters) != std::string::npos )
+		return false;
+
+	start = cmd_line.find_first_not_of(blanks);
+
+	while ( start != std::string::npos ) {
+		end = cmd_line.find_first_of(blanks, start);
+		_return.push_back(cmd_line.substr(start, end == std::string::npos ? std::string::npos : end - start));
+		start = end == std::string::npos ? end : cmd_line.find_first_not_of(blanks, end);
+	}
+
+	// VAR=value cmd sets the command's environment
+	if ( _return.empty() == true or _return[0].find('=') != std::string::npos ) {
+		_return.clear();
+		return false;
+	}
+
+	for ( size_t i = 0 ; builtins[i] != NULL ; i++ ) {
+		if ( _return[0].compare(builtins[i]) == 0 ) {
+			_return.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void	build_usage_from_rusage(const struct rusage& usage, rpc::t_job& _return) {
+	_return.__set_cpu_usage((usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000LL + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+#ifdef __APPLE__
+	_return.__set_memory_peak(usage.ru_maxrss);
+#else
+	_return.__set_memory_peak(usage.ru_maxrss * 1024LL);
+#endif
+	_return.__set_io_read_bytes(usage.ru_inblock * 512LL);
+	_return.__set_io_write_bytes(usage.ru_oublock * 512LL);
+}
+
+rpc::t_job_result	build_job_result(const rpc::e_job_result::type code, const std::string& msg) {
+	rpc::t_job_result	result;
+
+	result.code = code;
+
+	if ( msg.empty() == false )
+		result.__set_msg(msg);
+
+	return result;
+}
+
+bool	is_file_name(const std::string& name) {
+	if ( name.empty() == true or name[0] == '.' )
+		return false;
+
+	return name.find('/') == std::string::npos;
+}
@@ -26,21 +26,107 @@
  */
 
 #include "database.h"
+#include "convertions.h"
+
+#include <stdlib.h>
+
+#ifdef USE_SQLITE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/bind.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef USE_MYSQL
+
+/*
+ * mysql_thread_initialized
+ *
+ * The embedded server needs mysql_thread_init() to be called once per thread
+ * using the API and mysql_thread_end() before the thread exits. The pooled
+ * connections are shared by the threads, so we cannot tie it to them.
+ */
+static	void	mysql_thread_cleanup(bool* initialized) {
+	if ( initialized != NULL and *initialized == true )
+		mysql_thread_end();
+	delete initialized;
+}
+
+static	boost::thread_specific_ptr<bool>	mysql_thread_initialized(mysql_thread_cleanup);
+
+/*
+ * mysql_result_buffer_size
+ *
+ * The size of the buffers bound to the prepared statements' results, larger
+ * values are fetched again
+ */
+static	const size_t	mysql_result_buffer_size = 256;
+
+#endif // USE_MYSQL
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * append_row
+ *
+ * Row handler storing the rows, NULL values are given as "NULL"
+ */
+static	void	append_row(v_v_row* _return, const v_cells& cells) {
+	v_row	line;
+
+	line.reserve(cells.size());
+
+	BOOST_FOREACH(const sql_cell& c, cells) {
+		if ( c.is_null == true )
+			line.push_back(std::string("NULL"));
+		else
+			line.push_back(std::string(c.data, c.length));
+	}
+
+	_return->push_back(line);
+}
+
+/*
+ * append_values
+ *
+ * Row handler storing the values of the rows in a single row, NULL values
+ * are skipped
+ */
+static	void	append_values(v_row* _return, const v_cells& cells) {
+	BOOST_FOREACH(const sql_cell& c, cells) {
+		if ( c.is_null == false )
+			_return->push_back(std::string(c.data, c.length));
+	}
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 
 #ifdef USE_MYSQL
 
+///////////////////////////////////////////////////////////////////////////////
+
 Mysql::Mysql() {
+	this->opened_connections	= 0;
+	this->pool_size			= 1;
+	this->pool_check_interval	= 60;
+	this->queries_count		= 0;
 }
 
 Mysql::~Mysql() {
-	mysql_library_end();
+	this->shutdown();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool	Mysql::prepare() {
+bool	Mysql::prepare(const size_t pool_size, const time_t check_interval) {
 //	static char* server_args[] = {
 //		(char*)"this_program",	// this string is not used
 //		(char*)"--datadir=/tmp",
@@ -63,6 +149,16 @@ bool	Mysql::prepare() {
 		return false;
 	}
 
+	if ( pool_size == 0 ) {
+		ERROR << "the connections' pool size must be higher than 0";
+		return false;
+	}
+
+	this->pool_size			= pool_size;
+	this->pool_check_interval	= check_interval;
+
+	INFO << "MySQL connections' pool size is " << this->pool_size << ", health check after " << this->pool_check_interval << " idle seconds";
+
 	return true;
 }
 
@@ -110,6 +206,179 @@ bool	Mysql::init_domain_structure(const std::string& domain_name, const std::str
 
 ///////////////////////////////////////////////////////////////////////////////
 
+bool	Mysql::clone_schema(const std::string& source, const std::string& target, const v_sql_statements& after_copy) {
+	v_v_row			tables;
+	v_v_row			views;
+	v_queries		queries;
+	v_row			counts;
+	std::list<v_row>	pending_views;
+	std::list<v_row>::iterator	it;
+	std::string		source_prefix	= "`" + source + "`.";
+	std::string		target_prefix	= "`" + target + "`.";
+	std::string		query;
+	std::string		definition;
+	mysql_connection*	local_mysql	= NULL;
+	uint64_t		rows		= 0;
+	bool			depends;
+	rpc::ex_processing	e;
+
+	if ( source.empty() == true or target.empty() == true or source.find('`') != std::string::npos or target.find('`') != std::string::npos ) {
+		e.msg = "clone_schema:: invalid schema name";
+		throw e;
+	}
+
+	if ( this->prepared_query_full_result(tables, "SELECT TABLE_NAME FROM information_schema.TABLES WHERE TABLE_SCHEMA = ? AND TABLE_TYPE = 'BASE TABLE';", v_sql_params(1, source), NULL) == false or tables.empty() == true ) {
+		e.msg = "clone_schema:: cannot get the tables of ";
+		e.msg += source;
+		throw e;
+	}
+
+	if ( this->prepared_query_full_result(views, "SELECT TABLE_NAME,VIEW_DEFINITION FROM information_schema.VIEWS WHERE TABLE_SCHEMA = ?;", v_sql_params(1, source), NULL) == false ) {
+		e.msg = "clone_schema:: cannot get the views of ";
+		e.msg += source;
+		throw e;
+	}
+
+	/*
+	 * The structure: the server commits each DDL statement by itself, that is
+	 * why the target is dropped on failure
+	 */
+	queries.push_back("CREATE SCHEMA `" + target + "` DEFAULT CHARACTER SET latin1;");
+
+	BOOST_FOREACH(v_row table, tables) {
+		queries.push_back("CREATE TABLE " + target_prefix + "`" + table[0] + "` LIKE " + source_prefix + "`" + table[0] + "`;");
+	}
+
+	/*
+	 * The views refer to the tables and to the other views using fully
+	 * qualified names: a view is created once the views it uses exist
+	 */
+	pending_views.assign(views.begin(), views.end());
+
+	while ( pending_views.empty() == false ) {
+		size_t	pending = pending_views.size();
+
+		for ( it = pending_views.begin() ; it != pending_views.end() ; ) {
+			depends = false;
+
+			BOOST_FOREACH(v_row other, pending_views) {
+				if ( other[0] != it->at(0) and it->at(1).find(source_prefix + "`" + other[0] + "`") != std::string::npos ) {
+					depends = true;
+					break;
+				}
+			}
+
+			if ( depends == true ) {
+				it++;
+				continue;
+			}
+
+			definition = it->at(1);
+			boost::algorithm::replace_all(definition, source_prefix, target_prefix);
+			queries.push_back("CREATE VIEW " + target_prefix + "`" + it->at(0) + "` AS " + definition + ";");
+
+			it = pending_views.erase(it);
+		}
+
+		if ( pending_views.size() == pending ) {
+			e.msg = "clone_schema:: circular dependency between the views of ";
+			e.msg += source;
+			throw e;
+		}
+	}
+
+	try {
+		this->standalone_execute(queries, NULL);
+	} catch (rpc::ex_processing& e) {
+		this->drop_schema(target);
+		throw e;
+	}
+
+	/*
+	 * The data
+	 */
+	local_mysql = this->init(target.c_str());
+
+	try {
+		this->atomic_execute("SET FOREIGN_KEY_CHECKS = 0;", local_mysql->handle);
+		this->atomic_execute("START TRANSACTION;", local_mysql->handle);
+
+		BOOST_FOREACH(v_row table, tables) {
+			this->atomic_execute("INSERT INTO " + target_prefix + "`" + table[0] + "` SELECT * FROM " + source_prefix + "`" + table[0] + "`;", local_mysql->handle);
+		}
+
+		BOOST_FOREACH(const sql_statement& s, after_copy) {
+			mysql_stmt_free_result(this->prepared_run(local_mysql, s.query, s.params));
+		}
+
+		BOOST_FOREACH(v_row table, tables) {
+			query = "SELECT (SELECT COUNT(*) FROM " + source_prefix + "`" + table[0] + "`), (SELECT COUNT(*) FROM " + target_prefix + "`" + table[0] + "`);";
+
+			counts.clear();
+			this->fetch_one_row(counts, query, local_mysql);
+
+			if ( counts.size() != 2 or counts[0] != counts[1] ) {
+				e.msg = "clone_schema:: rows count mismatch on table ";
+				e.msg += table[0];
+				throw e;
+			}
+
+			rows += strtoull(counts[0].c_str(), NULL, 10);
+		}
+
+		this->atomic_execute("COMMIT;", local_mysql->handle);
+		this->atomic_execute("SET FOREIGN_KEY_CHECKS = 1;", local_mysql->handle);
+	} catch (rpc::ex_processing& e) {
+		ERROR << "clone_schema:: cannot copy " << source << " into " << target << ": " << e.msg;
+
+		// The connection must not go back to the pool inside a transaction
+		if ( mysql_query(local_mysql->handle, "ROLLBACK;") == 0 and mysql_query(local_mysql->handle, "SET FOREIGN_KEY_CHECKS = 1;") == 0 )
+			this->end(local_mysql);
+		else
+			this->end(local_mysql, true);
+
+		this->drop_schema(target);
+		throw e;
+	}
+
+	this->end(local_mysql);
+
+	INFO << "cloned " << source << " into " << target << ": " << tables.size() << " tables, " << views.size() << " views, " << rows << " rows";
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Mysql::schema_exists(const std::string& schema) {
+	v_row	result;
+
+	if ( this->prepared_query_one_row(result, "SELECT COUNT(*) FROM information_schema.SCHEMATA WHERE SCHEMA_NAME = ?;", v_sql_params(1, schema), NULL) == false or result.empty() == true ) {
+		rpc::ex_processing e;
+		e.msg = "Cannot get the available databases";
+		throw e;
+	}
+
+	return result[0].compare("0") != 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Mysql::list_schemas(std::vector<std::string>& _return) {
+	v_v_row	result;
+
+	if ( this->query_full_result(result, "SHOW DATABASES;", NULL) == false ) {
+		rpc::ex_processing e;
+		e.msg = "Cannot get the available databases";
+		throw e;
+	}
+
+	BOOST_FOREACH(const v_row& line, result) {
+		_return.push_back(line.at(0));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 bool	Mysql::atomic_execute(const std::string& query, MYSQL* m) {
 #ifndef QT_NO_DEBUG
 	MYSQL_RES*	res;
@@ -126,6 +395,8 @@ bool	Mysql::atomic_execute(const std::string& query, MYSQL* m) {
 	DEBUG << "atomic_execute:: " << query;
 #endif
 
+	this->count_query();
+
 	if ( mysql_query(m, query.c_str()) != 0 ) {
 		rpc::ex_processing e;
 		e.msg = "query: ";
@@ -159,45 +430,50 @@ bool	Mysql::atomic_execute(const std::string& query, MYSQL* m) {
 ///////////////////////////////////////////////////////////////////////////////
 
 bool	Mysql::standalone_execute(const v_queries& queries, const char* database_name) {
-	MYSQL*		local_mysql	= this->init(database_name);
-	std::string	query		= "START TRANSACTION;";
-	rpc::ex_processing		e;
-
-	if ( local_mysql == NULL ) {
-		e.msg = "cannot init the DB connection";
-		throw e;
-	}
+	mysql_connection*	local_mysql	= this->init(database_name);
+	std::string		query		= "START TRANSACTION;";
+	rpc::ex_processing	e;
 
-	if ( this->atomic_execute(query, local_mysql) == false ) {
-		this->end(local_mysql);
-
-		e.msg = "standalone_execute:: start transaction failed - ";
-		e.msg +=  mysql_error(local_mysql);
+	try {
+		if ( this->atomic_execute(query, local_mysql->handle) == false ) {
+			e.msg = "standalone_execute:: start transaction failed - ";
+			e.msg +=  mysql_error(local_mysql->handle);
+			throw e;
+		}
+	} catch (rpc::ex_processing& e) {
+		this->end(local_mysql, true);
 		throw e;
 	}
 
 	try {
 		BOOST_FOREACH(std::string q, queries) {
-			if ( this->atomic_execute(q, local_mysql) == false ) {
+			if ( this->atomic_execute(q, local_mysql->handle) == false ) {
 				query = "ROLLBACK;";
-				this->atomic_execute(query, local_mysql);
+				this->atomic_execute(query, local_mysql->handle);
 				this->end(local_mysql);
 
 				return false;
 			}
 		}
 	} catch (rpc::ex_processing& e) {
-		this->end(local_mysql);
+		// The connection must not go back to the pool inside a transaction
+		if ( mysql_query(local_mysql->handle, "ROLLBACK;") == 0 )
+			this->end(local_mysql);
+		else
+			this->end(local_mysql, true);
 		throw e;
 	}
 
 	query = "COMMIT;";
 
-	if ( this->atomic_execute(query, local_mysql) == false ) {
-		this->end(local_mysql);
-
-		e.msg = "standalone_execute:: commit failed - ";
-		e.msg +=  mysql_error(local_mysql);
+	try {
+		if ( this->atomic_execute(query, local_mysql->handle) == false ) {
+			e.msg = "standalone_execute:: commit failed - ";
+			e.msg +=  mysql_error(local_mysql->handle);
+			throw e;
+		}
+	} catch (rpc::ex_processing& e) {
+		this->end(local_mysql, true);
 		throw e;
 	}
 
@@ -208,38 +484,107 @@ bool	Mysql::standalone_execute(const v_queries& queries, const char* database_na
 ///////////////////////////////////////////////////////////////////////////////
 
 bool	Mysql::query_one_row(v_row& _return, const char* query, const char* database_name) {
-	MYSQL_RES*	res;
-	MYSQL_ROW	row;
-	MYSQL*		local_mysql = this->init(database_name);
+	return this->query_each_row(query, boost::bind(append_values, &_return, _1), database_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Mysql::query_full_result(v_v_row& _return, const char* query, const char* database_name) {
+	return this->query_each_row(query, boost::bind(append_row, &_return, _1), database_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Mysql::query_each_row(const char* query, const row_handler& handler, const char* database_name) {
+	return this->query_each_row(query, v_sql_columns(), handler, database_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Mysql::query_each_row(const char* query, const v_sql_columns& columns, const row_handler& handler, const char* database_name) {
+	MYSQL_RES*		res;
+	MYSQL_ROW		row;
+	unsigned long*		lengths;
+	unsigned int		num_fields;
+	v_cells			cells;
+	mysql_connection*	local_mysql = NULL;
 
 	if ( query == NULL )
 		return false;
 
-	if ( mysql_query(local_mysql, query) != 0 ) {
-		ERROR << query << mysql_error(local_mysql);
+	local_mysql = this->init(database_name);
+	this->count_query();
+
+	if ( mysql_query(local_mysql->handle, query) != 0 ) {
+		ERROR << query << mysql_error(local_mysql->handle);
+		this->end(local_mysql);
 		return false;
 	}
 
 	#ifndef QT_NO_DEBUG
-		DEBUG << "query_one_row:: " << query;
+	DEBUG << "query_each_row:: " << query;
 	#endif
 
-	res = mysql_store_result(local_mysql);
-	if ( res ) {
-		while ( ( row = mysql_fetch_row(res) ) )
-			if ( row ) {
-				for ( uint i=0; i < mysql_num_fields(res) ; i++ ) {
-					if ( row[i] != NULL )
-						_return.push_back(std::string(row[i]));
-				}
-			}
-	} else {
-		if ( mysql_field_count(local_mysql) != 0 ) {
-			ERROR << mysql_error(local_mysql);
-			mysql_free_result(res);
+	// The rows are read from the server while the handler is called
+	res = mysql_use_result(local_mysql->handle);
+
+	if ( res == NULL ) {
+		if ( mysql_field_count(local_mysql->handle) != 0 ) {
+			ERROR << "query_each_row: " << mysql_error(local_mysql->handle);
 			this->end(local_mysql);
 			return false;
 		}
+
+		// Not a SELECT
+		this->end(local_mysql);
+		return true;
+	}
+
+	num_fields = mysql_num_fields(res);
+	cells.resize(num_fields);
+
+	try {
+		while ( ( row = mysql_fetch_row(res) ) != NULL ) {
+			lengths = mysql_fetch_lengths(res);
+
+			for ( unsigned int i = 0 ; i < num_fields ; i++ ) {
+				cells[i].data		= row[i];
+				cells[i].length		= lengths[i];
+				cells[i].is_null	= row[i] == NULL;
+				cells[i].integer	= 0;
+
+				if ( i >= columns.size() or columns[i] != SQL_INTEGER or row[i] == NULL )
+					continue;
+
+				cells[i].data	= NULL;
+				cells[i].length	= 0;
+
+				if ( build_integer_from_string(row[i], lengths[i], cells[i].integer) == false ) {
+					rpc::ex_processing e;
+					e.msg = "query_each_row:: ";
+					e.msg.append(row[i], lengths[i]);
+					e.msg += " is not an integer. Query is ";
+					e.msg += query;
+					ERROR << e.msg;
+					throw e;
+				}
+			}
+
+			handler(cells);
+		}
+	} catch (...) {
+		// mysql_free_result() discards the rows left
+		mysql_free_result(res);
+		this->end(local_mysql);
+		throw;
+	}
+
+	// mysql_fetch_row() gives NULL on errors too
+	if ( mysql_errno(local_mysql->handle) != 0 ) {
+		ERROR << "query_each_row: " << mysql_error(local_mysql->handle);
+		mysql_free_result(res);
+		this->end(local_mysql, true);
+		return false;
 	}
 
 	mysql_free_result(res);
@@ -250,81 +595,91 @@ bool	Mysql::query_one_row(v_row& _return, const char* query, const char* databas
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool	Mysql::query_full_result(v_v_row& _return, const char* query, const char* database_name) {
-	MYSQL_RES*	res;
-	MYSQL_ROW	row;
-	MYSQL*		local_mysql = this->init(database_name);
-	v_row		line;
-	uint		num_fields;
+bool	Mysql::prepared_execute(const v_sql_statements& statements, const char* database_name) {
+	mysql_connection*	local_mysql	= this->init(database_name);
+	rpc::ex_processing	e;
 
-	if ( local_mysql == NULL )
-		return false;
+	try {
+		if ( this->atomic_execute("START TRANSACTION;", local_mysql->handle) == false ) {
+			e.msg = "prepared_execute:: start transaction failed - ";
+			e.msg +=  mysql_error(local_mysql->handle);
+			throw e;
+		}
 
-	if ( query == NULL )
-		return false;
+		BOOST_FOREACH(const sql_statement& s, statements) {
+			mysql_stmt_free_result(this->prepared_run(local_mysql, s.query, s.params));
+		}
 
-	if ( mysql_query(local_mysql, query) != 0 ) {
-		ERROR << query << mysql_error(local_mysql);
-		return false;
+		if ( this->atomic_execute("COMMIT;", local_mysql->handle) == false ) {
+			e.msg = "prepared_execute:: commit failed - ";
+			e.msg +=  mysql_error(local_mysql->handle);
+			throw e;
+		}
+	} catch (rpc::ex_processing& e) {
+		// The connection must not go back to the pool inside a transaction
+		if ( mysql_query(local_mysql->handle, "ROLLBACK;") == 0 )
+			this->end(local_mysql);
+		else
+			this->end(local_mysql, true);
+		throw e;
 	}
 
-	#ifndef QT_NO_DEBUG
-	DEBUG << "query_full_result:: " << query;
-	#endif
+	this->end(local_mysql);
+	return true;
+}
 
-	res = mysql_store_result(local_mysql);
+///////////////////////////////////////////////////////////////////////////////
 
-	#ifndef QT_NO_DEBUG
-	DEBUG << "query_full_result:: size of the result: " << mysql_affected_rows(local_mysql);
-	#endif
+bool	Mysql::prepared_query_one_row(v_row& _return, const std::string& query, const v_sql_params& params, const char* database_name) {
+	return this->prepared_query_each_row(query, params, boost::bind(append_values, &_return, _1), database_name);
+}
 
-	if (res) {
-		num_fields = mysql_num_fields(res);
-		#ifndef QT_NO_DEBUG
-		DEBUG << "num fields: " << num_fields;
-		#endif
-
-		while ( ( row = mysql_fetch_row(res) ) ) {
-			line.clear();
-
-			for ( uint i=0; i < num_fields ; i++ ) {
-				#ifndef QT_NO_DEBUG
-				if ( row[i] == NULL )
-					DEBUG << "\tquery_full_row:: NULL";
-				else
-					DEBUG << "\tquery_full_row:: " << row[i];
-				#endif
-
-				if ( row[i] != NULL )
-					line.push_back(std::string(row[i]));
-				else
-					line.push_back(std::string("NULL"));
-			}
+///////////////////////////////////////////////////////////////////////////////
 
-			_return.push_back(line);
-		}
-	} else
-		if ( mysql_field_count(local_mysql) != 0 ) {
-			mysql_free_result(res);
-			this->end(local_mysql);
-			ERROR << "query_full_result: " << mysql_error(local_mysql);
-			return false;
-		}
+bool	Mysql::prepared_query_full_result(v_v_row& _return, const std::string& query, const v_sql_params& params, const char* database_name) {
+	return this->prepared_query_each_row(query, params, boost::bind(append_row, &_return, _1), database_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Mysql::prepared_query_each_row(const std::string& query, const v_sql_params& params, const row_handler& handler, const char* database_name) {
+	return this->prepared_query_each_row(query, params, v_sql_columns(), handler, database_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Mysql::prepared_query_each_row(const std::string& query, const v_sql_params& params, const v_sql_columns& columns, const row_handler& handler, const char* database_name) {
+	mysql_connection*	local_mysql	= this->init(database_name);
+	MYSQL_STMT*		stmt		= NULL;
+	bool			result;
+
+	try {
+		stmt = this->prepared_run(local_mysql, query, params);
+	} catch (rpc::ex_processing&) {
+		this->end(local_mysql);
+		return false;
+	}
+
+	try {
+		result = this->prepared_fetch(stmt, columns, handler);
+	} catch (...) {
+		this->end(local_mysql);
+		throw;
+	}
 
-	mysql_free_result(res);
 	this->end(local_mysql);
 
-	return true;
+	return result;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 // TODO: make sure it works thanks to the domain's mutex
 int	Mysql::get_inserted_id(const char* database_name) {
-	MYSQL*	local_mysql	= this->init(database_name);
+	mysql_connection*	local_mysql	= this->init(database_name);
 	int		result;
 
-	result = mysql_insert_id(local_mysql);
+	result = mysql_insert_id(local_mysql->handle);
 
 	this->end(local_mysql);
 	return result;
@@ -332,28 +687,304 @@ int	Mysql::get_inserted_id(const char* database_name) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+uint64_t	Mysql::get_queries_count() {
+	boost::mutex::scoped_lock	lock(this->stats_mutex);
+	return this->queries_count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Mysql::count_query() {
+	boost::mutex::scoped_lock	lock(this->stats_mutex);
+	this->queries_count++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 bool	Mysql::shutdown() {
+	boost::mutex::scoped_lock	lock(this->pool_mutex);
+
+	BOOST_FOREACH(m_mysql_connections::value_type& schema, this->idle_connections) {
+		BOOST_FOREACH(mysql_connection* c, schema.second) {
+			this->disconnect(c);
+		}
+	}
+	this->idle_connections.clear();
+
+	if ( this->opened_connections > 0 )
+		WARN << this->opened_connections << " MySQL connections are still in use during the shutdown";
+
 	mysql_library_end();
 	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool	Mysql::load_file(const char* node_name, const char* file_path) {
-	std::ifstream	f (file_path, std::ifstream::in);
-	std::string		line;
-	std::string		query;
-	v_queries		queries;
-	boost::regex	end_of_query("^.*?;$", boost::regex::perl);
+void	Mysql::drop_schema(const std::string& schema) {
+	v_queries	queries;
+
+	queries.push_back("DROP SCHEMA IF EXISTS `" + schema + "`;");
+
+	try {
+		this->standalone_execute(queries, NULL);
+	} catch (rpc::ex_processing& e) {
+		ERROR << "cannot drop the schema " << schema << ": " << e.msg;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Mysql::fetch_one_row(v_row& _return, const std::string& query, mysql_connection* c) {
+	MYSQL_RES*		res;
+	MYSQL_ROW		row;
+	rpc::ex_processing	e;
+
+#ifndef QT_NO_DEBUG
+	DEBUG << "fetch_one_row:: " << query;
+#endif
+
+	this->count_query();
+
+	if ( mysql_query(c->handle, query.c_str()) != 0 or ( res = mysql_store_result(c->handle) ) == NULL ) {
+		e.msg = "query: ";
+		e.msg += query;
+		e.msg += " error: ";
+		e.msg += mysql_error(c->handle);
+		ERROR << e.msg;
+		throw e;
+	}
+
+	if ( ( row = mysql_fetch_row(res) ) != NULL ) {
+		for ( uint i = 0 ; i < mysql_num_fields(res) ; i++ )
+			_return.push_back(row[i] == NULL ? std::string("NULL") : std::string(row[i]));
+	}
+
+	mysql_free_result(res);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+MYSQL_STMT*	Mysql::get_statement(mysql_connection* c, const std::string& query) {
+	m_mysql_statements::iterator	it	= c->statements.find(query);
+	MYSQL_STMT*			stmt	= NULL;
+	rpc::ex_processing		e;
+
+	if ( it != c->statements.end() )
+		return it->second;
+
+	stmt = mysql_stmt_init(c->handle);
+
+	if ( stmt == NULL ) {
+		e.msg = "get_statement:: cannot init a statement: ";
+		e.msg += mysql_error(c->handle);
+		ERROR << e.msg;
+		throw e;
+	}
+
+	if ( mysql_stmt_prepare(stmt, query.c_str(), query.size()) != 0 ) {
+		e.msg = "get_statement:: cannot prepare: ";
+		e.msg += query;
+		e.msg += " error: ";
+		e.msg += mysql_stmt_error(stmt);
+		ERROR << e.msg;
+		mysql_stmt_close(stmt);
+		throw e;
+	}
+
+	c->statements[query] = stmt;
+	return stmt;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+MYSQL_STMT*	Mysql::prepared_run(mysql_connection* c, const std::string& query, const v_sql_params& params) {
+	MYSQL_STMT*			stmt	= this->get_statement(c, query);
+	std::vector<MYSQL_BIND>		binds(params.size());
+	std::vector<unsigned long>	lengths(params.size());
+	rpc::ex_processing		e;
+
+	if ( mysql_stmt_param_count(stmt) != params.size() ) {
+		e.msg = "prepared_run:: wrong number of parameters for query: ";
+		e.msg += query;
+		ERROR << e.msg;
+		throw e;
+	}
+
+	for ( size_t i = 0 ; i < params.size() ; i++ ) {
+		switch ( params[i].type ) {
+			case SQL_NULL:
+				binds[i].buffer_type	= MYSQL_TYPE_NULL;
+				break;
+			case SQL_INTEGER:
+				binds[i].buffer_type	= MYSQL_TYPE_LONGLONG;
+				binds[i].buffer		= const_cast<int64_t*>(&params[i].integer);
+				break;
+			case SQL_STRING:
+				lengths[i]		= params[i].string.size();
+				binds[i].buffer_type	= MYSQL_TYPE_STRING;
+				binds[i].buffer		= const_cast<char*>(params[i].string.data());
+				binds[i].buffer_length	= lengths[i];
+				binds[i].length		= &lengths[i];
+				break;
+		}
+	}
+
+	if ( params.empty() == false and mysql_stmt_bind_param(stmt, &binds[0]) != 0 ) {
+		e.msg = "prepared_run:: cannot bind the parameters of: ";
+		e.msg += query;
+		e.msg += " error: ";
+		e.msg += mysql_stmt_error(stmt);
+		ERROR << e.msg;
+		throw e;
+	}
+
+#ifndef QT_NO_DEBUG
+	DEBUG << "prepared_run:: " << query;
+#endif
+
+	this->count_query();
+
+	if ( mysql_stmt_execute(stmt) != 0 ) {
+		e.msg = "query: ";
+		e.msg += query;
+		e.msg += " error: ";
+		e.msg += mysql_stmt_error(stmt);
+		ERROR << e.msg;
+		mysql_stmt_reset(stmt);
+		throw e;
+	}
+
+	return stmt;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Mysql::prepared_fetch(MYSQL_STMT* stmt, const v_sql_columns& columns, const row_handler& handler) {
+	MYSQL_RES*	metadata	= mysql_stmt_result_metadata(stmt);
+	unsigned int	num_fields;
+	int		status;
+
+	// Not a SELECT
+	if ( metadata == NULL )
+		return true;
+
+	num_fields = mysql_num_fields(metadata);
+	mysql_free_result(metadata);
+
+	std::vector<MYSQL_BIND>		binds(num_fields);
+	std::vector<std::string>	buffers(num_fields);
+	std::vector<std::string>	large_values(num_fields);
+	std::vector<int64_t>		integers(num_fields);
+	std::vector<unsigned long>	lengths(num_fields);
+	std::vector<my_bool>		nulls(num_fields);
+	std::vector<my_bool>		errors(num_fields);
+	std::vector<bool>		is_integer(num_fields);
+	v_cells				cells(num_fields);
+
+	for ( unsigned int i = 0 ; i < num_fields ; i++ ) {
+		is_integer[i]		= i < columns.size() and columns[i] == SQL_INTEGER;
+
+		binds[i].is_null	= &nulls[i];
+		binds[i].error		= &errors[i];
+
+		// The server converts the integers itself, no text is involved
+		if ( is_integer[i] == true ) {
+			binds[i].buffer_type	= MYSQL_TYPE_LONGLONG;
+			binds[i].buffer		= &integers[i];
+			continue;
+		}
+
+		buffers[i].resize(mysql_result_buffer_size);
+
+		binds[i].buffer_type	= MYSQL_TYPE_STRING;
+		binds[i].buffer		= &buffers[i][0];
+		binds[i].buffer_length	= buffers[i].size();
+		binds[i].length		= &lengths[i];
+	}
+
+	if ( num_fields > 0 and mysql_stmt_bind_result(stmt, &binds[0]) != 0 ) {
+		ERROR << "prepared_fetch:: " << mysql_stmt_error(stmt);
+		mysql_stmt_free_result(stmt);
+		return false;
+	}
+
+	try {
+		while ( ( status = mysql_stmt_fetch(stmt) ) == 0 or status == MYSQL_DATA_TRUNCATED ) {
+			for ( unsigned int i = 0 ; i < num_fields ; i++ ) {
+				cells[i].is_null	= nulls[i];
+				cells[i].data		= NULL;
+				cells[i].length		= 0;
+				cells[i].integer	= 0;
+
+				if ( nulls[i] )
+					continue;
+
+				if ( is_integer[i] == true ) {
+					cells[i].integer = integers[i];
+					continue;
+				}
+
+				if ( lengths[i] <= buffers[i].size() ) {
+					cells[i].data	= buffers[i].data();
+					cells[i].length	= lengths[i];
+					continue;
+				}
+
+				// The value did not fit in the bound buffer
+				MYSQL_BIND	b	= binds[i];
+
+				large_values[i].resize(lengths[i]);
+				b.buffer	= &large_values[i][0];
+				b.buffer_length	= large_values[i].size();
+
+				if ( mysql_stmt_fetch_column(stmt, &b, i, 0) != 0 ) {
+					ERROR << "prepared_fetch:: " << mysql_stmt_error(stmt);
+					mysql_stmt_reset(stmt);
+					return false;
+				}
+
+				cells[i].data	= large_values[i].data();
+				cells[i].length	= large_values[i].size();
+			}
+
+			handler(cells);
+		}
+	} catch (...) {
+		// Discards the rows left
+		mysql_stmt_reset(stmt);
+		throw;
+	}
+
+	if ( status != MYSQL_NO_DATA ) {
+		ERROR << "prepared_fetch:: " << mysql_stmt_error(stmt);
+		mysql_stmt_reset(stmt);
+		return false;
+	}
+
+	mysql_stmt_free_result(stmt);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Mysql::close_statements(mysql_connection* c) {
+	BOOST_FOREACH(m_mysql_statements::value_type& s, c->statements) {
+		mysql_stmt_close(s.second);
+	}
+	c->statements.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Mysql::load_file(const char* node_name, const char* file_path) {
+	std::ifstream	f (file_path, std::ifstream::in);
+	std::string		line;
+	std::string		query;
+	v_queries		queries;
+	boost::regex	end_of_query("^.*?;$", boost::regex::perl);
 	boost::regex	empty_string("^\\s+$", boost::regex::perl);
 	boost::regex	comment_string("^--.*?$", boost::regex::perl);
 
-	query = "USE ";
-	query += node_name;
-	query += ";";
-	queries.insert(queries.end(), query);
-	query.clear();
-
 	if ( f.is_open() ) {
 		while ( ! f.eof() ) {
 			getline(f, line);
@@ -373,22 +1004,134 @@ bool	Mysql::load_file(const char* node_name, const char* file_path) {
 	if ( query.empty() == false and boost::regex_match(query, empty_string) == false  )
 		queries.insert(queries.end(), query);
 
-	return this->standalone_execute(queries, NULL);
+	/*
+	 * The queries are run by a connection bound to the schema instead of
+	 * using "USE": the connection goes back to the pool afterwards
+	 */
+	return this->standalone_execute(queries, node_name);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-MYSQL*		Mysql::init(const char* database_name) {
+mysql_connection*	Mysql::init(const char* database_name) {
+	std::string				schema;
+	mysql_connection*			local_mysql	= NULL;
+	m_mysql_connections::iterator		it;
+	boost::unique_lock<boost::mutex>	lock(this->pool_mutex);
+
+	if ( database_name != NULL )
+		schema = database_name;
+
+	if ( mysql_thread_initialized.get() == NULL ) {
+		mysql_thread_init();
+		mysql_thread_initialized.reset(new bool(true));
+	}
+
+	while ( local_mysql == NULL ) {
+		// An idle connection already using the schema
+		it = this->idle_connections.find(schema);
+		if ( it != this->idle_connections.end() and it->second.empty() == false ) {
+			local_mysql = it->second.front();
+			it->second.pop_front();
+			break;
+		}
+
+		// Room for a new connection
+		if ( this->opened_connections < this->pool_size ) {
+			this->opened_connections++;
+			lock.unlock();
+
+			try {
+				local_mysql = this->connect(database_name);
+			} catch (rpc::ex_processing& e) {
+				lock.lock();
+				this->opened_connections--;
+				this->pool_released.notify_one();
+				throw e;
+			}
+
+			return local_mysql;
+		}
+
+		// An idle connection using another schema
+		for ( it = this->idle_connections.begin() ; it != this->idle_connections.end() ; it++ ) {
+			if ( it->second.empty() == false ) {
+				local_mysql = it->second.front();
+				it->second.pop_front();
+				break;
+			}
+		}
+
+		if ( local_mysql == NULL )
+			this->pool_released.wait(lock);
+	}
+
+	lock.unlock();
+
+	// Health check
+	if ( time(NULL) - local_mysql->last_used > this->pool_check_interval and mysql_ping(local_mysql->handle) != 0 ) {
+		WARN << "MySQL connection to '" << local_mysql->schema << "' is broken, reconnecting: " << mysql_error(local_mysql->handle);
+		this->disconnect(local_mysql);
+
+		try {
+			return this->connect(database_name);
+		} catch (rpc::ex_processing& e) {
+			lock.lock();
+			this->opened_connections--;
+			this->pool_released.notify_one();
+			throw e;
+		}
+	}
+
+	// A connection without schema can run schema-less queries
+	if ( schema.empty() == false and local_mysql->schema.compare(schema) != 0 ) {
+		// The prepared statements refer to the previous schema's tables
+		this->close_statements(local_mysql);
+
+		if ( mysql_select_db(local_mysql->handle, database_name) != 0 ) {
+			rpc::ex_processing e;
+			e.msg = "Error: cannot select the schema ";
+			e.msg += schema;
+			e.msg += ": ";
+			e.msg += mysql_error(local_mysql->handle);
+			this->end(local_mysql);
+			throw e;
+		}
+		local_mysql->schema = schema;
+	}
+
+	return local_mysql;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Mysql::end(mysql_connection* c, const bool broken) {
+	boost::mutex::scoped_lock	lock(this->pool_mutex);
+
+	if ( c == NULL )
+		return;
+
+	if ( broken == true ) {
+		this->disconnect(c);
+		this->opened_connections--;
+	} else {
+		c->last_used = time(NULL);
+		this->idle_connections[c->schema].push_front(c);
+	}
+
+	this->pool_released.notify_one();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+mysql_connection*	Mysql::connect(const char* database_name) {
 	MYSQL*	local_mysql = NULL;
 	rpc::ex_processing e;
 
-	mysql_thread_init();
-
 	local_mysql = mysql_init(NULL);
 
 	if ( local_mysql == NULL ) {
 		e.msg = "Error: cannot init a MySQL connector";
-		mysql_thread_end();
 		throw e;
 	}
 
@@ -396,18 +1139,26 @@ MYSQL*		Mysql::init(const char* database_name) {
 	if ( ! mysql_real_connect(local_mysql, NULL, NULL, NULL, database_name, 0, NULL, 0) ) {
 		e.msg = "Error: cannot connect: ";
 		e.msg += mysql_error(local_mysql);
-		mysql_thread_end();
+		mysql_close(local_mysql);
 		throw e;
 	}
 
-	return local_mysql;
+	mysql_connection*	result = new mysql_connection();
+
+	result->handle		= local_mysql;
+	result->last_used	= time(NULL);
+	if ( database_name != NULL )
+		result->schema	= database_name;
+
+	return result;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void	Mysql::end(MYSQL* db) {
-	mysql_close(db);
-	mysql_thread_end();
+void	Mysql::disconnect(mysql_connection* c) {
+	this->close_statements(c);
+	mysql_close(c->handle);
+	delete c;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -431,231 +1182,843 @@ std::string Mysql::translate_into_prog(const std::string* str) {
 
 #ifdef USE_SQLITE
 
-Sqlite::Sqlite() {
-//	if ( sqlite3_threadsafe() != SQLITE_OK )
-//		throw "SQLite3 is not threadsafe !";
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * sqlite_busy_timeout
+ *
+ * How long (milliseconds) a connection waits for the lock of another one:
+ * the readers never wait in WAL mode, the writers are serialized
+ */
+static	const int	sqlite_busy_timeout = 5000;
+
+/*
+ * The functions used by the queries written for MySQL, registered on each
+ * connection. The timestamps are stored as UNIX timestamps and the times of
+ * the day as "HH:MM:SS" strings.
+ */
+
+/*
+ * sqlite_from_unixtime
+ *
+ * FROM_UNIXTIME(timestamp): the value is stored as it is
+ */
+static	void	sqlite_from_unixtime(sqlite3_context* context, int argc, sqlite3_value** argv) {
+	if ( argc != 1 or sqlite3_value_type(argv[0]) == SQLITE_NULL ) {
+		sqlite3_result_null(context);
+		return;
+	}
+
+	sqlite3_result_int64(context, sqlite3_value_int64(argv[0]));
+}
+
+/*
+ * sqlite_unix_timestamp
+ *
+ * UNIX_TIMESTAMP([date]): the current time, a stored timestamp or a local
+ * "YYYY-MM-DD HH:MM:SS" date
+ */
+static	void	sqlite_unix_timestamp(sqlite3_context* context, int argc, sqlite3_value** argv) {
+	struct tm	date;
+	const char*	text;
+
+	if ( argc == 0 ) {
+		sqlite3_result_int64(context, time(NULL));
+		return;
+	}
+
+	switch ( sqlite3_value_type(argv[0]) ) {
+		case SQLITE_NULL:
+			sqlite3_result_null(context);
+			return;
+		case SQLITE_INTEGER:
+		case SQLITE_FLOAT:
+			sqlite3_result_int64(context, sqlite3_value_int64(argv[0]));
+			return;
+	}
+
+	memset(&date, 0, sizeof(date));
+	text = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+
+	if ( text == NULL or sscanf(text, "%d-%d-%d %d:%d:%d", &date.tm_year, &date.tm_mon, &date.tm_mday, &date.tm_hour, &date.tm_min, &date.tm_sec) < 3 ) {
+		sqlite3_result_null(context);
+		return;
+	}
+
+	date.tm_year	-= 1900;
+	date.tm_mon	-= 1;
+	date.tm_isdst	= -1;
+
+	sqlite3_result_int64(context, mktime(&date));
+}
+
+/*
+ * sqlite_sec_to_time
+ *
+ * SEC_TO_TIME(seconds): "HH:MM:SS"
+ */
+static	void	sqlite_sec_to_time(sqlite3_context* context, int argc, sqlite3_value** argv) {
+	char		result[32];
+	sqlite3_int64	seconds;
+
+	if ( argc != 1 or sqlite3_value_type(argv[0]) == SQLITE_NULL ) {
+		sqlite3_result_null(context);
+		return;
+	}
+
+	seconds = sqlite3_value_int64(argv[0]);
 
-//	if ( sqlite3_config(SQLITE_CONFIG_SERIALIZED) != SQLITE_OK )
-//		throw "SQLite3 cannot use SQLITE_CONFIG_SERIALIZED";
+	if ( seconds < 0 ) {
+		sqlite3_result_null(context);
+		return;
+	}
+
+	snprintf(result, sizeof(result), "%02lld:%02d:%02d", seconds / 3600, static_cast<int>(seconds % 3600 / 60), static_cast<int>(seconds % 60));
+	sqlite3_result_text(context, result, -1, SQLITE_TRANSIENT);
+}
+
+/*
+ * sqlite_time_to_sec
+ *
+ * TIME_TO_SEC("HH:MM[:SS]"): the number of seconds
+ */
+static	void	sqlite_time_to_sec(sqlite3_context* context, int argc, sqlite3_value** argv) {
+	const char*	text;
+	int		hours	= 0;
+	int		minutes	= 0;
+	int		seconds	= 0;
+
+	if ( argc != 1 or sqlite3_value_type(argv[0]) == SQLITE_NULL ) {
+		sqlite3_result_null(context);
+		return;
+	}
+
+	text = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+
+	if ( text == NULL or sscanf(text, "%d:%d:%d", &hours, &minutes, &seconds) < 2 ) {
+		sqlite3_result_null(context);
+		return;
+	}
+
+	sqlite3_result_int64(context, static_cast<sqlite3_int64>(hours) * 3600 + minutes * 60 + seconds);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Sqlite::Sqlite() : thread_connections(&Sqlite::release_thread_connections) {
+	rpc::ex_processing	e;
+
+	/*
+	 * Each connection is used by a single thread
+	 */
+	if ( sqlite3_threadsafe() == 0 ) {
+		e.msg = "SQLite3 is not threadsafe !";
+		throw e;
+	}
 
 	if ( sqlite3_config(SQLITE_CONFIG_MULTITHREAD) != SQLITE_OK )
-		throw "SQLite3 cannot use SQLITE_CONFIG_MULTITHREAD";
+		WARN << "SQLite3 cannot use SQLITE_CONFIG_MULTITHREAD, it is already initialized";
+
+	if ( sqlite3_initialize() != SQLITE_OK ) {
+		e.msg = "SQLite3 cannot initialize";
+		throw e;
+	}
 
-	if ( sqlite3_initialize() != SQLITE_OK )
-		throw "SQLite3 cannot initialize";
+	this->registry.reset(new sqlite_registry());
+
+	this->mmap_size		= 0;
+	this->queries_count	= 0;
 }
 
 Sqlite::~Sqlite() {
-	sqlite3_shutdown();
+	this->shutdown();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool	Sqlite::prepare(const char* node_name, const std::string* db_data, const std::string* db_skeleton ) {
-	// TODO : deal with plannings' progression
-	std::string	db_name("schd_1.db");
-	std::string	mkdir_call("mkdir -p ");
-	int			result;
+bool	Sqlite::prepare(const std::string& data_path, const int64_t mmap_size) {
+	struct stat	info;
 
-	this->db += db_data->c_str();
-	this->db += "/";
-	this->db += node_name;
-	this->db += "/";
-	this->db += db_name.c_str();
+	if ( data_path.empty() == true ) {
+		ERROR << "the data path is empty";
+		return false;
+	}
 
-	mkdir_call += db_data->c_str();
-	mkdir_call += "/";
-	mkdir_call += node_name;
+	if ( mkdir(data_path.c_str(), 0750) != 0 and errno != EEXIST ) {
+		ERROR << "cannot create " << data_path << ": " << strerror(errno);
+		return false;
+	}
 
-	result = system(mkdir_call.c_str());
-	if ( result != 0 ) {
-		ERROR << "Error : system error : mkdir -p returned " << result;
+	if ( stat(data_path.c_str(), &info) != 0 or S_ISDIR(info.st_mode) == false ) {
+		ERROR << data_path << " is not a directory";
 		return false;
 	}
 
-	return this->load_file(node_name, db_skeleton->c_str());
+	this->data_path	= data_path;
+	this->mmap_size	= mmap_size;
+
+	INFO << "SQLite " << sqlite3_libversion() << " plannings are stored in " << this->data_path << ", memory map size is " << this->mmap_size << " bytes";
+
+	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool	Sqlite::atomic_execute(const std::string& query, sqlite3* p_db) {
-	char*	err_msg	= 0;
-	int		ret_code;
+bool	Sqlite::init_domain_structure(const std::string& domain_name, const std::string& db_skeleton) {
+	if ( this->schema_exists(domain_name) == true )
+		return true;
 
-	DEBUG << query.c_str();
-	ret_code = sqlite3_exec(p_db, query.c_str(), callback, 0, &err_msg);
+	if ( this->load_file(domain_name.c_str(), db_skeleton.c_str()) == false ) {
+		this->remove_schema(domain_name);
+		return false;
+	}
 
-	if ( ret_code != SQLITE_OK ) {
-		ERROR << "Error : SQLITE error code " << ret_code << " : " << err_msg;
-		sqlite3_free(err_msg);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
 
+bool	Sqlite::clone_schema(const std::string& source, const std::string& target, const v_sql_statements& after_copy) {
+	sqlite_connection*	source_c;
+	sqlite_connection*	target_c;
+	sqlite3_backup*		backup;
+	int			result;
+	rpc::ex_processing	e;
+
+	if ( this->schema_exists(source) == false ) {
+		e.msg = "clone_schema:: the planning ";
+		e.msg += source;
+		e.msg += " does not exist";
+		throw e;
+	}
+
+	if ( this->schema_exists(target) == true ) {
+		e.msg = "clone_schema:: the planning ";
+		e.msg += target;
+		e.msg += " already exists";
+		throw e;
+	}
+
+	try {
+		source_c = this->init(source.c_str());
+		target_c = this->init(target.c_str());
+
+		/*
+		 * The source is read in a single pass: the copy is consistent
+		 */
+		backup = sqlite3_backup_init(target_c->handle, "main", source_c->handle, "main");
+
+		if ( backup == NULL ) {
+			e.msg = "clone_schema:: cannot start the copy: ";
+			e.msg += sqlite3_errmsg(target_c->handle);
+			throw e;
+		}
+
+		result = sqlite3_backup_step(backup, -1);
+		sqlite3_backup_finish(backup);
+
+		if ( result != SQLITE_DONE ) {
+			e.msg = "clone_schema:: the copy failed: ";
+			e.msg += sqlite3_errstr(result);
+			throw e;
+		}
+
+		this->count_query();
+
+		if ( after_copy.empty() == false )
+			this->prepared_execute(after_copy, target.c_str());
+	} catch (rpc::ex_processing& e) {
+		ERROR << "clone_schema:: cannot copy " << source << " into " << target << ": " << e.msg;
+		this->remove_schema(target);
+		throw e;
+	}
+
+	INFO << "clone_schema:: " << target << " created from " << source;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sqlite::schema_exists(const std::string& schema) {
+	struct stat	info;
+
+	return stat(this->get_file_path(schema).c_str(), &info) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sqlite::list_schemas(std::vector<std::string>& _return) {
+	DIR*		directory;
+	struct dirent*	entry;
+	std::string	name;
+	std::string	extension(".db");
+
+	if ( ( directory = opendir(this->data_path.c_str()) ) == NULL ) {
+		rpc::ex_processing e;
+		e.msg = "Cannot read ";
+		e.msg += this->data_path;
+		throw e;
+	}
+
+	while ( ( entry = readdir(directory) ) != NULL ) {
+		name = entry->d_name;
+
+		if ( name.size() > extension.size() and name.compare(name.size() - extension.size(), extension.size(), extension) == 0 )
+			_return.push_back(name.substr(0, name.size() - extension.size()));
+	}
+
+	closedir(directory);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sqlite::atomic_execute(const std::string& query, sqlite_connection* c) {
+	char*	err_msg	= NULL;
+	boost::regex	empty_string("^\\s*$", boost::regex::perl);
+
+	if ( boost::regex_match(query, empty_string) == true ) {
+		ERROR << "atomic_execute:: query is empty !";
 		return false;
 	}
 
+#ifndef QT_NO_DEBUG
+	DEBUG << "atomic_execute:: " << query;
+#endif
+
+	this->count_query();
+
+	if ( sqlite3_exec(c->handle, query.c_str(), NULL, NULL, &err_msg) != SQLITE_OK ) {
+		rpc::ex_processing e;
+		e.msg = "query: ";
+		e.msg += query;
+		e.msg += " error: ";
+		e.msg += err_msg == NULL ? sqlite3_errmsg(c->handle) : err_msg;
+		sqlite3_free(err_msg);
+		ERROR << e.msg;
+		throw e;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sqlite::standalone_execute(const v_queries& queries, const char* database_name) {
+	sqlite_connection*	c = this->init(database_name);
+
+	this->atomic_execute("BEGIN IMMEDIATE;", c);
+
+	try {
+		BOOST_FOREACH(const std::string& q, queries) {
+			if ( this->atomic_execute(q, c) == false ) {
+				sqlite3_exec(c->handle, "ROLLBACK;", NULL, NULL, NULL);
+				return false;
+			}
+		}
+
+		this->atomic_execute("COMMIT;", c);
+	} catch (rpc::ex_processing& e) {
+		sqlite3_exec(c->handle, "ROLLBACK;", NULL, NULL, NULL);
+		throw e;
+	}
+
 	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool	Sqlite::standalone_execute(const v_queries* queries) {
-	sqlite3*	p_db	= this->init();
-	std::string	query	= "BEGIN TRANSACTION;";
+bool	Sqlite::query_one_row(v_row& _return, const char* query, const char* database_name) {
+	return this->query_each_row(query, boost::bind(&append_values, &_return, _1), database_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sqlite::query_full_result(v_v_row& _return, const char* query, const char* database_name) {
+	return this->query_each_row(query, boost::bind(&append_row, &_return, _1), database_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sqlite::query_each_row(const char* query, const row_handler& handler, const char* database_name) {
+	return this->query_each_row(query, v_sql_columns(), handler, database_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
 
-	if ( p_db == NULL )
+bool	Sqlite::query_each_row(const char* query, const v_sql_columns& columns, const row_handler& handler, const char* database_name) {
+	sqlite_connection*	c	= NULL;
+	sqlite3_stmt*		stmt	= NULL;
+	bool			result;
+
+	if ( query == NULL ) {
+		ERROR << "query_each_row:: query is NULL";
 		return false;
+	}
+
+	c = this->init(database_name);
+
+#ifndef QT_NO_DEBUG
+	DEBUG << "query_each_row:: " << query;
+#endif
 
-	if ( this->atomic_execute(query, p_db) == false ) {
-		this->end(p_db);
+	this->count_query();
+
+	if ( sqlite3_prepare_v2(c->handle, query, -1, &stmt, NULL) != SQLITE_OK ) {
+		ERROR << "query_each_row:: " << query << " error: " << sqlite3_errmsg(c->handle);
+		sqlite3_finalize(stmt);
 		return false;
 	}
 
-	BOOST_FOREACH(std::string q, *queries) {
-		if ( this->atomic_execute(q, p_db) == false ) {
-			query = "ROLLBACK;";
-			this->atomic_execute(query, p_db);
-			this->end(p_db);
-			return false;
-		}
+	try {
+		result = this->fetch(c, stmt, columns, handler);
+	} catch ( ... ) {
+		sqlite3_finalize(stmt);
+		throw;
 	}
 
-	query = "COMMIT;";
+	sqlite3_finalize(stmt);
 
-	if ( this->atomic_execute(query, p_db) == false ) {
-		this->end(p_db);
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sqlite::prepared_query_each_row(const std::string& query, const v_sql_params& params, const row_handler& handler, const char* database_name) {
+	return this->prepared_query_each_row(query, params, v_sql_columns(), handler, database_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sqlite::prepared_query_each_row(const std::string& query, const v_sql_params& params, const v_sql_columns& columns, const row_handler& handler, const char* database_name) {
+	sqlite_connection*	c	= this->init(database_name);
+	sqlite3_stmt*		stmt	= NULL;
+
+	try {
+		stmt = this->get_statement(c, query);
+	} catch (const rpc::ex_processing&) {
 		return false;
 	}
 
-	this->end(p_db);
-	return true;
+	this->count_query();
+
+	if ( this->bind_params(stmt, params) == false ) {
+		ERROR << "prepared_query_each_row:: cannot bind the parameters of " << query << ": " << sqlite3_errmsg(c->handle);
+		sqlite3_clear_bindings(stmt);
+		return false;
+	}
+
+	return this->fetch(c, stmt, columns, handler);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-v_row	Sqlite::query_one_row(const char* query) {
-	sqlite3*		p_db = this->init();
-	sqlite3_stmt*	stmt;
-	v_row			result;
+bool	Sqlite::prepared_execute(const v_sql_statements& statements, const char* database_name) {
+	sqlite_connection*	c	= this->init(database_name);
+	sqlite3_stmt*		stmt	= NULL;
+	int			status;
+	rpc::ex_processing	e;
+
+	/*
+	 * The write lock is taken at once: a deferred transaction could not be
+	 * upgraded while another connection writes
+	 */
+	this->atomic_execute("BEGIN IMMEDIATE;", c);
+
+	try {
+		BOOST_FOREACH(const sql_statement& s, statements) {
+#ifndef QT_NO_DEBUG
+			DEBUG << "prepared_execute:: " << s.query;
+#endif
+			stmt = this->get_statement(c, s.query);
+
+			this->count_query();
+
+			if ( this->bind_params(stmt, s.params) == false ) {
+				e.msg = "prepared_execute:: cannot bind the parameters of ";
+				e.msg += s.query;
+				e.msg += " - ";
+				e.msg += sqlite3_errmsg(c->handle);
+				throw e;
+			}
+
+			while ( ( status = sqlite3_step(stmt) ) == SQLITE_ROW );
+
+			sqlite3_reset(stmt);
+			stmt = NULL;
+
+			if ( status != SQLITE_DONE ) {
+				e.msg = "prepared_execute:: query: ";
+				e.msg += s.query;
+				e.msg += " error: ";
+				e.msg += sqlite3_errmsg(c->handle);
+				throw e;
+			}
+		}
+
+		this->atomic_execute("COMMIT;", c);
+	} catch (rpc::ex_processing& e) {
+		ERROR << e.msg;
 
-	if ( query == NULL or p_db == NULL)
-		return result;
+		if ( stmt != NULL )
+			sqlite3_reset(stmt);
 
-	if ( sqlite3_prepare_v2(p_db, query, -1, &stmt, NULL) != SQLITE_OK ) {
-		return result;
+		sqlite3_exec(c->handle, "ROLLBACK;", NULL, NULL, NULL);
+		throw e;
 	}
 
-	if ( sqlite3_step(stmt) == SQLITE_ROW ) {
-		result.clear();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sqlite::prepared_query_one_row(v_row& _return, const std::string& query, const v_sql_params& params, const char* database_name) {
+	return this->prepared_query_each_row(query, params, boost::bind(&append_values, &_return, _1), database_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sqlite::prepared_query_full_result(v_v_row& _return, const std::string& query, const v_sql_params& params, const char* database_name) {
+	return this->prepared_query_each_row(query, params, boost::bind(&append_row, &_return, _1), database_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int	Sqlite::get_inserted_id(const char* database_name) {
+	return static_cast<int>(sqlite3_last_insert_rowid(this->init(database_name)->handle));
+}
 
-		for ( int i = 0; i < sqlite3_data_count(stmt) ; i++ )
-			result.push_back(std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, i))));
+///////////////////////////////////////////////////////////////////////////////
+
+uint64_t	Sqlite::get_queries_count() {
+	boost::mutex::scoped_lock	lock(this->stats_mutex);
+	return this->queries_count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sqlite::count_query() {
+	boost::mutex::scoped_lock	lock(this->stats_mutex);
+	this->queries_count++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sqlite::shutdown() {
+	/*
+	 * The threads' lists keep pointing to the closed connections: they
+	 * are not in the registry anymore, the threads do not close them twice
+	 */
+	{
+		boost::mutex::scoped_lock	lock(this->registry->mutex);
+
+		BOOST_FOREACH(sqlite_connection* c, this->registry->connections) {
+			disconnect(c);
+		}
+
+		this->registry->connections.clear();
 	}
 
-	sqlite3_free(stmt);
-	this->end(p_db);
+	if ( this->thread_connections.get() != NULL )
+		this->thread_connections->connections.clear();
 
-	return result;
+	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-v_v_row*	Sqlite::query_full_result(const char* query) {
-	sqlite3*		p_db = this->init();
-	sqlite3_stmt*	stmt;
-	v_row			line;
-	v_v_row*		result = NULL;
+std::string	Sqlite::get_file_path(const std::string& schema) {
+	boost::regex	valid_name("^\\w+$", boost::regex::perl);
+
+	if ( boost::regex_match(schema, valid_name) == false ) {
+		rpc::ex_processing e;
+		e.msg = "invalid planning name: ";
+		e.msg += schema;
+		throw e;
+	}
+
+	return this->data_path + "/" + schema + ".db";
+}
 
-	if ( query == NULL or p_db == NULL)
-		return result;
+///////////////////////////////////////////////////////////////////////////////
 
-	if ( sqlite3_prepare_v2(p_db, query, -1, &stmt, NULL) != SQLITE_OK ) {
-		return result;
+void	Sqlite::remove_schema(const std::string& schema) {
+	std::string			path;
+	m_sqlite_connections::iterator	it;
+
+	try {
+		path = this->get_file_path(schema);
+	} catch (const rpc::ex_processing& e) {
+		ERROR << "remove_schema:: " << e.msg;
+		return;
 	}
 
-	while ( sqlite3_step(stmt) == SQLITE_ROW ) {
-		line.clear();
+	if ( this->thread_connections.get() != NULL ) {
+		it = this->thread_connections->connections.find(schema);
 
-		for ( int i = 0; i < sqlite3_data_count(stmt) ; i++ )
-			line.push_back(std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, i))));
+		if ( it != this->thread_connections->connections.end() ) {
+			boost::mutex::scoped_lock	lock(this->registry->mutex);
 
-		result->push_back(line);
+			if ( this->registry->connections.erase(it->second) > 0 )
+				disconnect(it->second);
+
+			this->thread_connections->connections.erase(it);
+		}
 	}
 
-	sqlite3_free(stmt);
-	this->end(p_db);
+	if ( unlink(path.c_str()) != 0 and errno != ENOENT )
+		ERROR << "remove_schema:: cannot remove " << path << ": " << strerror(errno);
 
-	return result;
+	unlink((path + "-wal").c_str());
+	unlink((path + "-shm").c_str());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// TODO: make it more robust
-int		Sqlite::get_inserted_id() {
-	sqlite3*	p_db = this->init();
 
-	return sqlite3_last_insert_rowid(p_db);
+sqlite3_stmt*	Sqlite::get_statement(sqlite_connection* c, const std::string& query) {
+	m_sqlite_statements::iterator	it	= c->statements.find(query);
+	sqlite3_stmt*			stmt	= NULL;
+	std::string			sql	= query;
+
+	if ( it != c->statements.end() )
+		return it->second;
+
+	// MySQL's syntax
+	boost::algorithm::replace_all(sql, "INSERT IGNORE ", "INSERT OR IGNORE ");
+
+	if ( sqlite3_prepare_v2(c->handle, sql.c_str(), sql.size(), &stmt, NULL) != SQLITE_OK ) {
+		rpc::ex_processing e;
+		e.msg = "get_statement:: cannot prepare ";
+		e.msg += query;
+		e.msg += " - ";
+		e.msg += sqlite3_errmsg(c->handle);
+		ERROR << e.msg;
+		sqlite3_finalize(stmt);
+		throw e;
+	}
+
+	c->statements[query] = stmt;
+
+	return stmt;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool	Sqlite::shutdown() {/*
-	if ( sqlite3_close(this->p_db) == SQLITE_OK )
-		return true;
-*/
-	return false;
+bool	Sqlite::bind_params(sqlite3_stmt* stmt, const v_sql_params& params) {
+	int	result = SQLITE_OK;
+
+	if ( static_cast<size_t>(sqlite3_bind_parameter_count(stmt)) != params.size() ) {
+		ERROR << "bind_params:: the statement expects " << sqlite3_bind_parameter_count(stmt) << " parameters, " << params.size() << " given";
+		return false;
+	}
+
+	for ( size_t i = 0 ; i < params.size() and result == SQLITE_OK ; i++ ) {
+		switch ( params[i].type ) {
+			case SQL_NULL:
+				result = sqlite3_bind_null(stmt, i + 1);
+				break;
+			case SQL_INTEGER:
+				result = sqlite3_bind_int64(stmt, i + 1, params[i].integer);
+				break;
+			case SQL_STRING:
+				result = sqlite3_bind_text(stmt, i + 1, params[i].string.c_str(), params[i].string.size(), SQLITE_TRANSIENT);
+				break;
+		}
+	}
+
+	return result == SQLITE_OK;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool	Sqlite::load_file(const char* node_name, const char* file_path) {
-	std::ifstream	f (file_path, std::ifstream::in);
-	std::string		line;
-	std::string		query;
-	v_queries		queries;
-	boost::regex	end_of_query("^.*?;$", boost::regex::perl);
+bool	Sqlite::fetch(sqlite_connection* c, sqlite3_stmt* stmt, const v_sql_columns& columns, const row_handler& handler) {
+	v_cells		cells(sqlite3_column_count(stmt));
+	int		status;
+	int		type;
 
-	// TODO: throw an exception if the file does not exist
-	if ( f.is_open() ) {
-		while ( ! f.eof() ) {
-			getline(f, line);
-			query += " ";
-			if ( boost::regex_match(line, end_of_query) == true ) {
-				query += line;
-				queries.insert(queries.end(), query);
-				query.clear();
-			} else
-				query += line;
+	try {
+		while ( ( status = sqlite3_step(stmt) ) == SQLITE_ROW ) {
+			for ( size_t i = 0 ; i < cells.size() ; i++ ) {
+				sql_cell&	cell = cells[i];
+
+				type		= sqlite3_column_type(stmt, i);
+				cell.is_null	= type == SQLITE_NULL;
+				cell.data	= NULL;
+				cell.length	= 0;
+				cell.integer	= 0;
+
+				if ( cell.is_null == true )
+					continue;
+
+				if ( i < columns.size() and columns[i] == SQL_INTEGER and ( type == SQLITE_INTEGER or type == SQLITE_FLOAT ) ) {
+					cell.integer = sqlite3_column_int64(stmt, i);
+					continue;
+				}
+
+				// sqlite3_column_bytes() must follow the conversion to text
+				cell.data	= reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
+				cell.length	= sqlite3_column_bytes(stmt, i);
+
+				if ( i < columns.size() and columns[i] == SQL_INTEGER ) {
+					if ( build_integer_from_string(cell.data, cell.length, cell.integer) == false ) {
+						rpc::ex_processing e;
+						e.msg = "fetch:: cannot cast ";
+						e.msg += std::string(cell.data, cell.length);
+						e.msg += " to integer";
+						throw e;
+					}
+
+					cell.data	= NULL;
+					cell.length	= 0;
+				}
+			}
+
+			handler(cells);
 		}
-	} else
+	} catch ( ... ) {
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+		throw;
+	}
+
+	if ( status != SQLITE_DONE )
+		ERROR << "fetch:: error: " << sqlite3_errmsg(c->handle);
+
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+
+	return status == SQLITE_DONE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sqlite::load_file(const char* database_name, const char* file_path) {
+	std::ifstream	f(file_path, std::ifstream::in);
+	std::string	content;
+
+	if ( f.is_open() == false ) {
+		ERROR << "load_file:: cannot open " << file_path;
 		return false;
+	}
 
-	queries.insert(queries.end(), query);
+	// sqlite3_exec() runs the statements one after the other
+	content.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+
+	try {
+		return this->standalone_execute(v_queries(1, content), database_name);
+	} catch (const rpc::ex_processing&) {
+		ERROR << "load_file:: cannot load " << file_path;
+	}
 
-	return this->standalone_execute(&queries);
+	return false;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-sqlite3*	Sqlite::init() {
-	sqlite3*	p_db;
+sqlite_connection*	Sqlite::init(const char* database_name) {
+	sqlite_thread_connections*	t	= this->thread_connections.get();
+	std::string			schema	= database_name == NULL ? "" : database_name;
+	m_sqlite_connections::iterator	it;
+	sqlite_connection*		c;
+
+	if ( t == NULL ) {
+		t = new sqlite_thread_connections();
+		t->registry = this->registry;
+		this->thread_connections.reset(t);
+	}
+
+	it = t->connections.find(schema);
+
+	if ( it != t->connections.end() )
+		return it->second;
+
+	c = this->connect(schema);
+	t->connections[schema] = c;
+
+	return c;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+sqlite_connection*	Sqlite::connect(const std::string& schema) {
+	std::string		path	= schema.empty() == true ? ":memory:" : this->get_file_path(schema);
+	std::string		pragmas;
+	sqlite_connection*	c	= new sqlite_connection();
+	rpc::ex_processing	e;
+
+	c->handle	= NULL;
+	c->schema	= schema;
+
+	if ( sqlite3_open_v2(path.c_str(), &c->handle, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK ) {
+		e.msg = "connect:: cannot open ";
+		e.msg += path;
+		e.msg += " - ";
+		e.msg += c->handle == NULL ? "not enough memory" : sqlite3_errmsg(c->handle);
+		ERROR << e.msg;
+		disconnect(c);
+		throw e;
+	}
+
+	sqlite3_busy_timeout(c->handle, sqlite_busy_timeout);
 
-	if ( sqlite3_open_v2(this->db.c_str(), &p_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK ) {
-		ERROR << "Error : SQLITE error : " << sqlite3_errmsg(p_db);
-		return NULL;
+	/*
+	 * WAL lets the readers run during the writes and syncs only at the
+	 * checkpoints when synchronous is NORMAL
+	 */
+	pragmas = "PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL; PRAGMA temp_store = MEMORY; PRAGMA mmap_size = ";
+	pragmas += boost::lexical_cast<std::string>(this->mmap_size);
+	pragmas += ";";
+
+	if ( sqlite3_exec(c->handle, pragmas.c_str(), NULL, NULL, NULL) != SQLITE_OK )
+		WARN << "connect:: cannot tune " << path << " - " << sqlite3_errmsg(c->handle);
+
+	if (
+		sqlite3_create_function(c->handle, "FROM_UNIXTIME", 1, SQLITE_UTF8, NULL, &sqlite_from_unixtime, NULL, NULL) != SQLITE_OK or
+		sqlite3_create_function(c->handle, "UNIX_TIMESTAMP", -1, SQLITE_UTF8, NULL, &sqlite_unix_timestamp, NULL, NULL) != SQLITE_OK or
+		sqlite3_create_function(c->handle, "SEC_TO_TIME", 1, SQLITE_UTF8, NULL, &sqlite_sec_to_time, NULL, NULL) != SQLITE_OK or
+		sqlite3_create_function(c->handle, "TIME_TO_SEC", 1, SQLITE_UTF8, NULL, &sqlite_time_to_sec, NULL, NULL) != SQLITE_OK
+	) {
+		e.msg = "connect:: cannot register the functions - ";
+		e.msg += sqlite3_errmsg(c->handle);
+		ERROR << e.msg;
+		disconnect(c);
+		throw e;
 	}
 
-	if ( p_db == NULL ) {
-		ERROR << "Error : SQLITE cannot create pointer : not enough memory";
-		sqlite3_close(p_db);
-		return NULL;
+	{
+		boost::mutex::scoped_lock	lock(this->registry->mutex);
+		this->registry->connections.insert(c);
 	}
 
-	return p_db;
+	DEBUG << "connect:: " << path << " opened";
+
+	return c;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void	Sqlite::end(sqlite3* p_db) {
-	sqlite3_close(p_db);
+void	Sqlite::disconnect(sqlite_connection* c) {
+	for ( m_sqlite_statements::iterator it = c->statements.begin() ; it != c->statements.end() ; ++it )
+		sqlite3_finalize(it->second);
+
+	c->statements.clear();
+
+	sqlite3_close(c->handle);
+	delete c;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sqlite::release_thread_connections(sqlite_thread_connections* t) {
+	boost::mutex::scoped_lock	lock(t->registry->mutex);
+
+	for ( m_sqlite_connections::iterator it = t->connections.begin() ; it != t->connections.end() ; ++it ) {
+		if ( t->registry->connections.erase(it->second) > 0 )
+			disconnect(it->second);
+	}
+
+	lock.unlock();
+	delete t;
+}
 
 #endif // USE_SQLITE
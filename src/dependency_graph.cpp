@@ -0,0 +1,337 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: dependency_graph.cpp
+ * Description: the jobs' links of the current planning, kept in memory.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "dependency_graph.h"
+
+Dependency_Graph::Dependency_Graph() {
+	this->start_time		= 0;
+	this->release_latencies_next	= 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Dependency_Graph::load(const std::string& planning_name, const time_t start_time, const time_t now, const int64_t at_window, const rpc::v_jobs& jobs, const m_jobs_links& links, const m_time_constraints& time_constraints, Name_Table* job_names) {
+	std::vector<int>			released;
+	m_graph_jobs::iterator			previous_it;
+	m_graph_jobs::iterator			next_it;
+	m_time_constraints::const_iterator	time_constraints_it;
+	v_command_args				args;
+	int					id;
+
+	this->invalidate();
+
+	// The windows of a planning not started yet open at its start
+	this->start_time = start_time;
+	this->wheel.reset(now > start_time ? now - start_time : 0);
+
+	BOOST_FOREACH(const rpc::t_job& j, jobs) {
+		id = job_names->intern(j.name);
+
+		graph_job&	job = this->jobs[id];
+
+		job.job = j;
+
+		// The command lines are split once, the launches share them
+		if ( build_args_from_command_line(j.cmd_line, args) == true )
+			job.args.reset(new v_command_args(args));
+
+		time_constraints_it = time_constraints.find(j.name);
+		if ( time_constraints_it != time_constraints.end() )
+			job.on_time = this->schedule_window(id, time_constraints_it->second, at_window);
+	}
+
+	BOOST_FOREACH(const m_jobs_links::value_type& l, links) {
+		previous_it = this->jobs.find(job_names->find(l.first));
+
+		BOOST_FOREACH(const std::string& next, l.second) {
+			next_it = this->jobs.find(job_names->find(next));
+
+			if ( next_it == this->jobs.end() )
+				continue;
+
+			// A missing previous job never succeeds
+			if ( previous_it == this->jobs.end() ) {
+				next_it->second.remaining++;
+				continue;
+			}
+
+			previous_it->second.next.push_back(next_it->first);
+
+			if ( previous_it->second.job.state != rpc::e_job_state::SUCCEDED )
+				next_it->second.remaining++;
+		}
+	}
+
+	BOOST_FOREACH(const m_graph_jobs::value_type& j, this->jobs) {
+		if ( j.second.job.state == rpc::e_job_state::WAITING and j.second.remaining == 0 and j.second.on_time == true )
+			released.push_back(j.first);
+	}
+
+	// The ids give the jobs' creation order
+	std::sort(released.begin(), released.end());
+
+	BOOST_FOREACH(const int id, released) {
+		this->push_ready(id, this->jobs[id]);
+	}
+
+	this->planning_name = planning_name;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Dependency_Graph::invalidate() {
+	this->planning_name.clear();
+	this->jobs.clear();
+	this->ready.clear();
+	this->wheel.reset(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Dependency_Graph::is_loaded(const std::string& planning_name) const {
+	return this->planning_name.empty() == false and this->planning_name == planning_name;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Dependency_Graph::set_state(const int job_id, const rpc::e_job_state::type state, const bool has_times, const time_t start_time, const time_t stop_time) {
+	m_graph_jobs::iterator	it = this->jobs.find(job_id);
+	m_graph_jobs::iterator	next_it;
+	rpc::e_job_state::type	previous_state;
+
+	if ( it == this->jobs.end() )
+		return;
+
+	graph_job&	job = it->second;
+
+	previous_state	= job.job.state;
+	job.job.state	= state;
+
+	if ( has_times == true ) {
+		job.job.start_time	= start_time;
+		job.job.stop_time	= stop_time;
+	}
+
+	if ( previous_state != rpc::e_job_state::SUCCEDED and state == rpc::e_job_state::SUCCEDED ) {
+		BOOST_FOREACH(const int next, job.next) {
+			next_it = this->jobs.find(next);
+
+			if ( next_it == this->jobs.end() or next_it->second.remaining == 0 )
+				continue;
+
+			next_it->second.remaining--;
+
+			if ( next_it->second.remaining == 0 )
+				next_it->second.released = boost::posix_time::microsec_clock::universal_time();
+
+			this->push_ready(next, next_it->second);
+		}
+	} else if ( previous_state == rpc::e_job_state::SUCCEDED and state != rpc::e_job_state::SUCCEDED ) {
+		// The job is run again: its next jobs wait for it
+		BOOST_FOREACH(const int next, job.next) {
+			next_it = this->jobs.find(next);
+
+			if ( next_it != this->jobs.end() )
+				next_it->second.remaining++;
+		}
+	}
+
+	this->push_ready(job_id, job);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Dependency_Graph::get_ready_jobs(rpc::v_jobs& _return, const char* node_name, const time_t now) {
+	m_graph_jobs::iterator		it;
+	size_t				kept = 0;
+	boost::posix_time::ptime	handed_over = boost::posix_time::microsec_clock::universal_time();
+	uint64_t			latency;
+
+	this->advance_windows(now);
+
+	for ( size_t i = 0 ; i < this->ready.size() ; i++ ) {
+		it = this->jobs.find(this->ready[i]);
+
+		if ( it == this->jobs.end() )
+			continue;
+
+		graph_job&	job = it->second;
+
+		// The started jobs leave the queue
+		if ( job.job.state != rpc::e_job_state::WAITING or job.remaining != 0 or job.on_time == false ) {
+			job.queued = false;
+			continue;
+		}
+
+		this->ready[kept++] = this->ready[i];
+
+		if ( node_name != NULL and job.job.node_name.compare(node_name) != 0 )
+			continue;
+
+		_return.push_back(job.job);
+
+		if ( job.released.is_not_a_date_time() == true )
+			continue;
+
+		latency		= ( handed_over - job.released ).total_microseconds();
+		job.released	= boost::posix_time::not_a_date_time;
+
+		if ( this->release_latencies.size() < DEPENDENCY_GRAPH_LATENCY_SAMPLES ) {
+			this->release_latencies.push_back(latency);
+		} else {
+			this->release_latencies[this->release_latencies_next] = latency;
+			this->release_latencies_next = ( this->release_latencies_next + 1 ) % DEPENDENCY_GRAPH_LATENCY_SAMPLES;
+		}
+	}
+
+	this->ready.resize(kept);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t	Dependency_Graph::get_jobs_count() const {
+	return this->jobs.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t	Dependency_Graph::get_ready_count() const {
+	return this->ready.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t	Dependency_Graph::get_timers_count() const {
+	return this->wheel.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+boost::shared_ptr<const v_command_args>	Dependency_Graph::get_args(const int job_id) const {
+	m_graph_jobs::const_iterator	it = this->jobs.find(job_id);
+
+	if ( it == this->jobs.end() )
+		return boost::shared_ptr<const v_command_args>();
+
+	return it->second.args;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Dependency_Graph::advance_windows(const time_t now) {
+	m_graph_jobs::iterator	it;
+	v_wheel_timers		timers;
+
+	if ( this->planning_name.empty() == true )
+		return;
+
+	this->wheel.advance(now - this->start_time, timers);
+
+	BOOST_FOREACH(const wheel_timer& t, timers) {
+		it = this->jobs.find(t.job_id);
+
+		if ( it == this->jobs.end() )
+			continue;
+
+		it->second.on_time = t.open;
+		this->push_ready(t.job_id, it->second);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Dependency_Graph::get_next_timeout(time_t& _return) const {
+	int64_t	expiry;
+
+	if ( this->planning_name.empty() == true or this->wheel.get_next_expiry(expiry) == false )
+		return false;
+
+	_return = this->start_time + expiry;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Dependency_Graph::get_release_latencies(std::vector<uint64_t>& _return) const {
+	_return = this->release_latencies;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Dependency_Graph::push_ready(const int job_id, graph_job& job) {
+	if ( job.queued == true or job.job.state != rpc::e_job_state::WAITING or job.remaining != 0 or job.on_time == false )
+		return;
+
+	job.queued = true;
+	this->ready.push_back(job_id);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Dependency_Graph::schedule_window(const int job_id, const rpc::v_time_constraints& time_constraints, const int64_t at_window) {
+	int64_t		now	= this->wheel.get_current_time();
+	int64_t		open	= 0;
+	int64_t		close	= -1;
+	wheel_timer	timer;
+
+	// Each constraint narrows the window, -1 means it never closes
+	BOOST_FOREACH(const rpc::t_time_constraint& tc, time_constraints) {
+		switch ( tc.type ) {
+			case rpc::e_time_constraint_type::AT:
+				open	= std::max(open, tc.value);
+				close	= close < 0 ? tc.value + at_window : std::min(close, tc.value + at_window);
+				break;
+			case rpc::e_time_constraint_type::AFTER:
+				open	= std::max(open, tc.value);
+				break;
+			case rpc::e_time_constraint_type::BEFORE:
+				close	= close < 0 ? tc.value : std::min(close, tc.value);
+				break;
+		}
+	}
+
+	// An empty window never opens
+	if ( close >= 0 and close <= open )
+		return false;
+
+	timer.job_id = job_id;
+
+	if ( open > now ) {
+		timer.expiry	= open;
+		timer.open	= true;
+		this->wheel.schedule(timer);
+	}
+
+	if ( close > now ) {
+		timer.expiry	= close;
+		timer.open	= false;
+		this->wheel.schedule(timer);
+	}
+
+	return open <= now and ( close < 0 or now < close );
+}
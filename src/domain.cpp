@@ -28,8 +28,6 @@
 
 #include "domain.h"
 
-///////////////////////////////////////////////////////////////////////////////
-
 // TODO: use day_{start_date,start_time,duration} to fill in planning_{start_time,duration}
 Domain::Domain(Config* c) {
 	if ( c == NULL ) {
@@ -48,6 +46,7 @@ Domain::Domain(Config* c) {
 	boost::smatch			what_hour;
 	boost::smatch			what_minute;
 	//boost::match_flag_type		flags = boost::match_default;
+	std::string*			skeleton;
 	std::string::const_iterator	start = this->config->get_param("day_duration")->begin();
 	std::string::const_iterator	end = this->config->get_param("day_duration")->end();
 
@@ -110,21 +109,21 @@ Domain::Domain(Config* c) {
 	/*
 	 * Let's prepare the template database
 	 */
-	if ( this->database.prepare() == false ) {
-		rpc::ex_processing e;
-		e.msg = "Error: cannot prepare the database";
-		throw e;
-	}
+	this->init_database();
 
 	/*
 	 * Let's prepare and populate the template planning
 	 */
-	if ( this->database.init_domain_structure(this->name, this->config->get_param("db_skeleton")->c_str()) == false ) {
+	skeleton = this->config->get_param("db_skeleton");
+
+	if ( this->database->init_planning(this->name, skeleton == NULL ? std::string() : *skeleton) == false ) {
 		rpc::ex_processing e;
 		e.msg = "Error: cannot prepare the template planning";
 		throw e;
 	}
 
+	this->database->load_names(this->name.c_str());
+
 	/*
 	 * Let's prepare and populate the next planning to start
 	 */
@@ -139,10 +138,111 @@ Domain::Domain(Config* c) {
 		ALERT << e.msg;
 	}
 
+	/*
+	 * The current planning may use ids removed from the template
+	 */
+	try {
+		if ( this->database->planning_exists(this->get_current_planning_name()) == true )
+			this->database->load_names(this->get_current_planning_name().c_str());
+	} catch (const rpc::ex_job& e) {
+		ALERT << e.msg;
+	}
+
+	INFO << this->job_names.size() << " jobs' and " << this->node_names.size() << " nodes' ids loaded";
+
 	INFO << "First start time is " << this->planning_start_time << " ("  << build_human_readable_time(this->planning_start_time) << ")";
+
+	/*
+	 * Let's start the writer of the jobs' states
+	 */
+	this->job_states_queued_sequence	= 0;
+	this->job_states_committed_sequence	= 0;
+	this->job_states_flush_requested	= false;
+	this->job_states_stopping		= false;
+	this->commit_interval			= boost::posix_time::milliseconds(this->config->get_integer_param("db_commit_interval", 5));
+	this->commit_retries			= this->config->get_integer_param("db_commit_retries", 10);
+	this->at_window				= this->config->get_integer_param("time_constraint_at_window", 60);
+	this->events_pending			= false;
+	this->job_states_writer			= new boost::thread(boost::bind(&Domain::write_job_states, this));
 }
 
 Domain::~Domain() {
+	job_states_metrics		metrics;
+	release_latency_metrics		latencies;
+
+	/*
+	 * The writer commits the remaining states before leaving
+	 */
+	this->job_states_mutex.lock();
+	this->job_states_stopping = true;
+	this->job_states_mutex.unlock();
+	this->job_states_queued.notify_one();
+
+	this->job_states_writer->join();
+	delete this->job_states_writer;
+
+	delete this->database;
+
+	this->get_job_states_metrics(metrics);
+
+	INFO << "jobs' states: " << metrics.updates << " updates committed in " << metrics.batches << " batches (" << metrics.failed_batches << " failed, " << metrics.parked << " dropped), max batch size " << metrics.max_batch_size << ", max commit latency " << metrics.max_commit_latency << " us";
+
+	this->get_release_latency_metrics(latencies);
+
+	INFO << "jobs' releases: " << latencies.samples << " samples, p50 " << latencies.p50 << " us, p99 " << latencies.p99 << " us, max " << latencies.max << " us";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Domain::init_database() {
+	std::string*	engine		= this->config->get_param("db_engine");
+	std::string	engine_name	= engine == NULL ? "mysql" : *engine;
+
+	this->database = NULL;
+
+#ifdef USE_MYSQL
+	if ( engine_name.compare("mysql") == 0 ) {
+		Mysql*	mysql = new Mysql();
+
+		if ( mysql->prepare(this->config->get_integer_param("db_pool_size", 8), this->config->get_integer_param("db_pool_check_interval", 60)) == false ) {
+			delete mysql;
+
+			rpc::ex_processing e;
+			e.msg = "Error: cannot prepare the database";
+			throw e;
+		}
+
+		this->database = new Sql_Database(mysql, &this->job_names, &this->node_names);
+	}
+#endif
+#ifdef USE_SQLITE
+	if ( engine_name.compare("sqlite") == 0 ) {
+		Sqlite*		sqlite		= new Sqlite();
+		std::string*	data_path	= this->config->get_param("db_data");
+
+		if ( data_path == NULL or sqlite->prepare(*data_path, this->config->get_integer_param("db_mmap_size", 268435456)) == false ) {
+			delete sqlite;
+
+			rpc::ex_processing e;
+			e.msg = "Error: cannot prepare the database";
+			throw e;
+		}
+
+		this->database = new Sql_Database(sqlite, &this->job_names, &this->node_names);
+	}
+#endif
+	if ( engine_name.compare("memory") == 0 )
+		this->database = new Memory_Database(&this->job_names, &this->node_names);
+
+	if ( this->database == NULL ) {
+		rpc::ex_processing e;
+		e.msg = "Error: the database engine ";
+		e.msg += engine_name;
+		e.msg += " is unknown or not built";
+		throw e;
+	}
+
+	INFO << "Database engine is " << engine_name;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -162,7 +262,6 @@ bool	Domain::get_planning(rpc::t_planning& _return, const char* domain_name, con
 ///////////////////////////////////////////////////////////////////////////////
 
 bool	Domain::set_next_planning(time_t& _return) {
-	rpc::v_nodes	nodes;
 	std::string		next_planning_name;
 
 	_return = this->get_next_planning_start_time();
@@ -173,41 +272,27 @@ bool	Domain::set_next_planning(time_t& _return) {
 
 	DEBUG << "next planning is " << next_planning_name << ", starting at " << _return << " (" << build_human_readable_time(_return) << ")";
 
+	/*
+	 * The planning is a copy of the template, the jobs' runtime values are
+	 * reset by the copy
+	 */
 	try {
-		v_row result;
-		std::string	query;
-
-		query ="SELECT IF('" + next_planning_name + "' IN(SELECT SCHEMA_NAME FROM INFORMATION_SCHEMA.SCHEMATA), 1, 0) AS found;";
-
-		if ( this->database.query_one_row(result, query.c_str(), NULL) == false ) {
-			ERROR << "cannot query the DB to find if the next planning alread exists";
-			return false;
-		}
-
-		if ( result.at(0).compare("1") == 0 ) {
+		if ( this->database->planning_exists(next_planning_name) == true ) {
 			INFO << "The schema already exists, skipping domain init...";
 			return true;
 		}
 
-		if ( this->database.init_domain_structure(next_planning_name.c_str(), *this->config->get_param("db_skeleton")) == false ) {
-			return true;
-		}
+		boost::posix_time::ptime	start = boost::posix_time::microsec_clock::universal_time();
+
+		if ( this->database->clone_planning(this->name, next_planning_name) == false )
+			return false;
+
+		INFO << "created " << next_planning_name << " from the template in " << (boost::posix_time::microsec_clock::universal_time() - start).total_milliseconds() << " ms";
 	} catch ( const rpc::ex_processing& e) {
 		ERROR << e.msg;
 		return false;
 	}
 
-	this->get_nodes(this->name.c_str(), nodes);
-
-	// We could use a method called "add_nodes" as well
-	BOOST_FOREACH(rpc::t_node node, nodes) {
-		if ( this->add_node(next_planning_name.c_str(), node) == false ) {
-			ERROR << "failed to add node " << node.name << " into planning " << next_planning_name;
-			return false;
-		}
-	}
-
-	INFO << "added " << nodes.size() << " nodes to " << next_planning_name;
 	return true;
 }
 
@@ -320,62 +405,24 @@ bool	Domain::add_node(const char* domain_name, const rpc::t_node& n) {
 ///////////////////////////////////////////////////////////////////////////////
 
 bool	Domain::add_node(const char* domain_name, const char* n) {
-	std::string query;
-	v_queries	queries;
-
-	this->updates_mutex.lock();
-
-#ifdef USE_MYSQL
-	query = "INSERT IGNORE INTO ";
-#endif
-	query += "node (node_name) VALUES ('";
-	query += n;
-	query += "');";
-
-	queries.insert(queries.end(), query);
+	boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
 
-#ifdef USE_MYSQL
-	if ( this->database.standalone_execute(queries, domain_name) == true ) {
-		this->updates_mutex.unlock();
-		return true;
-	}
-#endif
-	this->updates_mutex.unlock();
-	return false;
+	// The weight column defaults to 0
+	return this->database->add_node(domain_name, n, 0);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 bool	Domain::add_node(const char* domain_name, const std::string& n, const rpc::integer& w) {
-	std::string query;
-	v_queries	queries;
+	boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
 
-	this->updates_mutex.lock();
-
-	query = "INSERT IGNORE INTO node (node_name,node_weight) VALUES ('";
-	query += n.c_str();
-	query += "','";
-	query += boost::lexical_cast<std::string>(w);
-	query += "');";
-
-	queries.insert(queries.end(), query);
-
-#ifdef USE_MYSQL
-	if ( this->database.standalone_execute(queries, domain_name) == true ) {
-		this->updates_mutex.unlock();
-		return true;
-	}
-#endif
-	this->updates_mutex.unlock();
-	return false;
+	return this->database->add_node(domain_name, n, w);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 bool	Domain::remove_node(const char* domain_name, const std::string& n) {
-	rpc::t_node	node_to_remove;
-	std::string	query = "DELETE FROM node WHERE node_name='";
-	v_queries	queries;
+	rpc::t_node		node_to_remove;
 
 	this->get_node(domain_name, node_to_remove, n.c_str());
 
@@ -388,204 +435,54 @@ bool	Domain::remove_node(const char* domain_name, const std::string& n) {
 	// TODO: Remove the resources
 
 	// Remove the node
-	query += n;
-	query += "';";
-
-	queries.push_back(query);
-
-	this->updates_mutex.lock();
+	boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
 
-#ifdef USE_MYSQL
-	if ( this->database.standalone_execute(queries, domain_name) == true ) {
-		this->updates_mutex.unlock();
-		return true;
-	}
-#endif
-	this->updates_mutex.unlock();
-	return false;
+	return this->database->remove_node(domain_name, n);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 bool	Domain::add_job(const char* domain_name, const rpc::t_job& j) {
-	std::string		query;
-	//const char*		running_node = j.node_name.c_str();
-	v_queries		queries;
-	v_row			row;
-
-	this->updates_mutex.lock();
-
-	query = "SELECT COUNT(*) FROM node WHERE node_name = '";
-	query += j.node_name;
-	query += "';";
-
-	if ( this->database.query_one_row(row, query.c_str(), j.domain.c_str()) == false ) {
-		rpc::ex_processing e;
-		e.msg = "Cannot query the node table";
-
-		throw e;
-	}
-
-	if ( boost::lexical_cast<int>(row.at(0)) == 0 ) {
-		rpc::ex_node e;
-		e.msg = "The node ";
-		e.msg += j.node_name;
-		e.msg += " does not exist";
-		throw e;
-	}
+	bool	result;
 
-	query = "INSERT INTO job (job_name,job_cmd_line,job_node_name,job_weight) VALUES ('";
-	query += j.name;
-	query += "','";
-	query += j.cmd_line;
-	query += "','";
-	query += j.node_name;
-	query += "','";
-	query += boost::lexical_cast<std::string>(j.weight);
-	query += "');";
-
-	queries.push_back(query);
-
-	BOOST_FOREACH(std::string i, j.prv) {
-		query = "INSERT INTO ";
-		query += "jobs_link (job_name_prv,job_name_nxt) VALUES ('";
-		query += i;
-		query += "','";
-		query += j.name;
-		query += "');";
-
-		queries.push_back(query);
-	}
-
-	BOOST_FOREACH(std::string i, j.nxt) {
-		query = "INSERT INTO jobs_link (job_name_nxt,job_name_prv) VALUES ('";
-		query += i;
-		query += "','";
-		query += boost::lexical_cast<std::string>(j.name);
-		query += "');";
-
-		queries.push_back(query);
-	}
-
-	BOOST_FOREACH(rpc::t_time_constraint tc, j.time_constraints) {
+	BOOST_FOREACH(const rpc::t_time_constraint& tc, j.time_constraints) {
 		if ( this->planning_duration < tc.value ) {
 			rpc::ex_processing e;
 			e.msg = "the given value of the time_constraint is higher than the planning's duration (";
-			e.msg += tc.value;
+			e.msg += boost::lexical_cast<std::string>(tc.value);
 			e.msg += " > ";
-			e.msg += this->planning_duration;
+			e.msg += boost::lexical_cast<std::string>(this->planning_duration);
 			e.msg += ")";
 
 			throw e;
 		}
-
-		query = "INSERT INTO time_constraint (time_c_job_name, time_c_type, time_c_value) VALUES ('";
-		query += j.name;
-		query += "','";
-		query += build_string_from_time_constraint_type(tc.type);
-		query += "',SEC_TO_TIME(";
-		query += boost::lexical_cast<std::string>(tc.value);
-		query += "));";
-
-		queries.push_back(query);
 	}
 
 	// TODO: add recovery types
-//	this->get_add_recovery_type_query(query, j.recovery_type);
-//	queries.push_back(query);
 
-#ifdef USE_MYSQL
-	if ( this->database.standalone_execute(queries, domain_name) == true ) {
-		this->updates_mutex.unlock();
-		return true;
+	{
+		boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
+		result = this->database->add_job(domain_name, j);
 	}
-#endif
-	this->updates_mutex.unlock();
-	return false;
+
+	this->invalidate_graph(domain_name);
+
+	return result;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 bool	Domain::update_job(const rpc::t_job& j) {
-	std::string		query;
-	v_queries		queries;
-
-	this->updates_mutex.lock();
-
-	query = "REPLACE INTO job (job_name,job_cmd_line,job_node_name,job_weight) VALUES ('";
-	query += j.name;
-	query += "','";
-	query += j.cmd_line;
-	query += "','";
-	query += j.node_name;
-	query += "','";
-	query += boost::lexical_cast<std::string>(j.weight);
-	query += "');";
-
-	queries.insert(queries.end(), query);
-
-	query = "DELETE FROM jobs_link WHERE job_name_nxt ='";
-	query += j.name;
-	query += "');";
-
-	queries.insert(queries.end(), query);
-
-	BOOST_FOREACH(std::string i, j.prv) {
-		query = "REPLACE INTO";
-		query += "jobs_link (job_name_prv,job_name_nxt) VALUES ('";
-		query += boost::lexical_cast<std::string>(i);
-		query += "','";
-		query += j.name;
-		query += "');";
-
-		queries.insert(queries.end(), query);
-	}
-
-	query = "DELETE FROM jobs_link WHERE job_name_prv ='";
-	query += j.name;
-	query += "');";
-
-	queries.insert(queries.end(), query);
-
-	BOOST_FOREACH(std::string i, j.nxt) {
-		query = "REPLACE INTO jobs_link (job_name_nxt,job_name_prv) VALUES ('";
-		query += boost::lexical_cast<std::string>(i);
-		query += "','";
-		query += j.name;
-		query += "');";
-
-		queries.insert(queries.end(), query);
-	}
-
-	query = "DELETE FROM time_constraint WHERE time_c_job_name = '";
-	query += j.name;
-	query += "');";
+	bool	result;
 
-	queries.insert(queries.end(), query);
-
-	BOOST_FOREACH(rpc::t_time_constraint tc, j.time_constraints) {
-		query = "REPLACE INTO time_constraint (time_c_job_name, time_c_type, time_c_value) VALUES ('";
-		query += j.name;
-		query += "','";
-		query += build_string_from_time_constraint_type(tc.type);
-		query += "','";
-		query += boost::lexical_cast<std::string>(tc.value);
-		query += "');";
-
-		queries.insert(queries.end(), query);
+	{
+		boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
+		result = this->database->update_job(j.domain.c_str(), j);
 	}
 
-//	this->get_add_recovery_type_query(query, j.recovery_type);
-	queries.push_back(query);
+	this->invalidate_graph(j.domain.c_str());
 
-#ifdef USE_MYSQL
-	if ( this->database.standalone_execute(queries, j.node_name.c_str()) == true ) {
-		this->updates_mutex.unlock();
-		return true;
-	}
-#endif
-	this->updates_mutex.unlock();
-	return false;
+	return result;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -597,39 +494,16 @@ bool	Domain::remove_job(const rpc::t_job& j) {
 ///////////////////////////////////////////////////////////////////////////////
 
 bool	Domain::remove_job(const char* domain_name, const std::string& j_name) {
-	std::string	query;
-	v_queries	queries;
-
-	this->updates_mutex.lock();
-
-	query = "DELETE FROM job WHERE job_name = '";
-	query += j_name;
-	query += "';";
-
-	queries.insert(queries.end(), query);
-
-	query = "DELETE FROM jobs_link WHERE job_name_nxt = '";
-	query += j_name;
-	query += "' OR job_name_prv = '";
-	query += j_name;
-	query += "';";
-
-	queries.insert(queries.end(), query);
+	bool	result;
 
-	query = "DELETE FROM time_constraint WHERE time_c_job_name = '";
-	query += j_name;
-	query += "';";
+	{
+		boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
+		result = this->database->remove_job(domain_name, j_name);
+	}
 
-	queries.insert(queries.end(), query);
+	this->invalidate_graph(domain_name);
 
-#ifdef USE_MYSQL
-	if ( this->database.standalone_execute(queries, domain_name) == true ) {
-		this->updates_mutex.unlock();
-		return true;
-	}
-#endif
-	this->updates_mutex.unlock();
-	return false;
+	return result;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -646,599 +520,457 @@ bool	Domain::update_job_state(const char* domain_name, const Job* j, const rpc::
 		return false;
 	}
 
-	return this->update_job_state(domain_name, j->get_node_name2(), j->get_name(), js);
+	if ( this->queue_job_state(domain_name, j->get_id(), js, false, 0, 0, NULL) == false ) {
+		ERROR << "Error: the job " << j->get_name() << " has no id";
+		return false;
+	}
+
+	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 bool	Domain::update_job_state(const char* domain_name, const std::string& running_node, const std::string& j_name, const rpc::e_job_state::type& js) {
-	std::string	query;
-	v_queries	queries;
 	boost::regex	empty_string("^\\s+$", boost::regex::perl);
 
-	if ( running_node.empty() == true or boost::regex_match(query, empty_string) == true ) {
+	if ( running_node.empty() == true or boost::regex_match(running_node, empty_string) == true ) {
 		ERROR << "Error: running_node is empty";
 		return false;
 	}
 
-	this->updates_mutex.lock();
-
-	query = "UPDATE job SET job_state = '";
-	query += build_string_from_job_state(js);
-	query += "' WHERE job_name = '";
-	query += j_name;
-	query += "';";
-
-	queries.insert(queries.end(), query);
-
-#ifdef USE_MYSQL
-	if ( this->database.standalone_execute(queries, domain_name) == true ) {
-		this->updates_mutex.unlock();
-		return true;
+	if ( this->queue_job_state(domain_name, this->job_names.find(j_name), js, false, 0, 0, NULL) == false ) {
+		ERROR << "Error: the job " << j_name << " is unknown";
+		return false;
 	}
-#endif
-	this->updates_mutex.unlock();
-	return false;
+
+	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 bool	Domain::update_job_state(const char* domain_name, const std::string& running_node, const std::string& j_name, const rpc::e_job_state::type& js, time_t& start_time, time_t& stop_time) {
-	std::string	query;
-	v_queries	queries;
 	boost::regex	empty_string("^\\s+$", boost::regex::perl);
 
-	if ( running_node.empty() == true or boost::regex_match(query, empty_string) == true ) {
+	if ( running_node.empty() == true or boost::regex_match(running_node, empty_string) == true ) {
 		ERROR << "Error: running_node is empty";
 		return false;
 	}
 
-	this->updates_mutex.lock();
-
-	query = "UPDATE job SET job_state = '";
-	query += build_string_from_job_state(js);
-	query += "', job_start_time = FROM_UNIXTIME(";
-	query += boost::lexical_cast<std::string>(start_time);
-	query += "), job_stop_time = FROM_UNIXTIME(";
-	query += boost::lexical_cast<std::string>(stop_time);
-	query += ") WHERE job_name = '";
-	query += j_name;
-	query += "';";
-
-	queries.insert(queries.end(), query);
-
-#ifdef USE_MYSQL
-	if ( this->database.standalone_execute(queries, domain_name) == true ) {
-		this->updates_mutex.unlock();
-		return true;
+	if ( this->queue_job_state(domain_name, this->job_names.find(j_name), js, true, start_time, stop_time, NULL) == false ) {
+		ERROR << "Error: the job " << j_name << " is unknown";
+		return false;
 	}
-#endif
-	this->updates_mutex.unlock();
-	return false;
+
+	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 bool	Domain::update_job_state(const char* domain_name, const Job* j, const rpc::e_job_state::type& js, time_t& start_time, time_t& stop_time) {
-	return this->update_job_state(domain_name, j->get_node_name(), j->get_name(), js, start_time, stop_time);
-}
-
-///////////////////////////////////////////////////////////////////////////////
+	if ( j == NULL ) {
+		ERROR << "Error: j is NULL";
+		return false;
+	}
 
-void	Domain::get_ready_jobs(v_jobs& _return, const char* running_node) {
-	std::string	query("SELECT job_name,job_cmd_line,job_node_name,job_weight,job_state,job_rectype_id FROM get_ready_job");
-	v_row		job_rectype;
-	v_v_row		jobs_matrix;
-	Job*		job	= NULL;
-	rpc::t_job*	rpc_j	= NULL;
+	const rpc::t_job*	job = j->get_job();
+	job_usage		usage;
+	bool			has_usage = false;
 
-	if ( running_node == NULL )
-		query += ";";
-	else {
-		query += " WHERE job_node_name = '";
-		query += running_node;
-		query += "';";
+	// The counters measured by the launcher are recorded with the state
+	if ( job->__isset.stdout_bytes == true ) {
+		usage.stdout_bytes	= job->stdout_bytes;
+		has_usage		= true;
 	}
-
-#ifdef USE_MYSQL
-	if ( this->database.query_full_result(jobs_matrix, query.c_str(), this->get_current_planning_name().c_str()) == false ) {
-		rpc::ex_job e;
-		e.msg = "The database query failed";
-		throw e;
+	if ( job->__isset.stderr_bytes == true ) {
+		usage.stderr_bytes	= job->stderr_bytes;
+		has_usage		= true;
+	}
+	if ( job->__isset.cpu_usage == true ) {
+		usage.cpu_usage		= job->cpu_usage;
+		has_usage		= true;
+	}
+	if ( job->__isset.memory_peak == true ) {
+		usage.memory_peak	= job->memory_peak;
+		has_usage		= true;
+	}
+	if ( job->__isset.io_read_bytes == true ) {
+		usage.io_read_bytes	= job->io_read_bytes;
+		has_usage		= true;
+	}
+	if ( job->__isset.io_write_bytes == true ) {
+		usage.io_write_bytes	= job->io_write_bytes;
+		has_usage		= true;
+	}
+	if ( job->__isset.failure == true ) {
+		usage.failure		= job->failure;
+		has_usage		= true;
 	}
-#endif
-	BOOST_FOREACH(v_row job_row, jobs_matrix) {
-		delete job;
-		delete rpc_j;
-		rpc_j = new rpc::t_job();
-
-		rpc_j->name		= job_row[0];
-		rpc_j->cmd_line	= job_row[1];
-		rpc_j->node_name	= job_row[2];
-		try {
-			rpc_j->weight	= boost::lexical_cast<int>(job_row[3]);
-		} catch (const std::exception& lc_e) {
-			rpc::ex_processing e;
-			e.msg = "cannot cast value ";
-			e.msg += job_row[3];
-			e.msg += " to integer. Query is ";
-			e.msg += query;
-			e.msg += ". Exception is ";
-			e.msg += lc_e.what();
-			ERROR << e.msg;
-			throw e;
-		}
-
-		rpc_j->state		= build_job_state_from_string(job_row[4].c_str());
-
-		rpc_j->domain	= this->get_current_planning_name();
-/*
-		query = "SELECT job_rectype_id FROM job WHERE job_name ='";
-		query += rpc_j->name;
-		query += "';";
 
-#ifdef USE_MYSQL
-		if ( this->database.query_one_row(job_rectype, query.c_str(), this->name.c_str()) == false ) {
-			rpc::ex_job e;
-			e.msg = "The database query failed";
-			throw e;
-		}
-#endif
-		this->get_recovery_type(rpc_j->recovery_type, running_node, boost::lexical_cast<int>(job_row[5]));
-*/
-		job = new Job((Domain*)this, *rpc_j);
-		_return.push_back(*job);
+	if ( this->queue_job_state(domain_name, j->get_id(), js, true, start_time, stop_time, has_usage == true ? &usage : NULL) == false ) {
+		ERROR << "Error: the job " << j->get_name() << " has no id";
+		return false;
 	}
 
-	delete job;
-	delete rpc_j;
-	jobs_matrix.clear();
+	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void	Domain::get_ready_jobs(rpc::v_jobs& _return, const char* running_node) {
-	std::string	query("SELECT job_name,job_cmd_line,job_node_name,job_weight,job_state,job_rectype_id FROM get_ready_job");
-	v_v_row		jobs_matrix;
-	rpc::t_job*	job	= NULL;
+bool	Domain::add_jobs(const char* domain_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return) {
+	std::vector<size_t>	accepted;
+	rpc::v_jobs		accepted_jobs;
+	rpc::v_job_results	results;
+	bool			result;
 
-	// We do not query the database if the planning is not started yet
-	if ( this->planning_start_time < time(NULL) )
-		return;
+	_return.assign(jobs.size(), build_job_result(rpc::e_job_result::DONE, ""));
+
+	for ( size_t i = 0 ; i < jobs.size() ; i++ ) {
+		BOOST_FOREACH(const rpc::t_time_constraint& tc, jobs[i].time_constraints) {
+			if ( this->planning_duration < tc.value ) {
+				_return[i] = build_job_result(rpc::e_job_result::INVALID, "the given value of the time_constraint is higher than the planning's duration (" + boost::lexical_cast<std::string>(tc.value) + " > " + boost::lexical_cast<std::string>(this->planning_duration) + ")");
+				break;
+			}
+		}
 
-	if ( running_node != NULL ) {
-		query += " WHERE job_node_name = '";
-		query += running_node;
+		if ( _return[i].code == rpc::e_job_result::DONE )
+			accepted.push_back(i);
 	}
-	query += "';";
 
-#ifdef USE_MYSQL
-	if ( this->database.query_full_result(jobs_matrix, query.c_str(), this->get_current_planning_name().c_str()) == false ) {
-		rpc::ex_job	e;
-		e.msg = "The query failed";
-		throw e;
+	if ( accepted.empty() == true )
+		return true;
+
+	// The jobs are copied only if some are rejected
+	if ( accepted.size() < jobs.size() ) {
+		accepted_jobs.reserve(accepted.size());
+		BOOST_FOREACH(size_t i, accepted) {
+			accepted_jobs.push_back(jobs[i]);
+		}
 	}
-#endif
 
-	if ( jobs_matrix.empty() == true ) {
-		rpc::ex_job	e;
-		e.msg = "The database returned an empty result";
-		throw e;
+	{
+		boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
+		result = this->database->add_jobs(domain_name, accepted.size() < jobs.size() ? accepted_jobs : jobs, results);
 	}
 
-	BOOST_FOREACH(v_row job_row, jobs_matrix) {
-		delete job;
+	for ( size_t i = 0 ; i < accepted.size() ; i++ )
+		_return[accepted[i]] = results[i];
 
-		job = new rpc::t_job();
+	this->invalidate_graph(domain_name);
 
-		job->domain		= this->get_current_planning_name();
-		job->name		= job_row[0];
-		job->node_name	= job_row[2];
-		job->cmd_line	= job_row[1];
-		try {
-			job->weight		= boost::lexical_cast<int>(job_row[3]);
-		} catch (const std::exception& lc_e) {
-			rpc::ex_processing e;
-			e.msg = "cannot cast value ";
-			e.msg += job_row[3];
-			e.msg += " to integer. Query is ";
-			e.msg += query;
-			e.msg += ". Exception is ";
-			e.msg += lc_e.what();
-			ERROR << e.msg;
-			throw e;
-		}
-		job->state		= build_job_state_from_string(job_row[4].c_str());
+	return result;
+}
 
-		try {
-			this->get_recovery_type(this->get_current_planning_name().c_str(), job->recovery_type, boost::lexical_cast<int>(job_row[5].c_str()));
-		} catch (const std::exception& lc_e) {
-			rpc::ex_processing e;
-			e.msg = "cannot cast value ";
-			e.msg += job_row[5];
-			e.msg += " to integer. Query is ";
-			e.msg += query;
-			e.msg += ". Exception is ";
-			e.msg += lc_e.what();
-			ERROR << e.msg;
-			throw e;
-		}
+///////////////////////////////////////////////////////////////////////////////
 
-		_return.push_back(*job);
+bool	Domain::update_jobs(const char* domain_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return) {
+	bool	result;
+
+	{
+		boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
+		result = this->database->update_jobs(domain_name, jobs, _return);
 	}
 
-	delete job;
-	jobs_matrix.clear();
+	this->invalidate_graph(domain_name);
+
+	return result;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void	Domain::get_jobs(const char* domain_name, rpc::v_jobs& _return, const char* running_node) {
-	std::string	query("SELECT job_name,job_cmd_line,job_node_name,job_weight,job_state,job_rectype_id, unix_timestamp(job_start_time), unix_timestamp(job_stop_time) FROM job");
-	v_v_row		jobs_matrix;
-	rpc::t_job*	job	= NULL;
+bool	Domain::remove_jobs(const char* domain_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return) {
+	bool	result;
 
-	if ( running_node == NULL )
-		query += ";";
-	else {
-		query += " WHERE job_node_name = '";
-		query += running_node;
-		query += "';";
+	{
+		boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
+		result = this->database->remove_jobs(domain_name, jobs, _return);
 	}
 
-#ifdef USE_MYSQL
-	if ( this->database.query_full_result(jobs_matrix, query.c_str(), domain_name) == false ) {
-		rpc::ex_job	e;
-		e.msg = "The query failed";
-		throw e;
+	this->invalidate_graph(domain_name);
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Domain::update_job_states(const char* domain_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return) {
+	boost::regex		empty_string("^\\s+$", boost::regex::perl);
+	d_job_state_updates	updates;
+	job_state_update	update;
+
+	update.domain_name	= domain_name;
+	update.has_times	= false;
+	update.start_time	= 0;
+	update.stop_time	= 0;
+	update.has_usage	= false;
+
+	_return.clear();
+	_return.reserve(jobs.size());
+
+	if ( this->planning_exists(domain_name) == false ) {
+		_return.assign(jobs.size(), build_job_result(rpc::e_job_result::INVALID, std::string("the planning ") + domain_name + " does not exist"));
+		return;
 	}
-#endif
-	BOOST_FOREACH(v_row job_row, jobs_matrix) {
-		delete job;
-		job = new rpc::t_job();
-
-		job->domain		= this->name.c_str();
-		job->name		= job_row[0];
-		job->node_name	= job_row[2];
-		job->cmd_line	= job_row[1];
-		try {
-			job->weight		= boost::lexical_cast<int>(job_row[3]);
-		} catch (const std::exception& lc_e) {
-			rpc::ex_processing e;
-			e.msg = "cannot cast value ";
-			e.msg += job_row[3];
-			e.msg += " to integer. Query is ";
-			e.msg += query;
-			e.msg += ". Exception is ";
-			e.msg += lc_e.what();
-			ERROR << e.msg;
-			throw e;
-		}
-		job->state		= build_job_state_from_string(job_row[4].c_str());
 
-		if ( job_row[6].size() > 0 && job_row[6].compare("NULL") != 0 )
-			job->start_time		= boost::lexical_cast<int64_t>(job_row[6].c_str());
-		if ( job_row[7].size() > 0 && job_row[7].compare("NULL") != 0 )
-			job->stop_time		= boost::lexical_cast<int64_t>(job_row[7].c_str());
+	BOOST_FOREACH(const rpc::t_job& j, jobs) {
+		if ( j.node_name.empty() == true or boost::regex_match(j.node_name, empty_string) == true ) {
+			_return.push_back(build_job_result(rpc::e_job_result::INVALID, "running_node is empty"));
+			continue;
+		}
 
-		this->get_jobs_next(domain_name, job->nxt, job->name);
-		this->get_time_constraints(domain_name, job->time_constraints, job->name);
+		update.job_id	= this->job_names.find(j.name);
+		update.state	= j.state;
 
-		if ( job_row[5].size() > 0 && job_row[5].compare("NULL") != 0 ) {
-			DEBUG << job_row[5];
-			this->get_recovery_type(domain_name, job->recovery_type, boost::lexical_cast<int>(job_row[5].c_str()));
+		if ( update.job_id == 0 ) {
+			_return.push_back(build_job_result(rpc::e_job_result::UNKNOWN_JOB, "the job " + j.name + " is unknown"));
+			continue;
 		}
 
-		_return.push_back(*job);
+		updates.push_back(update);
+		_return.push_back(build_job_result(rpc::e_job_result::DONE, ""));
 	}
 
-	delete job;
-	jobs_matrix.clear();
+	if ( updates.empty() == false )
+		this->queue_job_states(updates);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void	Domain::get_job(const char* domain_name, rpc::t_job& _return, const char* running_node, const char* job_name) {
-	std::string	query("SELECT job_name,job_cmd_line,job_node_name,job_weight,job_state,job_rectype_id FROM job");
-	v_row		job_row;
+void	Domain::get_ready_jobs(v_jobs& _return, const char* running_node) {
+	std::string	planning_name	= this->get_current_planning_name();
+	rpc::v_jobs	jobs;
 
-	query += " WHERE job_name = '";
-	query += job_name;
-	query += "'";
+	m_recovery_types::const_iterator	recovery_types_it;
 
-	if ( running_node == NULL ) {
-		query += ";";
-	} else {
-		query += " AND job_node_name = '";
-		query += running_node;
-		query += "';";
-	}
+	this->get_graph_ready_jobs(jobs, planning_name, running_node);
 
-	if ( this->database.query_one_row(job_row, query.c_str(), domain_name) == false ) {
-		rpc::ex_job	e;
-		e.msg = "The query failed";
-		throw e;
-	}
+	_return.reserve(_return.size() + jobs.size());
 
-	_return.domain		= this->name.c_str();
-	_return.name		= job_row[0];
-	_return.node_name	= job_row[2];
-	_return.cmd_line	= job_row[1];
-	_return.weight		= boost::lexical_cast<int>(job_row[3]);
-	_return.state		= build_job_state_from_string(job_row[4].c_str());
+	// The recovery types and the arguments are read from the graph
+	boost::lock_guard<boost::mutex>	lock(this->graph_mutex);
 
-	this->get_jobs_next(domain_name, _return.nxt, _return.name);
-	this->get_time_constraints(domain_name, _return.time_constraints, _return.name);
-}
+	BOOST_FOREACH(rpc::t_job& j, jobs) {
+		j.domain = planning_name;
 
-///////////////////////////////////////////////////////////////////////////////
+		// The supervisor falls back on the recovery type's timeout
+		if ( j.recovery_type.id != 0 ) {
+			recovery_types_it = this->graph_recovery_types.find(j.recovery_type.id);
 
-void	Domain::get_jobs_next(const char* domain_name, rpc::v_job_names& _return, const std::string& j_name) {
-	std::string	query("SELECT job_name_nxt FROM jobs_link WHERE job_name_prv = '");
-	v_v_row		job_links_matrix;
+			if ( recovery_types_it != this->graph_recovery_types.end() )
+				j.recovery_type = recovery_types_it->second;
+			else
+				WARN << "the recovery type " << j.recovery_type.id << " of the job " << j.name << " does not exist";
+		}
 
-	query += j_name;
-	query += "';";
+		_return.push_back(Job((Domain*)this, j));
 
-#ifdef USE_MYSQL
-	if ( this->database.query_full_result(job_links_matrix, query.c_str(), domain_name) == false )   {
-		rpc::ex_job	e;
-		e.msg = "The query failed";
-		throw e;
-	}
-#endif
-	BOOST_FOREACH(v_row job_next_row, job_links_matrix) {
-		_return.push_back(job_next_row[0]);
+		// The state transitions use the ids
+		_return.back().set_id(this->job_names.find(j.name));
+		_return.back().set_node_id(this->node_names.find(j.node_name));
+		_return.back().set_args(this->graph.get_args(_return.back().get_id()));
 	}
-
-	job_links_matrix.clear();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void	Domain::get_macro_jobs(const char* domain_name, rpc::v_macro_jobs& _return, const char* running_node) {
-	std::string		query("SELECT macro_id,macro_name FROM macro_job;");
-	v_v_row			macro_jobs_matrix;
-	rpc::t_macro_job*	macro_job = NULL;
+void	Domain::get_ready_jobs(rpc::v_jobs& _return, const char* running_node) {
+	std::string	planning_name	= this->get_current_planning_name();
+	size_t		first		= _return.size();
 
-#ifdef USE_MYSQL
-	if ( this->database.query_full_result(macro_jobs_matrix, query.c_str(), domain_name) == false )   {
+	m_recovery_types		recovery_types;
+	m_recovery_types::iterator	recovery_types_it;
+
+	// We do not query the database if the planning is not started yet
+	if ( this->planning_start_time > time(NULL) )
+		return;
+
+	this->get_graph_ready_jobs(_return, planning_name, running_node);
+
+	if ( _return.size() == first ) {
 		rpc::ex_job	e;
-		e.msg = "The query failed";
+		e.msg = "The database returned an empty result";
 		throw e;
 	}
-#endif
-	BOOST_FOREACH(v_row macro_job_row, macro_jobs_matrix) {
-		delete macro_job;
 
-		macro_job->id = boost::lexical_cast<int>(macro_job_row[0]);
-		macro_job->name = macro_job_row[1];
+	this->database->get_recovery_types(planning_name.c_str(), recovery_types);
 
-		_return.push_back(*macro_job);
-	}
+	for ( size_t i = first ; i < _return.size() ; i++ ) {
+		_return[i].domain = planning_name;
+
+		if ( _return[i].recovery_type.id == 0 )
+			continue;
+
+		recovery_types_it = recovery_types.find(_return[i].recovery_type.id);
 
-	delete macro_job;
-	macro_jobs_matrix.clear();
+		if ( recovery_types_it != recovery_types.end() )
+			_return[i].recovery_type = recovery_types_it->second;
+		else
+			WARN << "the recovery type " << _return[i].recovery_type.id << " of the job " << _return[i].name << " does not exist";
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool	Domain::add_resource(const char* domain_name, const rpc::t_resource& r, const char* node_name) {
-	std::string	query("INSERT INTO resource (resource_name,resource_node_name,resource_current_value,resource_initial_value) VALUES ('");
-	v_queries	queries;
+void	Domain::get_jobs(const char* domain_name, rpc::v_jobs& _return, const char* running_node) {
+	size_t		first	= _return.size();
 
-	query += r.name;
-	query += "','";
-	query += node_name;
-	query += "','";
-	query += boost::lexical_cast<std::string>(r.current_value);
-	query += "','";
-	query += boost::lexical_cast<std::string>(r.initial_value);
-	query += "');";
+	m_jobs_links			links;
+	m_jobs_links::iterator		links_it;
+	m_time_constraints		time_constraints;
+	m_time_constraints::iterator	time_constraints_it;
+	m_recovery_types		recovery_types;
+	m_recovery_types::iterator	recovery_types_it;
 
-	queries.push_back(query);
+	this->flush_job_states();
 
-	this->updates_mutex.lock();
+	this->database->get_jobs(domain_name, _return, running_node, NULL);
 
-#ifdef USE_MYSQL
-	if ( this->database.standalone_execute(queries, domain_name) == true ) {
-		this->updates_mutex.unlock();
-		return true;
+	if ( _return.size() == first )
+		return;
+
+	this->database->get_jobs_links(domain_name, links, running_node, NULL);
+	this->database->get_time_constraints(domain_name, time_constraints, running_node, NULL);
+	this->database->get_recovery_types(domain_name, recovery_types);
+
+	for ( size_t i = first ; i < _return.size() ; i++ ) {
+		rpc::t_job&	job = _return[i];
+
+		job.domain = this->name;
+
+		links_it = links.find(job.name);
+		if ( links_it != links.end() )
+			job.nxt.swap(links_it->second);
+
+		time_constraints_it = time_constraints.find(job.name);
+		if ( time_constraints_it != time_constraints.end() )
+			job.time_constraints.swap(time_constraints_it->second);
+
+		if ( job.recovery_type.id != 0 ) {
+			recovery_types_it = recovery_types.find(job.recovery_type.id);
+
+			if ( recovery_types_it != recovery_types.end() )
+				job.recovery_type = recovery_types_it->second;
+			else
+				WARN << "the recovery type " << job.recovery_type.id << " of the job " << job.name << " does not exist";
+		}
 	}
-#endif
-	this->updates_mutex.unlock();
-	return false;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void	Domain::get_resources(const char* domain_name, rpc::v_resources& _return) {
-	std::string		query("SELECT resource_name,resource_node_name,resource_current_value,resource_initial_value FROM resource;");
-	v_v_row			resources_matrix;
-	rpc::t_resource*	resource = NULL;
+void	Domain::get_job(const char* domain_name, rpc::t_job& _return, const char* running_node, const char* job_name) {
+	rpc::v_jobs	jobs;
 
-#ifdef USE_MYSQL
-	 if ( this->database.query_full_result(resources_matrix, query.c_str(), domain_name) == false )   {
+	this->database->get_jobs(domain_name, jobs, running_node, job_name);
+
+	if ( jobs.empty() == true ) {
 		rpc::ex_job	e;
-		e.msg = "The query failed";
+		e.msg = "The job ";
+		e.msg += job_name;
+		e.msg += " does not exist";
 		throw e;
 	}
-#endif
-	BOOST_FOREACH(v_row resource_row, resources_matrix) {
-		delete resource;
-		resource = new rpc::t_resource();
-
-		resource->name		= resource_row[1];
-//		resource->node_name	= resource_row[2];
 
-		if ( resource_row[2].size() > 0 && resource_row[2].compare("NULL") > 0 )
-			resource->current_value		= boost::lexical_cast<int>(resource_row[2]);
-		else {
-			rpc::ex_processing	e;
-			e.msg = "cannot cast ";
-			e.msg += resource_row[2];
-			e.msg += " to integer";
+	_return = jobs[0];
+	_return.domain = this->name;
+	_return.recovery_type.id = 0;
 
-			throw e;
-		}
+	this->get_jobs_next(domain_name, _return.nxt, _return.name);
+	this->get_time_constraints(domain_name, _return.time_constraints, _return.name);
+}
 
-		if ( resource_row[3].size() > 0 && resource_row[3].compare("NULL") > 0 )
-			resource->initial_value		= boost::lexical_cast<int>(resource_row[3]);
-		else {
-			rpc::ex_processing	e;
-			e.msg = "cannot cast ";
-			e.msg += resource_row[3];
-			e.msg += " to integer";
+///////////////////////////////////////////////////////////////////////////////
 
-			throw e;
-		}
+void	Domain::get_jobs_next(const char* domain_name, rpc::v_job_names& _return, const std::string& j_name) {
+	m_jobs_links	links;
 
-		_return.push_back(*resource);
-	}
+	this->database->get_jobs_links(domain_name, links, NULL, j_name.c_str());
 
-	delete resource;
-	resources_matrix.clear();
+	if ( links.empty() == false )
+		_return.insert(_return.end(), links.begin()->second.begin(), links.begin()->second.end());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void	Domain::get_time_constraints(const char* domain_name, rpc::v_time_constraints& _return, const std::string& job_name) {
-	std::string			query("SELECT time_c_job_name,time_c_type,TIME_TO_SEC(time_c_value) FROM time_constraint WHERE time_c_job_name = '");
-	v_v_row				time_constraints_matrix;
-	rpc::t_time_constraint*		time_constraint = NULL;
+void	Domain::get_macro_jobs(const char* domain_name, rpc::v_macro_jobs& _return, const char* running_node) {
+	this->database->get_macro_jobs(domain_name, _return);
+}
 
-	query += job_name;
-	query += "';";
+///////////////////////////////////////////////////////////////////////////////
 
-#ifdef USE_MYSQL
-	if ( this->database.query_full_result(time_constraints_matrix, query.c_str(), domain_name) == false )  {
-		rpc::ex_job	e;
-		e.msg = "The query failed";
-		throw e;
-	}
-#endif
-	BOOST_FOREACH(v_row time_constraint_row, time_constraints_matrix) {
-		delete time_constraint;
-		time_constraint = new rpc::t_time_constraint();
+bool	Domain::add_resource(const char* domain_name, const rpc::t_resource& r, const char* node_name) {
+	boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
 
-		DEBUG << "job_name -> " << time_constraint_row[0].c_str();
-		time_constraint->job_name	= time_constraint_row[0].c_str();
+	return this->database->add_resource(domain_name, r, node_name);
+}
 
-		DEBUG << "type -> " << build_time_constraint_type_from_string(time_constraint_row[1].c_str());
-		time_constraint->type		= build_time_constraint_type_from_string(time_constraint_row[1].c_str());
+///////////////////////////////////////////////////////////////////////////////
 
-		try {
-			DEBUG << "value -> " << time_constraint_row[2];
-			time_constraint->value		= boost::lexical_cast<rpc::integer>(time_constraint_row[2]);
-		} catch (std::exception& lc_e) {
-			rpc::ex_processing	e;
-			e.msg = "cannot cast ";
-			e.msg += time_constraint_row[2];
-			e.msg += " to integer - ";
-			e.msg += lc_e.what();
-		}
+void	Domain::get_resources(const char* domain_name, rpc::v_resources& _return, const char* node_name) {
+	m_resources	resources;
 
-		_return.push_back(*time_constraint);
-	}
+	this->database->get_resources(domain_name, resources, node_name);
 
-	delete time_constraint;
-	time_constraints_matrix.clear(); // TODO: is it really useful ?
+	BOOST_FOREACH(m_resources::value_type& r, resources) {
+		_return.insert(_return.end(), r.second.begin(), r.second.end());
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void	Domain::get_recovery_types(const char* domain_name, rpc::v_recovery_types& _return) {
-	std::string		query("SELECT rectype_id,rectype_short_label,rectype_label,rectype_action FROM recovery_type;");
-	v_v_row			recoveries_matrix;
-	rpc::t_recovery_type*	recovery = NULL;
+void	Domain::get_time_constraints(const char* domain_name, rpc::v_time_constraints& _return, const std::string& job_name) {
+	m_time_constraints	time_constraints;
 
-#ifdef USE_MYSQL
-	if ( this->database.query_full_result(recoveries_matrix, query.c_str(), domain_name) == false ) {
-		rpc::ex_job	e;
-		e.msg = "The query failed";
-		throw e;
-	}
-#endif
-	BOOST_FOREACH(v_row recovery_row, recoveries_matrix) {
-		delete recovery;
+	this->database->get_time_constraints(domain_name, time_constraints, NULL, job_name.c_str());
 
-		try {
-			recovery->id		= boost::lexical_cast<int>(recovery_row[0]);
-		} catch (const std::exception& lc_e) {
-			rpc::ex_processing e;
-			e.msg = "cannot cast ";
-			e.msg += recovery_row[0];
-			e.msg += " to integer - ";
-			e.msg += e.what();
+	if ( time_constraints.empty() == false )
+		_return.insert(_return.end(), time_constraints.begin()->second.begin(), time_constraints.begin()->second.end());
+}
 
-			throw e;
-		}
+///////////////////////////////////////////////////////////////////////////////
 
-		recovery->short_label	= recovery_row[1];
-		recovery->label		= recovery_row[2];
-		recovery->action	= build_rectype_action_from_string(recovery_row[3].c_str());
+void	Domain::get_recovery_types(const char* domain_name, rpc::v_recovery_types& _return) {
+	m_recovery_types	recovery_types;
 
-		_return.push_back(*recovery);
-	}
+	this->database->get_recovery_types(domain_name, recovery_types);
 
-	delete recovery;
-	recoveries_matrix.clear(); // TODO: is it really useful ?
+	BOOST_FOREACH(m_recovery_types::value_type& r, recovery_types) {
+		_return.push_back(r.second);
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 void	Domain::get_recovery_type(const char* domain_name, rpc::t_recovery_type& _return, const int rec_id) {
-	std::string	query("SELECT rectype_id,rectype_short_label,rectype_label,rectype_action FROM recovery_type WHERE rectype_id = '");
-	v_row		recovery_row;
+	m_recovery_types		recovery_types;
+	m_recovery_types::iterator	recovery_types_it;
 
-	query += rec_id;
-	query += "';";
+	// The table is small: it is loaded at once
+	this->database->get_recovery_types(domain_name, recovery_types);
 
-#ifdef USE_MYSQL
-	if ( this->database.query_one_row(recovery_row, query.c_str(), domain_name) == false ) {
-		rpc::ex_job	e;
-		e.msg = "The query failed";
-		throw e;
-	}
-#endif
-	try {
-		_return.id		= boost::lexical_cast<int>(recovery_row[0]);
-	} catch (const std::exception& lc_e) {
-		rpc::ex_processing e;
-		e.msg = "cannot cast ";
-		e.msg += recovery_row[0];
-		e.msg += " to integer - ";
-		e.msg += e.what();
+	recovery_types_it = recovery_types.find(rec_id);
 
+	if ( recovery_types_it == recovery_types.end() ) {
+		rpc::ex_processing e;
+		e.msg = "the recovery type ";
+		e.msg += boost::lexical_cast<std::string>(rec_id);
+		e.msg += " does not exist";
 		throw e;
 	}
 
-	_return.short_label	= recovery_row[1];
-	_return.label		= recovery_row[2];
-	_return.action		= build_rectype_action_from_string(recovery_row[3].c_str());
+	_return = recovery_types_it->second;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 void	Domain::get_node(const char* domain_name, rpc::t_node& _return, const char* node_name) {
-	std::string	query("SELECT node_name,node_weight FROM node WHERE node_name = '");
-	v_row		node_row;
+	rpc::v_nodes	nodes;
 
-	query += node_name;
-	query += "';";
+	this->database->get_nodes(domain_name, nodes, node_name);
 
-#ifdef USE_MYSQL
-	if ( this->database.query_one_row(node_row, query.c_str(), domain_name) == false ) {
-		rpc::ex_job	e;
-		e.msg = "The query failed";
-		throw e;
-	}
-#endif
-	if ( node_row.size() > 0 ) {
-		_return.name	= node_row[0].c_str();
-		_return.weight	= boost::lexical_cast<rpc::integer>(node_row[1]);
-		_return.domain_name	= this->name.c_str();
-		this->get_resources(domain_name, _return.resources);
+	if ( nodes.size() > 0 ) {
+		_return = nodes[0];
+		_return.domain_name = this->name;
+		this->get_resources(domain_name, _return.resources, _return.name.c_str());
 		this->get_jobs(domain_name, _return.jobs, _return.name.c_str());
 	}
 }
@@ -1246,76 +978,76 @@ void	Domain::get_node(const char* domain_name, rpc::t_node& _return, const char*
 ///////////////////////////////////////////////////////////////////////////////
 
 void	Domain::get_nodes(const char* domain_name, rpc::v_nodes& _return) {
-	std::string	query("SELECT node_name,node_weight FROM node;");
-	v_v_row		nodes_matrix;
-	rpc::t_node*	node = NULL;
+	size_t		first	= _return.size();
 
-#ifdef USE_MYSQL
-	if ( this->database.query_full_result(nodes_matrix, query.c_str(), domain_name) == false ) {
-		rpc::ex_job	e;
-		e.msg = "The query failed";
-		throw e;
+	rpc::v_jobs		jobs;
+	m_jobs			jobs_by_node;
+	m_jobs::iterator	jobs_it;
+	m_resources		resources;
+	m_resources::iterator	resources_it;
+
+	uint64_t			queries_count	= this->database->get_queries_count();
+	boost::posix_time::ptime	start		= boost::posix_time::microsec_clock::universal_time();
+
+	this->database->get_nodes(domain_name, _return, NULL);
+
+	/*
+	 * The resources and the jobs of every node are fetched at once then
+	 * dispatched by node name
+	 */
+	this->database->get_resources(domain_name, resources, NULL);
+	this->get_jobs(domain_name, jobs, NULL);
+
+	BOOST_FOREACH(rpc::t_job& j, jobs) {
+		jobs_by_node[j.node_name].push_back(j);
 	}
-#endif
-	BOOST_FOREACH(v_row node_row, nodes_matrix) {
-		delete node;
-		node = new rpc::t_node();
 
-		node->name		= node_row[0];
+	for ( size_t i = first ; i < _return.size() ; i++ ) {
+		rpc::t_node&	node = _return[i];
 
-		try {
-			node->weight	= boost::lexical_cast<rpc::integer>(node_row[1]);
-		} catch ( ... ) {
-			ERROR << "Error while casting int: " << node_row[1];
-		}
+		node.domain_name = this->name;
 
-		this->get_node(domain_name, *node, node_row[0].c_str());
+		resources_it = resources.find(node.name);
+		if ( resources_it != resources.end() )
+			node.resources.swap(resources_it->second);
 
-		_return.push_back(*node);
+		jobs_it = jobs_by_node.find(node.name);
+		if ( jobs_it != jobs_by_node.end() )
+			node.jobs.swap(jobs_it->second);
 	}
 
-	delete node;
-	nodes_matrix.clear(); // TODO: is it really useful ?
+	// The counter is shared by the threads: it is an upper bound
+	DEBUG << "get_nodes:: " << _return.size() - first << " nodes and " << jobs.size() << " jobs loaded from " << domain_name << " using " << this->database->get_queries_count() - queries_count << " queries in " << (boost::posix_time::microsec_clock::universal_time() - start).total_milliseconds() << " ms";
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 void	Domain::sql_exec(const std::string& running_node, const std::string& s) {
-	v_v_row	result;
-#ifdef USE_MYSQL
-	this->database.query_full_result(result, s.c_str(), running_node.c_str());
-#endif
+	this->database->sql_exec(running_node.c_str(), s);
+	this->invalidate_graph(running_node.c_str());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 void	Domain::sql_exec(const std::string& s) {
-	v_v_row	result;
-#ifdef USE_MYSQL
-	this->database.query_full_result(result, s.c_str(), NULL);
-#endif
+	this->database->sql_exec(NULL, s);
+	this->invalidate_graph(NULL);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 rpc::integer	Domain::monitor_failed_jobs(const char* domain_name) {
-	std::string	query("SELECT COUNT(*) FROM job WHERE job_state = 'failed';");
-	v_row		result;
-
-	this->database.query_one_row(result, query.c_str(), domain_name);
+	this->flush_job_states();
 
-	return boost::lexical_cast<rpc::integer>(result.at(0));
+	return static_cast<rpc::integer>(this->database->count_jobs_in_state(domain_name, rpc::e_job_state::FAILED));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 rpc::integer	Domain::monitor_waiting_jobs(const char* domain_name) {
-	std::string	query("SELECT COUNT(*) FROM job WHERE job_state = 'waiting';");
-	v_row		result;
+	this->flush_job_states();
 
-	this->database.query_one_row(result, query.c_str(), domain_name);
-
-	return boost::lexical_cast<rpc::integer>(result.at(0));
+	return static_cast<rpc::integer>(this->database->count_jobs_in_state(domain_name, rpc::e_job_state::WAITING));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1339,17 +1071,14 @@ std::string Domain::get_current_planning_name() {
 ///////////////////////////////////////////////////////////////////////////////
 
 void	Domain::get_available_planning_names(std::vector<std::string>& _return) {
-	std::string	query;
-	v_v_row		result;
-	boost::regex	planning_db("^\\w+(_\\d+){0,1}$", boost::regex::perl);
-
-	query = "SHOW DATABASES";
+	std::vector<std::string>	schemas;
+	boost::regex			planning_db("^\\w+(_\\d+){0,1}$", boost::regex::perl);
 
-	this->database.query_full_result(result, query.c_str(), NULL);
+	this->database->get_planning_names(schemas);
 
-	BOOST_FOREACH(v_row line, result) {
-		if ( boost::regex_match(line.at(0), planning_db) == true && line.at(0).compare("information_schema") != 0 )
-			_return.push_back(line.at(0));
+	BOOST_FOREACH(const std::string& schema, schemas) {
+		if ( boost::regex_match(schema, planning_db) == true && schema.compare("information_schema") != 0 )
+			_return.push_back(schema);
 	}
 }
 
@@ -1386,15 +1115,394 @@ bool	Domain::contains_data(const char* node_name) {
 		throw e;
 	}
 
-	v_row	result;
-	std::string	query = "SELECT COUNT(*) FROM job WHERE job_name_name LIKE '";
-	query += node_name;
-	query += "';";
+	if ( this->database->count_node_jobs(this->name.c_str(), node_name) > 0 )
+		return true;
+
+	return false;
+}
 
-	this->database.query_one_row(result, query.c_str(), this->name.c_str());
+///////////////////////////////////////////////////////////////////////////////
 
-	if ( boost::lexical_cast<int>(result[0]) > 0 )
+bool	Domain::flush_job_states() {
+	boost::unique_lock<boost::mutex>	lock(this->job_states_mutex);
+	uint64_t				target		= this->job_states_queued_sequence;
+	uint64_t				failed_batches	= this->job_states_counters.failed_batches;
+
+	if ( this->job_states_committed_sequence >= target )
 		return true;
 
-	return false;
+	this->job_states_flush_requested = true;
+	this->job_states_queued.notify_one();
+
+	// A failed batch is retried later, the readers do not wait for it
+	while ( this->job_states_committed_sequence < target and this->job_states_counters.failed_batches == failed_batches )
+		this->job_states_committed.wait(lock);
+
+	if ( this->job_states_committed_sequence < target ) {
+		ERROR << "flush_job_states:: the queued states are not committed yet";
+		return false;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Domain::get_job_states_metrics(job_states_metrics& _return) {
+	boost::lock_guard<boost::mutex>	lock(this->job_states_mutex);
+
+	_return = this->job_states_counters;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Domain::planning_exists(const char* planning_name) {
+	bool	result = false;
+
+	{
+		boost::lock_guard<boost::mutex>	lock(this->known_plannings_mutex);
+
+		if ( this->known_plannings.find(planning_name) != this->known_plannings.end() )
+			return true;
+	}
+
+	{
+		boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
+
+		// A malformed name is rejected by the database
+		try {
+			result = this->database->planning_exists(planning_name);
+		} catch (const rpc::ex_processing& e) {
+			result = false;
+		}
+	}
+
+	if ( result == true ) {
+		boost::lock_guard<boost::mutex>	lock(this->known_plannings_mutex);
+		this->known_plannings.insert(planning_name);
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Domain::queue_job_state(const char* domain_name, const int job_id, const rpc::e_job_state::type js, const bool has_times, const time_t start_time, const time_t stop_time, const job_usage* usage) {
+	job_state_update		update;
+
+	if ( job_id == 0 )
+		return false;
+
+	// Its states would never be committed
+	if ( this->planning_exists(domain_name) == false ) {
+		ERROR << "queue_job_state:: the planning " << domain_name << " does not exist";
+		return false;
+	}
+
+	boost::lock_guard<boost::mutex>	lock(this->graph_mutex);
+
+	// The next jobs are released now, the database is updated later
+	if ( this->graph.is_loaded(domain_name) == true )
+		this->graph.set_state(job_id, js, has_times, start_time, stop_time);
+
+	update.domain_name	= domain_name;
+	update.job_id		= job_id;
+	update.state		= js;
+	update.has_times	= has_times;
+	update.start_time	= start_time;
+	update.stop_time	= stop_time;
+	update.has_usage	= usage != NULL;
+
+	if ( usage != NULL )
+		update.usage = *usage;
+
+	this->job_states_mutex.lock();
+
+	this->job_states.push_back(update);
+	this->job_states_queued_sequence++;
+
+	this->job_states_mutex.unlock();
+	this->job_states_queued.notify_one();
+
+	// A started job cannot release anything
+	if ( js != rpc::e_job_state::RUNNING )
+		this->notify_events();
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Domain::queue_job_states(const d_job_state_updates& updates) {
+	boost::lock_guard<boost::mutex>	lock(this->graph_mutex);
+	bool				released = false;
+
+	BOOST_FOREACH(const job_state_update& update, updates) {
+		if ( this->graph.is_loaded(update.domain_name) == true )
+			this->graph.set_state(update.job_id, update.state, update.has_times, update.start_time, update.stop_time);
+
+		if ( update.state != rpc::e_job_state::RUNNING )
+			released = true;
+	}
+
+	// A single block: the writer commits the transitions together
+	this->job_states_mutex.lock();
+
+	this->job_states.insert(this->job_states.end(), updates.begin(), updates.end());
+	this->job_states_queued_sequence += updates.size();
+
+	this->job_states_mutex.unlock();
+	this->job_states_queued.notify_one();
+
+	if ( released == true )
+		this->notify_events();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Domain::get_release_latency_metrics(release_latency_metrics& _return) {
+	std::vector<uint64_t>	latencies;
+
+	this->graph_mutex.lock();
+	this->graph.get_release_latencies(latencies);
+	this->graph_mutex.unlock();
+
+	_return = release_latency_metrics();
+
+	if ( latencies.empty() == true )
+		return;
+
+	std::sort(latencies.begin(), latencies.end());
+
+	_return.samples	= latencies.size();
+	_return.p50	= latencies[( latencies.size() - 1 ) * 50 / 100];
+	_return.p99	= latencies[( latencies.size() - 1 ) * 99 / 100];
+	_return.max	= latencies.back();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Domain::wait_for_events(const time_t deadline) {
+	time_t	wake_up = deadline;
+	time_t	timeout;
+	bool	result;
+
+	// The next time window to open or close
+	this->graph_mutex.lock();
+	if ( this->graph.get_next_timeout(timeout) == true and timeout < wake_up )
+		wake_up = timeout;
+	this->graph_mutex.unlock();
+
+	boost::unique_lock<boost::mutex>	lock(this->events_mutex);
+
+	while ( this->events_pending == false ) {
+		if ( this->events_signaled.timed_wait(lock, boost::posix_time::from_time_t(wake_up)) == false )
+			break;
+	}
+
+	result			= this->events_pending;
+	this->events_pending	= false;
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Domain::notify_events() {
+	this->events_mutex.lock();
+	this->events_pending = true;
+	this->events_mutex.unlock();
+
+	this->events_signaled.notify_all();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Domain::advance_windows(const time_t now) {
+	boost::lock_guard<boost::mutex>	lock(this->graph_mutex);
+
+	// The timers get_next_timeout gives to wait_for_events
+	this->graph.advance_windows(now);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Domain::load_graph(const std::string& planning_name) {
+	rpc::v_jobs			jobs;
+	m_jobs_links			links;
+	m_time_constraints		time_constraints;
+	boost::posix_time::ptime	start = boost::posix_time::microsec_clock::universal_time();
+
+	// The queued states are read back from the database
+	if ( this->flush_job_states() == false )
+		WARN << "load_graph:: the graph of " << planning_name << " may miss some states";
+
+	this->database->get_jobs(planning_name.c_str(), jobs, NULL, NULL);
+	this->database->get_jobs_links(planning_name.c_str(), links, NULL, NULL);
+	this->database->get_time_constraints(planning_name.c_str(), time_constraints, NULL, NULL);
+
+	this->graph_recovery_types.clear();
+	this->database->get_recovery_types(planning_name.c_str(), this->graph_recovery_types);
+
+	this->graph.load(planning_name, this->planning_start_time, time(NULL), this->at_window, jobs, links, time_constraints, &this->job_names);
+
+	INFO << "graph of " << planning_name << " loaded: " << this->graph.get_jobs_count() << " jobs, " << this->graph.get_ready_count() << " ready, " << this->graph.get_timers_count() << " timers, in " << (boost::posix_time::microsec_clock::universal_time() - start).total_milliseconds() << " ms";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Domain::invalidate_graph(const char* planning_name) {
+	boost::lock_guard<boost::mutex>	lock(this->graph_mutex);
+
+	if ( planning_name == NULL or this->graph.is_loaded(planning_name) == true )
+		this->graph.invalidate();
+
+	// The modified planning may have new ready jobs
+	this->notify_events();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Domain::get_graph_ready_jobs(rpc::v_jobs& _return, const std::string& planning_name, const char* running_node) {
+	boost::lock_guard<boost::mutex>	lock(this->graph_mutex);
+
+	if ( this->graph.is_loaded(planning_name) == false )
+		this->load_graph(planning_name);
+
+	this->graph.get_ready_jobs(_return, running_node, time(NULL));
 }
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Domain::write_job_states() {
+	boost::unique_lock<boost::mutex>	lock(this->job_states_mutex);
+	d_job_state_updates			batch;
+	d_job_state_updates			retained;
+	std::set<std::string>			failed;
+	uint64_t				target;
+	uint64_t				latency;
+	size_t					committed;
+	boost::posix_time::ptime		deadline;
+	boost::posix_time::ptime		start;
+
+	while ( true ) {
+		while ( this->job_states.empty() == true and this->job_states_stopping == false )
+			this->job_states_queued.wait(lock);
+
+		if ( this->job_states.empty() == true )
+			break;
+
+		/*
+		 * Let the other transitions join the batch unless a reader is
+		 * waiting for it
+		 */
+		deadline = boost::posix_time::microsec_clock::universal_time() + this->commit_interval;
+
+		while ( this->job_states_flush_requested == false and this->job_states_stopping == false and boost::posix_time::microsec_clock::universal_time() < deadline )
+			this->job_states_queued.timed_wait(lock, deadline);
+
+		batch.swap(this->job_states);
+		target = this->job_states_queued_sequence;
+		this->job_states_flush_requested = false;
+
+		lock.unlock();
+
+		failed.clear();
+
+		start	= boost::posix_time::microsec_clock::universal_time();
+		this->commit_job_states(batch, failed);
+		latency	= (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds();
+
+		lock.lock();
+
+		/*
+		 * A failing planning must not delay the others: its updates
+		 * are retried alone and dropped after commit_retries attempts
+		 */
+		BOOST_FOREACH(const std::string& planning_name, failed) {
+			this->job_states_counters.failed_batches += 1;
+
+			if ( this->job_states_stopping == true ) {
+				ERROR << "write_job_states:: shutting down, the states of the planning " << planning_name << " are lost";
+				this->job_states_failures.erase(planning_name);
+				continue;
+			}
+
+			if ( ++this->job_states_failures[planning_name] >= this->commit_retries ) {
+				ERROR << "write_job_states:: cannot commit the states of the planning " << planning_name << " after " << this->commit_retries << " attempts, dropping them";
+				this->job_states_failures.erase(planning_name);
+				continue;
+			}
+
+			ERROR << "write_job_states:: cannot commit the states of the planning " << planning_name << ", retrying";
+		}
+
+		committed = 0;
+		retained.clear();
+
+		BOOST_FOREACH(const job_state_update& update, batch) {
+			if ( failed.find(update.domain_name) == failed.end() ) {
+				this->job_states_failures.erase(update.domain_name);
+				committed++;
+			} else if ( this->job_states_failures.find(update.domain_name) != this->job_states_failures.end() ) {
+				retained.push_back(update);
+			} else {
+				this->job_states_counters.parked += 1;
+			}
+		}
+
+		if ( committed > 0 ) {
+			this->job_states_counters.updates		+= committed;
+			this->job_states_counters.batches		+= 1;
+			this->job_states_counters.total_commit_latency	+= latency;
+
+			if ( committed > this->job_states_counters.max_batch_size )
+				this->job_states_counters.max_batch_size = committed;
+			if ( latency > this->job_states_counters.max_commit_latency )
+				this->job_states_counters.max_commit_latency = latency;
+
+			DEBUG << "write_job_states:: " << committed << " states committed in " << latency << " us";
+		}
+
+		if ( retained.empty() == true ) {
+			this->job_states_committed_sequence = target;
+		} else {
+			// The retained transitions keep their place: they are applied in order
+			retained.insert(retained.end(), this->job_states.begin(), this->job_states.end());
+			this->job_states.swap(retained);
+			retained.clear();
+		}
+
+		batch.clear();
+
+		this->job_states_committed.notify_all();
+
+		// Do not hammer a failing database
+		if ( failed.empty() == false and this->job_states_stopping == false )
+			this->job_states_queued.timed_wait(lock, boost::posix_time::microsec_clock::universal_time() + this->commit_interval + boost::posix_time::seconds(1));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Domain::commit_job_states(const d_job_state_updates& batch, std::set<std::string>& _return) {
+	boost::lock_guard<boost::mutex>			lock(this->updates_mutex);
+	std::map<std::string, d_job_state_updates>	plannings;
+
+	BOOST_FOREACH(const job_state_update& update, batch) {
+		plannings[update.domain_name].push_back(update);
+	}
+
+	// A failing planning cannot take the others down
+	for ( std::map<std::string, d_job_state_updates>::const_iterator it = plannings.begin() ; it != plannings.end() ; it++ ) {
+		// The writer thread must survive the database errors
+		try {
+			if ( this->database->update_job_states(it->second) == false )
+				_return.insert(it->first);
+		} catch (const rpc::ex_processing& e) {
+			ERROR << "commit_job_states:: " << it->first << ": " << e.msg;
+			_return.insert(it->first);
+		}
+	}
+}
+
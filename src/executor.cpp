@@ -0,0 +1,213 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: executor.cpp
+ * Description: admits the local jobs and hands them to the supervisor.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#include "executor.h"
+
+Executor::Executor(Domain* d, Config* c) : supervisor(d, c) {
+	if ( d == NULL or c == NULL ) {
+		rpc::ex_processing e;
+		e.msg = "Executor: the domain and the configuration cannot be NULL";
+		throw e;
+	}
+
+	this->domain		= d;
+	this->sequence		= 0;
+	this->stopping		= false;
+
+	this->max_jobs		= c->get_integer_param("executor_max_jobs", 256);
+	this->node_limit	= c->get_integer_param("executor_node_limit", this->max_jobs);
+	this->queue_size	= c->get_integer_param("executor_queue_size", 1024);
+
+	INFO << "executor: " << this->max_jobs << " running jobs, " << this->node_limit << " per node, " << this->queue_size << " pending launches";
+}
+
+Executor::~Executor() {
+	boost::unique_lock<boost::mutex>	lock(this->mutex);
+	executor_metrics			metrics;
+
+	// The pending jobs are admitted as the running ones end
+	this->stopping = true;
+
+	while ( this->counters.queue_depth > 0 or this->counters.running > 0 )
+		this->idle.wait(lock);
+
+	metrics = this->counters;
+
+	INFO << "executor: " << metrics.started << " jobs started (" << metrics.rejected << " rejected), max queue depth " << metrics.max_queue_depth << ", max admission wait " << metrics.max_admission_wait << " us";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Executor::submit(const Job& j) {
+	this->mutex.lock();
+
+	if ( this->stopping == true or this->counters.queue_depth >= this->queue_size ) {
+		this->counters.rejected++;
+		this->mutex.unlock();
+		return false;
+	}
+
+	this->nodes[j.get_node_name2()].pending.push(executor_task(j, this->sequence++));
+
+	this->counters.submitted++;
+	this->counters.queue_depth++;
+
+	if ( this->counters.queue_depth > this->counters.max_queue_depth )
+		this->counters.max_queue_depth = this->counters.queue_depth;
+
+	this->mutex.unlock();
+
+	this->dispatch();
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Executor::is_full() {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	return this->counters.queue_depth >= this->queue_size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Executor::get_metrics(executor_metrics& _return) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	_return = this->counters;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Executor::dispatch() {
+	std::vector<executor_task>	admitted;
+	executor_node*			node;
+	uint64_t			wait;
+	bool				was_full;
+	bool				resumed;
+	size_t				failed;
+	time_t				now;
+
+	this->mutex.lock();
+
+	was_full = this->counters.queue_depth >= this->queue_size;
+
+	// The failed launches free their slots for the next jobs at once
+	do {
+		admitted.clear();
+
+		while ( this->counters.running < this->max_jobs and this->admit(node) == true ) {
+			admitted.push_back(node->pending.top());
+			node->pending.pop();
+			node->running++;
+
+			wait = ( boost::posix_time::microsec_clock::universal_time() - admitted.back().submitted ).total_microseconds();
+
+			this->counters.queue_depth--;
+			this->counters.running++;
+			this->counters.started++;
+			this->counters.total_admission_wait += wait;
+
+			if ( wait > this->counters.max_admission_wait )
+				this->counters.max_admission_wait = wait;
+		}
+
+		// The scheduler stopped submitting: it can go on
+		resumed		= was_full == true and this->counters.queue_depth < this->queue_size;
+		was_full	= was_full == true and resumed == false;
+
+		this->mutex.unlock();
+
+		if ( resumed == true )
+			this->domain->notify_events();
+
+		failed = 0;
+
+		BOOST_FOREACH(const executor_task& t, admitted) {
+			Job	job(this->domain, t.job);
+
+			job.set_id(t.job_id);
+			job.set_node_id(t.node_id);
+			job.set_args(t.args);
+
+			if ( this->supervisor.spawn(job, boost::bind(&Executor::release, this, t.job.node_name)) == true )
+				continue;
+
+			// The job cannot start: it failed
+			now = time(NULL);
+			job.set_failure(rpc::e_job_failure::SPAWN);
+			if ( job.update_state(rpc::e_job_state::FAILED, now, now) == false )
+				ERROR << "cannot update job's state to FAILED";
+
+			this->mutex.lock();
+			this->nodes[t.job.node_name].running--;
+			this->counters.running--;
+			this->mutex.unlock();
+
+			failed++;
+		}
+
+		this->mutex.lock();
+	} while ( failed > 0 );
+
+	if ( this->counters.queue_depth == 0 and this->counters.running == 0 )
+		this->idle.notify_all();
+
+	this->mutex.unlock();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Executor::release(const std::string& node_name) {
+	this->mutex.lock();
+
+	// The nodes are never erased
+	this->nodes[node_name].running--;
+	this->counters.running--;
+
+	this->mutex.unlock();
+
+	this->dispatch();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Executor::admit(executor_node*& _return) {
+	_return = NULL;
+
+	for ( m_executor_nodes::iterator it = this->nodes.begin() ; it != this->nodes.end() ; it++ ) {
+		if ( it->second.pending.empty() == true or it->second.running >= this->node_limit )
+			continue;
+
+		if ( _return == NULL or _return->pending.top() < it->second.pending.top() )
+			_return = &it->second;
+	}
+
+	return _return != NULL;
+}
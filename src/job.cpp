@@ -27,6 +27,8 @@
 
 #include "job.h"
 
+extern char**	environ;
+
 ///////////////////////////////////////////////////////////////////////////////
 /*
 Job::Job(Domain* d, const std::string& name, const std::string& node_name, const std::string& cmd_line, const int& weight, const v_job_ids& pj, const v_job_ids& nj) {
@@ -97,8 +99,10 @@ Job::Job(Domain* d, const rpc::t_job& j) {
 		throw e;
 	}
 
-	this->domain = d;
-	this->job = j;
+	this->domain	= d;
+	this->job	= j;
+	this->id	= 0;
+	this->node_id	= 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -124,15 +128,68 @@ bool	Job::run() {
 		return false;
 	}
 
-	try {
-		FILE*	p_job = NULL;
+	return this->execute();
+}
 
-		this->job.start_time	= static_cast<long int>(time(NULL));
+///////////////////////////////////////////////////////////////////////////////
 
-		if ( (p_job = popen(this->job.cmd_line.c_str(), "r")) != NULL )
-			this->job.return_code = pclose(p_job);
-		else
-			this->job.return_code = 1;
+bool	Job::execute() {
+	try {
+		char		buffer[4096];
+		ssize_t		length;
+		int64_t		stdout_bytes = 0;
+		int		output[2];
+		int		status;
+		int		result;
+		pid_t		pid;
+		struct rusage	usage;
+
+		this->job.start_time		= static_cast<long int>(time(NULL));
+		this->job.return_code		= 1;
+		this->job.__isset.failure	= false;
+
+		if ( pipe(output) != 0 ) {
+			ERROR << "cannot create the pipe of " << this->job.name << ": " << strerror(errno);
+			this->job.__set_failure(rpc::e_job_failure::SPAWN);
+		} else {
+			fcntl(output[0], F_SETFD, FD_CLOEXEC);
+			fcntl(output[1], F_SETFD, FD_CLOEXEC);
+
+			result = this->spawn(pid, output[1], -1, this->is_direct(), -1);
+			close(output[1]);
+
+			if ( result != 0 ) {
+				ERROR << "cannot spawn " << this->job.name << ": " << strerror(result);
+				this->job.__set_failure(rpc::e_job_failure::SPAWN);
+			} else {
+				// The output is read until the end: a full pipe would block the job
+				// Only the standard output is counted, the errors are not captured
+				while ( ( length = read(output[0], buffer, sizeof(buffer)) ) != 0 ) {
+					if ( length > 0 )
+						stdout_bytes += length;
+					else if ( errno != EINTR )
+						break;
+				}
+
+				this->job.__set_stdout_bytes(stdout_bytes);
+
+				while ( ( result = wait4(pid, &status, 0, &usage) ) < 0 and errno == EINTR )
+					;
+
+				if ( result == pid )
+					build_usage_from_rusage(usage, this->job);
+
+				if ( result == pid and WIFEXITED(status) )
+					this->job.return_code = WEXITSTATUS(status);
+				else if ( result == pid and WIFSIGNALED(status) )
+					this->job.return_code = 128 + WTERMSIG(status);
+
+				if ( this->job.return_code != 0 )
+					this->job.__set_failure(rpc::e_job_failure::RETURN_CODE);
+			}
+
+			close(output[0]);
+		}
 
 		this->job.stop_time	= static_cast<long int>(time(NULL));
 
@@ -168,6 +225,167 @@ bool	Job::run() {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+/*
+ * vfork_exec
+ *
+ * Starts a process with vfork: the child moves itself into its cgroup before
+ * running anything, as posix_spawn cannot do it
+ * The child only calls async-signal-safe functions, the parent's signals are
+ * blocked until the child runs the program
+ *
+ * @param	_return		the process' pid
+ * @param	argv		the arguments
+ * @param	shell		true to run /bin/sh, false to look for argv[0] in the PATH
+ * @param	stdout_fd	the standard output, -1 to keep the scheduler's
+ * @param	stderr_fd	the standard error, -1 to keep the scheduler's
+ * @param	cgroup_fd	the cgroup.procs of the leaf
+ * @param	defaults	the signals set to their defaults, 0 ended
+ *
+ * @return	0 on success, the error's number otherwise
+ */
+static	int	vfork_exec(pid_t& _return, const std::vector<const char*>& argv, const bool shell, const int stdout_fd, const int stderr_fd, const int cgroup_fd, const int* defaults) {
+	sigset_t		all;
+	sigset_t		saved;
+	struct sigaction	action;
+	volatile int		error = 0;
+	pid_t			pid;
+	int			fd;
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &saved);
+
+	pid = vfork();
+
+	if ( pid == 0 ) {
+		setpgid(0, 0);
+
+		// The scheduler's handlers cannot run in the child
+		for ( int s = 1 ; s < NSIG ; s++ ) {
+			if ( sigaction(s, NULL, &action) == 0 and action.sa_handler != SIG_DFL and action.sa_handler != SIG_IGN ) {
+				action.sa_handler = SIG_DFL;
+				sigaction(s, &action, NULL);
+			}
+		}
+
+		for ( int i = 0 ; defaults[i] != 0 ; i++ )
+			signal(defaults[i], SIG_DFL);
+
+		if ( write(cgroup_fd, "0", 1) != 1 ) {
+			error = errno;
+			_exit(127);
+		}
+
+		if ( ( fd = open("/dev/null", O_RDONLY) ) >= 0 and fd != STDIN_FILENO ) {
+			dup2(fd, STDIN_FILENO);
+			close(fd);
+		}
+
+		if ( stdout_fd >= 0 )
+			dup2(stdout_fd, STDOUT_FILENO);
+		if ( stderr_fd >= 0 )
+			dup2(stderr_fd, STDERR_FILENO);
+
+		sigemptyset(&all);
+		sigprocmask(SIG_SETMASK, &all, NULL);
+
+		if ( shell == true )
+			execve("/bin/sh", const_cast<char* const*>(&argv[0]), environ);
+		else
+			execvp(argv[0], const_cast<char* const*>(&argv[0]));
+
+		error = errno;
+		_exit(127);
+	}
+
+	if ( pid < 0 )
+		error = errno;
+
+	pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+	// The memory is shared until the exec: error is set by the failed child
+	if ( pid > 0 and error != 0 )
+		waitpid(pid, NULL, 0);
+
+	_return = pid;
+
+	return error;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int	Job::spawn(pid_t& _return, const int stdout_fd, const int stderr_fd, const bool direct, const int cgroup_fd) const {
+	posix_spawn_file_actions_t	actions;
+	posix_spawnattr_t		attributes;
+	sigset_t			signals;
+	std::vector<const char*>	argv;
+	short				flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP;
+	int				result;
+	const bool			shell = direct == false or this->is_direct() == false;
+	const int			defaults[] = { SIGPIPE, SIGCHLD, SIGHUP, SIGINT, SIGQUIT, SIGTERM, SIGTSTP, SIGTTIN, SIGTTOU, 0 };
+
+	// The shell is only needed by the command lines using its syntax
+	if ( shell == false ) {
+		BOOST_FOREACH(const std::string& a, *this->args) {
+			argv.push_back(a.c_str());
+		}
+	} else {
+		argv.push_back("sh");
+		argv.push_back("-c");
+		argv.push_back(this->job.cmd_line.c_str());
+	}
+	argv.push_back(NULL);
+
+	if ( cgroup_fd >= 0 )
+		return vfork_exec(_return, argv, shell, stdout_fd, stderr_fd, cgroup_fd, defaults);
+
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+
+	if ( stdout_fd >= 0 )
+		posix_spawn_file_actions_adddup2(&actions, stdout_fd, STDOUT_FILENO);
+	if ( stderr_fd >= 0 )
+		posix_spawn_file_actions_adddup2(&actions, stderr_fd, STDERR_FILENO);
+
+	// The jobs do not inherit the signals blocked or ignored by the scheduler
+	posix_spawnattr_init(&attributes);
+
+	sigemptyset(&signals);
+	posix_spawnattr_setsigmask(&attributes, &signals);
+
+	for ( int i = 0 ; defaults[i] != 0 ; i++ )
+		sigaddset(&signals, defaults[i]);
+	posix_spawnattr_setsigdefault(&attributes, &signals);
+
+	// The job and its children are signaled as a group
+	posix_spawnattr_setpgroup(&attributes, 0);
+
+#ifdef POSIX_SPAWN_USEVFORK
+	// glibc older than 2.24 copies the page tables without it
+	flags |= POSIX_SPAWN_USEVFORK;
+#endif // POSIX_SPAWN_USEVFORK
+
+	posix_spawnattr_setflags(&attributes, flags);
+
+	// An unknown program makes posix_spawnp fail: the job fails without running
+	if ( shell == true )
+		result = posix_spawn(&_return, "/bin/sh", &actions, &attributes, const_cast<char* const*>(&argv[0]), environ);
+	else
+		result = posix_spawnp(&_return, argv[0], &actions, &attributes, const_cast<char* const*>(&argv[0]), environ);
+
+	posix_spawnattr_destroy(&attributes);
+	posix_spawn_file_actions_destroy(&actions);
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Job::is_direct() const {
+	return this->args and this->args->empty() == false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 bool	Job::update_state(const rpc::e_job_state::type js) {
 	return this->domain->update_job_state(this->job.domain.c_str(), this, js);
 }
@@ -188,6 +406,18 @@ const rpc::t_job*	Job::get_job() const {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+int	Job::get_id() const {
+	return this->id;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int	Job::get_node_id() const {
+	return this->node_id;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 const std::string	Job::get_name() const {
 	return this->job.name;
 }
@@ -238,3 +468,33 @@ const rpc::v_job_names	Job::get_next() const {
 const rpc::v_job_names	Job::get_prev() const {
 	return this->job.prv;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job::set_id(const int i) {
+	this->id = i;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job::set_node_id(const int i) {
+	this->node_id = i;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const boost::shared_ptr<const v_command_args>&	Job::get_args() const {
+	return this->args;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job::set_args(const boost::shared_ptr<const v_command_args>& a) {
+	this->args = a;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job::set_failure(const rpc::e_job_failure::type f) {
+	this->job.__set_failure(f);
+}
@@ -0,0 +1,331 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: job_cgroup.cpp
+ * Description: limits and measures the jobs using cgroup v2.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "job_cgroup.h"
+
+Job_Cgroups::Job_Cgroups(Config* c) {
+	std::string*	value;
+
+	if ( c == NULL ) {
+		rpc::ex_processing e;
+		e.msg = "Job_Cgroups: the configuration cannot be NULL";
+		throw e;
+	}
+
+	if ( ( value = c->get_param("job_cgroup_path") ) != NULL )
+		this->path = *value;
+
+	this->cpu_per_weight	= c->get_integer_param("job_cgroup_cpu_per_weight", 0);
+	this->memory_per_weight	= c->get_integer_param("job_cgroup_memory_per_weight", 0);
+	this->sequence		= time(NULL);
+	this->cpu		= false;
+	this->memory		= false;
+	this->io		= false;
+
+	this->enabled = this->check();
+}
+
+Job_Cgroups::~Job_Cgroups() {
+	job_cgroups_metrics	metrics;
+
+	if ( this->enabled == false )
+		return;
+
+	this->remove("");
+	this->get_metrics(metrics);
+
+	INFO << "jobs' cgroups: " << metrics.created << " created (" << metrics.failures << " failures), " << metrics.oom_killed << " jobs killed by the OOM killer, " << metrics.stale << " leaves still holding processes";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Job_Cgroups::is_enabled() const {
+	return this->enabled;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Job_Cgroups::create(std::string& _return, const rpc::t_job& j) {
+	int64_t	weight = j.weight > 0 ? j.weight : 1;
+
+	_return.clear();
+
+	if ( this->enabled == false )
+		return false;
+
+	// The job runs without limits rather than in a leaf out of the hierarchy
+	if ( is_file_name(j.domain) == false or is_file_name(j.name) == false ) {
+		ERROR << "cannot create the cgroup of the job " << j.name << " of " << j.domain << ": unusable file name";
+
+		boost::lock_guard<boost::mutex>	lock(this->mutex);
+		this->counters.failures++;
+		return false;
+	}
+
+	this->mutex.lock();
+	_return = this->path + "/" + j.domain + "." + j.name + "." + boost::lexical_cast<std::string>(this->sequence++);
+	this->mutex.unlock();
+
+	if ( mkdir(_return.c_str(), 0755) != 0 ) {
+		ERROR << "cannot create the cgroup " << _return << ": " << strerror(errno);
+		_return.clear();
+
+		boost::lock_guard<boost::mutex>	lock(this->mutex);
+		this->counters.failures++;
+		return false;
+	}
+
+	// The job runs unlimited rather than not at all
+	if ( this->cpu == true ) {
+		if ( this->write_file(_return + "/cpu.weight", boost::lexical_cast<std::string>(std::min<int64_t>(weight * 100, 10000))) == false )
+			ERROR << "cannot set the CPU weight of " << _return << ": " << strerror(errno);
+
+		if ( this->cpu_per_weight > 0 and this->write_file(_return + "/cpu.max", boost::lexical_cast<std::string>(weight * this->cpu_per_weight * JOB_CGROUP_CPU_PERIOD / 100) + " " + boost::lexical_cast<std::string>(JOB_CGROUP_CPU_PERIOD)) == false )
+			ERROR << "cannot set the CPU limit of " << _return << ": " << strerror(errno);
+	}
+
+	if ( this->memory == true and this->memory_per_weight > 0 and this->write_file(_return + "/memory.max", boost::lexical_cast<std::string>(weight * this->memory_per_weight)) == false )
+		ERROR << "cannot set the memory limit of " << _return << ": " << strerror(errno);
+
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	this->counters.created++;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int	Job_Cgroups::attach(const std::string& leaf) {
+	int	fd = open((leaf + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+
+	if ( fd >= 0 )
+		return fd;
+
+	ERROR << "cannot open the processes of " << leaf << ": " << strerror(errno);
+
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	this->counters.failures++;
+
+	return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job_Cgroups::collect(const std::string& leaf, rpc::t_job& j) {
+	std::string	content;
+	int64_t		value;
+
+	if ( this->read_file(leaf + "/cpu.stat", content) == true and this->read_key(content, "usage_usec", value) == true )
+		j.__set_cpu_usage(value);
+
+	// memory.peak appeared with Linux 5.19
+	if ( this->memory == true and this->read_file(leaf + "/memory.peak", content) == true and this->read_key("peak " + content, "peak", value) == true )
+		j.__set_memory_peak(value);
+
+	if ( this->memory == true and this->read_file(leaf + "/memory.events", content) == true and this->read_key(content, "oom_kill", value) == true and value > 0 ) {
+		WARN << "job " << j.name << ": " << value << " processes killed by the OOM killer";
+
+		boost::lock_guard<boost::mutex>	lock(this->mutex);
+		this->counters.oom_killed++;
+	}
+
+	if ( this->io == true and this->read_file(leaf + "/io.stat", content) == true ) {
+		if ( this->read_key(content, "rbytes", value) == true )
+			j.__set_io_read_bytes(value);
+		if ( this->read_key(content, "wbytes", value) == true )
+			j.__set_io_write_bytes(value);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job_Cgroups::remove(const std::string& leaf) {
+	std::vector<std::string>	leaves;
+	std::vector<std::string>	busy;
+
+	this->mutex.lock();
+	leaves.swap(this->stale);
+	this->mutex.unlock();
+
+	if ( leaf.empty() == false )
+		leaves.push_back(leaf);
+
+	// The processes left by a job keep its leaf
+	BOOST_FOREACH(const std::string& l, leaves) {
+		if ( rmdir(l.c_str()) == 0 or errno == ENOENT )
+			continue;
+
+		if ( errno == EBUSY )
+			busy.push_back(l);
+		else
+			ERROR << "cannot remove the cgroup " << l << ": " << strerror(errno);
+	}
+
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	this->stale.insert(this->stale.end(), busy.begin(), busy.end());
+	this->counters.stale = this->stale.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job_Cgroups::get_metrics(job_cgroups_metrics& _return) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	_return = this->counters;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Job_Cgroups::check() {
+	std::string	controllers;
+	std::string	probe;
+
+	if ( this->path.empty() == true ) {
+		INFO << "jobs' cgroups: disabled";
+		return false;
+	}
+
+	if ( this->read_file(this->path + "/cgroup.controllers", controllers) == false ) {
+		WARN << "jobs' cgroups: " << this->path << " is not a cgroup v2 directory (" << strerror(errno) << "), the jobs are neither limited nor measured by cgroup";
+		return false;
+	}
+
+	this->cpu	= this->enable(controllers, "cpu");
+	this->memory	= this->enable(controllers, "memory");
+	this->io	= this->enable(controllers, "io");
+
+	// The leaves are created by the scheduler: it needs the rights
+	probe = this->path + "/ows-probe." + boost::lexical_cast<std::string>(getpid());
+
+	if ( mkdir(probe.c_str(), 0755) != 0 ) {
+		WARN << "jobs' cgroups: cannot create a leaf in " << this->path << " (" << strerror(errno) << "), the jobs are neither limited nor measured by cgroup";
+		return false;
+	}
+
+	rmdir(probe.c_str());
+
+	INFO << "jobs' cgroups: " << this->path << ", controllers:" << ( this->cpu == true ? " cpu" : "" ) << ( this->memory == true ? " memory" : "" ) << ( this->io == true ? " io" : "" ) << ", " << this->cpu_per_weight << " CPU percents and " << this->memory_per_weight << " bytes per unit of weight";
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Job_Cgroups::enable(const std::string& controllers, const char* name) {
+	std::istringstream	stream(controllers);
+	std::string		controller;
+	bool			available = false;
+
+	while ( stream >> controller ) {
+		if ( controller.compare(name) == 0 )
+			available = true;
+	}
+
+	if ( available == false ) {
+		WARN << "jobs' cgroups: the " << name << " controller is not available in " << this->path;
+		return false;
+	}
+
+	// The scheduler itself must not run in the directory
+	if ( this->write_file(this->path + "/cgroup.subtree_control", std::string("+") + name) == false ) {
+		WARN << "jobs' cgroups: cannot enable the " << name << " controller in " << this->path << ": " << strerror(errno);
+		return false;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Job_Cgroups::read_file(const std::string& file, std::string& _return) {
+	char	buffer[4096];
+	ssize_t	length;
+	int	fd;
+
+	_return.clear();
+
+	if ( ( fd = open(file.c_str(), O_RDONLY | O_CLOEXEC) ) < 0 )
+		return false;
+
+	while ( ( length = read(fd, buffer, sizeof(buffer)) ) > 0 )
+		_return.append(buffer, length);
+
+	close(fd);
+
+	return length == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Job_Cgroups::write_file(const std::string& file, const std::string& value) {
+	ssize_t	length;
+	int	fd;
+	int	error;
+
+	if ( ( fd = open(file.c_str(), O_WRONLY | O_CLOEXEC) ) < 0 )
+		return false;
+
+	length	= write(fd, value.c_str(), value.length());
+	error	= errno;
+
+	close(fd);
+
+	errno = error;
+
+	return length == static_cast<ssize_t>(value.length());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Job_Cgroups::read_key(const std::string& content, const std::string& key, int64_t& _return) {
+	std::istringstream	stream(content);
+	std::string		token;
+	bool			found = false;
+	int64_t			value;
+
+	_return = 0;
+
+	while ( stream >> token ) {
+		// Flat keyed files: "key value"
+		if ( token.compare(key) == 0 ) {
+			if ( stream >> token and build_integer_from_string(token.c_str(), token.length(), value) == true ) {
+				_return	+= value;
+				found	= true;
+			}
+			continue;
+		}
+
+		// Nested keyed files: "device key=value ..."
+		if ( token.compare(0, key.length() + 1, key + "=") == 0 and build_integer_from_string(token.c_str() + key.length() + 1, token.length() - key.length() - 1, value) == true ) {
+			_return	+= value;
+			found	= true;
+		}
+	}
+
+	return found;
+}
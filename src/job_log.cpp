@@ -0,0 +1,401 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: job_log.cpp
+ * Description: writes the jobs' outputs into size-capped and rotated files.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "job_log.h"
+
+/*
+ * find_last_sequence
+ *
+ * Looks for the last rotated file of a log left by a previous run
+ *
+ * @param	path	the log's path
+ *
+ * @return	the highest <path>.<sequence>[.gz] found, 0 if none
+ */
+static	uint64_t	find_last_sequence(const std::string& path) {
+	std::string::size_type	slash		= path.rfind('/');
+	std::string		directory	= path.substr(0, slash);
+	std::string		prefix		= path.substr(slash + 1) + ".";
+	DIR*			dir;
+	struct dirent*		entry;
+	uint64_t		last = 0;
+	uint64_t		sequence;
+	char*			end;
+
+	if ( ( dir = opendir(directory.c_str()) ) == NULL )
+		return 0;
+
+	while ( ( entry = readdir(dir) ) != NULL ) {
+		if ( strncmp(entry->d_name, prefix.c_str(), prefix.length()) != 0 )
+			continue;
+
+		sequence = strtoull(entry->d_name + prefix.length(), &end, 10);
+
+		if ( end != entry->d_name + prefix.length() and sequence > last )
+			last = sequence;
+	}
+
+	closedir(dir);
+
+	return last;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Job_Log::Job_Log(Job_Logs* l, const std::string& p) {
+	struct stat	status;
+
+	this->logs		= l;
+	this->path		= p;
+	this->size		= 0;
+	this->sequence		= 1;
+	this->stdout_bytes	= 0;
+	this->stderr_bytes	= 0;
+
+	this->fd = ::open(this->path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0640);
+
+	if ( this->fd < 0 ) {
+		ERROR << "cannot open the job's log " << this->path << ": " << strerror(errno);
+		return;
+	}
+
+	// A job run again goes on with its previous rotations
+	if ( fstat(this->fd, &status) == 0 and status.st_size > 0 ) {
+		this->size	= status.st_size;
+		this->sequence	= find_last_sequence(this->path) + 1;
+	}
+}
+
+Job_Log::~Job_Log() {
+	if ( this->fd >= 0 )
+		close(this->fd);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job_Log::write(const e_job_log_stream stream, const char* data, const size_t length) {
+	size_t	written = 0;
+	ssize_t	result;
+
+	if ( stream == JOB_STDOUT )
+		this->stdout_bytes += length;
+	else
+		this->stderr_bytes += length;
+
+	if ( this->size > 0 and this->size + static_cast<int64_t>(length) > this->logs->get_max_size() )
+		this->rotate();
+
+	if ( this->fd < 0 ) {
+		this->logs->add_lost(length);
+		return;
+	}
+
+	while ( written < length ) {
+		result = ::write(this->fd, data + written, length - written);
+
+		if ( result < 0 and errno == EINTR )
+			continue;
+
+		// The job goes on, its output is lost
+		if ( result < 0 ) {
+			ERROR << "cannot write the job's log " << this->path << ": " << strerror(errno);
+			close(this->fd);
+			this->fd = -1;
+			this->logs->add_lost(length - written);
+			break;
+		}
+
+		written += result;
+	}
+
+	this->size += written;
+	this->logs->add_written(written);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int64_t	Job_Log::get_stdout_bytes() const {
+	return this->stdout_bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int64_t	Job_Log::get_stderr_bytes() const {
+	return this->stderr_bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job_Log::rotate() {
+	std::string	rotated;
+	std::string	expired;
+	uint64_t	rotations = this->logs->get_rotations();
+
+	if ( this->fd >= 0 )
+		close(this->fd);
+
+	this->size = 0;
+
+	if ( rotations == 0 ) {
+		this->fd = ::open(this->path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0640);
+	} else {
+		rotated = this->path + "." + boost::lexical_cast<std::string>(this->sequence);
+
+		if ( this->sequence > rotations )
+			expired = this->path + "." + boost::lexical_cast<std::string>(this->sequence - rotations);
+
+		if ( rename(this->path.c_str(), rotated.c_str()) != 0 ) {
+			ERROR << "cannot rotate the job's log " << this->path << ": " << strerror(errno);
+			rotated.clear();
+		}
+
+		this->sequence++;
+		this->logs->archive(rotated, expired);
+
+		this->fd = ::open(this->path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0640);
+	}
+
+	if ( this->fd < 0 )
+		ERROR << "cannot open the job's log " << this->path << ": " << strerror(errno);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Job_Logs::Job_Logs(Config* c) {
+	std::string*	value;
+
+	if ( c == NULL ) {
+		rpc::ex_processing e;
+		e.msg = "Job_Logs: the configuration cannot be NULL";
+		throw e;
+	}
+
+	if ( ( value = c->get_param("job_logs_path") ) != NULL )
+		this->path = *value;
+	else if ( ( value = c->get_param("tmp_path") ) != NULL )
+		this->path = *value + "/jobs";
+	else
+		this->path = "/tmp/jobs";
+
+	value = c->get_param("job_log_compress");
+
+	this->max_size	= c->get_integer_param("job_log_max_size", 10485760);
+	this->rotations	= c->get_integer_param("job_log_rotations", 3);
+	this->compress	= value != NULL and value->compare("yes") == 0;
+	this->stopping	= false;
+
+	if ( mkdir(this->path.c_str(), 0750) != 0 and errno != EEXIST )
+		ERROR << "cannot create the jobs' logs directory " << this->path << ": " << strerror(errno);
+
+	INFO << "jobs' logs: " << this->path << ", " << this->max_size << " bytes per file, " << this->rotations << " rotations" << ( this->compress == true ? ", compressed" : "" );
+
+	this->thread = new boost::thread(boost::bind(&Job_Logs::archiver, this));
+}
+
+Job_Logs::~Job_Logs() {
+	job_logs_metrics	metrics;
+
+	this->mutex.lock();
+	this->stopping = true;
+	this->mutex.unlock();
+	this->queued.notify_one();
+
+	this->thread->join();
+	delete this->thread;
+
+	this->get_metrics(metrics);
+
+	INFO << "jobs' logs: " << metrics.opened << " opened, " << metrics.written_bytes << " bytes written, " << metrics.lost_bytes << " bytes lost, " << metrics.rotated << " rotations, " << metrics.compressed << " files compressed";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Job_Log*	Job_Logs::open(const std::string& planning_name, const std::string& job_name) {
+	std::string	directory	= this->path + "/" + planning_name;
+	Job_Log*	log;
+
+	// The output is not logged rather than written out of the directory
+	if ( is_file_name(planning_name) == false or is_file_name(job_name) == false ) {
+		ERROR << "cannot log the job " << job_name << " of " << planning_name << ": unusable file name";
+		return NULL;
+	}
+
+	if ( mkdir(directory.c_str(), 0750) != 0 and errno != EEXIST )
+		ERROR << "cannot create the planning's logs directory " << directory << ": " << strerror(errno);
+
+	log = new Job_Log(this, directory + "/" + job_name + ".log");
+
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	this->counters.opened++;
+
+	return log;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job_Logs::archive(const std::string& rotated, const std::string& expired) {
+	job_log_task	task;
+
+	this->mutex.lock();
+
+	this->counters.rotated++;
+
+	if ( ( this->compress == true and rotated.empty() == false ) or expired.empty() == false ) {
+		task.rotated	= this->compress == true ? rotated : "";
+		task.expired	= expired;
+		this->tasks.push_back(task);
+	}
+
+	this->mutex.unlock();
+	this->queued.notify_one();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job_Logs::add_written(const uint64_t bytes) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	this->counters.written_bytes += bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job_Logs::add_lost(const uint64_t bytes) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	this->counters.lost_bytes += bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int64_t	Job_Logs::get_max_size() const {
+	return this->max_size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+uint64_t	Job_Logs::get_rotations() const {
+	return this->rotations;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job_Logs::get_metrics(job_logs_metrics& _return) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	_return = this->counters;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Job_Logs::archiver() {
+	boost::unique_lock<boost::mutex>	lock(this->mutex);
+	job_log_task				task;
+
+	while ( true ) {
+		// The queued files are archived before leaving
+		while ( this->tasks.empty() == true and this->stopping == false )
+			this->queued.wait(lock);
+
+		if ( this->tasks.empty() == true )
+			return;
+
+		task = this->tasks.front();
+		this->tasks.pop_front();
+
+		lock.unlock();
+
+		if ( task.rotated.empty() == false and this->gzip(task.rotated) == true ) {
+			this->mutex.lock();
+			this->counters.compressed++;
+			this->mutex.unlock();
+		}
+
+		if ( task.expired.empty() == false ) {
+			if ( unlink(task.expired.c_str()) != 0 and errno != ENOENT )
+				ERROR << "cannot remove the job's log " << task.expired << ": " << strerror(errno);
+			if ( unlink((task.expired + ".gz").c_str()) != 0 and errno != ENOENT )
+				ERROR << "cannot remove the job's log " << task.expired << ".gz: " << strerror(errno);
+		}
+
+		lock.lock();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Job_Logs::gzip(const std::string& file) {
+	std::string	target = file + ".gz";
+	char		buffer[JOB_LOG_COMPRESS_BUFFER];
+	ssize_t		length;
+	gzFile		output;
+	int		input;
+	int		fd;
+	bool		result = true;
+
+	if ( ( input = ::open(file.c_str(), O_RDONLY | O_CLOEXEC) ) < 0 ) {
+		ERROR << "cannot open the job's log " << file << ": " << strerror(errno);
+		return false;
+	}
+
+	// The compressed file keeps the rights of the logs
+	if ( ( fd = ::open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640) ) < 0 or ( output = gzdopen(fd, "wb") ) == NULL ) {
+		ERROR << "cannot create the job's log " << target;
+		if ( fd >= 0 )
+			close(fd);
+		close(input);
+		return false;
+	}
+
+	while ( ( length = read(input, buffer, sizeof(buffer)) ) != 0 ) {
+		if ( length < 0 and errno == EINTR )
+			continue;
+
+		if ( length < 0 or gzwrite(output, buffer, length) != length ) {
+			ERROR << "cannot compress the job's log " << file;
+			result = false;
+			break;
+		}
+	}
+
+	close(input);
+
+	if ( gzclose(output) != Z_OK )
+		result = false;
+
+	// The plain file is kept until its copy is complete
+	if ( result == false ) {
+		unlink(target.c_str());
+		return false;
+	}
+
+	if ( unlink(file.c_str()) != 0 )
+		ERROR << "cannot remove the job's log " << file << ": " << strerror(errno);
+
+	return true;
+}
@@ -45,6 +45,7 @@
 #include "day.h"
 //#include "job.h"
 #include "domain.h"
+#include "executor.h"
 //#include "node.h"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -172,16 +173,24 @@ int	main (int argc, char * const argv[]) {
 		/*
 		 * Domain routine
 		 *
-		 * - Check for ready jobs every minute:
+		 * - Check for ready jobs when the domain signals an event (a job's
+		 *   state, a planning's change, a time window) or every
+		 *   scheduler_safety_poll seconds:
 		 *	- PASSIVE: for the whole nodes
 		 *	- ACTIVE/P2P: for the local node only
 		 * - Check if we need to initialize the next planning (buffer == 1 minute)
+		 * - Hand the local jobs to the executor, the ready jobs wait in the
+		 *   domain while its queue is full
 		 */
-		boost::thread_group	running_jobs;
+		Executor		executor(&domain, &conf_params);
+		time_t			safety_poll = conf_params.get_integer_param("scheduler_safety_poll", 60);
+		time_t			switch_retry = 0;
 
 		while (1) {
-			v_jobs	jobs;
-			time_t	now = time(NULL);
+			v_jobs			jobs;
+			time_t			now = time(NULL);
+			time_t			deadline;
+			executor_metrics	metrics;
 
 			try {
 				DEBUG << "planning start time: "
@@ -189,15 +198,22 @@ int	main (int argc, char * const argv[]) {
 					  << " (" << build_human_readable_time(domain.get_planning_start_time()) << ")";
 				DEBUG << "now: " << now << " (" << build_human_readable_time(now) << ")";
 
-				if ( domain.get_planning_start_time() <= now ) {
+				if ( domain.get_planning_start_time() <= now and executor.is_full() == true ) {
+					DEBUG << "the executor is full, the ready jobs are left in the domain";
+					domain.advance_windows(now);
+				} else if ( domain.get_planning_start_time() <= now ) {
 					if ( conf_params.get_running_mode() == PASSIVE )
 						domain.get_ready_jobs(jobs, NULL);
 					else
 						domain.get_ready_jobs(jobs, conf_params.get_param("node_name")->c_str());
 				}
 
-				if ( domain.get_next_planning_start_time() - now <= 60 ) {
-					domain.switch_planning();
+				// The next planning is switched to once, a failed switch waits for the next safety poll
+				if ( domain.get_next_planning_start_time() - now <= 60 and domain.get_planning_start_time() < domain.get_next_planning_start_time() and now >= switch_retry ) {
+					if ( domain.switch_planning() == false ) {
+						ERROR << "cannot switch to the next planning, retrying in " << safety_poll << " seconds";
+						switch_retry = now + safety_poll;
+					}
 				}
 
 			} catch ( const rpc::ex_job& e ) {
@@ -205,12 +221,28 @@ int	main (int argc, char * const argv[]) {
 			}
 
 			if ( domain.get_planning_start_time() <= now ) {
-				INFO << "planning " << domain.get_current_planning_name() << " - ready jobs: " << jobs.size();
+				executor.get_metrics(metrics);
+				INFO << "planning " << domain.get_current_planning_name() << " - ready jobs: " << jobs.size() << " - executor: " << metrics.running << " running, " << metrics.queue_depth << " pending";
 				if ( jobs.size() > 0 )
 					for ( unsigned long iter = 0 ; iter < jobs.size() ; ++iter ) {
 						if ( jobs[iter].get_state() == rpc::e_job_state::WAITING ) {
 							if ( jobs[iter].get_node_name2().compare(conf_params.get_param("node_name")->c_str()) == 0 ) {
-								running_jobs.create_thread(boost::bind(&Job::run, jobs[iter]));
+								// Backpressure: the next jobs stay waiting until a launch is admitted
+								if ( executor.is_full() == true ) {
+									NOTICE << "the executor is full, " << jobs.size() - iter << " jobs left for the next poll";
+									break;
+								}
+
+								// The next poll must not see it waiting
+								if ( jobs[iter].update_state(rpc::e_job_state::RUNNING) == false ) {
+									ERROR << "cannot update " << jobs[iter].get_name() << "'s state to RUNNING";
+									continue;
+								}
+
+								if ( executor.submit(jobs[iter]) == false ) {
+									ERROR << "the executor rejected " << jobs[iter].get_name();
+									jobs[iter].update_state(rpc::e_job_state::WAITING);
+								}
 							} else {
 								NOTICE << jobs[iter].get_name() << " is not a local job";
 								if ( conf_params.get_running_mode() == PASSIVE )
@@ -224,10 +256,27 @@ int	main (int argc, char * const argv[]) {
 			}
 			// This prevents the previous jobs to be run again
 			jobs.clear();
-			sleep(60);
+
+			/*
+			 * Sleep until an event or the next deadline:
+			 * - the safety poll
+			 * - the planning's start
+			 * - the next planning's initialization or its retry
+			 */
+			deadline = now + safety_poll;
+
+			if ( domain.get_planning_start_time() > now and domain.get_planning_start_time() < deadline )
+				deadline = domain.get_planning_start_time();
+
+			if ( domain.get_planning_start_time() < domain.get_next_planning_start_time() and domain.get_next_planning_start_time() - 60 < deadline and switch_retry <= now )
+				deadline = domain.get_next_planning_start_time() - 60;
+
+			if ( switch_retry > now and switch_retry < deadline )
+				deadline = switch_retry;
+
+			domain.wait_for_events(deadline);
 		}
 
-		running_jobs.join_all();
 		server_thread.join();
 
 	} catch ( const rpc::ex_processing& e ) {
@@ -0,0 +1,695 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: memory_database.cpp
+ * Description: the storage keeping the plannings in hash tables.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "memory_database.h"
+
+/*
+ * apply_usage_counter
+ *
+ * Stores a job's usage counter like the SQL engines: -1 means NULL
+ *
+ * @param	field	the job's field
+ * @param	isset	the field's flag
+ * @param	value	the counter
+ */
+static	void	apply_usage_counter(int64_t& field, bool& isset, const int64_t value) {
+	field	= value < 0 ? 0 : value;
+	isset	= value >= 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Memory_Database::Memory_Database(Name_Table* jobs, Name_Table* nodes) : Database(jobs, nodes) {
+	if ( jobs == NULL or nodes == NULL ) {
+		rpc::ex_processing e;
+		e.msg = "The name tables are null";
+		throw e;
+	}
+
+	this->operations_count = 0;
+}
+
+Memory_Database::~Memory_Database() {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::init_planning(const std::string& planning_name, const std::string&) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	// The tables are created on demand, there is no skeleton to load
+	this->plannings[planning_name];
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::planning_exists(const std::string& planning_name) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	return this->plannings.find(planning_name) != this->plannings.end();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::clone_planning(const std::string& source, const std::string& target) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	const memory_planning&		source_planning = this->get_planning(source.c_str());
+	memory_planning&		p = this->plannings[target];
+
+	p = source_planning;
+
+	BOOST_FOREACH(m_memory_jobs::value_type& j, p.jobs) {
+		j.second.state		= rpc::e_job_state::WAITING;
+		j.second.start_time	= 0;
+		j.second.stop_time	= 0;
+		j.second.__isset.stdout_bytes	= false;
+		j.second.__isset.stderr_bytes	= false;
+		j.second.__isset.cpu_usage	= false;
+		j.second.__isset.memory_peak	= false;
+		j.second.__isset.io_read_bytes	= false;
+		j.second.__isset.io_write_bytes	= false;
+		j.second.__isset.failure	= false;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::get_planning_names(std::vector<std::string>& _return) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	BOOST_FOREACH(const m_memory_plannings::value_type& p, this->plannings) {
+		_return.push_back(p.first);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::load_names(const char* planning_name) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+
+	// The names are interned when they are stored: this only checks them
+	BOOST_FOREACH(const m_memory_nodes::value_type& n, p.nodes) {
+		this->node_names->intern(n.first);
+	}
+
+	BOOST_FOREACH(const m_memory_jobs::value_type& j, p.jobs) {
+		this->job_names->intern(j.first);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::add_node(const char* planning_name, const std::string& node_name, const rpc::integer weight) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+
+	if ( p.nodes.find(node_name) != p.nodes.end() )
+		return true;
+
+	this->node_names->intern(node_name);
+
+	rpc::t_node&	node = p.nodes[node_name];
+
+	node.name	= node_name;
+	node.weight	= weight;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::remove_node(const char* planning_name, const std::string& node_name) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+
+	p.nodes.erase(node_name);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::add_job(const char* planning_name, const rpc::t_job& j) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+
+	if ( p.nodes.find(j.node_name) == p.nodes.end() ) {
+		rpc::ex_node e;
+		e.msg = "The node ";
+		e.msg += j.node_name;
+		e.msg += " does not exist";
+		throw e;
+	}
+
+	if ( p.jobs.find(j.name) != p.jobs.end() ) {
+		rpc::ex_processing e;
+		e.msg = "The job ";
+		e.msg += j.name;
+		e.msg += " already exists";
+		throw e;
+	}
+
+	this->store_job(p, j);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::update_job(const char* planning_name, const rpc::t_job& j) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+
+	// Like REPLACE INTO: the runtime values are reset
+	this->erase_job(p, j.name);
+	this->store_job(p, j);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::remove_job(const char* planning_name, const std::string& job_name) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+
+	this->erase_job(p, job_name);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::add_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+	std::set<std::string>		added;
+	bool				duplicate = false;
+
+	_return.clear();
+	_return.reserve(jobs.size());
+
+	BOOST_FOREACH(const rpc::t_job& j, jobs) {
+		if ( p.nodes.find(j.node_name) == p.nodes.end() ) {
+			_return.push_back(build_job_result(rpc::e_job_result::UNKNOWN_NODE, "The node " + j.node_name + " does not exist"));
+			continue;
+		}
+
+		if ( p.jobs.find(j.name) != p.jobs.end() or added.insert(j.name).second == false )
+			duplicate = true;
+
+		_return.push_back(build_job_result(rpc::e_job_result::DONE, ""));
+	}
+
+	// Like a failed INSERT: the whole batch is rolled back
+	if ( duplicate == true ) {
+		BOOST_FOREACH(rpc::t_job_result& r, _return) {
+			if ( r.code == rpc::e_job_result::DONE )
+				r = build_job_result(rpc::e_job_result::FAILED, "The batch adds an existing job");
+		}
+		return false;
+	}
+
+	for ( size_t i = 0 ; i < jobs.size() ; i++ ) {
+		if ( _return[i].code == rpc::e_job_result::DONE )
+			this->store_job(p, jobs[i]);
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::update_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+
+	_return.clear();
+	_return.reserve(jobs.size());
+
+	BOOST_FOREACH(const rpc::t_job& j, jobs) {
+		if ( p.jobs.find(j.name) == p.jobs.end() ) {
+			_return.push_back(build_job_result(rpc::e_job_result::UNKNOWN_JOB, "The job " + j.name + " does not exist"));
+			continue;
+		}
+
+		this->erase_job(p, j.name);
+		this->store_job(p, j);
+		_return.push_back(build_job_result(rpc::e_job_result::DONE, ""));
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::remove_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+
+	_return.clear();
+	_return.reserve(jobs.size());
+
+	BOOST_FOREACH(const rpc::t_job& j, jobs) {
+		if ( p.jobs.find(j.name) == p.jobs.end() ) {
+			_return.push_back(build_job_result(rpc::e_job_result::UNKNOWN_JOB, "The job " + j.name + " does not exist"));
+			continue;
+		}
+
+		this->erase_job(p, j.name);
+		_return.push_back(build_job_result(rpc::e_job_result::DONE, ""));
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::update_job_states(const d_job_state_updates& batch) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	m_memory_jobs::iterator		it;
+	std::string			job_name;
+
+	BOOST_FOREACH(const job_state_update& update, batch) {
+		memory_planning&	p = this->get_planning(update.domain_name.c_str());
+
+		// Like UPDATE: the unknown jobs are ignored
+		if ( this->job_names->get_name(job_name, update.job_id) == false )
+			continue;
+
+		it = p.jobs.find(job_name);
+		if ( it == p.jobs.end() )
+			continue;
+
+		it->second.state = update.state;
+
+		if ( update.has_times == true ) {
+			it->second.start_time	= update.start_time;
+			it->second.stop_time	= update.stop_time;
+		}
+
+		if ( update.has_usage == true ) {
+			apply_usage_counter(it->second.stdout_bytes, it->second.__isset.stdout_bytes, update.usage.stdout_bytes);
+			apply_usage_counter(it->second.stderr_bytes, it->second.__isset.stderr_bytes, update.usage.stderr_bytes);
+			apply_usage_counter(it->second.cpu_usage, it->second.__isset.cpu_usage, update.usage.cpu_usage);
+			apply_usage_counter(it->second.memory_peak, it->second.__isset.memory_peak, update.usage.memory_peak);
+			apply_usage_counter(it->second.io_read_bytes, it->second.__isset.io_read_bytes, update.usage.io_read_bytes);
+			apply_usage_counter(it->second.io_write_bytes, it->second.__isset.io_write_bytes, update.usage.io_write_bytes);
+
+			it->second.failure		= static_cast<rpc::e_job_failure::type>(update.usage.failure < 0 ? 0 : update.usage.failure);
+			it->second.__isset.failure	= update.usage.failure >= 0;
+		}
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::add_resource(const char* planning_name, const rpc::t_resource& r, const char* node_name) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+	rpc::v_resources&		resources = p.resources[node_name];
+
+	BOOST_FOREACH(const rpc::t_resource& i, resources) {
+		if ( i.name == r.name ) {
+			ERROR << "add_resource:: the resource " << r.name << " of " << node_name << " already exists";
+			return false;
+		}
+	}
+
+	resources.push_back(r);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::get_nodes(const char* planning_name, rpc::v_nodes& _return, const char* node_name) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+	m_memory_nodes::iterator	it;
+
+	if ( node_name != NULL ) {
+		it = p.nodes.find(node_name);
+		if ( it != p.nodes.end() )
+			_return.push_back(it->second);
+		return;
+	}
+
+	_return.reserve(_return.size() + p.nodes.size());
+
+	BOOST_FOREACH(const m_memory_nodes::value_type& n, p.nodes) {
+		_return.push_back(n.second);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::get_jobs(const char* planning_name, rpc::v_jobs& _return, const char* node_name, const char* job_name) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+	m_memory_jobs::iterator		it;
+	m_memory_index::iterator	index_it;
+
+	if ( job_name != NULL ) {
+		it = p.jobs.find(job_name);
+		if ( it != p.jobs.end() and ( node_name == NULL or it->second.node_name == node_name ) )
+			_return.push_back(it->second);
+		return;
+	}
+
+	if ( node_name == NULL ) {
+		_return.reserve(_return.size() + p.jobs.size());
+
+		BOOST_FOREACH(const m_memory_jobs::value_type& j, p.jobs) {
+			_return.push_back(j.second);
+		}
+		return;
+	}
+
+	index_it = p.node_jobs.find(node_name);
+	if ( index_it == p.node_jobs.end() )
+		return;
+
+	BOOST_FOREACH(const std::string& j, index_it->second) {
+		_return.push_back(p.jobs[j]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::get_ready_jobs(const char* planning_name, rpc::v_jobs& _return, const char* node_name) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+	m_memory_index::iterator	index_it;
+	int64_t				now = build_minute_of_day(time(NULL));
+
+	if ( node_name == NULL ) {
+		BOOST_FOREACH(const m_memory_jobs::value_type& j, p.jobs) {
+			if ( this->is_ready(p, j.second, now) == true )
+				_return.push_back(j.second);
+		}
+		return;
+	}
+
+	index_it = p.node_jobs.find(node_name);
+	if ( index_it == p.node_jobs.end() )
+		return;
+
+	BOOST_FOREACH(const std::string& j, index_it->second) {
+		const rpc::t_job&	job = p.jobs[j];
+
+		if ( this->is_ready(p, job, now) == true )
+			_return.push_back(job);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::get_jobs_links(const char* planning_name, m_jobs_links& _return, const char* node_name, const char* job_name) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+	m_memory_jobs::iterator		job_it;
+
+	BOOST_FOREACH(const m_memory_index::value_type& l, p.jobs_next) {
+		if ( job_name != NULL and l.first != job_name )
+			continue;
+
+		if ( node_name != NULL ) {
+			job_it = p.jobs.find(l.first);
+			if ( job_it == p.jobs.end() or job_it->second.node_name != node_name )
+				continue;
+		}
+
+		if ( l.second.empty() == false )
+			_return[l.first].insert(_return[l.first].end(), l.second.begin(), l.second.end());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::get_time_constraints(const char* planning_name, m_time_constraints& _return, const char* node_name, const char* job_name) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+	m_memory_jobs::iterator		job_it;
+
+	BOOST_FOREACH(const m_time_constraints::value_type& tc, p.time_constraints) {
+		if ( job_name != NULL and tc.first != job_name )
+			continue;
+
+		if ( node_name != NULL ) {
+			job_it = p.jobs.find(tc.first);
+			if ( job_it == p.jobs.end() or job_it->second.node_name != node_name )
+				continue;
+		}
+
+		_return[tc.first].insert(_return[tc.first].end(), tc.second.begin(), tc.second.end());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::get_resources(const char* planning_name, m_resources& _return, const char* node_name) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+	m_resources::iterator		it;
+
+	if ( node_name == NULL ) {
+		_return.insert(p.resources.begin(), p.resources.end());
+		return;
+	}
+
+	it = p.resources.find(node_name);
+	if ( it != p.resources.end() )
+		_return[it->first] = it->second;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::get_recovery_types(const char* planning_name, m_recovery_types& _return) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+
+	_return.insert(p.recovery_types.begin(), p.recovery_types.end());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::get_macro_jobs(const char* planning_name, rpc::v_macro_jobs& _return) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+
+	_return.insert(_return.end(), p.macro_jobs.begin(), p.macro_jobs.end());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int64_t	Memory_Database::count_jobs_in_state(const char* planning_name, const rpc::e_job_state::type state) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+	int64_t				result = 0;
+
+	BOOST_FOREACH(const m_memory_jobs::value_type& j, p.jobs) {
+		if ( j.second.state == state )
+			result++;
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int64_t	Memory_Database::count_node_jobs(const char* planning_name, const char* node_name) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+	memory_planning&		p = this->get_planning(planning_name);
+	m_memory_index::iterator	it = p.node_jobs.find(node_name);
+
+	if ( it == p.node_jobs.end() )
+		return 0;
+
+	return it->second.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::sql_exec(const char*, const std::string&) {
+	ERROR << "sql_exec:: the memory engine does not run SQL queries";
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+uint64_t	Memory_Database::get_queries_count() {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	return this->operations_count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+memory_planning&	Memory_Database::get_planning(const char* planning_name) {
+	m_memory_plannings::iterator	it;
+
+	if ( planning_name == NULL ) {
+		rpc::ex_processing e;
+		e.msg = "The planning's name is NULL";
+		throw e;
+	}
+
+	it = this->plannings.find(planning_name);
+
+	if ( it == this->plannings.end() ) {
+		rpc::ex_processing e;
+		e.msg = "The planning ";
+		e.msg += planning_name;
+		e.msg += " does not exist";
+		throw e;
+	}
+
+	this->operations_count++;
+
+	return it->second;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::unlink_job(memory_planning& p, const std::string& job_name) {
+	m_memory_index::iterator	it;
+
+	it = p.jobs_next.find(job_name);
+	if ( it != p.jobs_next.end() ) {
+		BOOST_FOREACH(const std::string& next, it->second) {
+			p.jobs_previous[next].erase(job_name);
+		}
+		p.jobs_next.erase(it);
+	}
+
+	it = p.jobs_previous.find(job_name);
+	if ( it != p.jobs_previous.end() ) {
+		BOOST_FOREACH(const std::string& previous, it->second) {
+			p.jobs_next[previous].erase(job_name);
+		}
+		p.jobs_previous.erase(it);
+	}
+
+	p.time_constraints.erase(job_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::erase_job(memory_planning& p, const std::string& job_name) {
+	m_memory_jobs::iterator	it = p.jobs.find(job_name);
+
+	if ( it != p.jobs.end() ) {
+		p.node_jobs[it->second.node_name].erase(job_name);
+		p.jobs.erase(it);
+	}
+	this->unlink_job(p, job_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::store_job(memory_planning& p, const rpc::t_job& j) {
+	rpc::t_job&	job = p.jobs[j.name];
+
+	this->job_names->intern(j.name);
+
+	job.name	= j.name;
+	job.cmd_line	= j.cmd_line;
+	job.node_name	= j.node_name;
+	job.weight	= j.weight;
+	job.state	= rpc::e_job_state::WAITING;
+
+	apply_usage_counter(job.timeout, job.__isset.timeout, j.__isset.timeout == true and j.timeout > 0 ? j.timeout : -1);
+
+	p.node_jobs[j.node_name].insert(j.name);
+
+	BOOST_FOREACH(const std::string& i, j.prv) {
+		this->link_jobs(p, i, j.name);
+	}
+
+	BOOST_FOREACH(const std::string& i, j.nxt) {
+		this->link_jobs(p, j.name, i);
+	}
+
+	if ( j.time_constraints.empty() == false ) {
+		rpc::v_time_constraints&	time_constraints = p.time_constraints[j.name];
+
+		BOOST_FOREACH(const rpc::t_time_constraint& tc, j.time_constraints) {
+			time_constraints.push_back(tc);
+			time_constraints.back().job_name = j.name;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Memory_Database::link_jobs(memory_planning& p, const std::string& previous, const std::string& next) {
+	// Like the SQL engines, a link may be added before its jobs
+	this->job_names->intern(previous);
+	this->job_names->intern(next);
+
+	p.jobs_next[previous].insert(next);
+	p.jobs_previous[next].insert(previous);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Memory_Database::is_ready(const memory_planning& p, const rpc::t_job& job, const int64_t now) {
+	m_memory_index::const_iterator		previous_it = p.jobs_previous.find(job.name);
+	m_time_constraints::const_iterator	time_constraints_it = p.time_constraints.find(job.name);
+	m_memory_jobs::const_iterator		job_it;
+	bool					result = false;
+
+	// A started or ended job is never ready, whatever its previous jobs
+	if ( job.state != rpc::e_job_state::WAITING )
+		return false;
+
+	if ( previous_it == p.jobs_previous.end() or previous_it->second.empty() == true ) {
+		result = true;
+	} else {
+		BOOST_FOREACH(const std::string& previous, previous_it->second) {
+			job_it = p.jobs.find(previous);
+
+			if ( job_it != p.jobs.end() and job_it->second.state == rpc::e_job_state::SUCCEDED ) {
+				result = true;
+				break;
+			}
+		}
+	}
+
+	if ( result == false or time_constraints_it == p.time_constraints.end() )
+		return result;
+
+	return match_time_constraints(time_constraints_it->second, now);
+}
@@ -57,6 +57,40 @@ enum	e_rectype_action {
 	STOP_SCHEDULE
 }
 
+/**
+ * e_job_failure
+ *
+ * Why a job failed
+ * - RETURN_CODE: it returned a code other than 0
+ * - SPAWN: it could not be started
+ * - TIMEOUT: it was killed after running longer than its timeout
+ */
+enum	e_job_failure {
+	RETURN_CODE,
+	SPAWN,
+	TIMEOUT
+}
+
+/**
+ * e_job_result
+ *
+ * What happened to a job given to a batch (add_jobs, update_jobs...)
+ * - DONE: it is applied
+ * - INVALID: a field is missing or wrong
+ * - UNKNOWN_NODE: its node is not in the planning
+ * - UNKNOWN_JOB: it is not in the planning
+ * - UNREACHABLE: its node cannot be reached
+ * - FAILED: the batch could not be written, nothing was applied
+ */
+enum	e_job_result {
+	DONE,
+	INVALID,
+	UNKNOWN_NODE,
+	UNKNOWN_JOB,
+	UNREACHABLE,
+	FAILED
+}
+
 /**
  * e_time_constraint_type
  */
@@ -102,6 +136,13 @@ struct	t_recovery_type {
 	2: required string		short_label,
 	3: required string		label,
 	4: required e_rectype_action	action,
+
+	/**
+	 * timeout
+	 *
+	 * The seconds its jobs may run, unset or 0 means no limit
+	 */
+	5: optional i64			timeout,
 }
 typedef list<t_recovery_type>	v_recovery_types
 
@@ -200,9 +241,77 @@ struct	t_job {
 	 * TODO: update the add / update methods
 	 */
 	13: required t_recovery_type	recovery_type,
+
+	/**
+	 * stdout_bytes
+	 *
+	 * The bytes written by the job on its standard output
+	 */
+	14: optional i64	stdout_bytes,
+
+	/**
+	 * stderr_bytes
+	 *
+	 * The bytes written by the job on its standard error
+	 */
+	15: optional i64	stderr_bytes,
+
+	/**
+	 * cpu_usage
+	 *
+	 * The CPU time used by the job in microseconds
+	 */
+	16: optional i64	cpu_usage,
+
+	/**
+	 * memory_peak
+	 *
+	 * The most memory used by the job in bytes
+	 */
+	17: optional i64	memory_peak,
+
+	/**
+	 * io_read_bytes
+	 *
+	 * The bytes read by the job from the storage
+	 */
+	18: optional i64	io_read_bytes,
+
+	/**
+	 * io_write_bytes
+	 *
+	 * The bytes written by the job to the storage
+	 */
+	19: optional i64	io_write_bytes,
+
+	/**
+	 * timeout
+	 *
+	 * The seconds the job may run before being killed, unset or 0 means
+	 * the timeout of its recovery type
+	 */
+	20: optional i64	timeout,
+
+	/**
+	 * failure
+	 *
+	 * Why the job failed, unset if it did not
+	 */
+	21: optional e_job_failure	failure,
 }
 typedef list<t_job>		v_jobs
 
+/**
+ * t_job_result
+ *
+ * The result of a job given to a batch, msg explains the failures
+ */
+struct	t_job_result {
+	1: required e_job_result	code,
+	2: optional string		msg,
+}
+typedef list<t_job_result>	v_job_results
+
 /**
  * t_node
  */
@@ -503,6 +612,47 @@ service ows_rpc {
 			3:ex_processing p
 	);
 
+	/**
+	 * Jobs batches
+	 *
+	 * The jobs are applied by their nodes, the jobs of a node in a single
+	 * transaction. The jobs hosted by other nodes are forwarded in one
+	 * call per gateway.
+	 *
+	 * @return	a result per job, in the given order
+	 */
+	v_job_results	add_jobs(
+			1: required t_routing_data	routing,
+			2: required v_jobs	jobs,
+	) throws (
+			1:ex_routing	r,
+			2:ex_processing p
+	);
+
+	v_job_results	update_jobs(
+			1: required t_routing_data	routing,
+			2: required v_jobs	jobs,
+	) throws (
+			1:ex_routing	r,
+			2:ex_processing p
+	);
+
+	v_job_results	remove_jobs(
+			1: required t_routing_data	routing,
+			2: required v_jobs	jobs,
+	) throws (
+			1:ex_routing	r,
+			2:ex_processing p
+	);
+
+	v_job_results	update_job_states(
+			1: required t_routing_data	routing,
+			2: required v_jobs	jobs,
+	) throws (
+			1:ex_routing	r,
+			2:ex_processing p
+	);
+
 	/**
 	 * SQL
 	 */
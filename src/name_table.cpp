@@ -0,0 +1,100 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: name_table.cpp
+ * Description: interns the jobs' and the nodes' names into integer ids.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "name_table.h"
+
+Name_Table::Name_Table() {
+	// The ids start at 1
+	this->names.push_back(std::string());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int	Name_Table::intern(const std::string& name) {
+	boost::lock_guard<boost::mutex>			lock(this->mutex);
+	boost::unordered_map<std::string, int>::iterator	it = this->ids.find(name);
+
+	if ( it != this->ids.end() )
+		return it->second;
+
+	this->names.push_back(name);
+	this->ids[name] = this->names.size() - 1;
+
+	return this->names.size() - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int	Name_Table::find(const std::string& name) {
+	boost::lock_guard<boost::mutex>			lock(this->mutex);
+	boost::unordered_map<std::string, int>::iterator	it = this->ids.find(name);
+
+	if ( it == this->ids.end() )
+		return 0;
+
+	return it->second;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Name_Table::get_name(std::string& _return, const int id) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	if ( id <= 0 or static_cast<size_t>(id) >= this->names.size() or this->names[id].empty() == true )
+		return false;
+
+	_return = this->names[id];
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Name_Table::insert(const int id, const std::string& name) {
+	boost::lock_guard<boost::mutex>			lock(this->mutex);
+	boost::unordered_map<std::string, int>::iterator	it;
+
+	if ( id <= 0 )
+		return;
+
+	if ( static_cast<size_t>(id) >= this->names.size() )
+		this->names.resize(id + 1);
+
+	this->names[id] = name;
+
+	it = this->ids.find(name);
+	if ( it == this->ids.end() or it->second < id )
+		this->ids[name] = id;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t	Name_Table::size() {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	return this->names.size() - 1;
+}
@@ -29,11 +29,13 @@
 
 Router::Router(Config* c) {
 	this->config		= c;
-	this->rpc_client	= new Rpc_Client();
+	this->clients		= new Rpc_Clients(c);
+	this->rpc_client	= new Rpc_Client(this->clients);
 }
 
 Router::~Router() {
 	delete this->rpc_client;
+	delete this->clients;
 	this->config = NULL;
 }
 
@@ -48,7 +50,7 @@ bool	Router::get_node(rpc::t_node& node, const rpc::t_routing_data& routing) {
     routing.target_node.domain_name = domain_name;
 
 	try {
-		this->rpc_client->open(this->get_gateway(*this->get_master_node())->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+		this->rpc_client->open(this->get_gateway(*this->get_master_node())->c_str());
         this->rpc_client->get_handler()->get_node(routing, node);
 	} catch (std::exception& e) {
 		std::cerr << "Cannot get the planning: " << e.what() << std::endl;
@@ -96,8 +98,9 @@ bool	Router::update_peers_list() {
 
 			if ( position != 0 ) {
 				try {
-					this->rpc_client->open(peer.name.c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+					this->rpc_client->open(peer.name.c_str());
 					this->rpc_client->get_handler()->hello(hello_result, peer);
+					this->rpc_client->close();
 				} catch (std::exception& e) {
 					this->hosts_keys.erase(peer.name);
 				}
@@ -143,6 +146,7 @@ bool	Router::update_routing_table() {
 bool	Router::insert_route(const std::string& destination, const std::string& gateway, const u_int& weight) {
 	m_routing_table::iterator	iter_t;
 	m_weighted_gateway*		mm_g;
+	boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
 
 	iter_t = this->routing_table.find(destination);
 
@@ -165,6 +169,7 @@ bool	Router::delete_route(const std::string* destination, const std::string* gat
 	m_routing_table::iterator	iter_t;
 	m_weighted_gateway::iterator	iter_g;
 	m_weighted_gateway*		mm_g;
+	boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
 
 	if ( this->routing_table.empty() == true )
 		return false;
@@ -194,6 +199,7 @@ bool	Router::delete_route(const std::string* destination, const std::string* gat
 p_weighted_gateway*	Router::get_route(const std::string& destination) {
 	m_routing_table::iterator		iter_dst;
 	m_weighted_gateway::const_iterator	iter_gtw;
+	boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
 
 	iter_dst = this->routing_table.find(destination);
 
@@ -223,23 +229,25 @@ std::string*	Router::get_gateway(const std::string* destination) {
 */
 ///////////////////////////////////////////////////////////////////////////////
 
-std::string*	Router::get_gateway(const std::string& destination) {
+std::string	Router::get_gateway(const std::string& destination) {
 	m_weighted_gateway::const_iterator	iter_gtw;
 	m_routing_table::iterator		iter_dst;
+	boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
 
 	iter_dst = this->routing_table.find(destination);
 
+	// A copy: the table may change once the lock is released
 	if ( iter_dst != this->routing_table.end() ) {
 		iter_gtw = iter_dst->second.begin();
-		return &(iter_gtw->second);
+		return iter_gtw->second;
 	}
 
-	return NULL;
+	return "";
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-std::string*	Router::get_gateway(const char* destination) {
+std::string	Router::get_gateway(const char* destination) {
 	std::string	buffer(destination);
 	return this->get_gateway(buffer);
 }
@@ -247,7 +255,7 @@ std::string*	Router::get_gateway(const char* destination) {
 ///////////////////////////////////////////////////////////////////////////////
 
 bool	Router::reach_master() {
-	if ( this->master_node.empty() == false )
+	if ( this->get_master_node().empty() == false )
 		return true;
 
 	// Call reach_master against the direct peers
@@ -263,8 +271,9 @@ bool	Router::reach_master() {
 bool	Router::reach_master(const char* target) {
 	rpc::t_route	result;
 
-	this->rpc_client->open(target, boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+	this->rpc_client->open(target);
 	this->rpc_client->get_handler()->reach_master(result);
+	this->rpc_client->close();
 
 	// We may have found the master, so update the routing table
 	if ( result.destination_node.name.empty() == false and result.hops >= 0 ) {
@@ -282,6 +291,8 @@ bool	Router::set_master_node(const char* node) {
 	if ( node == NULL )
 		return false;
 
+	boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
+
 	if ( this->master_node.empty() == false )
 		return false;
 	else
@@ -292,8 +303,10 @@ bool	Router::set_master_node(const char* node) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-std::string*	Router::get_master_node() {
-	return	&(this->master_node);
+std::string	Router::get_master_node() {
+	boost::lock_guard<boost::mutex>	lock(this->updates_mutex);
+
+	return	this->master_node;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -303,3 +316,9 @@ u_int	Router::get_reachable_peers_number() {
 }
 
 ///////////////////////////////////////////////////////////////////////////////
+
+Rpc_Clients*	Router::get_clients() {
+	return this->clients;
+}
+
+///////////////////////////////////////////////////////////////////////////////
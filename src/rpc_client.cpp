@@ -27,61 +27,366 @@
 
 #include "rpc_client.h"
 
-Rpc_Client::Rpc_Client() {
+Rpc_Clients::Rpc_Clients(Config* c) {
+	std::string*	mode;
+	std::string*	protocol;
+
+	if ( c == NULL ) {
+		rpc::ex_processing e;
+		e.msg = "Rpc_Clients: the configuration cannot be NULL";
+		throw e;
+	}
+
+	mode		= c->get_param("rpc_server_mode");
+	protocol	= c->get_param("rpc_protocol");
+
+	// The transport must match the peers': a mismatch is not detected
+	this->port		= c->get_integer_param("bind_port", 8080);
+	this->framed		= mode != NULL and mode->compare("simple") != 0;
+	this->compact		= protocol != NULL and protocol->compare("compact") == 0;
+	this->pool_size		= c->get_integer_param("rpc_client_pool_size", 8);
+	this->idle_timeout	= c->get_integer_param("rpc_client_idle_timeout", 60);
+	this->connect_timeout	= c->get_integer_param("rpc_client_connect_timeout", 5) * 1000;
+	this->call_timeout	= c->get_integer_param("rpc_client_call_timeout", 60) * 1000;
+	this->wait_timeout	= c->get_integer_param("rpc_client_wait_timeout", 30) * 1000;
+}
+
+Rpc_Clients::~Rpc_Clients() {
 #ifdef USE_THRIFT
-	this->handler	= NULL;
+	m_rpc_clients_metrics	metrics;
+
+	BOOST_FOREACH(m_rpc_gateway_pools::value_type& pool, this->pools) {
+		BOOST_FOREACH(rpc_connection* c, pool.second.idle) {
+			this->disconnect(c);
+		}
+		pool.second.idle.clear();
+	}
+
+	this->get_metrics(metrics);
+
+	BOOST_FOREACH(const m_rpc_clients_metrics::value_type& m, metrics) {
+		INFO << "RPC clients to " << m.first << ": " << m.second.opened << " connections opened (" << m.second.reconnected << " reconnections, " << m.second.failures << " failures), " << m.second.reused << " calls on a kept connection, " << m.second.broken << " broken, " << m.second.evicted << " evicted, " << m.second.waits << " waits for a free connection (" << m.second.timeouts << " timed out), " << m.second.fallbacks << " fallbacks to the binary protocol";
+	}
 #endif // USE_THRIFT
 }
 
-Rpc_Client::~Rpc_Client() {
 #ifdef USE_THRIFT
-	if ( this->handler != NULL ) {
-		delete this->handler;
-		this->handler = NULL;
-		if ( this->transport != NULL )
-			this->transport->close();
 
+///////////////////////////////////////////////////////////////////////////////
+
+rpc_connection*	Rpc_Clients::acquire(const std::string& gateway) {
+	boost::unique_lock<boost::mutex>	lock(this->mutex);
+	rpc_gateway_pool&			pool		= this->pools[gateway];
+	rpc_connection*				c		= NULL;
+	bool					reconnected	= false;
+	std::vector<rpc_connection*>		expired;
+	boost::system_time			deadline	= boost::get_system_time() + boost::posix_time::milliseconds(this->wait_timeout);
+
+	this->evict(time(NULL), expired);
+
+	while ( true ) {
+		if ( pool.idle.empty() == false ) {
+			c = pool.idle.front();
+			pool.idle.pop_front();
+			break;
+		}
+
+		// Room for a new connection
+		if ( pool.opened < this->pool_size ) {
+			pool.opened++;
+			break;
+		}
+
+		pool.counters.waits++;
+
+		// A gateway holding every connection must not block the callers forever
+		if ( this->released.timed_wait(lock, deadline) == false and pool.idle.empty() == true and pool.opened >= this->pool_size ) {
+			pool.counters.timeouts++;
+			lock.unlock();
+
+			BOOST_FOREACH(rpc_connection* e, expired) {
+				this->disconnect(e);
+			}
+
+			ERROR << "RPC connection to " << gateway << ": no connection released in " << this->wait_timeout << " ms";
+			throw apache::thrift::transport::TTransportException(apache::thrift::transport::TTransportException::TIMED_OUT, "no free connection to " + gateway);
+		}
 	}
-#endif //USE_THRIFT
+
+	lock.unlock();
+
+	BOOST_FOREACH(rpc_connection* e, expired) {
+		this->disconnect(e);
+	}
+
+	// The peer may have closed the kept connection
+	if ( c != NULL and this->is_alive(c) == false ) {
+		WARN << "RPC connection to " << gateway << " closed by the peer, reconnecting";
+		this->disconnect(c);
+		c		= NULL;
+		reconnected	= true;
+	}
+
+	if ( c != NULL ) {
+		lock.lock();
+		pool.counters.reused++;
+		return c;
+	}
+
+	try {
+		c = this->negotiate(pool, gateway);
+	} catch (const apache::thrift::transport::TTransportException& e) {
+		lock.lock();
+		if ( --pool.opened == 0 )
+			pool.negotiated = false;
+		pool.counters.failures++;
+		this->released.notify_all();
+		throw e;
+	}
+
+	lock.lock();
+	pool.counters.opened++;
+	if ( reconnected == true )
+		pool.counters.reconnected++;
+
+	return c;
 }
 
-#ifdef USE_THRIFT
+///////////////////////////////////////////////////////////////////////////////
 
-bool	Rpc_Client::open(const char* hostname, const int& port) {
-	boost::shared_ptr<apache::thrift::transport::TSocket>		socket(new apache::thrift::transport::TSocket(hostname, port));
-	boost::shared_ptr<apache::thrift::transport::TTransport>	transport(new apache::thrift::transport::TBufferedTransport(socket));
-	boost::shared_ptr<apache::thrift::protocol::TProtocol>		protocol(new apache::thrift::protocol::TBinaryProtocol(transport));
+void	Rpc_Clients::release(rpc_connection* c, const bool broken) {
+	boost::unique_lock<boost::mutex>	lock(this->mutex);
+	rpc_gateway_pool&			pool	= this->pools[c->gateway];
+	std::vector<rpc_connection*>		expired;
 
-	this->handler = new rpc::ows_rpcClient(protocol);
+	if ( broken == true ) {
+		if ( --pool.opened == 0 )
+			pool.negotiated = false;
+		pool.counters.broken++;
+		expired.push_back(c);
+	} else {
+		c->last_used = time(NULL);
+		pool.idle.push_front(c);
+		this->evict(c->last_used, expired);
+	}
+
+	lock.unlock();
+	this->released.notify_all();
+
+	BOOST_FOREACH(rpc_connection* e, expired) {
+		this->disconnect(e);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Rpc_Clients::get_metrics(m_rpc_clients_metrics& _return) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	_return.clear();
+
+	BOOST_FOREACH(const m_rpc_gateway_pools::value_type& pool, this->pools) {
+		_return[pool.first] = pool.second.counters;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+rpc_connection*	Rpc_Clients::connect(const std::string& gateway, const bool compact) {
+	rpc_connection*	c = new rpc_connection();
+	boost::shared_ptr<apache::thrift::protocol::TProtocol>	protocol;
+
+	c->gateway	= gateway;
+	c->socket.reset(new apache::thrift::transport::TSocket(gateway, this->port));
+	c->socket->setKeepAlive(true);
+	c->socket->setConnTimeout(this->connect_timeout);
+	c->socket->setRecvTimeout(this->call_timeout);
+	c->socket->setSendTimeout(this->call_timeout);
+
+	if ( this->framed == true )
+		c->transport.reset(new apache::thrift::transport::TFramedTransport(c->socket));
+	else
+		c->transport.reset(new apache::thrift::transport::TBufferedTransport(c->socket));
+
+	if ( compact == true )
+		protocol.reset(new apache::thrift::protocol::TCompactProtocol(c->transport));
+	else
+		protocol.reset(new apache::thrift::protocol::TBinaryProtocol(c->transport));
+
+	c->handler.reset(new rpc::ows_rpcClient(protocol));
 
 	try {
-		transport->open();
-	} catch (const apache::thrift::transport::TTransportException e) {
-		ERROR << e.what();
+		c->transport->open();
+	} catch (const apache::thrift::transport::TTransportException& e) {
+		ERROR << "cannot connect to " << gateway << ": " << e.what();
+		delete c;
+		throw e;
+	}
+
+	c->last_used = time(NULL);
+
+	return c;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+rpc_connection*	Rpc_Clients::negotiate(rpc_gateway_pool& pool, const std::string& gateway) {
+	rpc_connection*	c;
+	rpc::t_route	route;
+	bool		negotiated;
+	bool		binary;
+
+	this->mutex.lock();
+	negotiated	= pool.negotiated;
+	binary		= pool.binary;
+	this->mutex.unlock();
+
+	// Known as binary until its last connection is closed
+	if ( this->compact == false or ( negotiated == true and binary == true ) )
+		return this->connect(gateway, false);
+
+	c = this->connect(gateway, true);
+
+	if ( negotiated == true )
+		return c;
+
+	/*
+	 * Any answer, even an exception, is readable. A server which cannot
+	 * read the call sends garbage or closes the connection: a timeout or
+	 * another transport error says nothing about the protocol
+	 */
+	binary = false;
+
+	try {
+		c->handler->reach_master(route);
+	} catch (const rpc::ex_routing&) {
+	} catch (const apache::thrift::TApplicationException&) {
+	} catch (const apache::thrift::protocol::TProtocolException& e) {
+		binary = true;
+		WARN << "RPC connection to " << gateway << ": the compact protocol is rejected (" << e.what() << "), using the binary protocol";
+	} catch (const apache::thrift::transport::TTransportException& e) {
+		if ( e.getType() != apache::thrift::transport::TTransportException::END_OF_FILE ) {
+			ERROR << "RPC connection to " << gateway << ": cannot negotiate the protocol: " << e.what();
+			this->disconnect(c);
+			throw;
+		}
+
+		binary = true;
+		WARN << "RPC connection to " << gateway << ": the connection is closed on the first compact call, using the binary protocol";
+	}
+
+	if ( binary == true ) {
+		this->disconnect(c);
+		c = this->connect(gateway, false);
+	}
+
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	pool.negotiated	= true;
+	pool.binary	= binary;
+
+	if ( binary == true )
+		pool.counters.fallbacks++;
+
+	return c;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Rpc_Clients::disconnect(rpc_connection* c) {
+	try {
+		c->transport->close();
+	} catch (const apache::thrift::transport::TTransportException& e) {
+		ERROR << "cannot close the connection to " << c->gateway << ": " << e.what();
+	}
+
+	delete c;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Rpc_Clients::is_alive(const rpc_connection* c) const {
+	struct pollfd	descriptor;
+
+	if ( c->socket->isOpen() == false )
 		return false;
+
+	descriptor.fd		= c->socket->getSocketFD();
+	descriptor.events	= POLLIN;
+	descriptor.revents	= 0;
+
+	return poll(&descriptor, 1, 0) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Rpc_Clients::evict(const time_t now, std::vector<rpc_connection*>& _return) {
+	BOOST_FOREACH(m_rpc_gateway_pools::value_type& pool, this->pools) {
+		// The oldest connections are at the end
+		while ( pool.second.idle.empty() == false and now - pool.second.idle.back()->last_used > this->idle_timeout ) {
+			_return.push_back(pool.second.idle.back());
+			pool.second.idle.pop_back();
+			pool.second.counters.evicted++;
+
+			if ( --pool.second.opened == 0 )
+				pool.second.negotiated = false;
+		}
 	}
+}
+
+#endif // USE_THRIFT
+
+///////////////////////////////////////////////////////////////////////////////
+
+Rpc_Client::Rpc_Client(Rpc_Clients* c) {
+	this->clients		= c;
+#ifdef USE_THRIFT
+	this->connection	= NULL;
+#endif // USE_THRIFT
+}
+
+Rpc_Client::~Rpc_Client() {
+#ifdef USE_THRIFT
+	if ( this->connection != NULL ) {
+		this->clients->release(this->connection, true);
+		this->connection = NULL;
+	}
+#endif //USE_THRIFT
+}
+
+#ifdef USE_THRIFT
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Rpc_Client::open(const char* hostname) {
+	// The previous call did not reach close(): its connection is dropped
+	if ( this->connection != NULL ) {
+		this->clients->release(this->connection, true);
+		this->connection = NULL;
+	}
+
+	this->connection = this->clients->acquire(hostname);
 
 	return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
 rpc::ows_rpcClient*	Rpc_Client::get_handler() const {
-	return this->handler;
+	if ( this->connection == NULL )
+		return NULL;
+
+	return this->connection->handler.get();
 }
 
-//TODO: find a clean transport->close()
+///////////////////////////////////////////////////////////////////////////////
+
 bool	Rpc_Client::close() {
-	if ( this->handler != NULL ) {
-		delete this->handler;
+	if ( this->connection != NULL ) {
+		this->clients->release(this->connection);
+		this->connection = NULL;
 	}
-	this->handler = NULL;
-	/*
-	try {
-		this->transport->close();
-	} catch (const apache::thrift::transport::TTransportException e) {
-		ERROR << "Error: " << e.what();
-		return false;
-	}
-*/
+
 	return true;
 }
 
@@ -27,10 +27,46 @@
 
 #include "rpc_server.h"
 
+/*
+ * select_jobs
+ *
+ * Copies some jobs of a batch
+ *
+ * @param	jobs		the batch
+ * @param	positions	the jobs to copy
+ * @param	_return		the copies
+ */
+static	void	select_jobs(const rpc::v_jobs& jobs, const std::vector<size_t>& positions, rpc::v_jobs& _return) {
+	_return.clear();
+	_return.reserve(positions.size());
+
+	BOOST_FOREACH(size_t i, positions) {
+		_return.push_back(jobs[i]);
+	}
+}
+
+/*
+ * merge_job_results
+ *
+ * Puts the results of some jobs back at their positions in the batch
+ *
+ * @param	results		the results, in the order of positions
+ * @param	positions	the jobs' positions
+ * @param	_return		the batch's results
+ */
+static	void	merge_job_results(const rpc::v_job_results& results, const std::vector<size_t>& positions, rpc::v_job_results& _return) {
+	for ( size_t i = 0 ; i < positions.size() ; i++ ) {
+		if ( i < results.size() )
+			_return[positions[i]] = results[i];
+		else
+			_return[positions[i]] = build_job_result(rpc::e_job_result::FAILED, "the job has no result");
+	}
+}
+
 Rpc_Object::Rpc_Object(Config* c, Router* r) {
 	this->config	= c;
 	this->router	= r;
-	this->client	= new Rpc_Client();
+	this->client	= new Rpc_Client(r->get_clients());
 }
 
 Rpc_Object::~Rpc_Object() {
@@ -69,19 +105,56 @@ Rpc_Server::~Rpc_Server() {
 
 void	Rpc_Server::run() {
 	//	std::string*	address	= this->config->get_param("bind_address");
-	u_int			port	= boost::lexical_cast<u_int>(*this->config->get_param("bind_port"));
+	u_int			port		= boost::lexical_cast<u_int>(*this->config->get_param("bind_port"));
+	std::string*		mode		= this->config->get_param("rpc_server_mode");
+	std::string*		protocol	= this->config->get_param("rpc_protocol");
+	std::string		protocol_name	= ( protocol == NULL ) ? "binary" : *protocol;
+	size_t			workers		= this->config->get_integer_param("rpc_server_workers", 16);
+	size_t			max_connections	= this->config->get_integer_param("rpc_server_max_connections", 1024);
 
 #ifdef USE_THRIFT
 	try {
-		boost::shared_ptr<ows_rpcHandler>								handler(new ows_rpcHandler(this->domain, this->config, this->router));
-		boost::shared_ptr<apache::thrift::TProcessor>					processor(new rpc::ows_rpcProcessor(handler));
-		boost::shared_ptr<apache::thrift::transport::TServerTransport>	serverTransport(new apache::thrift::transport::TServerSocket(port));
-		boost::shared_ptr<apache::thrift::transport::TTransportFactory>	transportFactory(new apache::thrift::transport::TBufferedTransportFactory());
-		boost::shared_ptr<apache::thrift::protocol::TProtocolFactory>	protocolFactory(new apache::thrift::protocol::TBinaryProtocolFactory());
-
-		// TODO: use the multi-threaded version
-		apache::thrift::server::TSimpleServer server(processor, serverTransport, transportFactory, protocolFactory);
-		server.serve();
+		boost::shared_ptr<ows_rpcHandlerFactory>						handlerFactory(new ows_rpcHandlerFactory(this->domain, this->config, this->router));
+		boost::shared_ptr<apache::thrift::TProcessorFactory>			processor(new rpc::ows_rpcProcessorFactory(handlerFactory));
+		boost::shared_ptr<apache::thrift::protocol::TProtocolFactory>	protocolFactory;
+		boost::shared_ptr<apache::thrift::concurrency::ThreadManager>	threadManager;
+
+		// A compact server only answers compact clients, the compact clients fall back to a binary server
+		if ( protocol_name.compare("compact") == 0 )
+			protocolFactory.reset(new apache::thrift::protocol::TCompactProtocolFactory());
+		else
+			protocolFactory.reset(new apache::thrift::protocol::TBinaryProtocolFactory());
+
+		if ( mode == NULL or mode->compare("simple") == 0 ) {
+			boost::shared_ptr<apache::thrift::transport::TServerTransport>	serverTransport(new apache::thrift::transport::TServerSocket(port));
+			boost::shared_ptr<apache::thrift::transport::TTransportFactory>	transportFactory(new apache::thrift::transport::TBufferedTransportFactory());
+
+			INFO << "RPC server: port " << port << ", " << protocol_name << " protocol, one call at a time";
+
+			apache::thrift::server::TSimpleServer server(processor, serverTransport, transportFactory, protocolFactory);
+			server.serve();
+			return;
+		}
+
+		// The connections beyond the workers wait for a free thread
+		threadManager = apache::thrift::concurrency::ThreadManager::newSimpleThreadManager(workers, max_connections > workers ? max_connections - workers : 1);
+		threadManager->threadFactory(boost::shared_ptr<apache::thrift::concurrency::PosixThreadFactory>(new apache::thrift::concurrency::PosixThreadFactory()));
+		threadManager->start();
+
+		INFO << "RPC server: port " << port << ", " << protocol_name << " protocol, " << *mode << " mode, " << workers << " workers, " << max_connections << " connections";
+
+		if ( mode->compare("thread_pool") == 0 ) {
+			boost::shared_ptr<apache::thrift::transport::TServerTransport>	serverTransport(new apache::thrift::transport::TServerSocket(port));
+			boost::shared_ptr<apache::thrift::transport::TTransportFactory>	transportFactory(new apache::thrift::transport::TFramedTransportFactory());
+
+			apache::thrift::server::TThreadPoolServer server(processor, serverTransport, transportFactory, protocolFactory, threadManager);
+			server.serve();
+		} else {
+			// The event loop reads whole frames, the workers only run the calls
+			apache::thrift::server::TNonblockingServer server(processor, protocolFactory, port, threadManager);
+			server.setMaxConnections(max_connections);
+			server.serve();
+		}
 	} catch (std::exception const& e) {
 		ERROR << "Something failed: " << e.what();
 		throw e;
@@ -99,13 +172,29 @@ Domain*	Rpc_Server::get_domain() {
 
 #ifdef USE_THRIFT
 
+ows_rpcHandlerFactory::ows_rpcHandlerFactory(Domain* d, Config* c, Router* r) {
+	this->domain	= d;
+	this->config	= c;
+	this->router	= r;
+}
+
+rpc::ows_rpcIf*	ows_rpcHandlerFactory::getHandler(const apache::thrift::TConnectionInfo&) {
+	return new ows_rpcHandler(this->domain, this->config, this->router);
+}
+
+void	ows_rpcHandlerFactory::releaseHandler(rpc::ows_rpcIf* handler) {
+	delete handler;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 ows_rpcHandler::ows_rpcHandler(Domain* d, Config* c, Router* r) : Rpc_Object(c, r) {
 	this->domain	= d;
 }
 
 void	ows_rpcHandler::hello(rpc::t_hello& _return, const rpc::t_node& target_node) {
 	std::string*	result	= NULL;
-	std::string*	gateway;
+	std::string	gateway;
 
 	if ( target_node.name.compare(this->config->get_param("node_name")->c_str()) == 0 ) {
 		_return.name = target_node.name.c_str();
@@ -125,14 +214,14 @@ void	ows_rpcHandler::hello(rpc::t_hello& _return, const rpc::t_node& target_node
 		// Get the better gateway to reach the host
 		gateway = this->router->get_gateway(target_node.name);
 
-		if ( gateway == NULL ) {
+		if ( gateway.empty() == true ) {
 			rpc::ex_routing e;
 			e.msg = "Cannot reach target node ";
 			e.msg += target_node.name;
 			throw e;
 		} else {
 			try {
-				this->client->open(target_node.name.c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+				this->client->open(target_node.name.c_str());
 				this->client->get_handler()->hello(_return, target_node);
 				this->client->close();
 			} catch (rpc::ex_routing e) {
@@ -144,7 +233,7 @@ void	ows_rpcHandler::hello(rpc::t_hello& _return, const rpc::t_node& target_node
 }
 
 void	ows_rpcHandler::reach_master(rpc::t_route& _return) {
-	std::string*	master_node_name;
+	std::string	master_node_name;
 	p_weighted_gateway* p_wg = NULL;
 
 	if ( this->config->get_param("is_master")->compare("yes") == 0 ) {
@@ -153,14 +242,15 @@ void	ows_rpcHandler::reach_master(rpc::t_route& _return) {
 	} else {
 		master_node_name = this->router->get_master_node();
 
-		if ( master_node_name == NULL ) {
+		if ( master_node_name.empty() == true ) {
 			_return.destination_node.name = "";
 			_return.hops = -1;
 		} else {
-			p_wg = this->router->get_route(master_node_name->c_str());
+			p_wg = this->router->get_route(master_node_name.c_str());
 			if ( p_wg != NULL) {
 				_return.destination_node.name = p_wg->second;
 				_return.hops = p_wg->first;
+				delete p_wg;
 			} else {
 				rpc::ex_routing e;
 				e.msg = "Cannot reach the master node";
@@ -171,7 +261,7 @@ void	ows_rpcHandler::reach_master(rpc::t_route& _return) {
 }
 
 void	ows_rpcHandler::get_current_planning_name(std::string& _return, const rpc::t_routing_data& routing) {
-	std::string*	gateway;
+	std::string	gateway;
 
 	CHECK_ROUTING
 
@@ -189,7 +279,7 @@ void	ows_rpcHandler::get_current_planning_name(std::string& _return, const rpc::
 			if ( this->config->get_param("is_master")->compare("yes") != 0 ) {
 				gateway = this->router->get_gateway(this->config->get_master_node()->c_str());
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+					this->client->open(gateway.c_str());
 					this->client->get_handler()->get_current_planning_name(_return, routing);
 					this->client->close();
 				} catch (rpc::ex_planning e) {
@@ -213,7 +303,7 @@ void	ows_rpcHandler::get_current_planning_name(std::string& _return, const rpc::
 }
 
 void	ows_rpcHandler::get_available_planning_names(std::vector<std::string>& _return, const rpc::t_routing_data& routing) {
-	std::string*	gateway;
+	std::string	gateway;
 
 	CHECK_ROUTING
 
@@ -228,7 +318,7 @@ void	ows_rpcHandler::get_available_planning_names(std::vector<std::string>& _ret
 			if ( this->config->get_param("is_master")->compare("yes") != 0 ) {
 				gateway = this->router->get_gateway(this->config->get_master_node()->c_str());
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+					this->client->open(gateway.c_str());
 					this->client->get_handler()->get_available_planning_names(_return, routing);
 					this->client->close();
 				} catch (rpc::ex_planning e) {
@@ -253,7 +343,7 @@ void	ows_rpcHandler::get_available_planning_names(std::vector<std::string>& _ret
 }
 
 void	ows_rpcHandler::get_planning(rpc::t_planning& _return, const rpc::t_routing_data& routing, const rpc::t_node& node_to_get) {
-	std::string*	gateway;
+	std::string	gateway;
 
 	CHECK_ROUTING
 
@@ -268,7 +358,7 @@ void	ows_rpcHandler::get_planning(rpc::t_planning& _return, const rpc::t_routing
 			if ( this->config->get_param("is_master")->compare("yes") != 0 ) {
 				gateway = this->router->get_gateway(this->config->get_master_node()->c_str());
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+					this->client->open(gateway.c_str());
 					this->client->get_handler()->get_planning(_return, routing, node_to_get);
 					this->client->close();
 				} catch (rpc::ex_planning e) {
@@ -319,7 +409,7 @@ void	ows_rpcHandler::get_planning(rpc::t_planning& _return, const rpc::t_routing
 //}
 
 bool	ows_rpcHandler::add_node(const rpc::t_routing_data& routing, const rpc::t_node& node_to_add) {
-	std::string*	gateway;
+	std::string	gateway;
 	bool		result;
 
 	CHECK_ROUTING
@@ -343,7 +433,7 @@ bool	ows_rpcHandler::add_node(const rpc::t_routing_data& routing, const rpc::t_n
 			if ( this->config->get_param("node_name")->compare(routing.target_node.name) != 0 ) {
 				gateway = this->router->get_gateway(routing.target_node.name);
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+					this->client->open(gateway.c_str());
 					result = this->client->get_handler()->add_node(routing, node_to_add);
 					this->client->close();
 				} catch (rpc::ex_node e) {
@@ -371,7 +461,7 @@ bool	ows_rpcHandler::add_node(const rpc::t_routing_data& routing, const rpc::t_n
 }
 
 bool ows_rpcHandler::remove_node(const rpc::t_routing_data& routing, const rpc::t_node& node_to_remove) {
-	std::string*	gateway;
+	std::string	gateway;
 	bool		result;
 
 	CHECK_ROUTING
@@ -395,7 +485,7 @@ bool ows_rpcHandler::remove_node(const rpc::t_routing_data& routing, const rpc::
 			if ( this->config->get_param("node_name")->compare(routing.target_node.name) != 0 ) {
 				gateway = this->router->get_gateway(routing.target_node.name);
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+					this->client->open(gateway.c_str());
 					result = this->client->get_handler()->remove_node(routing, node_to_remove);
 					this->client->close();
 				} catch (rpc::ex_node e) {
@@ -423,7 +513,7 @@ bool ows_rpcHandler::remove_node(const rpc::t_routing_data& routing, const rpc::
 }
 
 void	ows_rpcHandler::get_node(rpc::t_node& _return, const rpc::t_routing_data& routing, const rpc::t_node& node_to_get) {
-	std::string*	gateway;
+	std::string	gateway;
 
 	CHECK_ROUTING
 
@@ -440,7 +530,7 @@ void	ows_rpcHandler::get_node(rpc::t_node& _return, const rpc::t_routing_data& r
 			if ( this->config->get_param("node_name")->compare(routing.target_node.name) != 0 ) {
 				gateway = this->router->get_gateway(routing.target_node.name);
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+					this->client->open(gateway.c_str());
 					this->client->get_handler()->get_node(_return, routing, node_to_get);
 					this->client->close();
 				} catch (rpc::ex_node e) {
@@ -458,7 +548,7 @@ void	ows_rpcHandler::get_node(rpc::t_node& _return, const rpc::t_routing_data& r
 }
 
 void ows_rpcHandler::get_nodes(rpc::v_nodes& _return, const rpc::t_routing_data& routing) {
-	std::string*	gateway;
+	std::string	gateway;
 
 	CHECK_ROUTING
 
@@ -475,7 +565,7 @@ void ows_rpcHandler::get_nodes(rpc::v_nodes& _return, const rpc::t_routing_data&
 			if ( this->config->get_param("node_name")->compare(routing.target_node.name) != 0 ) {
 				gateway = this->router->get_gateway(routing.target_node.name);
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+					this->client->open(gateway.c_str());
 					this->client->get_handler()->get_nodes(_return, routing);
 					this->client->close();
 				} catch (rpc::ex_node e) {
@@ -493,7 +583,7 @@ void ows_rpcHandler::get_nodes(rpc::v_nodes& _return, const rpc::t_routing_data&
 }
 
 void	ows_rpcHandler::get_jobs(rpc::v_jobs& _return, const rpc::t_routing_data& routing) {
-	std::string*	gateway;
+	std::string	gateway;
 
 	CHECK_ROUTING
 
@@ -510,7 +600,7 @@ void	ows_rpcHandler::get_jobs(rpc::v_jobs& _return, const rpc::t_routing_data& r
 			if ( this->config->get_param("node_name")->compare(routing.target_node.name) != 0 ) {
 				gateway = this->router->get_gateway(routing.target_node.name);
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+					this->client->open(gateway.c_str());
 					this->client->get_handler()->get_jobs(_return, routing);
 					this->client->close();
 				} catch (rpc::ex_job e) {
@@ -537,7 +627,7 @@ void	ows_rpcHandler::get_jobs(rpc::v_jobs& _return, const rpc::t_routing_data& r
 }
 // TODO: check if we need to keep the domain_name argument
 void	ows_rpcHandler::get_ready_jobs(rpc::v_jobs& _return, const rpc::t_routing_data& routing) {
-	std::string*	gateway;
+	std::string	gateway;
 
 	CHECK_ROUTING
 
@@ -554,7 +644,7 @@ void	ows_rpcHandler::get_ready_jobs(rpc::v_jobs& _return, const rpc::t_routing_d
 			if ( this->config->get_param("node_name")->compare(routing.target_node.name) != 0 ) {
 				gateway = this->router->get_gateway(routing.target_node.name);
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+					this->client->open(gateway.c_str());
 					this->client->get_handler()->get_ready_jobs(_return, routing);
 					this->client->close();
 				} catch (rpc::ex_job e) {
@@ -581,7 +671,7 @@ void	ows_rpcHandler::get_ready_jobs(rpc::v_jobs& _return, const rpc::t_routing_d
 }
 
 void	ows_rpcHandler::get_job(rpc::t_job& _return, const rpc::t_routing_data& routing, const rpc::t_job& job_to_get) {
-	std::string*	gateway;
+	std::string	gateway;
 
 	CHECK_ROUTING
 
@@ -599,7 +689,7 @@ void	ows_rpcHandler::get_job(rpc::t_job& _return, const rpc::t_routing_data& rou
 			if ( this->config->get_param("node_name")->compare(routing.target_node.name) != 0 ) {
 				gateway = this->router->get_gateway(routing.target_node.name);
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
+					this->client->open(gateway.c_str());
 					this->client->get_handler()->get_job(_return, routing, job_to_get);
 					this->client->close();
 				} catch (rpc::ex_job e) {
@@ -626,7 +716,8 @@ void	ows_rpcHandler::get_job(rpc::t_job& _return, const rpc::t_routing_data& rou
 }
 
 bool	ows_rpcHandler::add_job(const rpc::t_routing_data& routing, const rpc::t_job& j) {
-	std::string*	gateway = NULL;
+	std::string	gateway;
+	bool		result;
 	rpc::ex_routing	e;
 
 	CHECK_ROUTING
@@ -647,15 +738,16 @@ bool	ows_rpcHandler::add_job(const rpc::t_routing_data& routing, const rpc::t_jo
 			 */
 			if ( this->config->get_param("node_name")->compare(j.node_name) != 0 && this->config->get_master_node()->compare(this->config->get_param("node_name")->c_str()) != 0 ) {
 				gateway = this->router->get_gateway(j.node_name);
-				if ( gateway == NULL ) {
+				if ( gateway.empty() == true ) {
 					e.msg = "The node is not in the routing table";
 					throw e;
 				}
 
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
-					return this->client->get_handler()->add_job(routing, j);
+					this->client->open(gateway.c_str());
+					result = this->client->get_handler()->add_job(routing, j);
 					this->client->close();
+					return result;
 				} catch (rpc::ex_job e) {
 					ERROR << e.msg;
 					this->client->close();
@@ -683,7 +775,8 @@ bool	ows_rpcHandler::add_job(const rpc::t_routing_data& routing, const rpc::t_jo
 }
 
 bool	ows_rpcHandler::update_job(const rpc::t_routing_data& routing, const rpc::t_job& j) {
-	std::string*	gateway = NULL;
+	std::string	gateway;
+	bool		result;
 	rpc::ex_routing	e;
 
 	this->check_routing_args(routing.target_node.domain_name, routing.calling_node);
@@ -699,15 +792,16 @@ bool	ows_rpcHandler::update_job(const rpc::t_routing_data& routing, const rpc::t
 			 */
 			if ( this->config->get_param("node_name")->compare(j.node_name) != 0 ) {
 				gateway = this->router->get_gateway(j.node_name);
-				if ( gateway == NULL ) {
+				if ( gateway.empty() == true ) {
 					e.msg = "The node is not in the routing table";
 					throw e;
 				}
 
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
-					return this->client->get_handler()->update_job(routing, j);
+					this->client->open(gateway.c_str());
+					result = this->client->get_handler()->update_job(routing, j);
 					this->client->close();
+					return result;
 				} catch (rpc::ex_job e) {
 					this->client->close();
 					throw e;
@@ -734,7 +828,8 @@ bool	ows_rpcHandler::update_job(const rpc::t_routing_data& routing, const rpc::t
 }
 
 bool	ows_rpcHandler::remove_job(const rpc::t_routing_data& routing, const rpc::t_job& j) {
-	std::string*	gateway;
+	std::string	gateway;
+	bool		result;
 
 	this->check_routing_args(routing.target_node.domain_name, routing.calling_node);
 	this->check_job_arg(j);
@@ -750,9 +845,10 @@ bool	ows_rpcHandler::remove_job(const rpc::t_routing_data& routing, const rpc::t
 			if ( this->config->get_param("node_name")->compare(j.node_name) != 0 ) {
 				gateway = this->router->get_gateway(j.node_name);
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
-					return this->client->get_handler()->remove_job(routing, j);
+					this->client->open(gateway.c_str());
+					result = this->client->get_handler()->remove_job(routing, j);
 					this->client->close();
+					return result;
 				} catch (rpc::ex_job e) {
 					this->client->close();
 					throw e;
@@ -778,7 +874,8 @@ bool	ows_rpcHandler::remove_job(const rpc::t_routing_data& routing, const rpc::t
 }
 
 bool	ows_rpcHandler::update_job_state(const rpc::t_routing_data& routing, const rpc::t_job& j) {
-	std::string*	gateway;
+	std::string	gateway;
+	bool		result;
 	rpc::ex_routing	e;
 
 	this->check_routing_args(routing.target_node.domain_name, routing.calling_node);
@@ -794,9 +891,10 @@ bool	ows_rpcHandler::update_job_state(const rpc::t_routing_data& routing, const
 			if ( this->config->get_param("node_name")->compare(j.node_name) != 0 ) {
 				gateway = this->router->get_gateway(j.node_name);
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
-					return this->client->get_handler()->update_job_state(routing, j);
+					this->client->open(gateway.c_str());
+					result = this->client->get_handler()->update_job_state(routing, j);
 					this->client->close();
+					return result;
 				} catch (rpc::ex_job e) {
 					this->client->close();
 					throw e;
@@ -821,6 +919,30 @@ bool	ows_rpcHandler::update_job_state(const rpc::t_routing_data& routing, const
 	return false;
 }
 
+void	ows_rpcHandler::add_jobs(rpc::v_job_results& _return, const rpc::t_routing_data& routing, const rpc::v_jobs& jobs) {
+	CHECK_ROUTING
+
+	this->run_job_batch(_return, ADD_JOBS, routing, jobs);
+}
+
+void	ows_rpcHandler::update_jobs(rpc::v_job_results& _return, const rpc::t_routing_data& routing, const rpc::v_jobs& jobs) {
+	CHECK_ROUTING
+
+	this->run_job_batch(_return, UPDATE_JOBS, routing, jobs);
+}
+
+void	ows_rpcHandler::remove_jobs(rpc::v_job_results& _return, const rpc::t_routing_data& routing, const rpc::v_jobs& jobs) {
+	CHECK_ROUTING
+
+	this->run_job_batch(_return, REMOVE_JOBS, routing, jobs);
+}
+
+void	ows_rpcHandler::update_job_states(rpc::v_job_results& _return, const rpc::t_routing_data& routing, const rpc::v_jobs& jobs) {
+	CHECK_ROUTING
+
+	this->run_job_batch(_return, UPDATE_JOB_STATES, routing, jobs);
+}
+
 void	ows_rpcHandler::sql_exec(const std::string& query) {
 	//	std::string*	gateway;
 
@@ -849,7 +971,8 @@ void	ows_rpcHandler::sql_exec(const std::string& query) {
 }
 
 rpc::integer ows_rpcHandler::monitor_failed_jobs(const rpc::t_routing_data& routing) {
-	std::string*	gateway;
+	std::string	gateway;
+	rpc::integer	result;
 
 	CHECK_ROUTING
 
@@ -866,9 +989,10 @@ rpc::integer ows_rpcHandler::monitor_failed_jobs(const rpc::t_routing_data& rout
 			if ( this->config->get_param("node_name")->compare(routing.target_node.name) != 0 ) {
 				gateway = this->router->get_gateway(routing.target_node.name);
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
-					return this->client->get_handler()->monitor_failed_jobs(routing);
+					this->client->open(gateway.c_str());
+					result = this->client->get_handler()->monitor_failed_jobs(routing);
 					this->client->close();
+					return result;
 				} catch (rpc::ex_job e) {
 					this->client->close();
 					throw e;
@@ -894,7 +1018,8 @@ rpc::integer ows_rpcHandler::monitor_failed_jobs(const rpc::t_routing_data& rout
 }
 
 rpc::integer ows_rpcHandler::monitor_waiting_jobs(const rpc::t_routing_data& routing) {
-	std::string*	gateway;
+	std::string	gateway;
+	rpc::integer	result;
 
 	CHECK_ROUTING
 
@@ -911,9 +1036,10 @@ rpc::integer ows_rpcHandler::monitor_waiting_jobs(const rpc::t_routing_data& rou
 			if ( this->config->get_param("node_name")->compare(routing.target_node.name) != 0 ) {
 				gateway = this->router->get_gateway(routing.target_node.name);
 				try {
-					this->client->open(gateway->c_str(), boost::lexical_cast<int>(this->config->get_param("port")->c_str()));
-					return this->client->get_handler()->monitor_waiting_jobs(routing);
+					this->client->open(gateway.c_str());
+					result = this->client->get_handler()->monitor_waiting_jobs(routing);
 					this->client->close();
+					return result;
 				} catch (rpc::ex_job e) {
 					this->client->close();
 					throw e;
@@ -941,7 +1067,7 @@ rpc::integer ows_rpcHandler::monitor_waiting_jobs(const rpc::t_routing_data& rou
 void	ows_rpcHandler::check_master_node(const std::string& calling_node_name, const std::string& target_node_name) {
 	rpc::ex_routing	e;
 
-	if ( this->router->get_master_node()->compare(calling_node_name) != 0 or this->config->get_param("node_name")->compare(target_node_name) != 0 ) {
+	if ( this->router->get_master_node().compare(calling_node_name) != 0 or this->config->get_param("node_name")->compare(target_node_name) != 0 ) {
 		e.msg = calling_node_name;
 		e.msg += " is not the master_node";
 		throw e;
@@ -983,6 +1109,158 @@ void	ows_rpcHandler::check_routing_args(const std::string& domain_name, const rp
 	}
 }
 
+void	ows_rpcHandler::run_job_batch(rpc::v_job_results& _return, const e_job_batch batch, const rpc::t_routing_data& routing, const rpc::v_jobs& jobs) {
+	std::string*		node_name	= this->config->get_param("node_name");
+	bool			is_master	= this->config->get_master_node()->compare(*node_name) == 0;
+	std::string		gateway;
+	std::vector<size_t>	local;
+	m_gateway_jobs		forwarded;
+	rpc::v_jobs		selected;
+	rpc::v_job_results	results;
+
+	this->check_routing_args(routing.target_node.domain_name, routing.calling_node);
+
+	_return.assign(jobs.size(), build_job_result(rpc::e_job_result::DONE, ""));
+
+	switch (this->config->get_running_mode()) {
+		case P2P: {
+			_return.assign(jobs.size(), build_job_result(rpc::e_job_result::FAILED, "the batches are not available in P2P mode"));
+			return;
+		}
+		case ACTIVE: {
+			break;
+		}
+		case PASSIVE: {
+			// Only the master gives jobs to a passive node
+			this->check_master_node(routing.calling_node.name, *node_name);
+			break;
+		}
+	}
+
+	for ( size_t i = 0 ; i < jobs.size() ; i++ ) {
+		const rpc::t_job&	j = jobs[i];
+
+		// The state transitions only give the job's name and node
+		try {
+			if ( batch == UPDATE_JOB_STATES ) {
+				if ( j.name.empty() == true or j.node_name.empty() == true ) {
+					rpc::ex_job e;
+					e.msg = "job_name or node_name is empty";
+					throw e;
+				}
+			} else {
+				this->check_job_arg(j);
+			}
+		} catch (const rpc::ex_job& e) {
+			_return[i] = build_job_result(rpc::e_job_result::INVALID, e.msg);
+			continue;
+		}
+
+		/*
+		 * am I the job's node (or the master adding a job)?
+		 * - yes: apply it
+		 * - no: forward it, unless I am passive
+		 */
+		if ( node_name->compare(j.node_name) == 0 or ( batch == ADD_JOBS and is_master == true ) ) {
+			local.push_back(i);
+			continue;
+		}
+
+		if ( this->config->get_running_mode() == PASSIVE ) {
+			_return[i] = build_job_result(rpc::e_job_result::UNREACHABLE, j.node_name + " is not this node");
+			continue;
+		}
+
+		gateway = this->router->get_gateway(j.node_name);
+		if ( gateway.empty() == true ) {
+			_return[i] = build_job_result(rpc::e_job_result::UNREACHABLE, "The node is not in the routing table");
+			continue;
+		}
+
+		forwarded[gateway].push_back(i);
+	}
+
+	if ( local.empty() == false ) {
+		select_jobs(jobs, local, selected);
+		this->apply_job_batch(results, batch, routing.target_node.domain_name, selected);
+		merge_job_results(results, local, _return);
+	}
+
+	BOOST_FOREACH(const m_gateway_jobs::value_type& g, forwarded) {
+		select_jobs(jobs, g.second, selected);
+		this->forward_job_batch(results, batch, g.first, routing, selected);
+		merge_job_results(results, g.second, _return);
+	}
+}
+
+void	ows_rpcHandler::apply_job_batch(rpc::v_job_results& _return, const e_job_batch batch, const std::string& domain_name, const rpc::v_jobs& jobs) {
+	try {
+		switch (batch) {
+			case ADD_JOBS: {
+				this->domain->add_jobs(domain_name.c_str(), jobs, _return);
+				break;
+			}
+			case UPDATE_JOBS: {
+				this->domain->update_jobs(domain_name.c_str(), jobs, _return);
+				break;
+			}
+			case REMOVE_JOBS: {
+				this->domain->remove_jobs(domain_name.c_str(), jobs, _return);
+				break;
+			}
+			case UPDATE_JOB_STATES: {
+				this->domain->update_job_states(domain_name.c_str(), jobs, _return);
+				break;
+			}
+		}
+	} catch (const rpc::ex_processing& e) {
+		ERROR << e.msg;
+		_return.assign(jobs.size(), build_job_result(rpc::e_job_result::FAILED, e.msg));
+	} catch (const rpc::ex_job& e) {
+		ERROR << e.msg;
+		_return.assign(jobs.size(), build_job_result(rpc::e_job_result::FAILED, e.msg));
+	}
+}
+
+void	ows_rpcHandler::forward_job_batch(rpc::v_job_results& _return, const e_job_batch batch, const std::string& gateway, const rpc::t_routing_data& routing, const rpc::v_jobs& jobs) {
+	try {
+		this->client->open(gateway.c_str());
+
+		switch (batch) {
+			case ADD_JOBS: {
+				this->client->get_handler()->add_jobs(_return, routing, jobs);
+				break;
+			}
+			case UPDATE_JOBS: {
+				this->client->get_handler()->update_jobs(_return, routing, jobs);
+				break;
+			}
+			case REMOVE_JOBS: {
+				this->client->get_handler()->remove_jobs(_return, routing, jobs);
+				break;
+			}
+			case UPDATE_JOB_STATES: {
+				this->client->get_handler()->update_job_states(_return, routing, jobs);
+				break;
+			}
+		}
+
+		this->client->close();
+	} catch (const rpc::ex_routing& e) {
+		ERROR << gateway << ": " << e.msg;
+		this->client->close();
+		_return.assign(jobs.size(), build_job_result(rpc::e_job_result::UNREACHABLE, e.msg));
+	} catch (const rpc::ex_processing& e) {
+		ERROR << gateway << ": " << e.msg;
+		this->client->close();
+		_return.assign(jobs.size(), build_job_result(rpc::e_job_result::FAILED, e.msg));
+	} catch (const apache::thrift::TException& e) {
+		// The connection is dropped by the next open
+		ERROR << gateway << ": " << e.what();
+		_return.assign(jobs.size(), build_job_result(rpc::e_job_result::UNREACHABLE, e.what()));
+	}
+}
+
 void	ows_rpcHandler::check_job_arg(const rpc::t_job job) {
 	rpc::ex_job e;
 
@@ -991,6 +1269,12 @@ void	ows_rpcHandler::check_job_arg(const rpc::t_job job) {
 		throw e;
 	}
 
+	// The name gives the job's log and cgroup paths
+	if ( is_file_name(job.name) == false ) {
+		e.msg = "job_name must not contain '/' nor start with '.'";
+		throw e;
+	}
+
 	if ( job.domain.empty() == true ) {
 		e.msg = "domain_name is empty";
 		throw e;
@@ -0,0 +1,883 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: sql_database.cpp
+ * Description: the storage using an SQL engine (MySQLe or SQLite).
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "sql_database.h"
+
+/*
+ * The types of the columns read by the row handlers, the integers are decoded
+ * by the database layer
+ */
+static	const e_sql_param_type	job_types[]		= { SQL_INTEGER, SQL_STRING, SQL_STRING, SQL_INTEGER, SQL_INTEGER, SQL_STRING, SQL_INTEGER, SQL_INTEGER, SQL_INTEGER, SQL_INTEGER, SQL_INTEGER, SQL_INTEGER, SQL_INTEGER, SQL_INTEGER, SQL_INTEGER, SQL_INTEGER, SQL_STRING };
+static	const e_sql_param_type	node_types[]		= { SQL_INTEGER, SQL_STRING, SQL_INTEGER };
+static	const e_sql_param_type	resource_types[]	= { SQL_STRING, SQL_INTEGER, SQL_INTEGER, SQL_INTEGER };
+static	const e_sql_param_type	job_link_types[]	= { SQL_INTEGER, SQL_INTEGER };
+static	const e_sql_param_type	time_constraint_types[]	= { SQL_INTEGER, SQL_STRING, SQL_INTEGER };
+static	const e_sql_param_type	recovery_type_types[]	= { SQL_INTEGER, SQL_STRING, SQL_STRING, SQL_STRING, SQL_INTEGER };
+static	const e_sql_param_type	macro_job_types[]	= { SQL_INTEGER, SQL_STRING };
+static	const e_sql_param_type	count_types[]		= { SQL_INTEGER };
+static	const e_sql_param_type	name_types[]		= { SQL_INTEGER, SQL_STRING };
+
+#define	SQL_COLUMNS(types)	v_sql_columns(types, types + sizeof(types) / sizeof(types[0]))
+
+static	const v_sql_columns	job_columns		= SQL_COLUMNS(job_types);
+static	const v_sql_columns	node_columns		= SQL_COLUMNS(node_types);
+static	const v_sql_columns	resource_columns	= SQL_COLUMNS(resource_types);
+static	const v_sql_columns	job_link_columns	= SQL_COLUMNS(job_link_types);
+static	const v_sql_columns	time_constraint_columns	= SQL_COLUMNS(time_constraint_types);
+static	const v_sql_columns	recovery_type_columns	= SQL_COLUMNS(recovery_type_types);
+static	const v_sql_columns	macro_job_columns	= SQL_COLUMNS(macro_job_types);
+static	const v_sql_columns	count_columns		= SQL_COLUMNS(count_types);
+static	const v_sql_columns	name_columns		= SQL_COLUMNS(name_types);
+
+/*
+ * store_integer
+ *
+ * Row handler keeping the first cell of a one-column integer result
+ *
+ * @param	_return	the value
+ * @param	cells	the row
+ */
+static	void	store_integer(int64_t* _return, const v_cells& cells) {
+	if ( cells.empty() == false and cells[0].is_null == false )
+		*_return = cells[0].integer;
+}
+
+/*
+ * store_id
+ *
+ * Row handler collecting the first cell of a one-column integer result
+ *
+ * @param	_return	the values
+ * @param	cells	the row
+ */
+static	void	store_id(std::set<int64_t>* _return, const v_cells& cells) {
+	if ( cells.empty() == false and cells[0].is_null == false )
+		_return->insert(cells[0].integer);
+}
+
+/*
+ * fail_job_results
+ *
+ * Marks the jobs of a failed transaction, the rejected ones keep their
+ * result
+ *
+ * @param	_return	the results
+ * @param	msg	why the transaction failed
+ */
+static	void	fail_job_results(rpc::v_job_results& _return, const std::string& msg) {
+	BOOST_FOREACH(rpc::t_job_result& r, _return) {
+		if ( r.code == rpc::e_job_result::DONE )
+			r = build_job_result(rpc::e_job_result::FAILED, msg);
+	}
+}
+
+/*
+ * build_usage_param
+ *
+ * @param	value	a job's usage counter, -1 if it is not measured
+ *
+ * @return	the counter or NULL
+ */
+static	sql_param	build_usage_param(const int64_t value) {
+	return value < 0 ? sql_param() : sql_param(value);
+}
+
+/*
+ * add_filter
+ *
+ * Appends a "column = ?" condition to a query
+ *
+ * @param	query	the query
+ * @param	params	its parameters
+ * @param	column	the column to compare
+ * @param	value	the value, NULL means no condition
+ */
+static	void	add_filter(std::string& query, v_sql_params& params, const char* column, const char* value) {
+	if ( value == NULL )
+		return;
+
+	query += params.empty() == true ? " WHERE " : " AND ";
+	query += column;
+	query += " = ?";
+
+	params.push_back(value);
+}
+
+/*
+ * add_id_filter
+ *
+ * Appends a "column = ?" condition comparing an id to a query
+ *
+ * @param	query	the query
+ * @param	params	its parameters
+ * @param	column	the column to compare
+ * @param	names	the table giving the id
+ * @param	value	the name, NULL means no condition
+ *
+ * @return	false if the name is unknown: the query cannot return anything
+ */
+static	bool	add_id_filter(std::string& query, v_sql_params& params, const char* column, Name_Table* names, const char* value) {
+	int	id;
+
+	if ( value == NULL )
+		return true;
+
+	id = names->find(value);
+
+	if ( id == 0 )
+		return false;
+
+	query += params.empty() == true ? " WHERE " : " AND ";
+	query += column;
+	query += " = ?";
+
+	params.push_back(static_cast<int64_t>(id));
+
+	return true;
+}
+
+/*
+ * store_name
+ *
+ * Row handler registering an id and its name
+ *
+ * @param	names	the table to fill
+ * @param	cells	the row: id and name
+ */
+static	void	store_name(Name_Table* names, const v_cells& cells) {
+	names->insert(static_cast<int>(cells[0].integer), std::string(cells[1].data, cells[1].length));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Sql_Database::Sql_Database(Sql_Connector* c, Name_Table* jobs, Name_Table* nodes) : Database(jobs, nodes) {
+	if ( c == NULL ) {
+		rpc::ex_processing e;
+		e.msg = "The SQL connector is null";
+		throw e;
+	}
+
+	if ( jobs == NULL or nodes == NULL ) {
+		rpc::ex_processing e;
+		e.msg = "The name tables are null";
+		throw e;
+	}
+
+	this->connector = c;
+}
+
+Sql_Database::~Sql_Database() {
+	delete this->connector;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::init_planning(const std::string& planning_name, const std::string& skeleton) {
+	return this->connector->init_domain_structure(planning_name, skeleton);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::planning_exists(const std::string& planning_name) {
+	return this->connector->schema_exists(planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::clone_planning(const std::string& source, const std::string& target) {
+	v_sql_statements	after_copy;
+
+	/*
+	 * The planning is a copy made by the server, the jobs' runtime values
+	 * are reset during the copy
+	 */
+	after_copy.push_back(sql_statement("UPDATE job SET job_state = 'waiting', job_start_time = NULL, job_stop_time = NULL, job_stdout_bytes = NULL, job_stderr_bytes = NULL, job_cpu_usage = NULL, job_memory_peak = NULL, job_io_read_bytes = NULL, job_io_write_bytes = NULL, job_failure = NULL;"));
+
+	return this->connector->clone_schema(source, target, after_copy);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::get_planning_names(std::vector<std::string>& _return) {
+	this->connector->list_schemas(_return);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::load_names(const char* planning_name) {
+	this->query_each_row("SELECT node_id,node_name FROM node;", v_sql_params(), name_columns, boost::bind(&store_name, this->node_names, _1), planning_name);
+	this->query_each_row("SELECT job_id,job_name FROM job;", v_sql_params(), name_columns, boost::bind(&store_name, this->job_names, _1), planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::add_node(const char* planning_name, const std::string& node_name, const rpc::integer weight) {
+	v_sql_params		params;
+	v_sql_statements	statements;
+
+	// The SQLite backend translates INSERT IGNORE
+	params.push_back(static_cast<int64_t>(this->node_names->intern(node_name)));
+	params.push_back(node_name);
+	params.push_back(weight);
+	statements.push_back(sql_statement("INSERT IGNORE INTO node (node_id,node_name,node_weight) VALUES (?,?,?);", params));
+
+	return this->connector->prepared_execute(statements, planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::remove_node(const char* planning_name, const std::string& node_name) {
+	v_sql_statements	statements;
+	int64_t			node_id = this->node_names->find(node_name);
+
+	if ( node_id == 0 )
+		return true;
+
+	statements.push_back(sql_statement("DELETE FROM node WHERE node_id = ?;", v_sql_params(1, node_id)));
+
+	return this->connector->prepared_execute(statements, planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::add_job(const char* planning_name, const rpc::t_job& j) {
+	v_sql_statements	statements;
+	int64_t			nodes	= 0;
+	int64_t			node_id	= this->node_names->find(j.node_name);
+
+	if ( node_id != 0 )
+		this->query_each_row("SELECT COUNT(*) FROM node WHERE node_id = ?;", v_sql_params(1, node_id), count_columns, boost::bind(&store_integer, &nodes, _1), planning_name);
+
+	if ( nodes == 0 ) {
+		rpc::ex_node e;
+		e.msg = "The node ";
+		e.msg += j.node_name;
+		e.msg += " does not exist";
+		throw e;
+	}
+
+	this->add_job_statements(statements, j, node_id);
+
+	// TODO: add recovery types
+
+	return this->connector->prepared_execute(statements, planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::update_job(const char* planning_name, const rpc::t_job& j) {
+	v_sql_statements	statements;
+
+	this->update_job_statements(statements, j);
+
+	return this->connector->prepared_execute(statements, planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::remove_job(const char* planning_name, const std::string& job_name) {
+	v_sql_statements	statements;
+	int64_t			job_id = this->job_names->find(job_name);
+
+	// The id is kept: the other plannings may still use it
+	if ( job_id == 0 )
+		return true;
+
+	this->remove_job_statements(statements, job_id);
+
+	return this->connector->prepared_execute(statements, planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::add_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return) {
+	v_sql_statements	statements;
+	std::set<int64_t>	nodes;
+	int64_t			node_id;
+
+	_return.clear();
+	_return.reserve(jobs.size());
+
+	// The nodes are read once for the whole batch
+	this->query_each_row("SELECT node_id FROM node;", v_sql_params(), count_columns, boost::bind(&store_id, &nodes, _1), planning_name);
+
+	BOOST_FOREACH(const rpc::t_job& j, jobs) {
+		node_id = this->node_names->find(j.node_name);
+
+		if ( node_id == 0 or nodes.find(node_id) == nodes.end() ) {
+			_return.push_back(build_job_result(rpc::e_job_result::UNKNOWN_NODE, "The node " + j.node_name + " does not exist"));
+			continue;
+		}
+
+		this->add_job_statements(statements, j, node_id);
+		_return.push_back(build_job_result(rpc::e_job_result::DONE, ""));
+	}
+
+	return this->execute_job_batch(statements, planning_name, _return);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::update_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return) {
+	v_sql_statements	statements;
+	std::set<int64_t>	known;
+	int64_t			job_id;
+
+	_return.clear();
+	_return.reserve(jobs.size());
+
+	// The jobs are read once for the whole batch
+	this->query_each_row("SELECT job_id FROM job;", v_sql_params(), count_columns, boost::bind(&store_id, &known, _1), planning_name);
+
+	BOOST_FOREACH(const rpc::t_job& j, jobs) {
+		job_id = this->job_names->find(j.name);
+
+		if ( job_id == 0 or known.find(job_id) == known.end() ) {
+			_return.push_back(build_job_result(rpc::e_job_result::UNKNOWN_JOB, "The job " + j.name + " does not exist"));
+			continue;
+		}
+
+		this->update_job_statements(statements, j);
+		_return.push_back(build_job_result(rpc::e_job_result::DONE, ""));
+	}
+
+	return this->execute_job_batch(statements, planning_name, _return);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::remove_jobs(const char* planning_name, const rpc::v_jobs& jobs, rpc::v_job_results& _return) {
+	v_sql_statements	statements;
+	std::set<int64_t>	known;
+	int64_t			job_id;
+
+	_return.clear();
+	_return.reserve(jobs.size());
+
+	this->query_each_row("SELECT job_id FROM job;", v_sql_params(), count_columns, boost::bind(&store_id, &known, _1), planning_name);
+
+	BOOST_FOREACH(const rpc::t_job& j, jobs) {
+		job_id = this->job_names->find(j.name);
+
+		// A job given twice is removed once
+		if ( job_id == 0 or known.erase(job_id) == 0 ) {
+			_return.push_back(build_job_result(rpc::e_job_result::UNKNOWN_JOB, "The job " + j.name + " does not exist"));
+			continue;
+		}
+
+		this->remove_job_statements(statements, job_id);
+		_return.push_back(build_job_result(rpc::e_job_result::DONE, ""));
+	}
+
+	return this->execute_job_batch(statements, planning_name, _return);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::update_job_states(const d_job_state_updates& batch) {
+	std::map<std::string, v_sql_statements>	statements;
+	v_sql_params				params;
+
+	BOOST_FOREACH(const job_state_update& update, batch) {
+		params.clear();
+		params.push_back(build_string_from_job_state(update.state));
+
+		if ( update.has_usage == true ) {
+			params.push_back(static_cast<int64_t>(update.start_time));
+			params.push_back(static_cast<int64_t>(update.stop_time));
+			params.push_back(build_usage_param(update.usage.stdout_bytes));
+			params.push_back(build_usage_param(update.usage.stderr_bytes));
+			params.push_back(build_usage_param(update.usage.cpu_usage));
+			params.push_back(build_usage_param(update.usage.memory_peak));
+			params.push_back(build_usage_param(update.usage.io_read_bytes));
+			params.push_back(build_usage_param(update.usage.io_write_bytes));
+			params.push_back(update.usage.failure < 0 ? sql_param() : sql_param(build_string_from_job_failure(static_cast<rpc::e_job_failure::type>(update.usage.failure))));
+			params.push_back(static_cast<int64_t>(update.job_id));
+			statements[update.domain_name].push_back(sql_statement("UPDATE job SET job_state = ?, job_start_time = FROM_UNIXTIME(?), job_stop_time = FROM_UNIXTIME(?), job_stdout_bytes = ?, job_stderr_bytes = ?, job_cpu_usage = ?, job_memory_peak = ?, job_io_read_bytes = ?, job_io_write_bytes = ?, job_failure = ? WHERE job_id = ?;", params));
+		} else if ( update.has_times == true ) {
+			params.push_back(static_cast<int64_t>(update.start_time));
+			params.push_back(static_cast<int64_t>(update.stop_time));
+			params.push_back(static_cast<int64_t>(update.job_id));
+			statements[update.domain_name].push_back(sql_statement("UPDATE job SET job_state = ?, job_start_time = FROM_UNIXTIME(?), job_stop_time = FROM_UNIXTIME(?) WHERE job_id = ?;", params));
+		} else {
+			params.push_back(static_cast<int64_t>(update.job_id));
+			statements[update.domain_name].push_back(sql_statement("UPDATE job SET job_state = ? WHERE job_id = ?;", params));
+		}
+	}
+
+	for ( std::map<std::string, v_sql_statements>::const_iterator it = statements.begin() ; it != statements.end() ; ++it ) {
+		if ( this->connector->prepared_execute(it->second, it->first.c_str()) == false )
+			return false;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::add_resource(const char* planning_name, const rpc::t_resource& r, const char* node_name) {
+	v_sql_params		params;
+	v_sql_statements	statements;
+	int64_t			node_id = this->node_names->find(node_name);
+
+	if ( node_id == 0 ) {
+		ERROR << "add_resource:: the node " << node_name << " does not exist";
+		return false;
+	}
+
+	params.push_back(r.name);
+	params.push_back(node_id);
+	params.push_back(r.current_value);
+	params.push_back(r.initial_value);
+	statements.push_back(sql_statement("INSERT INTO resource (resource_name,resource_node_id,resource_current_value,resource_initial_value) VALUES (?,?,?,?);", params));
+
+	return this->connector->prepared_execute(statements, planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::get_nodes(const char* planning_name, rpc::v_nodes& _return, const char* node_name) {
+	std::string	query("SELECT node_id,node_name,node_weight FROM node");
+	v_sql_params	params;
+
+	if ( add_id_filter(query, params, "node_id", this->node_names, node_name) == false )
+		return;
+	query += ";";
+
+	this->query_each_row(query, params, node_columns, boost::bind(&Sql_Database::decode_node, this, &_return, _1), planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::get_jobs(const char* planning_name, rpc::v_jobs& _return, const char* node_name, const char* job_name) {
+	std::string	query("SELECT job_id,job_name,job_cmd_line,job_node_id,job_weight,job_state,job_rectype_id, unix_timestamp(job_start_time), unix_timestamp(job_stop_time), job_stdout_bytes, job_stderr_bytes, job_cpu_usage, job_memory_peak, job_io_read_bytes, job_io_write_bytes, job_timeout, job_failure FROM job");
+	v_sql_params	params;
+
+	if ( add_id_filter(query, params, "job_node_id", this->node_names, node_name) == false )
+		return;
+	if ( add_id_filter(query, params, "job_id", this->job_names, job_name) == false )
+		return;
+	query += ";";
+
+	// The rows are decoded straight into the output
+	this->query_each_row(query, params, job_columns, boost::bind(&Sql_Database::decode_job, this, &_return, _1), planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::get_ready_jobs(const char* planning_name, rpc::v_jobs& _return, const char* node_name) {
+	std::string	query("SELECT job_id,job_name,job_cmd_line,job_node_id,job_weight,job_state,job_rectype_id FROM get_ready_job");
+	v_sql_params	params;
+
+	if ( add_id_filter(query, params, "job_node_id", this->node_names, node_name) == false )
+		return;
+	query += ";";
+
+	this->query_each_row(query, params, job_columns, boost::bind(&Sql_Database::decode_job, this, &_return, _1), planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::get_jobs_links(const char* planning_name, m_jobs_links& _return, const char* node_name, const char* job_name) {
+	std::string	query("SELECT l.job_id_prv,l.job_id_nxt FROM jobs_link l");
+	v_sql_params	params;
+
+	if ( node_name != NULL )
+		query += " JOIN job j ON j.job_id = l.job_id_prv";
+
+	if ( add_id_filter(query, params, "j.job_node_id", this->node_names, node_name) == false )
+		return;
+	if ( add_id_filter(query, params, "l.job_id_prv", this->job_names, job_name) == false )
+		return;
+	query += ";";
+
+	this->query_each_row(query, params, job_link_columns, boost::bind(&Sql_Database::decode_job_link, this, &_return, _1), planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::get_time_constraints(const char* planning_name, m_time_constraints& _return, const char* node_name, const char* job_name) {
+	std::string	query("SELECT t.time_c_job_id,t.time_c_type,TIME_TO_SEC(t.time_c_value) FROM time_constraint t");
+	v_sql_params	params;
+
+	if ( node_name != NULL )
+		query += " JOIN job j ON j.job_id = t.time_c_job_id";
+
+	if ( add_id_filter(query, params, "j.job_node_id", this->node_names, node_name) == false )
+		return;
+	if ( add_id_filter(query, params, "t.time_c_job_id", this->job_names, job_name) == false )
+		return;
+	query += ";";
+
+	this->query_each_row(query, params, time_constraint_columns, boost::bind(&Sql_Database::decode_time_constraint, this, &_return, _1), planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::get_resources(const char* planning_name, m_resources& _return, const char* node_name) {
+	std::string	query("SELECT resource_name,resource_node_id,resource_current_value,resource_initial_value FROM resource");
+	v_sql_params	params;
+
+	if ( add_id_filter(query, params, "resource_node_id", this->node_names, node_name) == false )
+		return;
+	query += ";";
+
+	this->query_each_row(query, params, resource_columns, boost::bind(&Sql_Database::decode_resource, this, &_return, _1), planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::get_recovery_types(const char* planning_name, m_recovery_types& _return) {
+	this->query_each_row("SELECT rectype_id,rectype_short_label,rectype_label,rectype_action,rectype_timeout FROM recovery_type;", v_sql_params(), recovery_type_columns, boost::bind(&Sql_Database::decode_recovery_type, this, &_return, _1), planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::get_macro_jobs(const char* planning_name, rpc::v_macro_jobs& _return) {
+	this->query_each_row("SELECT macro_id,macro_name FROM macro_job;", v_sql_params(), macro_job_columns, boost::bind(&Sql_Database::decode_macro_job, this, &_return, _1), planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int64_t	Sql_Database::count_jobs_in_state(const char* planning_name, const rpc::e_job_state::type state) {
+	int64_t	result = 0;
+
+	this->query_each_row("SELECT COUNT(*) FROM job WHERE job_state = ?;", v_sql_params(1, build_string_from_job_state(state)), count_columns, boost::bind(&store_integer, &result, _1), planning_name);
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int64_t	Sql_Database::count_node_jobs(const char* planning_name, const char* node_name) {
+	int64_t	result	= 0;
+	int64_t	node_id	= this->node_names->find(node_name);
+
+	if ( node_id == 0 )
+		return 0;
+
+	this->query_each_row("SELECT COUNT(*) FROM job WHERE job_node_id = ?;", v_sql_params(1, node_id), count_columns, boost::bind(&store_integer, &result, _1), planning_name);
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::sql_exec(const char* planning_name, const std::string& query) {
+	v_v_row	result;
+
+	return this->connector->query_full_result(result, query.c_str(), planning_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+uint64_t	Sql_Database::get_queries_count() {
+	return this->connector->get_queries_count();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::query_each_row(const std::string& query, const v_sql_params& params, const v_sql_columns& columns, const row_handler& handler, const char* planning_name) {
+	bool	result = false;
+
+	// The queries without parameters are not cached by the connectors
+	if ( params.empty() == true )
+		result = this->connector->query_each_row(query.c_str(), columns, handler, planning_name);
+	else
+		result = this->connector->prepared_query_each_row(query, params, columns, handler, planning_name);
+
+	if ( result == false ) {
+		rpc::ex_job	e;
+		e.msg = "The query failed";
+		throw e;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Sql_Database::execute_job_batch(const v_sql_statements& statements, const char* planning_name, rpc::v_job_results& _return) {
+	std::string	msg = "The transaction failed";
+
+	if ( statements.empty() == true )
+		return true;
+
+	try {
+		if ( this->connector->prepared_execute(statements, planning_name) == true )
+			return true;
+	} catch (const rpc::ex_processing& e) {
+		msg = e.msg;
+	}
+
+	fail_job_results(_return, msg);
+
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::add_job_statements(v_sql_statements& _return, const rpc::t_job& j, const int64_t node_id) {
+	v_sql_params	params;
+	int64_t		job_id = this->job_names->intern(j.name);
+
+	params.push_back(job_id);
+	params.push_back(j.name);
+	params.push_back(j.cmd_line);
+	params.push_back(node_id);
+	params.push_back(j.weight);
+	params.push_back(j.__isset.timeout == true and j.timeout > 0 ? sql_param(j.timeout) : sql_param());
+	_return.push_back(sql_statement("INSERT INTO job (job_id,job_name,job_cmd_line,job_node_id,job_weight,job_timeout) VALUES (?,?,?,?,?,?);", params));
+
+	BOOST_FOREACH(const std::string& i, j.prv) {
+		params.clear();
+		params.push_back(static_cast<int64_t>(this->job_names->intern(i)));
+		params.push_back(job_id);
+		_return.push_back(sql_statement("INSERT INTO jobs_link (job_id_prv,job_id_nxt) VALUES (?,?);", params));
+	}
+
+	BOOST_FOREACH(const std::string& i, j.nxt) {
+		params.clear();
+		params.push_back(static_cast<int64_t>(this->job_names->intern(i)));
+		params.push_back(job_id);
+		_return.push_back(sql_statement("INSERT INTO jobs_link (job_id_nxt,job_id_prv) VALUES (?,?);", params));
+	}
+
+	BOOST_FOREACH(const rpc::t_time_constraint& tc, j.time_constraints) {
+		params.clear();
+		params.push_back(job_id);
+		params.push_back(build_string_from_time_constraint_type(tc.type));
+		params.push_back(tc.value);
+		_return.push_back(sql_statement("INSERT INTO time_constraint (time_c_job_id, time_c_type, time_c_value) VALUES (?,?,SEC_TO_TIME(?));", params));
+	}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::update_job_statements(v_sql_statements& _return, const rpc::t_job& j) {
+	v_sql_params	params;
+	int64_t		job_id	= this->job_names->intern(j.name);
+	int64_t		node_id	= this->node_names->intern(j.node_name);
+
+	params.push_back(job_id);
+	params.push_back(j.name);
+	params.push_back(j.cmd_line);
+	params.push_back(node_id);
+	params.push_back(j.weight);
+	params.push_back(j.__isset.timeout == true and j.timeout > 0 ? sql_param(j.timeout) : sql_param());
+	_return.push_back(sql_statement("REPLACE INTO job (job_id,job_name,job_cmd_line,job_node_id,job_weight,job_timeout) VALUES (?,?,?,?,?,?);", params));
+
+	_return.push_back(sql_statement("DELETE FROM jobs_link WHERE job_id_nxt = ?;", v_sql_params(1, job_id)));
+
+	BOOST_FOREACH(const std::string& i, j.prv) {
+		params.clear();
+		params.push_back(static_cast<int64_t>(this->job_names->intern(i)));
+		params.push_back(job_id);
+		_return.push_back(sql_statement("REPLACE INTO jobs_link (job_id_prv,job_id_nxt) VALUES (?,?);", params));
+	}
+
+	_return.push_back(sql_statement("DELETE FROM jobs_link WHERE job_id_prv = ?;", v_sql_params(1, job_id)));
+
+	BOOST_FOREACH(const std::string& i, j.nxt) {
+		params.clear();
+		params.push_back(static_cast<int64_t>(this->job_names->intern(i)));
+		params.push_back(job_id);
+		_return.push_back(sql_statement("REPLACE INTO jobs_link (job_id_nxt,job_id_prv) VALUES (?,?);", params));
+	}
+
+	_return.push_back(sql_statement("DELETE FROM time_constraint WHERE time_c_job_id = ?;", v_sql_params(1, job_id)));
+
+	BOOST_FOREACH(const rpc::t_time_constraint& tc, j.time_constraints) {
+		params.clear();
+		params.push_back(job_id);
+		params.push_back(build_string_from_time_constraint_type(tc.type));
+		params.push_back(tc.value);
+		_return.push_back(sql_statement("REPLACE INTO time_constraint (time_c_job_id, time_c_type, time_c_value) VALUES (?,?,SEC_TO_TIME(?));", params));
+	}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::remove_job_statements(v_sql_statements& _return, const int64_t job_id) {
+	v_sql_params	params;
+
+	_return.push_back(sql_statement("DELETE FROM job WHERE job_id = ?;", v_sql_params(1, job_id)));
+
+	params.push_back(job_id);
+	params.push_back(job_id);
+	_return.push_back(sql_statement("DELETE FROM jobs_link WHERE job_id_nxt = ? OR job_id_prv = ?;", params));
+
+	_return.push_back(sql_statement("DELETE FROM time_constraint WHERE time_c_job_id = ?;", v_sql_params(1, job_id)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::decode_job(rpc::v_jobs* _return, const v_cells& cells) {
+	_return->push_back(rpc::t_job());
+
+	rpc::t_job&	job = _return->back();
+
+	job.name.assign(cells[1].data, cells[1].length);
+	job.cmd_line.assign(cells[2].data, cells[2].length);
+	job.weight	= static_cast<rpc::integer>(cells[4].integer);
+
+	// The node is given by its id: no join is needed
+	if ( this->node_names->get_name(job.node_name, static_cast<int>(cells[3].integer)) == false )
+		WARN << "the node " << cells[3].integer << " of the job " << job.name << " is unknown";
+
+	// job_state defaults to waiting
+	if ( cells[5].is_null == true )
+		job.state	= rpc::e_job_state::WAITING;
+	else
+		job.state	= build_job_state_from_string(cells[5].data, cells[5].length);
+
+	// 0 means "no recovery type", the ids start at 1
+	if ( cells[6].is_null == false )
+		job.recovery_type.id	= static_cast<rpc::integer>(cells[6].integer);
+
+	if ( cells.size() > 8 ) {
+		if ( cells[7].is_null == false )
+			job.start_time	= cells[7].integer;
+		if ( cells[8].is_null == false )
+			job.stop_time	= cells[8].integer;
+	}
+
+	// The usage is only known once the job has run
+	if ( cells.size() > 14 ) {
+		if ( cells[9].is_null == false )
+			job.__set_stdout_bytes(cells[9].integer);
+		if ( cells[10].is_null == false )
+			job.__set_stderr_bytes(cells[10].integer);
+		if ( cells[11].is_null == false )
+			job.__set_cpu_usage(cells[11].integer);
+		if ( cells[12].is_null == false )
+			job.__set_memory_peak(cells[12].integer);
+		if ( cells[13].is_null == false )
+			job.__set_io_read_bytes(cells[13].integer);
+		if ( cells[14].is_null == false )
+			job.__set_io_write_bytes(cells[14].integer);
+	}
+
+	if ( cells.size() > 16 ) {
+		if ( cells[15].is_null == false )
+			job.__set_timeout(cells[15].integer);
+		if ( cells[16].is_null == false )
+			job.__set_failure(build_job_failure_from_string(cells[16].data, cells[16].length));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::decode_node(rpc::v_nodes* _return, const v_cells& cells) {
+	_return->push_back(rpc::t_node());
+
+	rpc::t_node&	node = _return->back();
+
+	node.name.assign(cells[1].data, cells[1].length);
+	node.weight	= static_cast<rpc::integer>(cells[2].integer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::decode_resource(m_resources* _return, const v_cells& cells) {
+	std::string	node_name;
+
+	if ( this->node_names->get_name(node_name, static_cast<int>(cells[1].integer)) == false ) {
+		WARN << "the node " << cells[1].integer << " of a resource is unknown";
+		return;
+	}
+
+	rpc::v_resources&	resources = (*_return)[node_name];
+
+	resources.push_back(rpc::t_resource());
+
+	rpc::t_resource&	resource = resources.back();
+
+	resource.name.assign(cells[0].data, cells[0].length);
+	resource.current_value	= static_cast<rpc::integer>(cells[2].integer);
+	resource.initial_value	= static_cast<rpc::integer>(cells[3].integer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::decode_job_link(m_jobs_links* _return, const v_cells& cells) {
+	std::string	previous;
+	std::string	next;
+
+	if ( this->job_names->get_name(previous, static_cast<int>(cells[0].integer)) == false or this->job_names->get_name(next, static_cast<int>(cells[1].integer)) == false ) {
+		WARN << "the link " << cells[0].integer << " -> " << cells[1].integer << " uses an unknown job";
+		return;
+	}
+
+	(*_return)[previous].push_back(next);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::decode_time_constraint(m_time_constraints* _return, const v_cells& cells) {
+	std::string	job_name;
+
+	if ( this->job_names->get_name(job_name, static_cast<int>(cells[0].integer)) == false ) {
+		WARN << "the job " << cells[0].integer << " of a time constraint is unknown";
+		return;
+	}
+
+	rpc::v_time_constraints&	time_constraints = (*_return)[job_name];
+
+	time_constraints.push_back(rpc::t_time_constraint());
+
+	rpc::t_time_constraint&	time_constraint = time_constraints.back();
+
+	time_constraint.job_name	= job_name;
+	time_constraint.type		= build_time_constraint_type_from_string(cells[1].data, cells[1].length);
+	time_constraint.value		= cells[2].integer;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::decode_recovery_type(m_recovery_types* _return, const v_cells& cells) {
+	rpc::t_recovery_type&	recovery = (*_return)[static_cast<int>(cells[0].integer)];
+
+	recovery.id	= static_cast<rpc::integer>(cells[0].integer);
+	recovery.short_label.assign(cells[1].data, cells[1].length);
+	recovery.label.assign(cells[2].data, cells[2].length);
+	recovery.action	= build_rectype_action_from_string(cells[3].data, cells[3].length);
+
+	if ( cells.size() > 4 and cells[4].is_null == false )
+		recovery.__set_timeout(cells[4].integer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Sql_Database::decode_macro_job(rpc::v_macro_jobs* _return, const v_cells& cells) {
+	_return->push_back(rpc::t_macro_job());
+
+	rpc::t_macro_job&	macro_job = _return->back();
+
+	macro_job.id	= static_cast<rpc::integer>(cells[0].integer);
+	macro_job.name.assign(cells[1].data, cells[1].length);
+}
@@ -0,0 +1,638 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: supervisor.cpp
+ * Description: spawns the jobs and waits for them from a single thread.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#include "supervisor.h"
+
+Supervisor::Supervisor(Domain* d, Config* c) : job_logs(c), job_cgroups(c), output(SUPERVISOR_OUTPUT_BUFFER) {
+	struct rlimit	limit;
+
+	if ( d == NULL ) {
+		rpc::ex_processing e;
+		e.msg = "Supervisor: the domain cannot be NULL";
+		throw e;
+	}
+
+	this->domain		= d;
+	this->woken		= false;
+	this->stopping		= false;
+	this->direct_exec	= c->get_param("job_direct_exec") == NULL or c->get_param("job_direct_exec")->compare("no") != 0;
+	this->default_timeout	= c->get_integer_param("job_timeout", 0);
+	this->kill_grace	= c->get_integer_param("job_kill_grace", 10);
+	this->origin		= time(NULL);
+
+	// Each running job uses four descriptors
+	if ( getrlimit(RLIMIT_NOFILE, &limit) == 0 and limit.rlim_cur < limit.rlim_max ) {
+		limit.rlim_cur = limit.rlim_max;
+
+		if ( setrlimit(RLIMIT_NOFILE, &limit) != 0 )
+			ERROR << "cannot raise the opened files' limit: " << strerror(errno);
+	}
+
+#ifdef __linux__
+	struct epoll_event	event;
+
+	this->epoll_fd	= epoll_create1(EPOLL_CLOEXEC);
+	this->event_fd	= eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+	// The pids are the events' keys, 0 is the wake-up
+	event.events	= EPOLLIN;
+	event.data.u64	= 0;
+
+	if ( this->epoll_fd < 0 or this->event_fd < 0 or epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, this->event_fd, &event) != 0 ) {
+		rpc::ex_processing e;
+		e.msg = "Supervisor: cannot create the event descriptors: ";
+		e.msg += strerror(errno);
+		throw e;
+	}
+#endif // __linux__
+
+	this->thread = new boost::thread(boost::bind(&Supervisor::supervise, this));
+}
+
+Supervisor::~Supervisor() {
+	supervisor_metrics	metrics;
+
+	this->mutex.lock();
+	this->stopping = true;
+	this->notify();
+	this->mutex.unlock();
+
+	this->thread->join();
+	delete this->thread;
+
+#ifdef __linux__
+	close(this->event_fd);
+	close(this->epoll_fd);
+#endif // __linux__
+
+	this->get_metrics(metrics);
+
+	INFO << "supervisor: " << metrics.spawned << " jobs spawned (" << metrics.direct << " without shell, " << metrics.spawn_failures << " failures), " << metrics.exited << " exited (" << metrics.timed_out << " timed out), user time " << metrics.total_user_time / 1000 << " ms, system time " << metrics.total_system_time / 1000 << " ms";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Supervisor::spawn(const Job& j, const boost::function<void ()>& on_exit) {
+	supervised_job			child;
+	wheel_timer			timer;
+	int64_t				timeout;
+	int64_t				next_expiry;
+	pid_t				pid;
+	int				result;
+	int				stdout_pipe[2];
+	int				stderr_pipe[2];
+	int				cgroup_fd = -1;
+	const bool			direct = this->direct_exec == true and j.is_direct() == true;
+
+	child.job		= *j.get_job();
+	child.job_id		= j.get_id();
+	child.node_id		= j.get_node_id();
+	child.pidfd		= -1;
+	child.stdout_fd		= -1;
+	child.stderr_fd		= -1;
+	child.deadline		= -1;
+	child.timed_out		= false;
+	child.on_exit		= on_exit;
+	child.job.start_time	= time(NULL);
+	timeout			= this->get_timeout(child.job);
+
+	// The failure of a previous run is forgotten
+	child.job.__isset.failure	= false;
+
+	if ( this->open_pipe(stdout_pipe) == false ) {
+		this->mutex.lock();
+		this->counters.spawn_failures++;
+		this->mutex.unlock();
+		return false;
+	}
+
+	if ( this->open_pipe(stderr_pipe) == false ) {
+		close(stdout_pipe[0]);
+		close(stdout_pipe[1]);
+		this->mutex.lock();
+		this->counters.spawn_failures++;
+		this->mutex.unlock();
+		return false;
+	}
+
+	child.log.reset(this->job_logs.open(child.job.domain, child.job.name));
+
+	// The job runs without limits rather than not at all
+	if ( this->job_cgroups.create(child.cgroup, child.job) == true and ( cgroup_fd = this->job_cgroups.attach(child.cgroup) ) < 0 ) {
+		this->job_cgroups.remove(child.cgroup);
+		child.cgroup.clear();
+	}
+
+	// The outputs are logged
+	result = j.spawn(pid, stdout_pipe[1], stderr_pipe[1], direct, cgroup_fd);
+
+	// Nothing has run when the spawn fails: the job is spawned again
+	// outside of its leaf
+	if ( result != 0 and cgroup_fd >= 0 ) {
+		WARN << "cannot spawn the job " << child.job.name << " into " << child.cgroup << ": " << strerror(result) << ", spawning it without cgroup";
+		this->job_cgroups.remove(child.cgroup);
+		child.cgroup.clear();
+		result = j.spawn(pid, stdout_pipe[1], stderr_pipe[1], direct, -1);
+	}
+
+	if ( cgroup_fd >= 0 )
+		close(cgroup_fd);
+
+	// The children hold the write ends
+	close(stdout_pipe[1]);
+	close(stderr_pipe[1]);
+
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	if ( result != 0 ) {
+		ERROR << "cannot spawn the job " << child.job.name << ": " << strerror(result);
+		close(stdout_pipe[0]);
+		close(stderr_pipe[0]);
+		this->counters.spawn_failures++;
+		return false;
+	}
+
+	DEBUG << "job " << child.job.name << " spawned, pid " << pid;
+
+	child.stdout_fd	= stdout_pipe[0];
+	child.stderr_fd	= stderr_pipe[0];
+
+	this->counters.spawned++;
+	this->counters.running++;
+
+	if ( direct == true )
+		this->counters.direct++;
+
+	// The loop may be waiting for a later deadline
+	if ( timeout > 0 ) {
+		timer.expiry	= child.job.start_time - this->origin + timeout;
+		timer.job_id	= pid;
+		timer.open	= true;
+		child.deadline	= timer.expiry;
+
+		if ( this->timeouts.get_next_expiry(next_expiry) == false or timer.expiry < next_expiry )
+			this->notify();
+
+		this->timeouts.schedule(timer);
+	}
+
+#ifdef __linux__
+	struct epoll_event	event;
+
+	// A pipe which cannot be polled is closed: the job must not block on it
+	event.events	= EPOLLIN;
+	event.data.u64	= SUPERVISOR_KEY(pid, JOB_STDOUT);
+
+	if ( epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, child.stdout_fd, &event) != 0 ) {
+		ERROR << "cannot poll the output of the job " << child.job.name << ": " << strerror(errno);
+		close(child.stdout_fd);
+		child.stdout_fd = -1;
+	}
+
+	event.data.u64	= SUPERVISOR_KEY(pid, JOB_STDERR);
+
+	if ( epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, child.stderr_fd, &event) != 0 ) {
+		ERROR << "cannot poll the errors of the job " << child.job.name << ": " << strerror(errno);
+		close(child.stderr_fd);
+		child.stderr_fd = -1;
+	}
+
+	// The child cannot be reaped before its insertion: the loop waits for the lock
+	child.pidfd = syscall(SYS_pidfd_open, pid, 0);
+
+	if ( child.pidfd >= 0 ) {
+		event.events	= EPOLLIN;
+		event.data.u64	= pid;
+
+		if ( epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, child.pidfd, &event) == 0 ) {
+			this->children[pid] = child;
+			return true;
+		}
+
+		ERROR << "cannot poll the job " << child.job.name << ": " << strerror(errno);
+		close(child.pidfd);
+		child.pidfd = -1;
+	}
+#endif // __linux__
+
+	this->children[pid] = child;
+	this->swept.push_back(pid);
+	this->notify();
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Supervisor::get_metrics(supervisor_metrics& _return) {
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	_return = this->counters;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Supervisor::supervise() {
+	std::vector<pid_t>	exited;
+	std::vector<pid_t>	swept;
+	std::vector<uint64_t>	outputs;
+	int64_t			expiry;
+	int			timeout;
+
+	while ( true ) {
+		this->mutex.lock();
+
+		// The running jobs are waited for
+		if ( this->stopping == true and this->children.empty() == true ) {
+			this->mutex.unlock();
+			return;
+		}
+
+		timeout	= this->swept.empty() == true ? -1 : SUPERVISOR_SWEEP_INTERVAL;
+		swept	= this->swept;
+
+		// The deadlines are checked to the second, a far one wakes us up on the way
+		if ( this->timeouts.get_next_expiry(expiry) == true ) {
+			expiry = std::min<int64_t>(std::max<int64_t>(this->origin + expiry - time(NULL), 0) * 1000, INT_MAX);
+
+			if ( timeout < 0 or expiry < timeout )
+				timeout = static_cast<int>(expiry);
+		}
+
+		this->mutex.unlock();
+
+		exited.clear();
+		outputs.clear();
+		this->wait_for_events(exited, outputs, timeout);
+
+		// The outputs are read before the exits: the keys stay valid
+		BOOST_FOREACH(const uint64_t key, outputs) {
+			this->drain(key, false);
+		}
+
+		BOOST_FOREACH(const pid_t pid, exited) {
+			this->reap(pid);
+		}
+
+		BOOST_FOREACH(const pid_t pid, swept) {
+			this->reap(pid);
+		}
+
+		this->expire();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Supervisor::wait_for_events(std::vector<pid_t>& _return, std::vector<uint64_t>& outputs, const int timeout) {
+#ifdef __linux__
+	struct epoll_event	events[SUPERVISOR_EVENTS];
+	uint64_t		value;
+	int			count;
+
+	count = epoll_wait(this->epoll_fd, events, SUPERVISOR_EVENTS, timeout);
+
+	if ( count < 0 ) {
+		if ( errno != EINTR )
+			ERROR << "epoll_wait failed: " << strerror(errno);
+		return;
+	}
+
+	for ( int i = 0 ; i < count ; i++ ) {
+		if ( events[i].data.u64 == 0 ) {
+			if ( read(this->event_fd, &value, sizeof(value)) < 0 and errno != EAGAIN )
+				ERROR << "cannot read the supervisor's wake-ups: " << strerror(errno);
+			continue;
+		}
+
+		if ( events[i].data.u64 >> 32 == 0 )
+			_return.push_back(static_cast<pid_t>(events[i].data.u64));
+		else
+			outputs.push_back(events[i].data.u64);
+	}
+#else
+	boost::unique_lock<boost::mutex>	lock(this->mutex);
+
+	if ( this->woken == false ) {
+		if ( timeout < 0 )
+			this->wake_up.wait(lock);
+		else
+			this->wake_up.timed_wait(lock, boost::posix_time::milliseconds(timeout));
+	}
+
+	this->woken = false;
+
+	// Without poller the pipes are read at each sweep
+	BOOST_FOREACH(const m_supervised_jobs::value_type& child, this->children) {
+		if ( child.second.stdout_fd >= 0 )
+			outputs.push_back(SUPERVISOR_KEY(child.first, JOB_STDOUT));
+		if ( child.second.stderr_fd >= 0 )
+			outputs.push_back(SUPERVISOR_KEY(child.first, JOB_STDERR));
+	}
+#endif // __linux__
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Supervisor::open_pipe(int fds[2]) {
+	int	flags;
+
+#ifdef __linux__
+	if ( pipe2(fds, O_CLOEXEC) != 0 ) {
+#else
+	if ( pipe(fds) != 0 ) {
+#endif // __linux__
+		ERROR << "cannot create a job's pipe: " << strerror(errno);
+		return false;
+	}
+
+	// The write end is given to the child by dup2 only
+	flags = fcntl(fds[0], F_GETFL);
+
+	if ( flags < 0 or fcntl(fds[0], F_SETFL, flags | O_NONBLOCK) != 0 or fcntl(fds[0], F_SETFD, FD_CLOEXEC) != 0 or fcntl(fds[1], F_SETFD, FD_CLOEXEC) != 0 ) {
+		ERROR << "cannot set up a job's pipe: " << strerror(errno);
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Supervisor::drain(const uint64_t key, const bool all) {
+	m_supervised_jobs::iterator	it;
+	boost::shared_ptr<Job_Log>	log;
+	pid_t				pid	= static_cast<pid_t>(key & 0xffffffff);
+	e_job_log_stream		stream	= static_cast<e_job_log_stream>(key >> 32);
+	int				fd;
+
+	this->mutex.lock();
+
+	it = this->children.find(pid);
+
+	if ( it == this->children.end() ) {
+		this->mutex.unlock();
+		return;
+	}
+
+	fd	= stream == JOB_STDOUT ? it->second.stdout_fd : it->second.stderr_fd;
+	log	= it->second.log;
+
+	this->mutex.unlock();
+
+	// Only this thread reads and closes the pipes
+	if ( fd < 0 or this->read_output(fd, stream, log.get(), all) == true )
+		return;
+
+	this->mutex.lock();
+
+	it = this->children.find(pid);
+
+	if ( it != this->children.end() ) {
+		if ( stream == JOB_STDOUT )
+			it->second.stdout_fd = -1;
+		else
+			it->second.stderr_fd = -1;
+	}
+
+	this->mutex.unlock();
+
+	// Closing the pipe removes it from the poller
+	close(fd);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Supervisor::read_output(const int fd, const e_job_log_stream stream, Job_Log* log, const bool all) {
+	ssize_t	length;
+
+	do {
+		length = read(fd, &this->output[0], this->output.size());
+
+		if ( length > 0 ) {
+			if ( log != NULL )
+				log->write(stream, &this->output[0], length);
+			continue;
+		}
+
+		if ( length == 0 )
+			return false;
+
+		if ( errno == EAGAIN or errno == EWOULDBLOCK )
+			return true;
+
+		if ( errno != EINTR ) {
+			ERROR << "cannot read a job's output: " << strerror(errno);
+			return false;
+		}
+	} while ( all == true );
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Supervisor::notify() {
+#ifdef __linux__
+	uint64_t	value = 1;
+
+	if ( write(this->event_fd, &value, sizeof(value)) < 0 and errno != EAGAIN )
+		ERROR << "cannot wake the supervisor up: " << strerror(errno);
+#else
+	this->woken = true;
+	this->wake_up.notify_one();
+#endif // __linux__
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int64_t	Supervisor::get_timeout(const rpc::t_job& j) const {
+	if ( j.__isset.timeout == true and j.timeout > 0 )
+		return j.timeout;
+
+	if ( j.recovery_type.__isset.timeout == true and j.recovery_type.timeout > 0 )
+		return j.recovery_type.timeout;
+
+	return this->default_timeout;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Supervisor::expire() {
+	m_supervised_jobs::iterator	it;
+	v_wheel_timers			timers;
+	wheel_timer			kill_timer;
+
+	boost::lock_guard<boost::mutex>	lock(this->mutex);
+
+	this->timeouts.advance(time(NULL) - this->origin, timers);
+
+	BOOST_FOREACH(const wheel_timer& t, timers) {
+		it = this->children.find(t.job_id);
+
+		// The timers of the reaped jobs are dropped: the deadline tells a
+		// reused pid
+		if ( it == this->children.end() or it->second.deadline != t.expiry )
+			continue;
+
+		supervised_job&	child = it->second;
+
+		if ( t.open == true ) {
+			WARN << "job " << child.job.name << " (pid " << t.job_id << ") timed out, sending SIGTERM";
+
+			child.timed_out	= true;
+			this->counters.timed_out++;
+
+			kill_timer.expiry	= t.expiry + this->kill_grace;
+			kill_timer.job_id	= t.job_id;
+			kill_timer.open		= false;
+			child.deadline		= kill_timer.expiry;
+
+			this->timeouts.schedule(kill_timer);
+		} else {
+			WARN << "job " << child.job.name << " (pid " << t.job_id << ") still running " << this->kill_grace << " s after SIGTERM, sending SIGKILL";
+
+			child.deadline	= -1;
+		}
+
+		// The whole process group: the shell's children too
+		if ( kill(-t.job_id, t.open == true ? SIGTERM : SIGKILL) != 0 and errno != ESRCH )
+			ERROR << "cannot signal the job " << child.job.name << ": " << strerror(errno);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Supervisor::reap(const pid_t pid) {
+	m_supervised_jobs::iterator	it;
+	supervised_job			child;
+	struct rusage			usage;
+	int				status;
+	pid_t				result;
+	time_t				start_time;
+	time_t				stop_time;
+	rpc::e_job_state::type		state;
+
+	result = wait4(pid, &status, WNOHANG, &usage);
+
+	if ( result == 0 )
+		return false;
+
+	if ( result < 0 ) {
+		ERROR << "cannot wait for the pid " << pid << ": " << strerror(errno);
+		memset(&usage, 0, sizeof(usage));
+		status = -1;
+	}
+
+	this->mutex.lock();
+
+	it = this->children.find(pid);
+
+	if ( it == this->children.end() ) {
+		this->mutex.unlock();
+		return true;
+	}
+
+	child = it->second;
+	this->children.erase(it);
+
+	if ( child.pidfd < 0 )
+		this->swept.erase(std::remove(this->swept.begin(), this->swept.end(), pid), this->swept.end());
+
+	this->counters.exited++;
+	this->counters.running--;
+	this->counters.total_user_time		+= usage.ru_utime.tv_sec * 1000000 + usage.ru_utime.tv_usec;
+	this->counters.total_system_time	+= usage.ru_stime.tv_sec * 1000000 + usage.ru_stime.tv_usec;
+
+	this->mutex.unlock();
+
+	// Closing the pidfd removes it from the poller
+	if ( child.pidfd >= 0 )
+		close(child.pidfd);
+
+	// The outputs left in the pipes are logged, the pipes may still be
+	// held by the job's own children
+	if ( child.stdout_fd >= 0 ) {
+		this->read_output(child.stdout_fd, JOB_STDOUT, child.log.get(), true);
+		close(child.stdout_fd);
+	}
+
+	if ( child.stderr_fd >= 0 ) {
+		this->read_output(child.stderr_fd, JOB_STDERR, child.log.get(), true);
+		close(child.stderr_fd);
+	}
+
+	if ( child.log ) {
+		child.job.__set_stdout_bytes(child.log->get_stdout_bytes());
+		child.job.__set_stderr_bytes(child.log->get_stderr_bytes());
+	}
+
+	// The leaf also counts the processes started by the job
+	if ( result > 0 )
+		build_usage_from_rusage(usage, child.job);
+
+	if ( child.cgroup.empty() == false ) {
+		this->job_cgroups.collect(child.cgroup, child.job);
+		this->job_cgroups.remove(child.cgroup);
+	}
+
+	start_time	= child.job.start_time;
+	stop_time	= time(NULL);
+
+	if ( status >= 0 and WIFEXITED(status) )
+		child.job.return_code = WEXITSTATUS(status);
+	else if ( status >= 0 and WIFSIGNALED(status) )
+		child.job.return_code = 128 + WTERMSIG(status);
+	else
+		child.job.return_code = 1;
+
+	// A job ending after its SIGTERM fails whatever its code
+	if ( child.timed_out == true )
+		child.job.__set_failure(rpc::e_job_failure::TIMEOUT);
+	else if ( child.job.return_code != 0 )
+		child.job.__set_failure(rpc::e_job_failure::RETURN_CODE);
+
+	state = child.job.__isset.failure == true ? rpc::e_job_state::FAILED : rpc::e_job_state::SUCCEDED;
+
+	INFO << "job " << child.job.name << " returned code " << child.job.return_code << " after " << stop_time - start_time << " s (user " << usage.ru_utime.tv_sec * 1000 + usage.ru_utime.tv_usec / 1000 << " ms, system " << usage.ru_stime.tv_sec * 1000 + usage.ru_stime.tv_usec / 1000 << " ms, max rss " << usage.ru_maxrss << " kB, output " << child.job.stdout_bytes << " bytes, errors " << child.job.stderr_bytes << " bytes)";
+
+	Job	job(this->domain, child.job);
+
+	job.set_id(child.job_id);
+	job.set_node_id(child.node_id);
+
+	if ( this->domain->update_job_state(child.job.domain.c_str(), &job, state, start_time, stop_time) == false )
+		ERROR << "cannot update the state of the job " << child.job.name;
+
+	if ( child.on_exit )
+		child.on_exit();
+
+	return true;
+}
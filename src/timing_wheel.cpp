@@ -0,0 +1,178 @@
+/**
+ * Project: OWS: an Open Source Workload Scheduler
+ * File name: timing_wheel.cpp
+ * Description: the timers of the jobs' time constraints.
+ *
+ * @author Mathieu Grzybek on 2010-05-16
+ * @copyright 2010 Mathieu Grzybek. All rights reserved.
+ * @version $Id: code-gpl-license.txt,v 1.2 2004/05/04 13:19:30 garry Exp $
+ *
+ * @see The GNU Public License (GPL) version 3 or higher
+ *
+ *
+ * OWS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#include "timing_wheel.h"
+
+Timing_Wheel::Timing_Wheel() {
+	this->reset(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Timing_Wheel::reset(const int64_t now) {
+	for ( int level = 0 ; level < TIMING_WHEEL_LEVELS ; level++ )
+		for ( int slot = 0 ; slot < TIMING_WHEEL_SLOTS ; slot++ )
+			this->slots[level][slot].clear();
+
+	this->overdue.clear();
+	this->current	= now;
+	this->count	= 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Timing_Wheel::schedule(const wheel_timer& timer) {
+	this->count++;
+
+	if ( timer.expiry <= this->current ) {
+		this->overdue.push_back(timer);
+		return;
+	}
+
+	this->place(timer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Timing_Wheel::advance(const int64_t now, v_wheel_timers& _return) {
+	int	level;
+
+	if ( now < this->current )
+		return;
+
+	if ( this->overdue.empty() == false ) {
+		_return.insert(_return.end(), this->overdue.begin(), this->overdue.end());
+		this->count -= this->overdue.size();
+		this->overdue.clear();
+	}
+
+	while ( this->current < now ) {
+		// Nothing to wait for: the wheel jumps to the end
+		if ( this->count == 0 ) {
+			this->current = now;
+			break;
+		}
+
+		this->current++;
+
+		// The upper levels are emptied when the lower ones wrap
+		for ( level = 1 ; level < TIMING_WHEEL_LEVELS ; level++ ) {
+			if ( ( this->current & ( ( (int64_t)1 << ( TIMING_WHEEL_BITS * level ) ) - 1 ) ) != 0 )
+				break;
+		}
+
+		for ( level-- ; level > 0 ; level-- )
+			this->cascade(level);
+
+		v_wheel_timers&	slot = this->slots[0][this->current & TIMING_WHEEL_MASK];
+
+		if ( slot.empty() == true )
+			continue;
+
+		_return.insert(_return.end(), slot.begin(), slot.end());
+		this->count -= slot.size();
+		slot.clear();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool	Timing_Wheel::get_next_expiry(int64_t& _return) const {
+	int64_t	position;
+	bool	found = false;
+
+	if ( this->count == 0 )
+		return false;
+
+	if ( this->overdue.empty() == false ) {
+		_return = this->current;
+		return true;
+	}
+
+	// The first non-empty slot of each level, the lowest levels are nearer
+	for ( int level = 0 ; level < TIMING_WHEEL_LEVELS ; level++ ) {
+		position = this->current >> ( TIMING_WHEEL_BITS * level );
+
+		for ( int i = 1 ; i <= TIMING_WHEEL_SLOTS ; i++ ) {
+			if ( this->slots[level][( position + i ) & TIMING_WHEEL_MASK].empty() == true )
+				continue;
+
+			if ( found == false or ( ( position + i ) << ( TIMING_WHEEL_BITS * level ) ) < _return )
+				_return = ( position + i ) << ( TIMING_WHEEL_BITS * level );
+
+			found = true;
+			break;
+		}
+	}
+
+	return found;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int64_t	Timing_Wheel::get_current_time() const {
+	return this->current;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t	Timing_Wheel::size() const {
+	return this->count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Timing_Wheel::place(const wheel_timer& timer) {
+	int64_t	delta = timer.expiry - this->current;
+	int	level;
+
+	for ( level = 0 ; level < TIMING_WHEEL_LEVELS - 1 ; level++ ) {
+		if ( delta < ( (int64_t)1 << ( TIMING_WHEEL_BITS * ( level + 1 ) ) ) )
+			break;
+	}
+
+	// The farthest timers wait in the last slot of the top level
+	if ( level == TIMING_WHEEL_LEVELS - 1 and delta >= ( (int64_t)1 << ( TIMING_WHEEL_BITS * TIMING_WHEEL_LEVELS ) ) ) {
+		this->slots[level][( ( this->current >> ( TIMING_WHEEL_BITS * level ) ) - 1 ) & TIMING_WHEEL_MASK].push_back(timer);
+		return;
+	}
+
+	this->slots[level][( timer.expiry >> ( TIMING_WHEEL_BITS * level ) ) & TIMING_WHEEL_MASK].push_back(timer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void	Timing_Wheel::cascade(const int level) {
+	v_wheel_timers	timers;
+
+	timers.swap(this->slots[level][( this->current >> ( TIMING_WHEEL_BITS * level ) ) & TIMING_WHEEL_MASK]);
+
+	BOOST_FOREACH(const wheel_timer& t, timers) {
+		this->place(t);
+	}
+}